@@ -17,6 +17,9 @@
 #pragma once
 
 #include <string>
+#include <memory>
+#include <atomic>
+#include <exception>
 #include <coroutine>
 
 #define VK_USE_PLATFORM_WIN32_KHR
@@ -63,31 +66,31 @@ namespace Dfl {
         class BitFlag {
             unsigned int flag{ 0 };
         public:
-            BitFlag() {}
+            constexpr BitFlag() {}
             template< Bitable N >
-            BitFlag(N num) { this->flag = static_cast<unsigned int>(num); }
+            constexpr BitFlag(N num) { this->flag = static_cast<unsigned int>(num); }
 
             // assignment
 
             template< Bitable N >
-            BitFlag& operator= (const N num) { this->flag = static_cast<unsigned int>(num); return *this; }
+            constexpr BitFlag& operator= (const N num) { this->flag = static_cast<unsigned int>(num); return *this; }
             template< Bitable N >
-            BitFlag& operator|= (const N num) { this->flag |= static_cast<unsigned int>(num); return *this; }
+            constexpr BitFlag& operator|= (const N num) { this->flag |= static_cast<unsigned int>(num); return *this; }
             template< Bitable N >
-            BitFlag& operator&= (const N num) { this->flag &= static_cast<unsigned int>(num); return *this; }
+            constexpr BitFlag& operator&= (const N num) { this->flag &= static_cast<unsigned int>(num); return *this; }
 
             // bitwise
 
             template< Bitable N >
-            BitFlag       operator| (const N num) const { return BitFlag(this->flag | static_cast<unsigned int>(num)); }
+            constexpr BitFlag       operator| (const N num) const { return BitFlag(this->flag | static_cast<unsigned int>(num)); }
             template< Bitable N >
-            BitFlag       operator& (const N num) const { return BitFlag(this->flag & static_cast<unsigned int>(num)); }
+            constexpr BitFlag       operator& (const N num) const { return BitFlag(this->flag & static_cast<unsigned int>(num)); }
 
             // conversions
 
-            operator unsigned int() { return this->flag; }
+            constexpr operator unsigned int() const { return this->flag; }
 
-            const unsigned int GetValue() const { return this->flag; }
+            constexpr const unsigned int GetValue() const { return this->flag; }
         };
 
         template< typename T, uint32_t NodeNumber >
@@ -160,7 +163,7 @@ namespace Dfl {
                 std::suspend_never initial_suspend() noexcept { return std::suspend_never(); };
                 std::suspend_never final_suspend() noexcept { this->pJobObject->State = Job::RoutineState::Done; return std::suspend_never(); };
                 void               return_value(T expr) { this->pJobObject->State = Job::RoutineState::Done; this->pJobObject->Value = expr; };
-                void               unhandled_exception() {};
+                void               unhandled_exception() { this->pJobObject->pException = std::current_exception(); };
 
             private:
                 std::coroutine_handle<Promise>  PromiseHandle{ nullptr };
@@ -175,28 +178,43 @@ namespace Dfl {
                 Done
             };
 
+            // A job can wait either on a fence (GPU work) or on a flag
+            // raised by another CPU thread (e.g. a worker)
             struct Awaitable {
-                VkDevice hGPU{ nullptr };
-                VkFence  hFence{ nullptr };
+                VkDevice                                 hGPU{ nullptr };
+                VkFence                                  hFence{ nullptr };
+                std::shared_ptr<const std::atomic_bool>  pFlag{ nullptr };
 
                 Awaitable() : hGPU(nullptr), hFence(nullptr) {}
                 Awaitable(VkDevice device, VkFence fence) : hGPU(device), hFence(fence) {}
+                Awaitable(std::shared_ptr<const std::atomic_bool> flag) : pFlag(flag) {}
             };
 
+            // Suspends the job once if the fence or flag isn't ready yet. A
+            // resumed job isn't told whether it became ready in the meantime, so
+            // the wait has to be a loop that checks it again.
             struct Awaiter {
                 Awaiter(Awaitable awaitable) : Wait(awaitable) {}
 
-                bool await_ready() { return vkGetFenceStatus(this->Wait.hGPU, this->Wait.hFence) == VK_SUCCESS; };
-                bool await_suspend(std::coroutine_handle<promise_type> promiseHandle) { return vkGetFenceStatus(this->Wait.hGPU, this->Wait.hFence) == VK_SUCCESS; };
+                bool await_ready() { return this->IsReady(); };
+                bool await_suspend(std::coroutine_handle<promise_type> promiseHandle) { return !this->IsReady(); };
                 void await_resume() { };
 
             private:
                 Awaitable Wait{ nullptr };
+
+                bool IsReady() { return this->Wait.pFlag != nullptr 
+                                        ? this->Wait.pFlag->load()
+                                        : vkGetFenceStatus(this->Wait.hGPU, this->Wait.hFence) == VK_SUCCESS; }
             };
 
             ~Job() { this->Stop(); }
 
-            Job& Resume() { if (this->State == RoutineState::InProgress) { this->PromiseHandle.resume(); } return *this; }
+            // An exception the job didn't catch ends it, and is rethrown to
+            // whoever resumes it or takes its value
+            Job& Resume() { if (this->State == RoutineState::InProgress) { this->PromiseHandle.resume(); } 
+                            if (this->pException != nullptr) { std::rethrow_exception(this->pException); }
+                            return *this; }
             Job& Stop() { if (this->State == RoutineState::InProgress) { this->PromiseHandle.destroy(); } return *this; }
             operator T () { this->Resume(); return this->Value; }
 
@@ -205,6 +223,7 @@ namespace Dfl {
             std::coroutine_handle<promise_type> PromiseHandle{ nullptr };
             T                                   Value;
             RoutineState                        State{ RoutineState::InProgress };
+            std::exception_ptr                  pException{ nullptr };
 
             Job(std::coroutine_handle<promise_type> promiseHandle) : PromiseHandle(promiseHandle) { this->PromiseHandle.promise().pJobObject = this; }
         };
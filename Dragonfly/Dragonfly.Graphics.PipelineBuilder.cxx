@@ -0,0 +1,754 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Dragonfly.Graphics.PipelineBuilder.hxx"
+
+#include <vector>
+#include <fstream>
+#include <cstring>
+
+namespace DflHW = Dfl::Hardware;
+namespace DflGr = Dfl::Graphics;
+
+// Internal for PipelineBuilder constructor
+
+static DflGr::PipelineBuilder::CacheHeader INT_GetCacheHeader(const VkPhysicalDevice& hPhysDevice)
+{
+    VkPhysicalDeviceIDProperties idProps{
+        .sType{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES },
+        .pNext{ nullptr }
+    };
+    VkPhysicalDeviceProperties2 props{
+        .sType{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 },
+        .pNext{ &idProps }
+    };
+    vkGetPhysicalDeviceProperties2(hPhysDevice, &props);
+
+    DflGr::PipelineBuilder::CacheHeader header{
+        .VendorID{ props.properties.vendorID },
+        .DeviceID{ props.properties.deviceID },
+        .DriverVersion{ props.properties.driverVersion }
+    };
+    std::memcpy(header.DeviceUUID.data(), idProps.deviceUUID, VK_UUID_SIZE);
+    std::memcpy(header.CacheUUID.data(), props.properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    return header;
+}
+
+// Reads the cache data of a file, as long as the header of the file
+// matches the device's. Otherwise, nothing is returned and the
+// cache starts cold.
+static std::vector<char> INT_ReadCache(
+    const std::filesystem::path&               path,
+    const DflGr::PipelineBuilder::CacheHeader& expected)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return { };
+    }
+
+    DflGr::PipelineBuilder::CacheHeader header{ };
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        return { };
+    }
+
+    if ( header.Magic != expected.Magic
+         || header.HeaderVersion != expected.HeaderVersion
+         || header.VendorID != expected.VendorID
+         || header.DeviceID != expected.DeviceID
+         || header.DriverVersion != expected.DriverVersion
+         || header.DeviceUUID != expected.DeviceUUID
+         || header.CacheUUID != expected.CacheUUID )
+    {
+        return { };
+    }
+
+    // a truncated or corrupt file could claim any size, so it has to be
+    // exactly what's left of the file
+    const std::streampos dataStart{ file.tellg() };
+    file.seekg(0, std::ios::end);
+    const std::streampos fileEnd{ file.tellg() };
+    if ( dataStart < 0
+         || fileEnd < dataStart
+         || static_cast<uint64_t>(fileEnd - dataStart) != header.DataSize )
+    {
+        return { };
+    }
+    file.seekg(dataStart);
+
+    std::vector<char> data(header.DataSize);
+    if (!file.read(data.data(), header.DataSize))
+    {
+        return { };
+    }
+
+    return data;
+}
+
+static DflGr::PipelineBuilder::Handles INT_GetHandles(
+    const VkDevice&                            hGPU,
+    const std::filesystem::path&               cachePath,
+    const DflGr::PipelineBuilder::CacheHeader& header)
+{
+    const std::vector<char> data{ INT_ReadCache(cachePath, header) };
+
+    const VkPipelineCacheCreateInfo cacheInfo{
+        .sType{ VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .initialDataSize{ data.size() },
+        .pInitialData{ data.empty() ? nullptr : data.data() }
+    };
+
+    VkPipelineCache cache{ nullptr };
+    if ( vkCreatePipelineCache(
+            hGPU,
+            &cacheInfo,
+            nullptr,
+            &cache) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create pipeline cache",
+                L"INT_GetHandles");
+    }
+
+    const VkPipelineLayoutCreateInfo layoutInfo{
+        .sType{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .setLayoutCount{ 0 },
+        .pSetLayouts{ nullptr },
+        .pushConstantRangeCount{ 0 },
+        .pPushConstantRanges{ nullptr }
+    };
+
+    VkPipelineLayout layout{ nullptr };
+    if ( vkCreatePipelineLayout(
+            hGPU,
+            &layoutInfo,
+            nullptr,
+            &layout) != VK_SUCCESS )
+    {
+        vkDestroyPipelineCache(
+            hGPU,
+            cache,
+            nullptr);
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create empty pipeline layout",
+                L"INT_GetHandles");
+    }
+
+    return { cache, layout, !data.empty() };
+}
+
+// Internal for Build
+
+static inline uint64_t INT_HashBytes(
+          uint64_t hash,
+    const void*    pData,
+    const uint64_t size) noexcept
+{
+    // FNV-1a
+    const auto* pBytes{ static_cast<const uint8_t*>(pData) };
+    for (uint64_t i{ 0 }; i < size; i++)
+    {
+        hash ^= pBytes[i];
+        hash *= 0x100000001b3;
+    }
+
+    return hash;
+}
+
+template< typename T >
+static inline uint64_t INT_HashValue(
+          uint64_t hash,
+    const T&       value) noexcept
+{
+    return INT_HashBytes(hash, &value, sizeof(T));
+}
+
+static VkPipeline INT_GetPipeline(
+    const VkDevice&                       hGPU,
+    const VkPipelineCache&                hCache,
+    const VkPipelineLayout&               hLayout,
+    const VkShaderModule&                 hVertexModule,
+    const VkShaderModule&                 hFragmentModule,
+    const DflGr::PipelineBuilder::State&  state)
+{
+    // every feature bit is given explicitly, so a variant never depends
+    // on the default value written in the shader. Constant IDs the shader
+    // doesn't declare are ignored.
+    std::array<VkSpecializationMapEntry, DflGr::PipelineBuilder::MaxFeatures> featureEntries{ };
+    std::array<VkBool32, DflGr::PipelineBuilder::MaxFeatures>                 featureValues{ };
+    for (uint32_t i{ 0 }; i < DflGr::PipelineBuilder::MaxFeatures; i++)
+    {
+        featureEntries[i] = {
+            .constantID{ i },
+            .offset{ static_cast<uint32_t>(i * sizeof(VkBool32)) },
+            .size{ sizeof(VkBool32) } };
+        featureValues[i] = (state.Features.GetValue() & (1u << i)) != 0 ? VK_TRUE : VK_FALSE;
+    }
+    const VkSpecializationInfo specializationInfo{
+        .mapEntryCount{ static_cast<uint32_t>(featureEntries.size()) },
+        .pMapEntries{ featureEntries.data() },
+        .dataSize{ featureValues.size() * sizeof(VkBool32) },
+        .pData{ featureValues.data() }
+    };
+
+    const std::array<VkPipelineShaderStageCreateInfo, 2> stages{ {
+        {
+            .sType{ VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .stage{ VK_SHADER_STAGE_VERTEX_BIT },
+            .module{ hVertexModule },
+            .pName{ "main" },
+            .pSpecializationInfo{ &specializationInfo }
+        },
+        {
+            .sType{ VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .stage{ VK_SHADER_STAGE_FRAGMENT_BIT },
+            .module{ hFragmentModule },
+            .pName{ "main" },
+            .pSpecializationInfo{ &specializationInfo }
+        } } };
+
+    const VkPipelineVertexInputStateCreateInfo vertexInfo{
+        .sType{ VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .vertexBindingDescriptionCount{ static_cast<uint32_t>(state.VertexBindings.size()) },
+        .pVertexBindingDescriptions{ state.VertexBindings.data() },
+        .vertexAttributeDescriptionCount{ static_cast<uint32_t>(state.VertexAttributes.size()) },
+        .pVertexAttributeDescriptions{ state.VertexAttributes.data() }
+    };
+
+    const VkPipelineInputAssemblyStateCreateInfo assemblyInfo{
+        .sType{ VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .topology{ state.Topology },
+        .primitiveRestartEnable{ VK_FALSE }
+    };
+
+    // viewport and scissor are dynamic, so that a window resize
+    // doesn't invalidate the pipeline
+    const VkPipelineViewportStateCreateInfo viewportInfo{
+        .sType{ VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .viewportCount{ 1 },
+        .pViewports{ nullptr },
+        .scissorCount{ 1 },
+        .pScissors{ nullptr }
+    };
+
+    const VkPipelineRasterizationStateCreateInfo rasterInfo{
+        .sType{ VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .depthClampEnable{ VK_FALSE },
+        .rasterizerDiscardEnable{ VK_FALSE },
+        .polygonMode{ state.PolygonMode },
+        .cullMode{ state.CullMode },
+        .frontFace{ state.FrontFace },
+        .depthBiasEnable{ VK_FALSE },
+        .lineWidth{ 1.0f }
+    };
+
+    const VkPipelineMultisampleStateCreateInfo multisampleInfo{
+        .sType{ VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .rasterizationSamples{ static_cast<VkSampleCountFlagBits>(state.Samples) },
+        .sampleShadingEnable{ VK_FALSE }
+    };
+
+    const bool hasDepth{ state.DepthFormat != VK_FORMAT_UNDEFINED };
+    const VkPipelineDepthStencilStateCreateInfo depthInfo{
+        .sType{ VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .depthTestEnable{ hasDepth ? VK_TRUE : VK_FALSE },
+        .depthWriteEnable{ hasDepth ? VK_TRUE : VK_FALSE },
+        .depthCompareOp{ VK_COMPARE_OP_LESS_OR_EQUAL },
+        .depthBoundsTestEnable{ VK_FALSE },
+        .stencilTestEnable{ VK_FALSE }
+    };
+
+    const VkPipelineColorBlendAttachmentState blendAttachment{
+        .blendEnable{ state.DoBlend ? VK_TRUE : VK_FALSE },
+        .srcColorBlendFactor{ VK_BLEND_FACTOR_SRC_ALPHA },
+        .dstColorBlendFactor{ VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA },
+        .colorBlendOp{ VK_BLEND_OP_ADD },
+        .srcAlphaBlendFactor{ VK_BLEND_FACTOR_ONE },
+        .dstAlphaBlendFactor{ VK_BLEND_FACTOR_ZERO },
+        .alphaBlendOp{ VK_BLEND_OP_ADD },
+        .colorWriteMask{ VK_COLOR_COMPONENT_R_BIT |
+                         VK_COLOR_COMPONENT_G_BIT |
+                         VK_COLOR_COMPONENT_B_BIT |
+                         VK_COLOR_COMPONENT_A_BIT }
+    };
+    const VkPipelineColorBlendStateCreateInfo blendInfo{
+        .sType{ VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .logicOpEnable{ VK_FALSE },
+        .attachmentCount{ 1 },
+        .pAttachments{ &blendAttachment }
+    };
+
+    constexpr std::array<VkDynamicState, 2> dynamicStates{
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+    const VkPipelineDynamicStateCreateInfo dynamicInfo{
+        .sType{ VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .dynamicStateCount{ static_cast<uint32_t>(dynamicStates.size()) },
+        .pDynamicStates{ dynamicStates.data() }
+    };
+
+    // pipelines are built against attachment formats, instead of a render pass
+    const VkPipelineRenderingCreateInfo renderingInfo{
+        .sType{ VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO },
+        .pNext{ nullptr },
+        .viewMask{ 0 },
+        .colorAttachmentCount{ 1 },
+        .pColorAttachmentFormats{ &state.ColourFormat },
+        .depthAttachmentFormat{ state.DepthFormat },
+        .stencilAttachmentFormat{ VK_FORMAT_UNDEFINED }
+    };
+
+    const VkGraphicsPipelineCreateInfo pipelineInfo{
+        .sType{ VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO },
+        .pNext{ &renderingInfo },
+        .flags{ 0 },
+        .stageCount{ static_cast<uint32_t>(stages.size()) },
+        .pStages{ stages.data() },
+        .pVertexInputState{ &vertexInfo },
+        .pInputAssemblyState{ &assemblyInfo },
+        .pTessellationState{ nullptr },
+        .pViewportState{ &viewportInfo },
+        .pRasterizationState{ &rasterInfo },
+        .pMultisampleState{ &multisampleInfo },
+        .pDepthStencilState{ &depthInfo },
+        .pColorBlendState{ &blendInfo },
+        .pDynamicState{ &dynamicInfo },
+        .layout{ hLayout },
+        .renderPass{ nullptr },
+        .subpass{ 0 },
+        .basePipelineHandle{ nullptr },
+        .basePipelineIndex{ -1 }
+    };
+
+    VkPipeline pipeline{ nullptr };
+    if ( vkCreateGraphicsPipelines(
+            hGPU,
+            hCache,
+            1,
+            &pipelineInfo,
+            nullptr,
+            &pipeline) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create graphics pipeline",
+                L"INT_GetPipeline");
+    }
+
+    return pipeline;
+}
+
+//
+
+DflGr::PipelineBuilder::PipelineBuilder(const Info& info)
+: pInfo( new Info(info) ),
+  Header( INT_GetCacheHeader(info.Device.GetPhysicalDevice()) ),
+  Cache( INT_GetHandles(
+            info.Device.GetDevice(),
+            info.CachePath,
+            this->Header) ),
+  pTracker( new Tracker() ) 
+{
+    uint32_t workersNumber{ info.WorkersNumber };
+    if (workersNumber == 0)
+    {
+        workersNumber = std::thread::hardware_concurrency() > 1
+                        ? std::thread::hardware_concurrency() - 1
+                        : 1;
+    }
+
+    for (uint32_t i{ 0 }; i < workersNumber; i++)
+    {
+        this->pTracker->Workers.emplace_back(
+            [this](std::stop_token stopToken) { this->Work(stopToken); });
+    }
+}
+
+DflGr::PipelineBuilder::~PipelineBuilder()
+{
+    const VkDevice& device{ this->pInfo->Device.GetDevice() };
+
+    // workers must be done before their pipelines are destroyed
+    for (auto& worker : this->pTracker->Workers)
+    {
+        worker.request_stop();
+    }
+    this->pTracker->RequestAdded.notify_all();
+    this->pTracker->Workers.clear();
+
+    vkDeviceWaitIdle(device);
+
+    this->SaveCache();
+
+    for (auto& [hash, pipeline] : this->pTracker->Pipelines)
+    {
+        vkDestroyPipeline(
+            device,
+            pipeline,
+            nullptr);
+    }
+
+    for (auto& [path, module] : this->pTracker->Shaders)
+    {
+        vkDestroyShaderModule(
+            device,
+            module,
+            nullptr);
+    }
+
+    vkDestroyPipelineLayout(
+        device,
+        this->Cache.hEmptyLayout,
+        nullptr);
+
+    vkDestroyPipelineCache(
+        device,
+        this->Cache.hCache,
+        nullptr);
+}
+
+VkShaderModule DflGr::PipelineBuilder::LoadShader(const std::filesystem::path& path)
+{
+    // expects the tracker to be already locked
+    if ( auto module{ this->pTracker->Shaders.find(path.wstring()) };
+         module != this->pTracker->Shaders.end() )
+    {
+        return module->second;
+    }
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        throw Dfl::Error::NoData(
+                L"Unable to open shader file",
+                L"PipelineBuilder::LoadShader",
+                Dfl::API::None);
+    }
+
+    // SPIR-V is made of 32-bit words
+    std::vector<uint32_t> code(static_cast<uint64_t>(file.tellg()) / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(code.data()), code.size() * sizeof(uint32_t));
+
+    const VkShaderModuleCreateInfo moduleInfo{
+        .sType{ VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .codeSize{ code.size() * sizeof(uint32_t) },
+        .pCode{ code.data() }
+    };
+
+    VkShaderModule module{ nullptr };
+    if ( vkCreateShaderModule(
+            this->pInfo->Device.GetDevice(),
+            &moduleInfo,
+            nullptr,
+            &module) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create shader module",
+                L"PipelineBuilder::LoadShader");
+    }
+
+    this->pTracker->Shaders.emplace(path.wstring(), module);
+    return module;
+}
+
+uint64_t DflGr::PipelineBuilder::Hash(const State& state) noexcept
+{
+    uint64_t hash{ 0xcbf29ce484222325 };
+
+    const std::wstring vertexPath{ state.VertexShader.wstring() };
+    const std::wstring fragmentPath{ state.FragmentShader.wstring() };
+    hash = INT_HashBytes(hash, vertexPath.data(), vertexPath.size() * sizeof(wchar_t));
+    hash = INT_HashBytes(hash, fragmentPath.data(), fragmentPath.size() * sizeof(wchar_t));
+
+    for (auto& binding : state.VertexBindings)
+    {
+        hash = INT_HashValue(hash, binding.binding);
+        hash = INT_HashValue(hash, binding.stride);
+        hash = INT_HashValue(hash, binding.inputRate);
+    }
+    for (auto& attribute : state.VertexAttributes)
+    {
+        hash = INT_HashValue(hash, attribute.location);
+        hash = INT_HashValue(hash, attribute.binding);
+        hash = INT_HashValue(hash, attribute.format);
+        hash = INT_HashValue(hash, attribute.offset);
+    }
+
+    hash = INT_HashValue(hash, state.Topology);
+    hash = INT_HashValue(hash, state.PolygonMode);
+    hash = INT_HashValue(hash, state.CullMode);
+    hash = INT_HashValue(hash, state.FrontFace);
+    hash = INT_HashValue(hash, state.Samples);
+    hash = INT_HashValue(hash, state.ColourFormat);
+    hash = INT_HashValue(hash, state.DepthFormat);
+    hash = INT_HashValue(hash, state.DoBlend);
+    hash = INT_HashValue(hash, state.hLayout);
+    hash = INT_HashValue(hash, state.Features.GetValue());
+
+    return hash;
+}
+
+VkPipeline DflGr::PipelineBuilder::Compile(
+    const State&   state,
+    const uint64_t hash)
+{
+    VkShaderModule vertexModule{ nullptr };
+    VkShaderModule fragmentModule{ nullptr };
+    {
+        std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+        if ( auto pipeline{ this->pTracker->Pipelines.find(hash) };
+             pipeline != this->pTracker->Pipelines.end() )
+        {
+            return pipeline->second;
+        }
+
+        vertexModule = this->LoadShader(state.VertexShader);
+        fragmentModule = this->LoadShader(state.FragmentShader);
+    }
+
+    // the pipeline cache is internally synchronized, so compilation itself
+    // happens outside of the lock
+    const VkPipeline pipeline{ INT_GetPipeline(
+                                    this->pInfo->Device.GetDevice(),
+                                    this->Cache.hCache,
+                                    state.hLayout == nullptr
+                                        ? this->Cache.hEmptyLayout
+                                        : state.hLayout,
+                                    vertexModule,
+                                    fragmentModule,
+                                    state) };
+
+    std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+    // if another thread compiled the same state in the meantime, the first
+    // one to finish is kept
+    if ( auto [existing, isInserted]{ this->pTracker->Pipelines.emplace(hash, pipeline) };
+         !isInserted )
+    {
+        vkDestroyPipeline(
+            this->pInfo->Device.GetDevice(),
+            pipeline,
+            nullptr);
+        return existing->second;
+    }
+
+    return pipeline;
+}
+
+void DflGr::PipelineBuilder::Work(std::stop_token stopToken)
+{
+    while (!stopToken.stop_requested())
+    {
+        std::unique_lock<std::mutex> lock(this->pTracker->Lock);
+        if ( !this->pTracker->RequestAdded.wait(
+                lock,
+                stopToken,
+                [this]() { return !this->pTracker->Requests.empty(); }) )
+        {
+            return;
+        }
+
+        const CompileRequest request{ this->pTracker->Requests.front() };
+        this->pTracker->Requests.pop_front();
+        lock.unlock();
+
+        // the worker must outlive any failure, so the error is handed
+        // to the jobs that wait on the request instead
+        std::exception_ptr pException{ nullptr };
+        try {
+            this->Compile(request.PipelineState, request.Hash);
+        } catch (...) {
+            pException = std::current_exception();
+        }
+
+        lock.lock();
+        this->pTracker->Pending.erase(request.Hash);
+        if (pException != nullptr)
+        {
+            this->pTracker->Failures.insert_or_assign(request.Hash, pException);
+        }
+        request.pIsReady->store(true);
+    }
+}
+
+VkPipeline DflGr::PipelineBuilder::Build(const State& state)
+{
+    return this->Compile(state, Hash(state));
+}
+
+auto DflGr::PipelineBuilder::Request(const State& state)
+-> DflGen::Job<VkPipeline>
+{
+    const uint64_t                    hash{ Hash(state) };
+    std::shared_ptr<std::atomic_bool> pIsReady{ nullptr };
+    {
+        std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+        if ( auto pipeline{ this->pTracker->Pipelines.find(hash) };
+             pipeline != this->pTracker->Pipelines.end() )
+        {
+            co_return pipeline->second;
+        }
+
+        // the same state requested twice is only compiled once
+        if ( auto pending{ this->pTracker->Pending.find(hash) };
+             pending != this->pTracker->Pending.end() )
+        {
+            pIsReady = pending->second;
+        }
+        else {
+            // requesting a failed state again retries it
+            this->pTracker->Failures.erase(hash);
+            pIsReady = std::make_shared<std::atomic_bool>(false);
+            this->pTracker->Pending.emplace(hash, pIsReady);
+            this->pTracker->Requests.push_back({ state, hash, pIsReady });
+            this->pTracker->RequestAdded.notify_one();
+        }
+    }
+
+    while (!pIsReady->load())
+    {
+        co_await DflGen::Job<VkPipeline>::Awaitable(pIsReady);
+    }
+
+    // the state may not outlive the suspension, so only the hash is used from here on
+    std::exception_ptr pException{ nullptr };
+    {
+        std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+        if ( auto pipeline{ this->pTracker->Pipelines.find(hash) };
+             pipeline != this->pTracker->Pipelines.end() )
+        {
+            co_return pipeline->second;
+        }
+
+        if ( auto failure{ this->pTracker->Failures.find(hash) };
+             failure != this->pTracker->Failures.end() )
+        {
+            pException = failure->second;
+        }
+    }
+
+    if (pException != nullptr)
+    {
+        std::rethrow_exception(pException);
+    }
+    co_return nullptr;
+}
+
+VkPipeline DflGr::PipelineBuilder::Find(const State& state) const noexcept
+{
+    return this->Find(Hash(state));
+}
+
+VkPipeline DflGr::PipelineBuilder::Find(const uint64_t hash) const noexcept
+{
+    std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+    if ( auto pipeline{ this->pTracker->Pipelines.find(hash) };
+         pipeline != this->pTracker->Pipelines.end() )
+    {
+        return pipeline->second;
+    }
+
+    return nullptr;
+}
+
+VkPipeline DflGr::PipelineBuilder::Select(
+    const State& state,
+    const State& fallback) const noexcept
+{
+    // never waits on compilation; if neither is ready, the caller
+    // is expected to skip the draw
+    if (const VkPipeline pipeline{ this->Find(state) }; pipeline != nullptr)
+    {
+        return pipeline;
+    }
+
+    return this->Find(fallback);
+}
+
+bool DflGr::PipelineBuilder::SaveCache() const noexcept
+{
+    const VkDevice& device{ this->pInfo->Device.GetDevice() };
+
+    size_t size{ 0 };
+    if ( vkGetPipelineCacheData(
+            device,
+            this->Cache.hCache,
+            &size,
+            nullptr) != VK_SUCCESS )
+    {
+        return false;
+    }
+
+    std::vector<char> data(size);
+    if ( vkGetPipelineCacheData(
+            device,
+            this->Cache.hCache,
+            &size,
+            data.data()) != VK_SUCCESS )
+    {
+        return false;
+    }
+
+    CacheHeader header{ this->Header };
+    header.DataSize = size;
+
+    // the cache is first written to a temporary file, so that a crash
+    // mid-write never leaves a half-written cache behind
+    std::filesystem::path tempPath{ this->pInfo->CachePath };
+    tempPath += L".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if ( !file.is_open()
+             || !file.write(reinterpret_cast<const char*>(&header), sizeof(header))
+             || !file.write(data.data(), size) )
+        {
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, this->pInfo->CachePath, error);
+
+    return !error;
+}
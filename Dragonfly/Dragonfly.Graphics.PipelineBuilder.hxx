@@ -0,0 +1,288 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <deque>
+#include <exception>
+#include <condition_variable>
+#include <filesystem>
+#include <unordered_map>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "Dragonfly.h"
+
+#include "Dragonfly.Generics.hxx"
+#include "Dragonfly.Hardware.Device.hxx"
+
+namespace Dfl {
+    // Dragonfly.Graphics
+    namespace Graphics {
+        // Dragonfly.Graphics.PipelineBuilder
+        class PipelineBuilder {
+        public:
+            struct Info {
+                      DflHW::Device&        Device;
+                const std::filesystem::path CachePath{ L"Dragonfly.PipelineCache.bin" }; // where the pipeline cache persists between runs
+                const uint32_t              WorkersNumber{ 0 }; // threads compiling requested pipelines. If 0, one less than the processor count is used
+            };
+
+            // Every field of the state takes part in the hash of the pipeline,
+            // so two identical states always resolve to the same VkPipeline
+            struct State {
+                std::filesystem::path                          VertexShader{ L"Shaders/test_vert.spv" };
+                std::filesystem::path                          FragmentShader{ L"Shaders/test_frag.spv" };
+
+                std::vector<
+                    VkVertexInputBindingDescription>           VertexBindings{
+                                                                    { 0, 6 * sizeof(float), VK_VERTEX_INPUT_RATE_VERTEX } };
+                std::vector<
+                    VkVertexInputAttributeDescription>         VertexAttributes{
+                                                                    { 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0 },
+                                                                    { 1, 0, VK_FORMAT_R32G32B32_SFLOAT, 3 * sizeof(float) } };
+
+                VkPrimitiveTopology                            Topology{ VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST };
+                VkPolygonMode                                  PolygonMode{ VK_POLYGON_MODE_FILL };
+                VkCullModeFlags                                CullMode{ VK_CULL_MODE_BACK_BIT };
+                VkFrontFace                                    FrontFace{ VK_FRONT_FACE_CLOCKWISE };
+                uint32_t                                       Samples{ 1 };
+
+                VkFormat                                       ColourFormat{ VK_FORMAT_B8G8R8A8_SRGB };
+                VkFormat                                       DepthFormat{ VK_FORMAT_UNDEFINED }; // undefined means no depth attachment
+                bool                                           DoBlend{ false };
+
+                VkPipelineLayout                               hLayout{ nullptr }; // if null, an empty layout is used
+
+                DflGen::BitFlag                                Features{ 0 }; // bit i is given to both stages as the boolean specialization constant with constant_id i
+            };
+
+            static constexpr uint32_t MaxFeatures{ 32 };
+
+            struct Handles {
+                const VkPipelineCache  hCache{ nullptr };
+                const VkPipelineLayout hEmptyLayout{ nullptr };
+                const bool             IsWarm{ false }; // whether a valid cache was found on disk
+
+                operator VkPipelineCache() const { return this->hCache; }
+            };
+
+            // A pipeline waiting for a worker to compile it
+            struct CompileRequest {
+                const State                              PipelineState{ };
+                const uint64_t                           Hash{ 0 };
+                const std::shared_ptr<std::atomic_bool>  pIsReady{ nullptr };
+            };
+
+            struct Tracker {
+                std::unordered_map<
+                    uint64_t, VkPipeline>          Pipelines{ }; // only pipelines that are done compiling
+                std::unordered_map<
+                    uint64_t, 
+                    std::shared_ptr<
+                        std::atomic_bool>>         Pending{ }; // requested, but not yet compiled
+                std::unordered_map<
+                    uint64_t, std::exception_ptr>  Failures{ }; // requested, but failed to compile
+                std::unordered_map<
+                    std::wstring, VkShaderModule>  Shaders{ };
+
+                std::deque<CompileRequest>         Requests{ };
+                std::condition_variable_any        RequestAdded;
+                std::vector<std::jthread>          Workers{ };
+
+                std::mutex                         Lock;
+            };
+
+            // Written in front of the cache data on disk. The cache is discarded
+            // if any of these differ from the device it is loaded on.
+            struct CacheHeader {
+                uint32_t                          Magic{ 0x504c4644 }; // "DFLP"
+                uint32_t                          HeaderVersion{ 1 };
+                uint32_t                          VendorID{ 0 };
+                uint32_t                          DeviceID{ 0 };
+                uint32_t                          DriverVersion{ 0 };
+                std::array<uint8_t, VK_UUID_SIZE> DeviceUUID{ };
+                std::array<uint8_t, VK_UUID_SIZE> CacheUUID{ };
+                uint64_t                          DataSize{ 0 };
+            };
+
+        protected:
+            const std::unique_ptr<const Info>    pInfo{ nullptr };
+            const CacheHeader                    Header{ };
+            const Handles                        Cache{ };
+            const std::unique_ptr<Tracker>       pTracker{ nullptr };
+
+                  VkShaderModule                 LoadShader(const std::filesystem::path& path);
+                  VkPipeline                     Compile(
+                                                    const State&   state,
+                                                    const uint64_t hash);
+                  void                           Work(std::stop_token stopToken);
+        public:
+            DFL_API DFL_CALL PipelineBuilder(const Info& info);
+            DFL_API DFL_CALL ~PipelineBuilder();
+
+                  DflHW::Device&    GetDevice() const noexcept {
+                                        return this->pInfo->Device; }
+            const VkPipelineCache   GetCache() const noexcept {
+                                        return this->Cache.hCache; }
+            const bool              WasCacheWarm() const noexcept {
+                                        return this->Cache.IsWarm; }
+
+            DFL_API
+            static
+                  uint64_t
+            DFL_CALL                Hash(const State& state) noexcept;
+
+            DFL_API
+                  VkPipeline
+            DFL_CALL                Build(const State& state);
+            // Compiles the pipeline on a worker. If compilation fails, the job
+            // rethrows the error when it's resumed; the state can be requested
+            // again afterwards.
+            DFL_API
+                  DflGen::Job<VkPipeline>
+            DFL_CALL                Request(const State& state);
+            DFL_API
+                  VkPipeline
+            DFL_CALL                Find(const State& state) const noexcept;
+            DFL_API
+                  VkPipeline
+            DFL_CALL                Find(const uint64_t hash) const noexcept;
+            DFL_API
+                  VkPipeline
+            DFL_CALL                Select(
+                                        const State& state,
+                                        const State& fallback) const noexcept;
+            DFL_API
+                  bool
+            DFL_CALL                SaveCache() const noexcept;
+        };
+
+        // Dragonfly.Graphics.Variants
+        // Every combination of FeatureCount features of one pipeline state.
+        // The variants share the same SPIR-V and only differ in their
+        // specialization constants, so the driver strips the disabled
+        // branches instead of the shader testing them at runtime.
+        // The variants are compiled by the builder's workers; Update(), e.g.
+        // called once a frame, drives their jobs and reports their errors.
+        template< uint32_t FeatureCount >
+        class Variants {
+            static_assert(FeatureCount <= 12, "The number of variants doubles with each feature");
+        public:
+            static constexpr uint32_t Count{ 1u << FeatureCount };
+
+        protected:
+            const PipelineBuilder&                      Builder;
+                  std::array<uint64_t, Count>           Hashes{ };
+            mutable std::array<
+                        std::atomic<VkPipeline>, Count> Pipelines{ };
+                  std::array<
+                    std::unique_ptr<
+                        DflGen::Job<VkPipeline>>,
+                    Count>                              Jobs{ }; // null once the variant is done compiling
+
+        public:
+            Variants(
+                      PipelineBuilder&        builder,
+                const PipelineBuilder::State& base);
+
+            // Resumes the jobs of the variants still compiling, and returns how
+            // many still are. A variant that failed to compile rethrows its
+            // error here, once, and is never found afterwards.
+            uint32_t   Update();
+
+            // null while the variant is still compiling
+            VkPipeline operator[] (const DflGen::BitFlag& features) const noexcept;
+
+            template< unsigned int Features >
+            VkPipeline Get() const noexcept {
+                            static_assert(Features < Count, "Feature outside of the variant set");
+                            return (*this)[Features]; }
+        };
+    }
+    namespace DflGr = Dfl::Graphics;
+}
+
+// TEMPLATE DEFINITIONS
+
+// Dragonfly.Graphics.Variants
+
+template< uint32_t FeatureCount >
+Dfl::Graphics::Variants<FeatureCount>::Variants(
+          PipelineBuilder&        builder,
+    const PipelineBuilder::State& base)
+: Builder( builder )
+{
+    for (uint32_t features{ 0 }; features < Count; features++)
+    {
+        PipelineBuilder::State state{ base };
+        state.Features = features;
+
+        this->Hashes[features] = PipelineBuilder::Hash(state);
+        this->Pipelines[features].store(nullptr, std::memory_order_relaxed);
+        this->Jobs[features].reset(new DflGen::Job<VkPipeline>(builder.Request(state)));
+    }
+}
+
+template< uint32_t FeatureCount >
+uint32_t Dfl::Graphics::Variants<FeatureCount>::Update()
+{
+    uint32_t compilingCount{ 0 };
+    for (uint32_t features{ 0 }; features < Count; features++)
+    {
+        if (this->Jobs[features] == nullptr)
+        {
+            continue;
+        }
+
+        // the job is taken out before resuming it, so that if it rethrows,
+        // it's dropped and its error is only reported once
+        std::unique_ptr<DflGen::Job<VkPipeline>> pJob{ std::move(this->Jobs[features]) };
+        pJob->Resume();
+        if (pJob->GetState() == DflGen::Job<VkPipeline>::RoutineState::Done)
+        {
+            this->Pipelines[features].store(*pJob, std::memory_order_relaxed);
+        }
+        else {
+            this->Jobs[features] = std::move(pJob);
+            compilingCount++;
+        }
+    }
+
+    return compilingCount;
+}
+
+template< uint32_t FeatureCount >
+VkPipeline Dfl::Graphics::Variants<FeatureCount>::operator[] (const DflGen::BitFlag& features) const noexcept
+{
+    const uint32_t index{ features.GetValue() & (Count - 1) };
+
+    VkPipeline pipeline{ this->Pipelines[index].load(std::memory_order_relaxed) };
+    if (pipeline == nullptr) [[ unlikely ]]
+    {
+        pipeline = this->Builder.Find(this->Hashes[index]);
+        this->Pipelines[index].store(pipeline, std::memory_order_relaxed);
+    }
+
+    return pipeline;
+}
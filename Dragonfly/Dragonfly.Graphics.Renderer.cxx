@@ -19,6 +19,7 @@
 #include <vector>
 #include <thread>
 #include <chrono>
+#include <utility>
 
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
@@ -154,7 +155,9 @@ static inline VkSwapchainKHR INT_GetSwapchain(
     const bool&                            doVsync,
     const VkSurfaceKHR&                    surface,
     const std::array< uint32_t, 2 >&       targetRes,
-    const VkSwapchainKHR&                  hOldSwapchain) 
+    const VkSwapchainKHR&                  hOldSwapchain,
+          VkFormat&                        format,
+          VkExtent2D&                      extent) 
 {
     auto characteristics{ INT_GetCharacteristics(
                             hPhysDevice,
@@ -162,21 +165,23 @@ static inline VkSwapchainKHR INT_GetSwapchain(
                             targetRes) };
 
     VkColorSpaceKHR colorSpace;
+    format = INT_DoesSupportSRGB(
+                colorSpace, 
+                characteristics.Formats) 
+             ? VK_FORMAT_B8G8R8A8_SRGB 
+             : characteristics.Formats[0].format;
+    extent = INT_MakeExtent(
+                targetRes, 
+                characteristics.Capabilities);
     const VkSwapchainCreateInfoKHR swapchainInfo = {
         .sType{ VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR },
         .pNext{ nullptr },
         .flags{ 0 },
         .surface{ surface },
         .minImageCount{ characteristics.Capabilities.minImageCount + 1 },
-        .imageFormat{ INT_DoesSupportSRGB(
-                        colorSpace, 
-                        characteristics.Formats) 
-                      ? VK_FORMAT_B8G8R8A8_SRGB 
-                      : characteristics.Formats[0].format },
+        .imageFormat{ format },
         .imageColorSpace{ colorSpace },
-        .imageExtent{ INT_MakeExtent(
-                        targetRes, 
-                        characteristics.Capabilities) },
+        .imageExtent{ extent },
         .imageArrayLayers{ 1 },
         .imageUsage{ VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT },
         .imageSharingMode{ VK_SHARING_MODE_EXCLUSIVE },
@@ -216,9 +221,168 @@ static inline VkSwapchainKHR INT_GetSwapchain(
     return swapchain;
 };
 
-static VkCommandPool INT_GetCommandPool()
+static VkCommandPool INT_GetCommandPool(
+    const VkDevice& hDevice,
+    const uint32_t  familyIndex)
 {
+    const VkCommandPoolCreateInfo poolInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT }, // every frame rerecords its own buffer
+        .queueFamilyIndex{ familyIndex }
+    };
+
+    VkCommandPool pool{ nullptr };
+    if ( vkCreateCommandPool(
+            hDevice,
+            &poolInfo,
+            nullptr,
+            &pool) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create command pool",
+                L"INT_GetCommandPool");
+    }
+
+    return pool;
+}
+
+static std::vector<VkImageView> INT_GetImageViews(
+    const VkDevice&             hDevice,
+    const std::vector<VkImage>& images,
+    const VkFormat&             format)
+{
+    std::vector<VkImageView> views(images.size(), nullptr);
+    for (uint32_t i{ 0 }; i < images.size(); i++)
+    {
+        const VkImageViewCreateInfo viewInfo{
+            .sType{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .image{ images[i] },
+            .viewType{ VK_IMAGE_VIEW_TYPE_2D },
+            .format{ format },
+            .components{ },
+            .subresourceRange{
+                .aspectMask{ VK_IMAGE_ASPECT_COLOR_BIT },
+                .baseMipLevel{ 0 },
+                .levelCount{ 1 },
+                .baseArrayLayer{ 0 },
+                .layerCount{ 1 } }
+        };
+        if ( vkCreateImageView(
+                hDevice,
+                &viewInfo,
+                nullptr,
+                &views[i]) != VK_SUCCESS )
+        {
+            for (auto& view : views)
+            {
+                if (view != nullptr) { vkDestroyImageView(hDevice, view, nullptr); }
+            }
 
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create view of swapchain image",
+                    L"INT_GetImageViews");
+        }
+    }
+
+    return views;
+}
+
+static std::vector<VkSemaphore> INT_GetSemaphores(
+    const VkDevice& hDevice,
+    const uint32_t  count)
+{
+    const VkSemaphoreCreateInfo semaphoreInfo{
+        .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 }
+    };
+
+    std::vector<VkSemaphore> semaphores(count, nullptr);
+    for (auto& semaphore : semaphores)
+    {
+        if ( vkCreateSemaphore(
+                hDevice,
+                &semaphoreInfo,
+                nullptr,
+                &semaphore) != VK_SUCCESS )
+        {
+            for (auto& created : semaphores)
+            {
+                if (created != nullptr) { vkDestroySemaphore(hDevice, created, nullptr); }
+            }
+
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create semaphore",
+                    L"INT_GetSemaphores");
+        }
+    }
+
+    return semaphores;
+}
+
+static std::array<DflGr::Renderer::Frame, DflGr::Renderer::FramesInFlight> INT_GetFrames(
+    const VkDevice&      hDevice,
+    const VkCommandPool& hCmdPool)
+{
+    const VkCommandBufferAllocateInfo bufferInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO },
+        .pNext{ nullptr },
+        .commandPool{ hCmdPool },
+        .level{ VK_COMMAND_BUFFER_LEVEL_PRIMARY },
+        .commandBufferCount{ DflGr::Renderer::FramesInFlight }
+    };
+    std::array<VkCommandBuffer, DflGr::Renderer::FramesInFlight> buffers{ };
+    if ( vkAllocateCommandBuffers(
+            hDevice,
+            &bufferInfo,
+            buffers.data()) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to allocate frame command buffers",
+                L"INT_GetFrames");
+    }
+
+    auto semaphores{ INT_GetSemaphores(
+                        hDevice,
+                        DflGr::Renderer::FramesInFlight) };
+
+    // created signaled, so the first wait on each frame returns immediately
+    const VkFenceCreateInfo fenceInfo{
+        .sType{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ VK_FENCE_CREATE_SIGNALED_BIT }
+    };
+    std::array<VkFence, DflGr::Renderer::FramesInFlight> fences{ };
+    for (auto& fence : fences)
+    {
+        if ( vkCreateFence(
+                hDevice,
+                &fenceInfo,
+                nullptr,
+                &fence) != VK_SUCCESS )
+        {
+            for (auto& created : fences)
+            {
+                if (created != nullptr) { vkDestroyFence(hDevice, created, nullptr); }
+            }
+            for (auto& semaphore : semaphores)
+            {
+                vkDestroySemaphore(hDevice, semaphore, nullptr);
+            }
+
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create frame fence",
+                    L"INT_GetFrames");
+        }
+    }
+
+    return [&]<size_t... frame>(std::index_sequence<frame...>) {
+        return std::array<DflGr::Renderer::Frame, DflGr::Renderer::FramesInFlight>{ {
+            { buffers[frame], semaphores[frame], fences[frame] }... } };
+    }(std::make_index_sequence<DflGr::Renderer::FramesInFlight>());
 }
 
 using DflQueueFams = Dfl::Hardware::Device::Queue::Family;
@@ -232,7 +396,11 @@ static DflGr::Renderer::Handles INT_GetHandles(
     const std::optional<
             DflHW::Device::Queue >&  oldQueue,
     const VkSwapchainKHR&            oldSwapchain,
-    const VkCommandPool&             oldCommandPool) 
+    const VkCommandPool&             oldCommandPool,
+    const std::optional<
+            std::array<
+              DflGr::Renderer::Frame,
+              DflGr::Renderer::FramesInFlight> >& oldFrames) 
 {
     auto surface{ oldSurface == nullptr 
                     ? INT_GetSurface(
@@ -245,11 +413,17 @@ static DflGr::Renderer::Handles INT_GetHandles(
                    ? gpu.BorrowQueue(DflHW::Device::Queue::Type::Graphics)
                    : oldQueue.value() };
 
-    VkSwapchainKHR       swapchain{ nullptr };
-    std::vector<VkImage> swapImages;
-    VkCommandPool        comPool{ oldCommandPool == nullptr 
-                                    ? nullptr
-                                    : oldCommandPool };
+    VkSwapchainKHR           swapchain{ nullptr };
+    VkFormat                 format{ VK_FORMAT_UNDEFINED };
+    VkExtent2D               extent{ 0, 0 };
+    std::vector<VkImage>     swapImages;
+    std::vector<VkImageView> swapViews;
+    std::vector<VkSemaphore> renderFinished;
+    VkCommandPool            comPool{ oldCommandPool == nullptr 
+                                        ? INT_GetCommandPool(
+                                            gpu.GetDevice(),
+                                            queue.FamilyIndex)
+                                        : oldCommandPool };
     try {
         swapchain = INT_GetSwapchain(
                         gpu.GetDevice(),
@@ -257,7 +431,9 @@ static DflGr::Renderer::Handles INT_GetHandles(
                         doVsync,
                         surface,
                         targetRes,
-                        oldSwapchain);
+                        oldSwapchain,
+                        format,
+                        extent);
 
         uint32_t swapImageCount{ 0 };
         vkGetSwapchainImagesKHR(
@@ -276,8 +452,33 @@ static DflGr::Renderer::Handles INT_GetHandles(
             swapchain,
             &swapImageCount,
             swapImages.data());
+
+        // recreating the swapchain only means recreating these views;
+        // there are no framebuffers or render passes depending on them
+        swapViews = INT_GetImageViews(
+                        gpu.GetDevice(),
+                        swapImages,
+                        format);
+        renderFinished = INT_GetSemaphores(
+                            gpu.GetDevice(),
+                            swapImageCount);
     }
     catch (Dfl::Error::Generic& err) {
+        for (auto& view : swapViews)
+        {
+            vkDestroyImageView(
+                gpu.GetDevice(),
+                view,
+                nullptr);
+        }
+
+        if (oldCommandPool == nullptr) {
+            vkDestroyCommandPool(
+                gpu.GetDevice(),
+                comPool,
+                nullptr);
+        }
+
         vkDestroySurfaceKHR(
             gpu.GetSession().GetInstance(),
             surface,
@@ -293,11 +494,33 @@ static DflGr::Renderer::Handles INT_GetHandles(
         throw;
     }
 
-    return { surface, queue, swapchain, swapImages, comPool };
+    return { surface, 
+             queue, 
+             swapchain, 
+             format, 
+             extent, 
+             swapImages, 
+             swapViews, 
+             renderFinished, 
+             comPool, 
+             oldFrames.has_value()
+             ? oldFrames.value()
+             : INT_GetFrames(
+                 gpu.GetDevice(),
+                 comPool) };
 }
 
 // Internal for constructor
 
+// the renderer's frames continue from the value the lent timeline has reached
+static inline DflGr::Renderer::Timeline* INT_GetTimeline(const DflHW::Device& device)
+{
+    const DflHW::Device::TimelinePoint point{ device.GetTimeline() };
+
+    return new DflGr::Renderer::Timeline{ .hSemaphore{ point.hSemaphore },
+                                          .Value{ point.Value } };
+}
+
 DflGr::Renderer::Renderer(const Info& info)
 : pInfo(new Info(info)),
   Swapchain( INT_GetHandles(
@@ -308,18 +531,20 @@ DflGr::Renderer::Renderer(const Info& info)
                nullptr,
                std::nullopt,
                nullptr,
-               nullptr) ),
+               nullptr,
+               std::nullopt) ),
   pCharacteristics( new Characteristics( INT_GetCharacteristics(
                                             info.AssocDevice.GetPhysicalDevice(),
                                             this->Swapchain.hSurface,
                                             info.AssocWindow.GetRectangle<DflUI::Window::Rectangle::Resolution>()) ) ),
   QueueFence( this->pInfo->AssocDevice.GetFence(this->Swapchain.AssignedQueue.FamilyIndex,
-                                                   this->Swapchain.AssignedQueue.Index) )
+                                                   this->Swapchain.AssignedQueue.Index) ),
+  pTimeline( INT_GetTimeline(info.AssocDevice) )
 {
 }
 
 DflGr::Renderer::Renderer(Renderer&& oldRenderer) 
-: pInfo( oldRenderer.pInfo.get() ),
+: pInfo( oldRenderer.pInfo ),
   Swapchain( INT_GetHandles(
                this->pInfo->AssocDevice,
                this->pInfo->AssocWindow.GetHandle(),
@@ -328,21 +553,64 @@ DflGr::Renderer::Renderer(Renderer&& oldRenderer)
                oldRenderer.Swapchain.hSurface,
                oldRenderer.Swapchain.AssignedQueue,
                oldRenderer.Swapchain.hSwapchain,
-               oldRenderer.Swapchain.hCmdPool) ),
-  pCharacteristics( oldRenderer.pCharacteristics.get() ),
-  QueueFence( oldRenderer.QueueFence )
+               oldRenderer.Swapchain.hCmdPool,
+               oldRenderer.Swapchain.Frames) ),
+  pCharacteristics( oldRenderer.pCharacteristics ),
+  QueueFence( oldRenderer.QueueFence ),
+  pTimeline( oldRenderer.pTimeline ),
+  FrameIndex( oldRenderer.FrameIndex )
 {
+    // the surface, queue, command pool and frames now belong to this renderer
+    oldRenderer.IsReplaced = true;
 }
 
 DflGr::Renderer::~Renderer() {
     auto& device{ this->pInfo->AssocDevice };
     vkDeviceWaitIdle(device.GetDevice());
 
+    // the swapchain and its views and semaphores are always this renderer's
+    // own; the rest is shared with the renderer that replaced it, if any
+    if (!this->IsReplaced)
+    {
+        for (auto& frame : this->Swapchain.Frames)
+        {
+            vkDestroySemaphore(
+                device.GetDevice(),
+                frame.hImageAvailable,
+                nullptr);
+            vkDestroyFence(
+                device.GetDevice(),
+                frame.hInFlight,
+                nullptr);
+        }
+    }
+
+    for (auto& semaphore : this->Swapchain.hRenderFinished)
+    {
+        vkDestroySemaphore(
+            device.GetDevice(),
+            semaphore,
+            nullptr);
+    }
+
+    for (auto& view : this->Swapchain.hSwapchainViews)
+    {
+        vkDestroyImageView(
+            device.GetDevice(),
+            view,
+            nullptr);
+    }
+
     vkDestroySwapchainKHR(
         device.GetDevice(),
         this->Swapchain.hSwapchain,
         nullptr);
 
+    if (this->IsReplaced)
+    {
+        return;
+    }
+
     vkDestroyCommandPool(
         device.GetDevice(),
         this->Swapchain.hCmdPool,
@@ -354,25 +622,445 @@ DflGr::Renderer::~Renderer() {
         nullptr);
 
     this->pInfo->AssocDevice.ReturnQueue(this->Swapchain.AssignedQueue);
+    this->pInfo->AssocDevice.ReturnTimeline(this->pTimeline->hSemaphore);
 }
 
-void DflGr::Renderer::Cycle() 
+auto DflGr::Renderer::GetTimeline() const noexcept
+-> DflHW::Device::TimelinePoint
+{
+    std::lock_guard<std::mutex> lock(this->pTimeline->Lock);
+
+    return { .hSemaphore{ this->pTimeline->hSemaphore },
+             .Value{ this->pTimeline->Value } };
+}
+
+DflGr::Renderer& DflGr::Renderer::WaitFor(const DflHW::Device::TimelinePoint& point) noexcept
+{
+    std::lock_guard<std::mutex> lock(this->pTimeline->Lock);
+
+    this->pTimeline->Waits.push_back(point);
+    return *this;
+}
+
+// Internal for Cycle
+
+// Signals what a frame that can't be submitted would have, without its work,
+// so nothing waiting on its timeline point or its fence hangs. The image's
+// semaphore is waited on along with the other waits, so it can be signaled
+// again. If even that can't be submitted, the point is signaled by the host,
+// once the frames before it are done.
+static inline void INT_SkipFrame(
+    const VkDevice&                           hGPU,
+    const VkQueue&                            hQueue,
+    const std::vector<VkSemaphoreSubmitInfo>& waits,
+    const VkSemaphoreSubmitInfo&              timelineSignal,
+    const VkFence&                            hInFlight)
+{
+    const VkSubmitInfo2 skipInfo{
+        .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .waitSemaphoreInfoCount{ static_cast<uint32_t>(waits.size()) },
+        .pWaitSemaphoreInfos{ waits.data() },
+        .commandBufferInfoCount{ 0 },
+        .pCommandBufferInfos{ nullptr },
+        .signalSemaphoreInfoCount{ 1 },
+        .pSignalSemaphoreInfos{ &timelineSignal }
+    };
+    if ( vkQueueSubmit2(
+            hQueue,
+            1,
+            &skipInfo,
+            hInFlight) == VK_SUCCESS )
+    {
+        return;
+    }
+
+    const uint64_t previousValue{ timelineSignal.value - 1 };
+    const VkSemaphoreWaitInfo previousInfo{
+        .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .semaphoreCount{ 1 },
+        .pSemaphores{ &timelineSignal.semaphore },
+        .pValues{ &previousValue }
+    };
+    vkWaitSemaphores(
+        hGPU,
+        &previousInfo,
+        UINT64_MAX);
+
+    const VkSemaphoreSignalInfo signalInfo{
+        .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO },
+        .pNext{ nullptr },
+        .semaphore{ timelineSignal.semaphore },
+        .value{ timelineSignal.value }
+    };
+    vkSignalSemaphore(
+        hGPU,
+        &signalInfo);
+    vkQueueSubmit(
+        hQueue,
+        0,
+        nullptr,
+        hInFlight);
+}
+
+void DflGr::Renderer::Cycle(const std::function<void(const Pass&)>& draw) 
 {
     switch (this->CurrentState) 
     {
     case State::Initialize:
-        printf("INITIALIZATION\n");
         this->CurrentState = State::Loop;
         break;
     case State::Loop:
-        printf("");
         break;
     default:
+        return;
+    }
+
+    auto&        device{ this->pInfo->AssocDevice };
+    const Frame& frame{ this->Swapchain.Frames[this->FrameIndex] };
+
+    if (this->pInfo->pProfiler != nullptr)
+    {
+        this->pInfo->pProfiler->BeginFrame();
+    }
+    DflHW::Profiler::CPUZone cycleZone(this->pInfo->pProfiler, "Renderer::Cycle");
+
+    // the frame's previous submission has to be done before its command buffer is reused
+    vkWaitForFences(
+        device.GetDevice(),
+        1,
+        &frame.hInFlight,
+        VK_TRUE,
+        UINT64_MAX);
+
+    uint32_t imageIndex{ 0 };
+    switch (vkAcquireNextImageKHR(
+                device.GetDevice(),
+                this->Swapchain.hSwapchain,
+                UINT64_MAX,
+                frame.hImageAvailable,
+                nullptr,
+                &imageIndex)) 
+    {
+    case VK_SUCCESS:
+    case VK_SUBOPTIMAL_KHR:
         break;
+    default:
+        // the swapchain is out of date; the frame is skipped until the renderer is recreated
+        return;
+    }
+
+    vkResetFences(
+        device.GetDevice(),
+        1,
+        &frame.hInFlight);
+    vkResetCommandBuffer(
+        frame.hCmdBuffer,
+        0);
+
+    const VkCommandBufferBeginInfo beginInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO },
+        .pNext{ nullptr },
+        .flags{ VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT },
+        .pInheritanceInfo{ nullptr }
+    };
+    vkBeginCommandBuffer(
+        frame.hCmdBuffer,
+        &beginInfo);
+
+    {
+        DflHW::Profiler::Zone frameZone(
+                                this->pInfo->pProfiler,
+                                frame.hCmdBuffer,
+                                this->Swapchain.AssignedQueue.FamilyIndex,
+                                "Renderer::Frame",
+                                true);
+
+        // without a render pass, the layout transitions it used to do
+        // are recorded as plain barriers around the rendering
+        const VkImageSubresourceRange colourRange{
+            .aspectMask{ VK_IMAGE_ASPECT_COLOR_BIT },
+            .baseMipLevel{ 0 },
+            .levelCount{ 1 },
+            .baseArrayLayer{ 0 },
+            .layerCount{ 1 }
+        };
+        const VkImageMemoryBarrier2 toAttachment{
+            .sType{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 },
+            .pNext{ nullptr },
+            .srcStageMask{ VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT },
+            .srcAccessMask{ VK_ACCESS_2_NONE },
+            .dstStageMask{ VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT },
+            .dstAccessMask{ VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT },
+            .oldLayout{ VK_IMAGE_LAYOUT_UNDEFINED },
+            .newLayout{ VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+            .srcQueueFamilyIndex{ VK_QUEUE_FAMILY_IGNORED },
+            .dstQueueFamilyIndex{ VK_QUEUE_FAMILY_IGNORED },
+            .image{ this->Swapchain.hSwapchainImages[imageIndex] },
+            .subresourceRange{ colourRange }
+        };
+        const VkDependencyInfo toAttachmentDependency{
+            .sType{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO },
+            .pNext{ nullptr },
+            .dependencyFlags{ 0 },
+            .imageMemoryBarrierCount{ 1 },
+            .pImageMemoryBarriers{ &toAttachment }
+        };
+        vkCmdPipelineBarrier2(
+            frame.hCmdBuffer,
+            &toAttachmentDependency);
+
+        const VkRenderingAttachmentInfo colourAttachment{
+            .sType{ VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO },
+            .pNext{ nullptr },
+            .imageView{ this->Swapchain.hSwapchainViews[imageIndex] },
+            .imageLayout{ VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+            .resolveMode{ VK_RESOLVE_MODE_NONE },
+            .resolveImageView{ nullptr },
+            .resolveImageLayout{ VK_IMAGE_LAYOUT_UNDEFINED },
+            .loadOp{ VK_ATTACHMENT_LOAD_OP_CLEAR },
+            .storeOp{ VK_ATTACHMENT_STORE_OP_STORE },
+            .clearValue{ .color{ .float32{ 
+                            this->pInfo->ClearColour[0],
+                            this->pInfo->ClearColour[1],
+                            this->pInfo->ClearColour[2],
+                            this->pInfo->ClearColour[3] } } }
+        };
+        const VkRenderingInfo renderingInfo{
+            .sType{ VK_STRUCTURE_TYPE_RENDERING_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .renderArea{ 
+                .offset{ 0, 0 },
+                .extent{ this->Swapchain.Extent } },
+            .layerCount{ 1 },
+            .viewMask{ 0 },
+            .colorAttachmentCount{ 1 },
+            .pColorAttachments{ &colourAttachment },
+            .pDepthAttachment{ nullptr },
+            .pStencilAttachment{ nullptr }
+        };
+        vkCmdBeginRendering(
+            frame.hCmdBuffer,
+            &renderingInfo);
+
+        // pipelines built by PipelineBuilder against GetFormat() are bound and drawn here
+        if (draw)
+        {
+            draw(Pass(frame.hCmdBuffer, this->pInfo->pProfiler));
+        }
+
+        vkCmdEndRendering(frame.hCmdBuffer);
+
+        const VkImageMemoryBarrier2 toPresent{
+            .sType{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 },
+            .pNext{ nullptr },
+            .srcStageMask{ VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT },
+            .srcAccessMask{ VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT },
+            .dstStageMask{ VK_PIPELINE_STAGE_2_NONE },
+            .dstAccessMask{ VK_ACCESS_2_NONE },
+            .oldLayout{ VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+            .newLayout{ VK_IMAGE_LAYOUT_PRESENT_SRC_KHR },
+            .srcQueueFamilyIndex{ VK_QUEUE_FAMILY_IGNORED },
+            .dstQueueFamilyIndex{ VK_QUEUE_FAMILY_IGNORED },
+            .image{ this->Swapchain.hSwapchainImages[imageIndex] },
+            .subresourceRange{ colourRange }
+        };
+        const VkDependencyInfo toPresentDependency{
+            .sType{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO },
+            .pNext{ nullptr },
+            .dependencyFlags{ 0 },
+            .imageMemoryBarrierCount{ 1 },
+            .pImageMemoryBarriers{ &toPresent }
+        };
+        vkCmdPipelineBarrier2(
+            frame.hCmdBuffer,
+            &toPresentDependency);
+    }
+
+    const bool isRecorded{ vkEndCommandBuffer(frame.hCmdBuffer) == VK_SUCCESS };
+
+    if (this->pInfo->pProfiler != nullptr)
+    {
+        this->pInfo->pProfiler->Count(DflHW::Profiler::Counter::BarriersIssued, 2);
     }
 
+    // only the work that reads what other queues produced waits for them;
+    // the frame's barriers and clears can overlap with it
+    std::vector<VkSemaphoreSubmitInfo> waits{ {
+        .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO },
+        .pNext{ nullptr },
+        .semaphore{ frame.hImageAvailable },
+        .value{ 0 },
+        .stageMask{ VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT },
+        .deviceIndex{ 0 } } };
+    uint64_t signalValue{ 0 };
+    {
+        std::lock_guard<std::mutex> lock(this->pTimeline->Lock);
+        for (const auto& point : this->pTimeline->Waits)
+        {
+            waits.push_back({
+                .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO },
+                .pNext{ nullptr },
+                .semaphore{ point.hSemaphore },
+                .value{ point.Value },
+                .stageMask{ VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT 
+                            | VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT
+                            | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT
+                            | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT },
+                .deviceIndex{ 0 } });
+        }
+        this->pTimeline->Waits.clear();
+
+        signalValue = ++this->pTimeline->Value;
+    }
+    const std::array<VkSemaphoreSubmitInfo, 2> signals{ {
+        {
+            .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO },
+            .pNext{ nullptr },
+            .semaphore{ this->Swapchain.hRenderFinished[imageIndex] },
+            .value{ 0 },
+            .stageMask{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT },
+            .deviceIndex{ 0 } },
+        {
+            .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO },
+            .pNext{ nullptr },
+            .semaphore{ this->pTimeline->hSemaphore },
+            .value{ signalValue },
+            .stageMask{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT },
+            .deviceIndex{ 0 } } } };
+
+    const VkCommandBufferSubmitInfo cmdBufferInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO },
+        .pNext{ nullptr },
+        .commandBuffer{ frame.hCmdBuffer },
+        .deviceMask{ 0 }
+    };
+    const VkSubmitInfo2 submitInfo{
+        .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .waitSemaphoreInfoCount{ static_cast<uint32_t>(waits.size()) },
+        .pWaitSemaphoreInfos{ waits.data() },
+        .commandBufferInfoCount{ 1 },
+        .pCommandBufferInfos{ &cmdBufferInfo },
+        .signalSemaphoreInfoCount{ static_cast<uint32_t>(signals.size()) },
+        .pSignalSemaphoreInfos{ signals.data() }
+    };
+    // the frame's timeline point was handed out already, and its fence was
+    // reset, so they're signaled even if the frame's work isn't submitted
+    if ( !isRecorded
+         || vkQueueSubmit2(
+                this->Swapchain.AssignedQueue,
+                1,
+                &submitInfo,
+                frame.hInFlight) != VK_SUCCESS )
+    {
+        INT_SkipFrame(
+            device.GetDevice(),
+            this->Swapchain.AssignedQueue,
+            waits,
+            signals[1],
+            frame.hInFlight);
+        if (this->pInfo->pProfiler != nullptr)
+        {
+            this->pInfo->pProfiler->Discard(frame.hCmdBuffer);
+        }
+        this->CurrentState = State::Fail;
+        return;
+    }
+
+    const VkPresentInfoKHR presentInfo{
+        .sType{ VK_STRUCTURE_TYPE_PRESENT_INFO_KHR },
+        .pNext{ nullptr },
+        .waitSemaphoreCount{ 1 },
+        .pWaitSemaphores{ &this->Swapchain.hRenderFinished[imageIndex] },
+        .swapchainCount{ 1 },
+        .pSwapchains{ &this->Swapchain.hSwapchain },
+        .pImageIndices{ &imageIndex },
+        .pResults{ nullptr }
+    };
+    vkQueuePresentKHR(
+        this->Swapchain.AssignedQueue,
+        &presentInfo);
+
+    this->FrameIndex = (this->FrameIndex + 1) % FramesInFlight;
+
     if (!this->pInfo->DoVsync || !INT_DoesSupportMailbox(this->pCharacteristics->PresentModes)) 
     {
         std::this_thread::sleep_for(std::chrono::microseconds(1000000/this->pInfo->Rate)); 
     }
 };
+
+// Dragonfly.Graphics.Renderer.Pass
+
+auto DflGr::Renderer::Pass::Draw(
+    const uint32_t vertexCount,
+    const uint32_t instanceCount,
+    const uint32_t firstVertex,
+    const uint32_t firstInstance) const noexcept
+-> const Pass&
+{
+    vkCmdDraw(
+        this->hCmdBuffer,
+        vertexCount,
+        instanceCount,
+        firstVertex,
+        firstInstance);
+
+    if (this->pProfiler != nullptr)
+    {
+        this->pProfiler->Count(DflHW::Profiler::Counter::DrawCalls, 1);
+    }
+
+    return *this;
+}
+
+auto DflGr::Renderer::Pass::DrawIndexed(
+    const uint32_t indexCount,
+    const uint32_t instanceCount,
+    const uint32_t firstIndex,
+    const int32_t  vertexOffset,
+    const uint32_t firstInstance) const noexcept
+-> const Pass&
+{
+    vkCmdDrawIndexed(
+        this->hCmdBuffer,
+        indexCount,
+        instanceCount,
+        firstIndex,
+        vertexOffset,
+        firstInstance);
+
+    if (this->pProfiler != nullptr)
+    {
+        this->pProfiler->Count(DflHW::Profiler::Counter::DrawCalls, 1);
+    }
+
+    return *this;
+}
+
+auto DflGr::Renderer::Pass::DrawIndirect(
+    const VkBuffer& buffer,
+    const uint64_t  offset,
+    const uint32_t  drawCount,
+    const uint32_t  stride) const noexcept
+-> const Pass&
+{
+    vkCmdDrawIndirect(
+        this->hCmdBuffer,
+        buffer,
+        offset,
+        drawCount,
+        stride);
+
+    if (this->pProfiler != nullptr)
+    {
+        this->pProfiler->Count(DflHW::Profiler::Counter::DrawCalls, drawCount);
+    }
+
+    return *this;
+}
@@ -18,6 +18,9 @@
 
 #include <vector>
 #include <memory>
+#include <array>
+#include <mutex>
+#include <functional>
 
 #define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan/vulkan.h>
@@ -25,6 +28,7 @@
 #include "Dragonfly.h"
 
 #include "Dragonfly.Hardware.Device.hxx"
+#include "Dragonfly.Hardware.Profiler.hxx"
 
 namespace Dfl {
     namespace UI { class Window; }
@@ -40,6 +44,21 @@ namespace Dfl {
 
                 bool                   DoVsync{ true };
                 uint32_t               Rate{ 60 };
+
+                std::array<float, 4>   ClearColour{ 0.0f, 0.0f, 0.0f, 1.0f };
+
+                DflHW::Profiler*       pProfiler{ nullptr }; // if not null, every cycle begins a profiler frame and is timed
+            };
+
+            static constexpr uint32_t FramesInFlight{ 2 };
+
+            // What a frame needs while it is being recorded and executed. There is
+            // no render pass or framebuffer; the swapchain image view is attached
+            // directly when rendering begins.
+            struct Frame {
+                const VkCommandBuffer hCmdBuffer{ nullptr };
+                const VkSemaphore     hImageAvailable{ nullptr };
+                const VkFence         hInFlight{ nullptr };
             };
 
             struct Handles {
@@ -47,15 +66,71 @@ namespace Dfl {
                 const DflHW::Device::Queue            AssignedQueue{ };
 
                 const VkSwapchainKHR                  hSwapchain{ nullptr };
+                const VkFormat                        Format{ VK_FORMAT_UNDEFINED };
+                const VkExtent2D                      Extent{ 0, 0 };
                 const std::vector<VkImage>            hSwapchainImages{ };
+                const std::vector<VkImageView>        hSwapchainViews{ };
+                const std::vector<VkSemaphore>        hRenderFinished{ }; // one per swapchain image, since presentation holds on to it
                 const VkCommandPool                   hCmdPool{ nullptr };
                 // ^ why is this here, even though command pools are per family? The reason is that command pools need to be
                 // used only by the thread that created them. Hence, it is not safe to allocate one command pool per family, but rather
                 // per thread.
+                const std::array<Frame, FramesInFlight> Frames{ };
 
                 operator VkSwapchainKHR() { return this->hSwapchain; }
             };
 
+            // Every frame advances the renderer's timeline semaphore, and
+            // can wait on the timelines of other queues, without the
+            // CPU waiting for either
+            struct Timeline {
+                      VkSemaphore                               hSemaphore{ nullptr }; // reaches n once the n-th frame is done
+                      uint64_t                                  Value{ 0 };
+                      std::vector<DflHW::Device::TimelinePoint> Waits{ }; // for the next frame
+
+                      std::mutex                                Lock;
+            };
+
+            // What a frame's draws are recorded through, while it renders to the
+            // swapchain image. Pipelines and descriptors are bound on GetCmdBuffer(),
+            // but draws go through the pass, so the profiler can count them.
+            class Pass {
+                const VkCommandBuffer   hCmdBuffer{ nullptr };
+                      DflHW::Profiler*  pProfiler{ nullptr };
+            public:
+                Pass(
+                    const VkCommandBuffer& cmdBuffer,
+                          DflHW::Profiler* profiler) noexcept
+                : hCmdBuffer( cmdBuffer ), pProfiler( profiler ) { }
+
+                const VkCommandBuffer& GetCmdBuffer() const noexcept {
+                                            return this->hCmdBuffer; }
+
+                DFL_API
+                const Pass&
+                DFL_CALL Draw(
+                            const uint32_t vertexCount,
+                            const uint32_t instanceCount = 1,
+                            const uint32_t firstVertex = 0,
+                            const uint32_t firstInstance = 0) const noexcept;
+                DFL_API
+                const Pass&
+                DFL_CALL DrawIndexed(
+                            const uint32_t indexCount,
+                            const uint32_t instanceCount = 1,
+                            const uint32_t firstIndex = 0,
+                            const int32_t  vertexOffset = 0,
+                            const uint32_t firstInstance = 0) const noexcept;
+                // Every draw of the buffer counts as one
+                DFL_API
+                const Pass&
+                DFL_CALL DrawIndirect(
+                            const VkBuffer& buffer,
+                            const uint64_t  offset,
+                            const uint32_t  drawCount,
+                            const uint32_t  stride) const noexcept;
+            };
+
             struct Characteristics {
                 const std::array< uint32_t, 2>        TargetRes{ 0, 0 };
 
@@ -77,17 +152,38 @@ namespace Dfl {
             const Handles                                Swapchain;
             const std::shared_ptr<const Characteristics> pCharacteristics;
             const VkFence                                QueueFence{ nullptr };
+            const std::shared_ptr<Timeline>              pTimeline{ nullptr };
 
                   State                                  CurrentState{ State::Initialize };
+                  uint32_t                               FrameIndex{ 0 };
+                  bool                                   IsReplaced{ false }; // if true, a renderer moved from this one owns the handles they share
         public:
             DFL_API DFL_CALL Renderer(const Info& info);
             DFL_API DFL_CALL Renderer(Renderer&& oldRenderer);
 
             DFL_API DFL_CALL ~Renderer();
 
+            const VkFormat   GetFormat() const noexcept {
+                                return this->Swapchain.Format; }
+            const VkExtent2D GetExtent() const noexcept {
+                                return this->Swapchain.Extent; }
+            const uint32_t   GetFrameIndex() const noexcept {
+                                return this->FrameIndex; }
+
+            // The point reached once the latest frame is done
+            DFL_API
+            DflHW::Device::TimelinePoint
+            DFL_CALL GetTimeline() const noexcept;
+            // The next frame waits on the device for point, e.g. the
+            // dispatch of a simulation whose results it draws
+            DFL_API
+            Renderer&
+            DFL_CALL WaitFor(const DflHW::Device::TimelinePoint& point) noexcept;
+
+            // draw records the frame's draws, if any, between clearing and presenting the image
             DFL_API       
             void  
-            DFL_CALL Cycle();
+            DFL_CALL Cycle(const std::function<void(const Pass&)>& draw = nullptr);
         };
     }
     namespace DflGr = Dfl::Graphics;
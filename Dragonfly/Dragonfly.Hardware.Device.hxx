@@ -20,6 +20,7 @@
 #include <vector>
 #include <memory>
 #include <array>
+#include <mutex>
 
 #define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan/vulkan.h>
@@ -62,6 +63,7 @@ namespace Dfl {
                     Graphics = 1,
                     Compute = 2,
                     Transfer = 4,
+                    Sparse = 8 // binds memory to sparse resources
                 };
 
                 struct Family {
@@ -85,6 +87,23 @@ namespace Dfl {
                 operator VkFence () { return this->hFence; }
             };
 
+            // A value of a timeline semaphore. The work that signals it
+            // is done once the semaphore reaches the value.
+            struct TimelinePoint {
+                VkSemaphore hSemaphore{ nullptr };
+                uint64_t    Value{ 0 };
+            };
+
+            // A slot of the stage ring, past the first StageMemory of the stage.
+            // The host writes to it through pMap, and the device copies out of it.
+            struct StageSlot {
+                uint32_t Index{ 0 };
+                uint64_t Offset{ 0 }; // in the stage buffer
+                void*    pMap{ nullptr };
+                VkFence  hFence{ nullptr }; // signaled once the device is done with the slot
+                bool     IsClaimed{ false };
+            };
+
             struct Characteristics {
                 const std::string                             Name{ "Placeholder GPU Name" };
 
@@ -96,6 +115,7 @@ namespace Dfl {
                         bool         IsHostVisible{ false };
                         bool         IsHostCoherent{ false };
                         bool         IsHostCached{ false };
+                        bool         IsDeviceLocal{ false }; // if also host visible, the host can write to it directly (UMA or resizable BAR)
                     };
 
                     VkDeviceSize            Size{ 0 };
@@ -117,7 +137,10 @@ namespace Dfl {
                 const uint64_t                                MaxDrawIndirectCount{ 0 };
             
                 const std::vector<VkExtensionProperties>      Extensions{ };
-            
+
+                const uint64_t                                NonCoherentAtomSize{ 1 }; // flushed and invalidated ranges have to be aligned to this
+                const bool                                    HasMappableLocalMemory{ false }; // some device local memory is host visible
+                const uint64_t                                HostPointerAlignment{ 0 }; // of imported host memory, 0 if it can't be imported
             };
 
             struct Tracker {
@@ -131,6 +154,9 @@ namespace Dfl {
                 std::vector<uint64_t>              UsedSharedMemoryHeaps{ }; // size is the amount of heaps
 
                 std::vector<Fence>                 Fences{ };
+                std::vector<VkSemaphore>           Timelines{ }; // every one made, destroyed along with the device
+                std::vector<VkSemaphore>           FreeTimelines{ }; // given back, to be lent again
+                std::mutex                         TimelineLock;
 
                 VkDeviceMemory                     hStageMemory{ nullptr };
                 VkBuffer                           hStageBuffer{ nullptr };
@@ -139,6 +165,11 @@ namespace Dfl {
                 VkBuffer                           hIntermediateBuffer{ nullptr };
 
                 void*                              pStageMemoryMap{ nullptr };
+
+                std::vector<VkFence>               StageFences{ }; // one per slot of the stage ring
+                std::vector<bool>                  StageClaims{ }; // one per slot of the stage ring
+                uint32_t                           NextStageSlot{ 0 };
+                std::mutex                         StageLock;
             };
 
             struct Handles {
@@ -151,8 +182,9 @@ namespace Dfl {
             };
 
             static constexpr uint64_t StageMemory{ 65536 }; // 64 KB of stage memory
-            static constexpr uint64_t IntermediateMemory{ 829440 }; // 24 MB of intermediate memory for copying to images
-            // roughly the size of a 4K image
+            static constexpr uint64_t StageSlotMemory{ 65536 }; // 64 KB in each slot of the stage ring
+            static constexpr uint32_t StageSlots{ 4 };
+            static constexpr uint64_t IntermediateMemory{ 829440 }; // 810 KB of intermediate memory for reading images back and converting formats
         protected:
             const std::unique_ptr<const Info>             pInfo{ };
             const std::unique_ptr<const Characteristics>  pCharacteristics{ };
@@ -191,9 +223,43 @@ namespace Dfl {
             DFL_CALL                           GetFence(
                                                     const uint32_t queueFamilyIndex,
                                                     const uint32_t queueIndex) const;
+            // Lends a timeline semaphore, along with the value it has reached (0 if
+            // it's new). Owners signal values past that, and give it back with
+            // ReturnTimeline once the device is done with their work. Semaphores
+            // given back are lent again instead of being destroyed, so points of
+            // their earlier owners can still be waited on.
+            DFL_API
+            const TimelinePoint
+            DFL_CALL                           GetTimeline() const;
+            DFL_API
+                  void
+            DFL_CALL                           ReturnTimeline(const VkSemaphore timeline) const noexcept;
+            // Claims the next slot of the stage ring, if the device is done with it and
+            // no one else holds it. Whoever claims it writes to it, submits the copy out
+            // of it with its fence (reset right before) and gives it back with
+            // ReturnStageSlot. If it isn't claimed, its fence is what to wait for
+            // before trying again. Slots aren't mapped if the stage isn't.
+            DFL_API
+            const StageSlot
+            DFL_CALL                           ClaimStageSlot() const noexcept;
+            DFL_API
+                  void
+            DFL_CALL                           ReturnStageSlot(const StageSlot& slot) const noexcept;
+            // Lends the least claimed queue of the first family of the type. Sparse
+            // queues can also copy. If no family is of the type, the queue's handle
+            // is null.
             DFL_API
             const Queue                       
             DFL_CALL                           BorrowQueue(Queue::Type type) noexcept;
+            // Imports host memory, so that the device can access it directly. 
+            // Returns null if the memory can't be imported (e.g. it's not aligned to
+            // HostPointerAlignment, or no coherent type in typeBits can hold it).
+            DFL_API
+            const VkDeviceMemory
+            DFL_CALL                           ImportHostMemory(
+                                                    void*    pMemory,
+                                                    uint64_t size,
+                                                    uint32_t typeBits) noexcept;
             template< MemoryType type >
             const VkDeviceMemory               BorrowMemory(
                                                     uint64_t heapIndex,
@@ -202,6 +268,13 @@ namespace Dfl {
                                                     bool     isHostCoherent,
                                                     bool     hasAnyProperty,
                                                     uint64_t size) noexcept;
+            // Allocates memory of exactly typeIndex, which has to be one of the
+            // heap's types; null if it isn't, or the heap doesn't have room
+            template< MemoryType type >
+            const VkDeviceMemory               BorrowMemory(
+                                                    uint64_t heapIndex,
+                                                    uint32_t typeIndex,
+                                                    uint64_t size) noexcept;
             
                   void                         ReturnQueue(Queue queue) noexcept {
                                                     this->pTracker->
@@ -216,6 +289,9 @@ namespace Dfl {
                                                     if constexpr (type == MemoryType::Local) { this->pTracker->UsedLocalMemoryHeaps[heapIndex] += size; }
                                                     else { this->pTracker->UsedSharedMemoryHeaps[heapIndex] += size; }
                                                     
+                                                    vkFreeMemory(this->GPU, memory, nullptr); };
+                  void                         ReturnHostMemory(VkDeviceMemory memory) noexcept {
+                                                    this->pTracker->Allocations--;
                                                     vkFreeMemory(this->GPU, memory, nullptr); };
         };
     }
@@ -299,4 +375,65 @@ const VkDeviceMemory Dfl::Hardware::Device::BorrowMemory(
 
     this->pTracker->Allocations++;
     return memory;
-}
\ No newline at end of file
+}
+
+template< Dfl::Hardware::Device::MemoryType type >
+const VkDeviceMemory Dfl::Hardware::Device::BorrowMemory(
+                                        uint64_t heapIndex,
+                                        uint32_t typeIndex,
+                                        uint64_t size) noexcept
+{
+    if( heapIndex >= ( type == Device::MemoryType::Local 
+                          ? this->pCharacteristics->LocalHeaps.size()
+                          : this->pCharacteristics->SharedHeaps.size() ) )
+    {
+        return nullptr;
+    }
+
+    if (this->pTracker->Allocations + 1 > this->pCharacteristics->MaxAllocations)
+    {
+        return nullptr;
+    }
+
+    const auto& heap{ [&]() -> const auto& {
+                        if constexpr (type == Device::MemoryType::Local) { return this->pCharacteristics->LocalHeaps[heapIndex]; }
+                        else { return this->pCharacteristics->SharedHeaps[heapIndex]; } }() };
+    uint64_t& usedMemory{ type == Device::MemoryType::Local
+                            ? this->pTracker->UsedLocalMemoryHeaps[heapIndex]
+                            : this->pTracker->UsedSharedMemoryHeaps[heapIndex] };
+
+    bool isInHeap{ false };
+    for (auto& property : heap.MemProperties)
+    {
+        if (property.TypeIndex == typeIndex)
+        {
+            isInHeap = true;
+            break;
+        }
+    }
+    if ( !isInHeap
+         || heap - usedMemory <= size )
+    {
+        return nullptr;
+    }
+
+    VkDeviceMemory memory{ nullptr };
+    VkMemoryAllocateInfo memInfo{
+        .sType{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO },
+        .pNext{ nullptr },
+        .allocationSize{ size },
+        .memoryTypeIndex{ typeIndex }
+    };
+    if ( vkAllocateMemory(
+                    this->GPU,
+                    &memInfo,
+                    nullptr,
+                    &memory) != VK_SUCCESS ) 
+    {
+        return nullptr;
+    }
+
+    usedMemory += size;
+    this->pTracker->Allocations++;
+    return memory;
+}
@@ -0,0 +1,638 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Dragonfly.Hardware.Profiler.hxx"
+
+#include <thread>
+#include <fstream>
+#include <algorithm>
+
+namespace DflHW = Dfl::Hardware;
+
+// Internal for Profiler constructor
+
+static inline double INT_GetTimestampPeriod(const VkPhysicalDevice& hPhysDevice)
+{
+    VkPhysicalDeviceProperties props{ };
+    vkGetPhysicalDeviceProperties(hPhysDevice, &props);
+
+    // software drivers report a period as well, so this is never 0
+    // on a conformant implementation
+    return props.limits.timestampPeriod > 0.0f
+           ? static_cast<double>(props.limits.timestampPeriod)
+           : 1.0;
+}
+
+// Timestamps can only be written on families whose valid bits aren't 0
+static inline std::vector<uint32_t> INT_GetTimestampBits(const VkPhysicalDevice& hPhysDevice)
+{
+    uint32_t familyCount{ 0 };
+    vkGetPhysicalDeviceQueueFamilyProperties(hPhysDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(hPhysDevice, &familyCount, families.data());
+
+    std::vector<uint32_t> bits(familyCount, 0);
+    for (uint32_t i{ 0 }; i < familyCount; i++)
+    {
+        bits[i] = families[i].timestampValidBits;
+    }
+
+    return bits;
+}
+
+static inline bool INT_CanQueryStatistics(
+    const VkPhysicalDevice& hPhysDevice,
+    const bool              doStatistics)
+{
+    if (!doStatistics)
+    {
+        return false;
+    }
+
+    VkPhysicalDeviceFeatures features{ };
+    vkGetPhysicalDeviceFeatures(hPhysDevice, &features);
+
+    return features.pipelineStatisticsQuery == VK_TRUE;
+}
+
+// the statistics the device writes, in the order of their bits
+static constexpr VkQueryPipelineStatisticFlags INT_StatisticsFlags{ 
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT
+    | VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT };
+
+static DflHW::Profiler::Handles INT_GetHandles(
+    const VkDevice& hGPU,
+    const uint32_t  queryCount,
+    const bool      doStatistics)
+{
+    const VkQueryPoolCreateInfo poolInfo{
+        .sType{ VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .queryType{ VK_QUERY_TYPE_TIMESTAMP },
+        .queryCount{ queryCount },
+        .pipelineStatistics{ 0 }
+    };
+
+    VkQueryPool timestamps{ nullptr };
+    if ( vkCreateQueryPool(
+            hGPU,
+            &poolInfo,
+            nullptr,
+            &timestamps) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create timestamp query pool",
+                L"INT_GetHandles");
+    }
+
+    // queries start in an undefined state
+    vkResetQueryPool(
+        hGPU,
+        timestamps,
+        0,
+        queryCount);
+
+    if (!doStatistics)
+    {
+        return { timestamps, nullptr };
+    }
+
+    // one statistics query per zone, so half as many as timestamps
+    const VkQueryPoolCreateInfo statisticsInfo{
+        .sType{ VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .queryType{ VK_QUERY_TYPE_PIPELINE_STATISTICS },
+        .queryCount{ queryCount / 2 },
+        .pipelineStatistics{ INT_StatisticsFlags }
+    };
+
+    VkQueryPool statistics{ nullptr };
+    if ( vkCreateQueryPool(
+            hGPU,
+            &statisticsInfo,
+            nullptr,
+            &statistics) != VK_SUCCESS )
+    {
+        vkDestroyQueryPool(
+            hGPU,
+            timestamps,
+            nullptr);
+
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create pipeline statistics query pool",
+                L"INT_GetHandles");
+    }
+
+    vkResetQueryPool(
+        hGPU,
+        statistics,
+        0,
+        queryCount / 2);
+
+    return { timestamps, statistics };
+}
+
+static inline std::unique_ptr<DflHW::Profiler::Tracker> INT_GetTracker(const uint32_t frameCount)
+{
+    auto pTracker{ std::make_unique<DflHW::Profiler::Tracker>() };
+    pTracker->Slots.resize(frameCount);
+    pTracker->Slots[0].Begin = std::chrono::steady_clock::now();
+
+    return pTracker;
+}
+
+static inline std::string INT_EscapeJSON(const std::string& text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (const char character : text)
+    {
+        if (character == '"' || character == '\\')
+        {
+            escaped.push_back('\\');
+        }
+        escaped.push_back(character);
+    }
+
+    return escaped;
+}
+
+// Dragonfly.Hardware.Profiler
+
+DflHW::Profiler::Profiler(const Info& info)
+: pInfo( new Info(info) ),
+  TimestampPeriod( INT_GetTimestampPeriod(info.Device.GetPhysicalDevice()) ),
+  TimestampBits( INT_GetTimestampBits(info.Device.GetPhysicalDevice()) ),
+  CanQueryStatistics( INT_CanQueryStatistics(
+                        info.Device.GetPhysicalDevice(),
+                        info.DoStatistics) ),
+  Origin( std::chrono::steady_clock::now() ),
+  Queries( INT_GetHandles(
+             info.Device.GetDevice(),
+             2 * info.FrameCount * info.MaxZones,
+             this->CanQueryStatistics) ),
+  pTracker( INT_GetTracker(info.FrameCount) )
+{
+}
+
+DflHW::Profiler::~Profiler()
+{
+    vkDeviceWaitIdle(this->pInfo->Device.GetDevice());
+
+    if (this->Queries.hStatistics != nullptr)
+    {
+        vkDestroyQueryPool(
+            this->pInfo->Device.GetDevice(),
+            this->Queries.hStatistics,
+            nullptr);
+    }
+
+    vkDestroyQueryPool(
+        this->pInfo->Device.GetDevice(),
+        this->Queries.hTimestamps,
+        nullptr);
+}
+
+uint32_t DflHW::Profiler::BeginZone(
+    const VkCommandBuffer& cmdBuffer,
+    const uint32_t         family,
+    const std::string&     name,
+    const bool             doStatistics) noexcept
+{
+    if ( family >= this->TimestampBits.size()
+         || this->TimestampBits[family] == 0 ) [[ unlikely ]]
+    {
+        return UINT32_MAX;
+    }
+
+    std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+
+    Slot& slot{ this->pTracker->Slots[this->pTracker->Current] };
+    if ( !this->pTracker->IsCurrentUsable
+         || slot.Used >= this->pInfo->MaxZones ) [[ unlikely ]]
+    {
+        return UINT32_MAX;
+    }
+
+    // every zone takes two consecutive queries, beginning and end
+    const uint32_t query{ 2 * (this->pTracker->Current * this->pInfo->MaxZones + slot.Used) };
+    slot.Names.push_back(name);
+    slot.HasStatistics.push_back(doStatistics);
+    slot.CmdBuffers.push_back(cmdBuffer);
+    slot.ValidBits.push_back(this->TimestampBits[family]);
+    slot.IsDiscarded.push_back(false);
+    slot.Used++;
+    slot.IsPending = true;
+
+    vkCmdWriteTimestamp2(
+        cmdBuffer,
+        VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        this->Queries.hTimestamps,
+        query);
+
+    // the statistics query of a zone has the same index as the zone
+    if (doStatistics)
+    {
+        vkCmdBeginQuery(
+            cmdBuffer,
+            this->Queries.hStatistics,
+            query / 2,
+            0);
+    }
+
+    return query;
+}
+
+void DflHW::Profiler::EndZone(
+    const VkCommandBuffer& cmdBuffer,
+    const uint32_t         query,
+    const bool             hasStatistics) noexcept
+{
+    if (query == UINT32_MAX)
+    {
+        return;
+    }
+
+    if (hasStatistics)
+    {
+        vkCmdEndQuery(
+            cmdBuffer,
+            this->Queries.hStatistics,
+            query / 2);
+    }
+
+    vkCmdWriteTimestamp2(
+        cmdBuffer,
+        VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        this->Queries.hTimestamps,
+        query + 1);
+}
+
+void DflHW::Profiler::AddSample(Sample&& sample) noexcept
+{
+    if (this->pTracker->History.size() >= this->pInfo->HistoryLength)
+    {
+        this->pTracker->History.pop_front();
+    }
+    this->pTracker->History.push_back(std::move(sample));
+}
+
+bool DflHW::Profiler::CollectSlot(const uint32_t index) noexcept
+{
+    Slot& slot{ this->pTracker->Slots[index] };
+    if (!slot.IsPending)
+    {
+        return true;
+    }
+
+    const VkDevice& device{ this->pInfo->Device.GetDevice() };
+    const uint32_t  firstQuery{ 2 * index * this->pInfo->MaxZones };
+
+    // each query is followed by its availability. Discarded zones are never
+    // available, so the pool may not be ready as a whole, and every zone that
+    // isn't discarded is checked instead.
+    std::vector<uint64_t> results(4 * static_cast<size_t>(slot.Used), 0);
+    if (slot.Used > 0)
+    {
+        const VkResult result{ vkGetQueryPoolResults(
+                                    device,
+                                    this->Queries.hTimestamps,
+                                    firstQuery,
+                                    2 * slot.Used,
+                                    results.size() * sizeof(uint64_t),
+                                    results.data(),
+                                    2 * sizeof(uint64_t),
+                                    VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT) };
+        if (result != VK_SUCCESS && result != VK_NOT_READY)
+        {
+            return false;
+        }
+    }
+    for (uint32_t zone{ 0 }; zone < slot.Used; zone++)
+    {
+        if ( !slot.IsDiscarded[zone]
+             && ( results[4 * zone + 1] == 0
+                  || results[4 * zone + 3] == 0 ) )
+        {
+            return false;
+        }
+    }
+
+    // four statistics and their availability per zone
+    std::vector<uint64_t> statistics(5 * static_cast<size_t>(slot.Used), 0);
+    for (uint32_t zone{ 0 }; zone < slot.Used; zone++)
+    {
+        if ( slot.HasStatistics[zone]
+             && !slot.IsDiscarded[zone]
+             && vkGetQueryPoolResults(
+                    device,
+                    this->Queries.hStatistics,
+                    firstQuery / 2 + zone,
+                    1,
+                    5 * sizeof(uint64_t),
+                    &statistics[5 * zone],
+                    5 * sizeof(uint64_t),
+                    VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT) != VK_SUCCESS )
+        {
+            return false;
+        }
+    }
+
+    // GPU ticks have no relation to the CPU clock, so the frame's GPU
+    // zones are placed relative to its first timestamp, starting
+    // when the frame began on the CPU
+    uint64_t firstTick{ UINT64_MAX };
+    for (uint32_t zone{ 0 }; zone < slot.Used; zone++)
+    {
+        if (!slot.IsDiscarded[zone])
+        {
+            firstTick = std::min(firstTick, results[4 * zone]);
+        }
+    }
+    const double frameBegin{ std::chrono::duration<double, std::micro>(slot.Begin - this->Origin).count() };
+
+    for (uint32_t zone{ 0 }; zone < slot.Used; zone++)
+    {
+        if (slot.IsDiscarded[zone])
+        {
+            continue;
+        }
+
+        // bits past the valid ones are 0, so a counter that wrapped around
+        // during the zone is recovered by masking the difference
+        const uint64_t mask{ slot.ValidBits[zone] >= 64
+                                ? UINT64_MAX
+                                : (uint64_t{ 1 } << slot.ValidBits[zone]) - 1 };
+        const uint64_t begin{ results[4 * zone] };
+        const uint64_t end{ results[4 * zone + 2] };
+
+        const PipelineStatistics zoneStatistics{
+            .VertexInvocations{ statistics[5 * zone] },
+            .ClippingPrimitives{ statistics[5 * zone + 1] },
+            .FragmentInvocations{ statistics[5 * zone + 2] },
+            .ComputeInvocations{ statistics[5 * zone + 3] } };
+        slot.Totals.Statistics.VertexInvocations += zoneStatistics.VertexInvocations;
+        slot.Totals.Statistics.ClippingPrimitives += zoneStatistics.ClippingPrimitives;
+        slot.Totals.Statistics.FragmentInvocations += zoneStatistics.FragmentInvocations;
+        slot.Totals.Statistics.ComputeInvocations += zoneStatistics.ComputeInvocations;
+
+        this->AddSample({
+            .Name{ std::move(slot.Names[zone]) },
+            .Start{ frameBegin + ((begin - firstTick) & mask) * this->TimestampPeriod / 1000.0 },
+            .Duration{ ((end - begin) & mask) * this->TimestampPeriod / 1000.0 },
+            .Frame{ slot.Frame },
+            .Thread{ 0 },
+            .IsGPU{ true },
+            .Statistics{ zoneStatistics } });
+    }
+
+    if (slot.Used > 0)
+    {
+        vkResetQueryPool(
+            device,
+            this->Queries.hTimestamps,
+            firstQuery,
+            2 * slot.Used);
+
+        if (this->Queries.hStatistics != nullptr)
+        {
+            vkResetQueryPool(
+                device,
+                this->Queries.hStatistics,
+                firstQuery / 2,
+                slot.Used);
+        }
+    }
+
+    // frames finish in order, so the last one read is the most recent
+    if (slot.Totals.Frame >= this->pTracker->Latest.Frame)
+    {
+        this->pTracker->Latest = slot.Totals;
+    }
+
+    slot.Used = 0;
+    slot.Names.clear();
+    slot.HasStatistics.clear();
+    slot.CmdBuffers.clear();
+    slot.ValidBits.clear();
+    slot.IsDiscarded.clear();
+    slot.Totals = { };
+    slot.IsPending = false;
+
+    return true;
+}
+
+void DflHW::Profiler::BeginFrame() noexcept
+{
+    std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+
+    auto& tracker{ *this->pTracker };
+
+    // the finished frame keeps its counters until its zones are read,
+    // so the two always describe the same frame
+    if (tracker.IsCurrentUsable)
+    {
+        Slot& finished{ tracker.Slots[tracker.Current] };
+        finished.Totals.Frame = finished.Frame;
+        finished.Totals.DrawCalls = tracker.EngineCounters[static_cast<unsigned int>(Counter::DrawCalls)].exchange(0);
+        finished.Totals.BytesUploaded = tracker.EngineCounters[static_cast<unsigned int>(Counter::BytesUploaded)].exchange(0);
+        finished.Totals.BarriersIssued = tracker.EngineCounters[static_cast<unsigned int>(Counter::BarriersIssued)].exchange(0);
+        finished.IsPending = true;
+    }
+    else 
+    {
+        for (auto& counter : tracker.EngineCounters)
+        {
+            counter.store(0);
+        }
+    }
+
+    tracker.Frame++;
+    tracker.Current = (tracker.Current + 1) % this->pInfo->FrameCount;
+
+    for (uint32_t i{ 1 }; i < this->pInfo->FrameCount; i++)
+    {
+        this->CollectSlot((tracker.Current + i) % this->pInfo->FrameCount);
+    }
+
+    // if the device is so far behind that the slot is still in use,
+    // the frame is not profiled rather than waiting for it
+    Slot& slot{ tracker.Slots[tracker.Current] };
+    tracker.IsCurrentUsable = this->CollectSlot(tracker.Current);
+    if (!tracker.IsCurrentUsable) [[ unlikely ]]
+    {
+        tracker.DroppedFrames++;
+        return;
+    }
+
+    slot.Frame = tracker.Frame;
+    slot.Begin = std::chrono::steady_clock::now();
+}
+
+void DflHW::Profiler::Collect() noexcept
+{
+    std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+
+    // the current slot may still be recorded into
+    for (uint32_t i{ 1 }; i < this->pInfo->FrameCount; i++)
+    {
+        this->CollectSlot((this->pTracker->Current + i) % this->pInfo->FrameCount);
+    }
+}
+
+void DflHW::Profiler::Discard(const VkCommandBuffer& cmdBuffer) noexcept
+{
+    std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+
+    // earlier recordings of the command buffer are done executing, since it
+    // was recorded again, so of its zones only those of the last recording
+    // aren't available
+    for (uint32_t index{ 0 }; index < this->pInfo->FrameCount; index++)
+    {
+        Slot& slot{ this->pTracker->Slots[index] };
+        for (uint32_t zone{ 0 }; zone < slot.Used; zone++)
+        {
+            if ( slot.CmdBuffers[zone] != cmdBuffer
+                 || slot.IsDiscarded[zone] )
+            {
+                continue;
+            }
+
+            std::array<uint64_t, 4> results{ };
+            vkGetQueryPoolResults(
+                this->pInfo->Device.GetDevice(),
+                this->Queries.hTimestamps,
+                2 * (index * this->pInfo->MaxZones + zone),
+                2,
+                results.size() * sizeof(uint64_t),
+                results.data(),
+                2 * sizeof(uint64_t),
+                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+            slot.IsDiscarded[zone] = results[1] == 0 || results[3] == 0;
+        }
+    }
+}
+
+auto DflHW::Profiler::GetCounters() const noexcept
+-> Counters
+{
+    std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+
+    return this->pTracker->Latest;
+}
+
+auto DflHW::Profiler::GetSamples() const noexcept
+-> std::vector<Sample>
+{
+    std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+
+    return { this->pTracker->History.begin(), this->pTracker->History.end() };
+}
+
+bool DflHW::Profiler::ExportChromeTrace(const std::filesystem::path& path) const noexcept
+{
+    const auto samples{ this->GetSamples() };
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+    for (const auto& sample : samples)
+    {
+        file << ",\n{\"name\":\"" << INT_EscapeJSON(sample.Name)
+             << "\",\"cat\":\"" << (sample.IsGPU ? "GPU" : "CPU")
+             << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << sample.Thread
+             << ",\"ts\":" << sample.Start
+             << ",\"dur\":" << sample.Duration
+             << ",\"args\":{\"frame\":" << sample.Frame;
+        if (sample.IsGPU)
+        {
+            file << ",\"vertex invocations\":" << sample.Statistics.VertexInvocations
+                 << ",\"clipping primitives\":" << sample.Statistics.ClippingPrimitives
+                 << ",\"fragment invocations\":" << sample.Statistics.FragmentInvocations
+                 << ",\"compute invocations\":" << sample.Statistics.ComputeInvocations;
+        }
+        file << "}}";
+    }
+    file << "\n]}\n";
+
+    return file.good();
+}
+
+// Dragonfly.Hardware.Profiler.Zone
+
+DflHW::Profiler::Zone::Zone(
+    Profiler*              profiler,
+    const VkCommandBuffer& cmdBuffer,
+    const uint32_t         family,
+    const std::string&     name,
+    const bool             doStatistics)
+: pProfiler( profiler ),
+  hCmdBuffer( cmdBuffer ),
+  HasStatistics( profiler != nullptr
+                 && doStatistics
+                 && profiler->Queries.hStatistics != nullptr ),
+  Query( profiler == nullptr
+         ? UINT32_MAX
+         : profiler->BeginZone(cmdBuffer, family, name, this->HasStatistics) )
+{
+}
+
+DflHW::Profiler::Zone::~Zone()
+{
+    if (this->pProfiler != nullptr)
+    {
+        this->pProfiler->EndZone(this->hCmdBuffer, this->Query, this->HasStatistics);
+    }
+}
+
+// Dragonfly.Hardware.Profiler.CPUZone
+
+DflHW::Profiler::CPUZone::CPUZone(
+    Profiler*          profiler,
+    const std::string& name)
+: pProfiler( profiler ),
+  Name( profiler == nullptr ? "" : name ),
+  Begin( std::chrono::steady_clock::now() )
+{
+}
+
+DflHW::Profiler::CPUZone::~CPUZone()
+{
+    if (this->pProfiler == nullptr)
+    {
+        return;
+    }
+
+    const auto end{ std::chrono::steady_clock::now() };
+
+    std::lock_guard<std::mutex> lock(this->pProfiler->pTracker->Lock);
+    this->pProfiler->AddSample({
+        .Name{ this->Name },
+        .Start{ std::chrono::duration<double, std::micro>(this->Begin - this->pProfiler->Origin).count() },
+        .Duration{ std::chrono::duration<double, std::micro>(end - this->Begin).count() },
+        .Frame{ this->pProfiler->pTracker->Frame },
+        .Thread{ std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1 }, // never 0, which is the GPU
+        .IsGPU{ false } });
+}
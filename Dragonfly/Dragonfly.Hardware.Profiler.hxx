@@ -0,0 +1,237 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <filesystem>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "Dragonfly.h"
+
+#include "Dragonfly.Generics.hxx"
+#include "Dragonfly.Hardware.Device.hxx"
+
+namespace Dfl {
+    // Dragonfly.Hardware
+    namespace Hardware {
+        // Dragonfly.Hardware.Profiler
+        class Profiler {
+        public:
+            struct Info {
+                      Hardware::Device& Device;
+                const uint32_t          FrameCount{ 3 }; // frames whose zones can be in flight at once. Results are read this many frames late at most
+                const uint32_t          MaxZones{ 256 }; // GPU zones per frame. Zones past this are not timed
+                const uint32_t          HistoryLength{ 8192 }; // samples kept for reading and exporting
+                const bool              DoStatistics{ false }; // collect pipeline statistics in zones that ask for them. Ignored if the device can't
+            };
+
+            // What the engine counts on its own, as opposed to what the device reports
+            enum class Counter : unsigned int {
+                DrawCalls,
+                BytesUploaded,
+                BarriersIssued,
+            };
+
+            // Ordered as the device writes them, which is by flag bit
+            struct PipelineStatistics {
+                uint64_t VertexInvocations{ 0 };
+                uint64_t ClippingPrimitives{ 0 };
+                uint64_t FragmentInvocations{ 0 };
+                uint64_t ComputeInvocations{ 0 };
+            };
+
+            // The totals of one frame
+            struct Counters {
+                uint64_t           Frame{ 0 };
+
+                uint64_t           DrawCalls{ 0 };
+                uint64_t           BytesUploaded{ 0 };
+                uint64_t           BarriersIssued{ 0 };
+
+                PipelineStatistics Statistics{ };
+            };
+
+            // A finished zone. Times are in microseconds since the profiler was created.
+            struct Sample {
+                std::string        Name{ };
+                double             Start{ 0.0 };
+                double             Duration{ 0.0 };
+                uint64_t           Frame{ 0 };
+                uint64_t           Thread{ 0 }; // 0 for the GPU
+                bool               IsGPU{ false };
+
+                PipelineStatistics Statistics{ }; // only for GPU zones that asked for them
+            };
+
+            struct Handles {
+                const VkQueryPool hTimestamps{ nullptr };
+                const VkQueryPool hStatistics{ nullptr }; // null if statistics are not collected
+
+                operator VkQueryPool() const { return this->hTimestamps; }
+            };
+
+            // The queries of one frame. A slot is reset from the host once all its
+            // results have been read, so reading never waits on the device.
+            struct Slot {
+                uint64_t                 Frame{ 0 };
+                uint32_t                 Used{ 0 };
+                bool                     IsPending{ false }; // has zones that have not been read yet
+                std::vector<std::string> Names{ };
+                std::vector<bool>        HasStatistics{ };
+                std::vector<VkCommandBuffer>
+                                         CmdBuffers{ };
+                std::vector<uint32_t>    ValidBits{ }; // of the timestamps of the zone's queue family
+                std::vector<bool>        IsDiscarded{ }; // never submitted, so never read
+                std::chrono::steady_clock::time_point
+                                         Begin{ };
+
+                Counters                 Totals{ };
+            };
+
+            struct Tracker {
+                std::vector<Slot>        Slots{ };
+                uint32_t                 Current{ 0 };
+                bool                     IsCurrentUsable{ true }; // false if the current slot could not be freed in time
+                uint64_t                 Frame{ 0 };
+                uint64_t                 DroppedFrames{ 0 };
+
+                std::deque<Sample>       History{ };
+
+                std::array<
+                    std::atomic<uint64_t>, 3> EngineCounters{ }; // of the frame being recorded
+                Counters                 Latest{ }; // of the last frame whose results were read
+
+                std::mutex               Lock;
+            };
+
+            // Times the GPU work recorded in a command buffer during its lifetime.
+            // A null profiler makes the zone do nothing, so callers can
+            // profile optionally without branching. So does a queue family
+            // without timestamps.
+            // Pipeline statistics can only be asked for on graphics and compute queues.
+            // If the command buffer isn't submitted after all, the profiler has
+            // to be told with Discard.
+            class Zone {
+                      Profiler* const pProfiler{ nullptr };
+                const VkCommandBuffer hCmdBuffer{ nullptr };
+                const bool            HasStatistics{ false };
+                const uint32_t        Query{ UINT32_MAX };
+            public:
+                DFL_API DFL_CALL Zone(
+                                    Profiler*              profiler,
+                                    const VkCommandBuffer& cmdBuffer,
+                                    const uint32_t         family, // the command buffer is submitted to
+                                    const std::string&     name,
+                                    const bool             doStatistics = false);
+                DFL_API DFL_CALL ~Zone();
+
+                Zone(const Zone&) = delete;
+                Zone& operator= (const Zone&) = delete;
+            };
+
+            // Times the work of the calling thread during its lifetime.
+            class CPUZone {
+                      Profiler* const                       pProfiler{ nullptr };
+                const std::string                           Name{ };
+                const std::chrono::steady_clock::time_point Begin{ };
+            public:
+                DFL_API DFL_CALL CPUZone(
+                                    Profiler*          profiler,
+                                    const std::string& name);
+                DFL_API DFL_CALL ~CPUZone();
+
+                CPUZone(const CPUZone&) = delete;
+                CPUZone& operator= (const CPUZone&) = delete;
+            };
+
+        protected:
+            const std::unique_ptr<const Info>           pInfo{ nullptr };
+            const double                                TimestampPeriod{ 1.0 }; // nanoseconds per tick
+            const std::vector<uint32_t>                 TimestampBits{ }; // valid bits of timestamps, per queue family
+            const bool                                  CanQueryStatistics{ false };
+            const std::chrono::steady_clock::time_point Origin{ };
+            const Handles                               Queries{ };
+            const std::unique_ptr<Tracker>              pTracker{ nullptr };
+
+                  uint32_t                              BeginZone(
+                                                            const VkCommandBuffer& cmdBuffer,
+                                                            const uint32_t         family,
+                                                            const std::string&     name,
+                                                            const bool             doStatistics) noexcept;
+                  void                                  EndZone(
+                                                            const VkCommandBuffer& cmdBuffer,
+                                                            const uint32_t         query,
+                                                            const bool             hasStatistics) noexcept;
+                  void                                  AddSample(Sample&& sample) noexcept;
+                  bool                                  CollectSlot(const uint32_t slot) noexcept; // expects the lock to be held
+        public:
+            DFL_API DFL_CALL Profiler(const Info& info);
+            DFL_API DFL_CALL ~Profiler();
+
+                  Device&           GetDevice() const noexcept {
+                                        return this->pInfo->Device; }
+            const double            GetTimestampPeriod() const noexcept {
+                                        return this->TimestampPeriod; }
+
+                  void              Count(
+                                        const Counter  counter,
+                                        const uint64_t value) noexcept {
+                                        this->pTracker->EngineCounters[static_cast<unsigned int>(counter)]
+                                                        .fetch_add(value, std::memory_order_relaxed); }
+
+            // Moves to the slot of the next frame, reading whichever
+            // earlier frames the device is done with
+            DFL_API
+                  void
+            DFL_CALL                BeginFrame() noexcept;
+            // Reads the results of every frame the device is done with.
+            // Frames still executing are left for a later call.
+            DFL_API
+                  void
+            DFL_CALL                Collect() noexcept;
+            // Gives back the queries of the zones recorded into cmdBuffer, if it
+            // won't be submitted, e.g. because recording or submitting it failed.
+            // Otherwise they never become available, and their frame is never
+            // read nor its slot reused.
+            DFL_API
+                  void
+            DFL_CALL                Discard(const VkCommandBuffer& cmdBuffer) noexcept;
+            DFL_API
+                  std::vector<Sample>
+            DFL_CALL                GetSamples() const noexcept;
+            // The counters of the most recent frame whose results were read
+            DFL_API
+                  Counters
+            DFL_CALL                GetCounters() const noexcept;
+            // Writes the samples in Chrome's trace event format, which
+            // chrome://tracing and Perfetto can open
+            DFL_API
+                  bool
+            DFL_CALL                ExportChromeTrace(const std::filesystem::path& path) const noexcept;
+        };
+    }
+    namespace DflHW = Dfl::Hardware;
+}
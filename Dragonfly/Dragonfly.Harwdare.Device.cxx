@@ -19,6 +19,7 @@
 #include "Dragonfly.Hardware.Device.hxx"
 
 #include <optional>
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include <thread>
@@ -66,6 +67,8 @@ static inline auto INT_OrganizeMemory(
                 dflProps.TypeIndex = j;
                 dflProps.IsHostVisible =
                     props.memoryTypes[j].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT ? true : false;
+                dflProps.IsDeviceLocal =
+                    props.memoryTypes[j].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT ? true : false;
                 
                 if constexpr (type == DflMemType::Local) 
                 { 
@@ -113,6 +116,17 @@ static DflHW::Device::Characteristics INT_OrganizeData(const VkPhysicalDevice& d
     INT_OrganizeMemory(localHeaps, memProps);
     INT_OrganizeMemory(sharedHeaps, memProps);
 
+    // on UMA devices and software drivers every local type is, and with
+    // resizable BAR a discrete device exposes all of its memory this way
+    bool hasMappableLocalMemory{ false };
+    for (const auto& heap : localHeaps)
+    {
+        for (const auto& property : heap.MemProperties)
+        {
+            hasMappableLocalMemory |= property.IsDeviceLocal && property.IsHostVisible;
+        }
+    }
+
     uint32_t currentCheck{ 0x40 }; // represents VkSampleCountFlagBits elements
     uint32_t maxColourSamples{ 0 };
     uint32_t maxDepthSamples{ 0 };
@@ -148,6 +162,26 @@ static DflHW::Device::Characteristics INT_OrganizeData(const VkPhysicalDevice& d
         &extensionCount,
         extensions.data());
 
+    // host memory can only be imported at the alignment the device asks for
+    uint64_t hostPointerAlignment{ 0 };
+    if (std::any_of(
+            extensions.begin(),
+            extensions.end(),
+            [](const VkExtensionProperties& extension) { 
+                return !strcmp(extension.extensionName, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME); }))
+    {
+        VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostProps{
+            .sType{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT },
+            .pNext{ nullptr }
+        };
+        VkPhysicalDeviceProperties2 devProps2{
+            .sType{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 },
+            .pNext{ &hostProps }
+        };
+        vkGetPhysicalDeviceProperties2(device, &devProps2);
+        hostPointerAlignment = hostProps.minImportedHostPointerAlignment;
+    }
+
     return {
         std::string(devProps.deviceName),
         localHeaps, sharedHeaps,
@@ -156,7 +190,10 @@ static DflHW::Device::Characteristics INT_OrganizeData(const VkPhysicalDevice& d
         { devProps.limits.maxComputeWorkGroupCount[0], devProps.limits.maxComputeWorkGroupCount[1], devProps.limits.maxComputeWorkGroupCount[2] },
         devProps.limits.maxMemoryAllocationCount,
         devProps.limits.maxDrawIndirectCount,
-        extensions };
+        extensions,
+        devProps.limits.nonCoherentAtomSize,
+        hasMappableLocalMemory,
+        hostPointerAlignment };
 };
 
 static inline auto INT_OrganizeQueues(const VkPhysicalDevice& device)
@@ -185,6 +222,9 @@ static inline auto INT_OrganizeQueues(const VkPhysicalDevice& device)
     DflGen::BitFlag      queueType{ 0 };
 
     for (uint32_t i{ 0 }; i < queueFamilyCount; i++) {
+        // every family has its own capabilities, not those of the ones before it
+        queueType = 0;
+
         if (props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT &&
             vkGetPhysicalDeviceWin32PresentationSupportKHR(
                 device,
@@ -200,6 +240,10 @@ static inline auto INT_OrganizeQueues(const VkPhysicalDevice& device)
             queueType |= DflHW::Device::Queue::Type::Transfer;
         }
 
+        if (props[i].queueFlags & VK_QUEUE_SPARSE_BINDING_BIT) {
+            queueType |= DflHW::Device::Queue::Type::Sparse;
+        }
+
         queueCount = props[i].queueCount;
         index = i;
 
@@ -247,6 +291,11 @@ static auto INT_GetQueues(
                 1 : family.QueueCount - usedQueues;
         }
 
+        // e.g. families that only bind sparse memory
+        if (usedQueues == 0) {
+            continue;
+        }
+
         VkDeviceQueueCreateInfo info = {
             .sType{ VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO },
             .pNext{ nullptr },
@@ -284,6 +333,15 @@ static DflHW::Device::Handles INT_InitDevice(
                                    simNum,
                                    queueFamilies) };
 
+    // only the queues created can be borrowed
+    for (auto& family : queueFamilies) {
+        const auto info{ std::find_if(
+                            queueInfo.begin(),
+                            queueInfo.end(),
+                            [&family](const VkDeviceQueueCreateInfo& info) { return info.queueFamilyIndex == family.Index; }) };
+        family.QueueCount = info != queueInfo.end() ? info->queueCount : 0;
+    }
+
     float** const priorities = new float* [queueInfo.size()];
     for (uint32_t i{ 0 }; i < queueInfo.size(); i++) 
     {
@@ -305,6 +363,11 @@ static DflHW::Device::Handles INT_InitDevice(
             desiredExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
         }
 
+        if (!strcmp(extension.extensionName, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME)) 
+        {
+            desiredExtensions.push_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+        }
+
         if (!strcmp(extension.extensionName, VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME)) 
         {
             desiredExtensions.push_back(VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME);
@@ -313,9 +376,50 @@ static DflHW::Device::Handles INT_InitDevice(
         }
     }
 
+    // only the features Dragonfly builds upon are enabled, and only
+    // if the device supports them
+    VkPhysicalDeviceVulkan13Features supported13{
+        .sType{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES },
+        .pNext{ nullptr }
+    };
+    VkPhysicalDeviceVulkan12Features supported12{
+        .sType{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES },
+        .pNext{ &supported13 }
+    };
+    VkPhysicalDeviceFeatures2 supported{
+        .sType{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 },
+        .pNext{ &supported12 }
+    };
+    vkGetPhysicalDeviceFeatures2(physDevice, &supported);
+
+    VkPhysicalDeviceVulkan13Features enabled13{
+        .sType{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES },
+        .pNext{ nullptr },
+        .synchronization2{ supported13.synchronization2 }, // the renderer's layout transitions use vkCmdPipelineBarrier2
+        .dynamicRendering{ supported13.dynamicRendering } // pipelines are built against attachment formats, not render passes
+    };
+    VkPhysicalDeviceVulkan12Features enabled12{
+        .sType{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES },
+        .pNext{ &enabled13 },
+        .hostQueryReset{ supported12.hostQueryReset }, // the profiler recycles its queries without recording a command
+        .timelineSemaphore{ supported12.timelineSemaphore } // queues wait on each other's progress without fences
+    };
+    const VkPhysicalDeviceFeatures2 enabled{
+        .sType{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 },
+        .pNext{ &enabled12 },
+        .features{ 
+            .textureCompressionBC{ supported.features.textureCompressionBC }, // images can be stored in BC1-BC7
+            .pipelineStatisticsQuery{ supported.features.pipelineStatisticsQuery }, // for the profiler's optional statistics
+            .shaderStorageImageReadWithoutFormat{ supported.features.shaderStorageImageReadWithoutFormat }, // the downsampler's levels have no declared format,
+            .shaderStorageImageWriteWithoutFormat{ supported.features.shaderStorageImageWriteWithoutFormat }, // so one shader serves every format
+            .shaderStorageImageArrayDynamicIndexing{ supported.features.shaderStorageImageArrayDynamicIndexing }, // the downsampler picks mip levels in a loop
+            .sparseBinding{ supported.features.sparseBinding }, // virtual textures bind memory to their tiles
+            .sparseResidencyImage2D{ supported.features.sparseResidencyImage2D } } // and leave the rest unbound
+    };
+
     const VkDeviceCreateInfo deviceInfo{
        .sType{ VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO },
-       .pNext{ nullptr },
+       .pNext{ &enabled },
        .flags{ 0 },
        .queueCreateInfoCount{ static_cast<uint32_t>(queueInfo.size()) },
        .pQueueCreateInfos{ queueInfo.data() },
@@ -358,6 +462,10 @@ static DflHW::Device::Handles INT_InitDevice(
 
 //
 
+// the stage, followed by the slots of the stage ring
+static constexpr uint64_t INT_StageSize{ DflHW::Device::StageMemory
+                                         + DflHW::Device::StageSlots * DflHW::Device::StageSlotMemory };
+
 const VkDeviceMemory INT_GetStageMemory(
                         const VkDevice&                           gpu,
                         const std::vector<
@@ -383,7 +491,7 @@ const VkDeviceMemory INT_GetStageMemory(
             {
                 stageMemoryIndex = property.TypeIndex;
                 isStageVisible = property.IsHostVisible;
-                usedMemories[i] += DflHW::Device::StageMemory;
+                usedMemories[i] += INT_StageSize;
                 break;
             }
         }
@@ -391,10 +499,10 @@ const VkDeviceMemory INT_GetStageMemory(
 
     if (stageMemoryIndex == std::nullopt) {
         for (uint32_t i{ 0 }; i < memories.size(); i++) {
-            if (memories[i] - usedMemories[i] > DflHW::Device::StageMemory ) {
+            if (memories[i] - usedMemories[i] > INT_StageSize ) {
                 stageMemoryIndex = memories[i].MemProperties[0].TypeIndex;
                 isStageVisible = memories[i].MemProperties[0].IsHostVisible;
-                usedMemories[i] += DflHW::Device::StageMemory;
+                usedMemories[i] += INT_StageSize;
                 break;
             }
         }
@@ -404,7 +512,7 @@ const VkDeviceMemory INT_GetStageMemory(
     VkMemoryAllocateInfo memInfo{
         .sType{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO },
         .pNext{ nullptr },
-        .allocationSize{ DflHW::Device::StageMemory },
+        .allocationSize{ INT_StageSize },
         .memoryTypeIndex{ stageMemoryIndex.value() }
     };
     if ( vkAllocateMemory(
@@ -422,9 +530,10 @@ const VkDeviceMemory INT_GetStageMemory(
         .sType{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO },
         .pNext{ nullptr },
         .flags{ 0 },
-        .size{ DflHW::Device::StageMemory },
+        .size{ INT_StageSize },
         .usage{ VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
-                VK_BUFFER_USAGE_TRANSFER_DST_BIT },
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT }, // read and written by the converter
         .sharingMode{ VK_SHARING_MODE_EXCLUSIVE }
     };
 
@@ -467,7 +576,7 @@ const VkDeviceMemory INT_GetStageMemory(
                 gpu,
                 stageMemory,
                 0,
-                DflHW::Device::StageMemory,
+                INT_StageSize,
                 0,
                 &stageMap) != VK_SUCCESS) 
         {
@@ -549,7 +658,8 @@ const VkDeviceMemory INT_GetIntermediateMem(
         .flags{ 0 },
         .size{ DflHW::Device::IntermediateMemory },
         .usage{ VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
-                VK_BUFFER_USAGE_TRANSFER_DST_BIT },
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT }, // read and written by the converter
         .sharingMode{ VK_SHARING_MODE_EXCLUSIVE }
     };
 
@@ -604,7 +714,7 @@ DflHW::Device::Device(const Info& info)
                 this->pCharacteristics->Extensions) ),
   pTracker( new Tracker() ) 
 {
-     this->pTracker->QueueClaims.resize(this->GPU.Families.size());
+     this->pTracker->QueueClaims.resize(this->GPU.Families.empty() ? 0 : this->GPU.Families.back().Index + 1);
      for (auto& family : this->GPU.Families)
      {
         this->pTracker->QueueClaims[family.Index].resize(family.QueueCount);
@@ -624,6 +734,28 @@ DflHW::Device::Device(const Info& info)
                                                 this->pCharacteristics->LocalHeaps,
                                                 this->pTracker->hIntermediateBuffer,
                                                 this->pTracker->UsedLocalMemoryHeaps);
+
+          // signaled, since every slot of the ring starts out free
+          const VkFenceCreateInfo fenceInfo{
+              .sType{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO },
+              .pNext{ nullptr },
+              .flags{ VK_FENCE_CREATE_SIGNALED_BIT }
+          };
+          this->pTracker->StageFences.resize(StageSlots, nullptr);
+          this->pTracker->StageClaims.resize(StageSlots, false);
+          for (auto& fence : this->pTracker->StageFences)
+          {
+              if ( vkCreateFence(
+                      this->GPU,
+                      &fenceInfo,
+                      nullptr,
+                      &fence) != VK_SUCCESS )
+              {
+                  throw Dfl::Error::HandleCreation(
+                          L"Unable to create fences for the stage ring",
+                          L"Device::Device");
+              }
+          }
      } catch (Dfl::Error::HandleCreation& error) {
          vkDestroyDevice(
              this->GPU,
@@ -642,6 +774,22 @@ DflHW::Device::~Device()
                 nullptr);
     }
 
+    for (auto& fence : this->pTracker->StageFences) 
+    {
+        vkDestroyFence(
+                this->GPU,
+                fence,
+                nullptr);
+    }
+
+    for (auto& timeline : this->pTracker->Timelines) 
+    {
+        vkDestroySemaphore(
+                this->GPU,
+                timeline,
+                nullptr);
+    }
+
     vkDestroyBuffer(
         this->GPU,
         this->pTracker->hIntermediateBuffer,
@@ -666,6 +814,181 @@ DflHW::Device::~Device()
     vkDestroyDevice(this->GPU, nullptr);
 };
 
+auto DflHW::Device::GetTimeline() const
+-> const TimelinePoint
+{
+    std::lock_guard<std::mutex> lock(this->pTracker->TimelineLock);
+
+    if (!this->pTracker->FreeTimelines.empty())
+    {
+        const VkSemaphore timeline{ this->pTracker->FreeTimelines.back() };
+        this->pTracker->FreeTimelines.pop_back();
+
+        // timelines only move forward, so the next owner continues from where the last one stopped
+        uint64_t value{ 0 };
+        vkGetSemaphoreCounterValue(
+            this->GPU,
+            timeline,
+            &value);
+
+        return { .hSemaphore{ timeline },
+                 .Value{ value } };
+    }
+
+    const VkSemaphoreTypeCreateInfo typeInfo{
+        .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO },
+        .pNext{ nullptr },
+        .semaphoreType{ VK_SEMAPHORE_TYPE_TIMELINE },
+        .initialValue{ 0 }
+    };
+    const VkSemaphoreCreateInfo semaphoreInfo{
+        .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO },
+        .pNext{ &typeInfo },
+        .flags{ 0 }
+    };
+
+    VkSemaphore timeline{ nullptr };
+    if ( vkCreateSemaphore(
+            this->GPU,
+            &semaphoreInfo,
+            nullptr,
+            &timeline) != VK_SUCCESS ) {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create timeline semaphore",
+                L"Device::GetTimeline");
+    }
+    this->pTracker->Timelines.push_back(timeline);
+
+    return { .hSemaphore{ timeline },
+             .Value{ 0 } };
+}
+
+void DflHW::Device::ReturnTimeline(const VkSemaphore timeline) const noexcept
+{
+    std::lock_guard<std::mutex> lock(this->pTracker->TimelineLock);
+
+    this->pTracker->FreeTimelines.push_back(timeline);
+}
+
+auto DflHW::Device::ClaimStageSlot() const noexcept
+-> const StageSlot
+{
+    std::lock_guard<std::mutex> lock(this->pTracker->StageLock);
+
+    const uint32_t index{ this->pTracker->NextStageSlot };
+    const uint64_t offset{ StageMemory + index * StageSlotMemory };
+    StageSlot slot{
+        .Index{ index },
+        .Offset{ offset },
+        .pMap{ this->pTracker->pStageMemoryMap == nullptr
+                ? nullptr
+                : static_cast<std::byte*>(this->pTracker->pStageMemoryMap) + offset },
+        .hFence{ this->pTracker->StageFences[index] } };
+
+    if ( !this->pTracker->StageClaims[index]
+         && vkGetFenceStatus(this->GPU, slot.hFence) == VK_SUCCESS )
+    {
+        this->pTracker->StageClaims[index] = true;
+        this->pTracker->NextStageSlot = (index + 1) % StageSlots;
+        slot.IsClaimed = true;
+    }
+
+    return slot;
+}
+
+void DflHW::Device::ReturnStageSlot(const StageSlot& slot) const noexcept
+{
+    std::lock_guard<std::mutex> lock(this->pTracker->StageLock);
+
+    this->pTracker->StageClaims[slot.Index] = false;
+}
+
+const VkDeviceMemory DflHW::Device::ImportHostMemory(
+                            void*    pMemory,
+                            uint64_t size,
+                            uint32_t typeBits) noexcept
+{
+    const uint64_t alignment{ this->pCharacteristics->HostPointerAlignment };
+    if ( alignment == 0
+         || reinterpret_cast<uintptr_t>(pMemory) % alignment != 0
+         || size % alignment != 0 )
+    {
+        return nullptr;
+    }
+
+    if (this->pTracker->Allocations + 1 > this->pCharacteristics->MaxAllocations)
+    {
+        return nullptr;
+    }
+
+    const auto getHostPointerProperties{ 
+        reinterpret_cast<PFN_vkGetMemoryHostPointerPropertiesEXT>(vkGetDeviceProcAddr(
+            this->GPU,
+            "vkGetMemoryHostPointerPropertiesEXT")) };
+    if (getHostPointerProperties == nullptr) 
+    {
+        return nullptr;
+    }
+
+    VkMemoryHostPointerPropertiesEXT hostProps{
+        .sType{ VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT },
+        .pNext{ nullptr }
+    };
+    if ( getHostPointerProperties(
+            this->GPU,
+            VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+            pMemory,
+            &hostProps) != VK_SUCCESS ) 
+    {
+        return nullptr;
+    }
+
+    // the host keeps accessing the memory as it's used to, so it has to be coherent
+    VkPhysicalDeviceMemoryProperties memProps;
+    vkGetPhysicalDeviceMemoryProperties(this->GPU, &memProps);
+
+    std::optional<uint32_t> typeIndex{ std::nullopt };
+    for (uint32_t i{ 0 }; i < memProps.memoryTypeCount; i++)
+    {
+        if ( hostProps.memoryTypeBits & typeBits & (1u << i) 
+             && memProps.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT )
+        {
+            typeIndex = i;
+            break;
+        }
+    }
+
+    if (!typeIndex.has_value())
+    {
+        return nullptr;
+    }
+
+    const VkImportMemoryHostPointerInfoEXT importInfo{
+        .sType{ VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT },
+        .pNext{ nullptr },
+        .handleType{ VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT },
+        .pHostPointer{ pMemory }
+    };
+    const VkMemoryAllocateInfo memInfo{
+        .sType{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO },
+        .pNext{ &importInfo },
+        .allocationSize{ size },
+        .memoryTypeIndex{ typeIndex.value() }
+    };
+    VkDeviceMemory memory{ nullptr };
+    if ( vkAllocateMemory(
+            this->GPU,
+            &memInfo,
+            nullptr,
+            &memory) != VK_SUCCESS ) 
+    {
+        return nullptr;
+    }
+    this->pTracker->Allocations++;
+
+    return memory;
+}
+
 const VkFence DflHW::Device::GetFence(
                     const uint32_t queueFamilyIndex,
                     const uint32_t queueIndex) const 
@@ -700,50 +1023,36 @@ const VkFence DflHW::Device::GetFence(
 
 const DflHW::Device::Queue DflHW::Device::BorrowQueue(DflHW::Device::Queue::Type type) noexcept 
 {
-    VkQueue                 queue{ nullptr };
-    uint32_t                familyIndex{ 0 };
-    uint32_t                leastClaims{ 0 };
-    std::optional<uint32_t> queueIndex{ std::nullopt };
+    // what's bound to sparse resources is filled right after, on the same queue
+    const DflGen::BitFlag needs{ type == Queue::Type::Sparse
+                                   ? DflGen::BitFlag(Queue::Type::Sparse) | Queue::Type::Transfer
+                                   : DflGen::BitFlag(type) };
 
-    while (familyIndex <= this->GPU.Families.size()) 
+    // the least claimed queue of the first family that can do everything needed
+    for (const auto& family : this->GPU.Families)
     {
-        if (familyIndex == this->GPU.Families.size()) 
+        if ( (family.QueueType & needs) != needs
+             || family.QueueCount == 0 ) 
         {
-            familyIndex = 0;
             continue;
         }
 
-        if (!(this->GPU.Families[familyIndex].QueueType & type)) 
-        {
-            familyIndex++;
-            continue;
-        }
-
-        auto& totalClaims{ this->pTracker->QueueClaims[familyIndex] };
-        for( uint32_t i{ 0 }; i < totalClaims.size(); i++ )
-        {
-            if (totalClaims[i] == leastClaims)
-            {
-                queueIndex = i;
-                break;
-            }
-        }
-
-        if (!queueIndex.has_value())
-        {
-            leastClaims++;
-            continue;
-        }
+        auto& claims{ this->pTracker->QueueClaims[family.Index] };
+        const uint32_t queueIndex{ static_cast<uint32_t>(
+                                    std::min_element(claims.begin(), claims.end()) - claims.begin() ) };
 
+        VkQueue queue{ nullptr };
         vkGetDeviceQueue(
             this->GPU,
-            familyIndex,
-            queueIndex.value(),
+            family.Index,
+            queueIndex,
             &queue);
-        this->pTracker->QueueClaims[familyIndex][queueIndex.value()]++;
-        break;
+        claims[queueIndex]++;
+
+        return { queue, family.Index, queueIndex };
     }
 
-    return { queue, familyIndex, queueIndex.value() };
+    // no family can, so there's nothing to lend
+    return { nullptr, 0, 0 };
 }
 
@@ -0,0 +1,317 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Dragonfly.Memory.Atlas.hxx"
+
+#include <algorithm>
+#include <limits>
+#include <atomic>
+
+namespace DflMem = Dfl::Memory;
+namespace DflGen = Dfl::Generics;
+
+// Internal for Atlas
+
+static inline DflMem::Atlas::Image::Info INT_GetPagesInfo(const DflMem::Atlas::Info& info)
+{
+    const DflMem::Atlas::Image::TexelBlock block{ DflMem::Atlas::Image::GetTexelBlock(info.Format) };
+    if (block.Size == 0 || block.IsCompressed())
+    {
+        throw Dfl::Error::Limit(
+                L"Atlas pages have to be in an uncompressed format",
+                L"INT_GetPagesInfo",
+                Dfl::API::None);
+    }
+    if (info.PageSize == 0 || info.Pages == 0)
+    {
+        throw Dfl::Error::Limit(
+                L"Atlas has no pages to pack into",
+                L"INT_GetPagesInfo",
+                Dfl::API::None);
+    }
+
+    return { .MemoryBlock{ info.MemoryBlock },
+             .AccessingQueues{ info.AccessingQueues },
+             .Size{ info.PageSize, info.PageSize, 0 },
+             .MipLevels{ 1 },
+             .Layers{ info.Pages },
+             .Format{ info.Format },
+             .Options{ info.Options } };
+}
+
+// Where the lowest spot for a width * height rect along the skyline is, as the
+// index of the segment its left edge is on, and the height of its bottom.
+// Among spots as low, the leftmost one wins.
+static inline std::optional<std::pair<uint64_t, uint32_t>> INT_FindSpot(
+    const std::vector<DflMem::Atlas::Segment>& skyline,
+    const uint32_t                             pageSize,
+    const uint32_t                             width,
+    const uint32_t                             height)
+{
+    std::optional<std::pair<uint64_t, uint32_t>> spot{ std::nullopt };
+    uint32_t bestTop{ std::numeric_limits<uint32_t>::max() };
+    for (uint64_t i{ 0 }; i < skyline.size(); i++)
+    {
+        // the segments are in order, so past this point nothing fits
+        if (static_cast<uint64_t>(skyline[i].X) + width > pageSize) { break; }
+
+        // the rect rests on the highest of the segments under it
+        uint32_t bottom{ 0 };
+        uint32_t covered{ 0 };
+        for (uint64_t j{ i }; covered < width; j++)
+        {
+            bottom = std::max(bottom, skyline[j].Y);
+            covered += skyline[j].Width;
+        }
+
+        if ( static_cast<uint64_t>(bottom) + height <= pageSize
+             && bottom + height < bestTop )
+        {
+            bestTop = bottom + height;
+            spot = { i, bottom };
+        }
+    }
+
+    return spot;
+}
+
+// Raises the skyline under a rect placed at the spot
+static inline void INT_Place(
+          std::vector<DflMem::Atlas::Segment>& skyline,
+    const uint64_t                             index,
+    const uint32_t                             bottom,
+    const uint32_t                             width,
+    const uint32_t                             height)
+{
+    const uint32_t left{ skyline[index].X };
+    const uint32_t right{ left + width };
+    skyline.insert(
+        skyline.begin() + index,
+        { .X{ left }, .Y{ bottom + height }, .Width{ width } });
+
+    // the segments the rect covers shrink, or go entirely
+    for (uint64_t i{ index + 1 }; i < skyline.size() && skyline[i].X < right;)
+    {
+        const uint32_t overlap{ right - skyline[i].X };
+        if (skyline[i].Width <= overlap)
+        {
+            skyline.erase(skyline.begin() + i);
+            continue;
+        }
+
+        skyline[i].X += overlap;
+        skyline[i].Width -= overlap;
+        break;
+    }
+
+    // and neighbours at the same height become one
+    for (uint64_t i{ 0 }; i + 1 < skyline.size();)
+    {
+        if (skyline[i].Y == skyline[i + 1].Y)
+        {
+            skyline[i].Width += skyline[i + 1].Width;
+            skyline.erase(skyline.begin() + i + 1);
+            continue;
+        }
+        i++;
+    }
+}
+
+// Dragonfly.Memory.Atlas
+
+DflMem::Atlas::Atlas(const Info& info)
+: pInfo( new Info(info) ),
+  Pages( INT_GetPagesInfo(info) ),
+  TexelSize( Image::GetTexelBlock(info.Format).Size ),
+  Skylines( info.Pages, { { .X{ 0 }, .Y{ 0 }, .Width{ info.PageSize } } } )
+{ }
+
+DflMem::Atlas::~Atlas()
+{ }
+
+auto DflMem::Atlas::Add(
+    const std::span<const std::byte> source,
+    const uint32_t                   width,
+    const uint32_t                   height)
+-> std::optional<Rect>
+{
+    if ( width == 0
+         || height == 0
+         || width > this->pInfo->PageSize
+         || height > this->pInfo->PageSize
+         || source.size() < static_cast<uint64_t>(width) * height * this->TexelSize ) [[ unlikely ]]
+    {
+        return std::nullopt;
+    }
+
+    // the padding can go past the page's edges, where there's nothing to bleed
+    // into, so an image as wide as the page has none before it either
+    const uint32_t padding{ this->pInfo->Padding };
+    const std::array<uint32_t, 2> lead{
+        std::min(padding, this->pInfo->PageSize - width),
+        std::min(padding, this->pInfo->PageSize - height) };
+    const uint32_t paddedWidth{ static_cast<uint32_t>(
+                                    std::min<uint64_t>(static_cast<uint64_t>(width) + 2 * static_cast<uint64_t>(padding), this->pInfo->PageSize)) };
+    const uint32_t paddedHeight{ static_cast<uint32_t>(
+                                    std::min<uint64_t>(static_cast<uint64_t>(height) + 2 * static_cast<uint64_t>(padding), this->pInfo->PageSize)) };
+
+    // the first page with room, so the later ones stay empty for as long as possible
+    for (uint32_t layer{ 0 }; layer < this->Skylines.size(); layer++)
+    {
+        const auto spot{ INT_FindSpot(
+                            this->Skylines[layer],
+                            this->pInfo->PageSize,
+                            paddedWidth,
+                            paddedHeight) };
+        if (!spot.has_value()) { continue; }
+
+        const std::array<uint32_t, 2> origin{ this->Skylines[layer][spot->first].X, spot->second };
+        const Rect rect{
+            .Layer{ layer },
+            .Offset{ origin[0] + lead[0], origin[1] + lead[1] },
+            .Size{ width, height } };
+        INT_Place(
+            this->Skylines[layer],
+            spot->first,
+            spot->second,
+            paddedWidth,
+            paddedHeight);
+        this->UsedArea += static_cast<uint64_t>(paddedWidth) * paddedHeight;
+
+        // the pages start out undefined, so the padding is written along with
+        // the image: the rows above and below it repeat its first and last one,
+        // and the texels left and right of it its first and last column, corners
+        // included, so filtering past its edges only finds the edges
+        const uint64_t rowSize{ static_cast<uint64_t>(width) * this->TexelSize };
+        const uint64_t paddedRowSize{ static_cast<uint64_t>(paddedWidth) * this->TexelSize };
+        const uint64_t offset{ this->PendingTexels.size() };
+        this->PendingTexels.resize(offset + paddedRowSize * paddedHeight);
+        for (uint32_t row{ 0 }; row < paddedHeight; row++)
+        {
+            const uint32_t sourceRow{ std::min(row - std::min(row, lead[1]), height - 1) };
+            const std::byte* const pSource{ source.data() + sourceRow * rowSize };
+                  std::byte* const pTarget{ this->PendingTexels.data() + offset + row * paddedRowSize };
+            for (uint32_t x{ 0 }; x < lead[0]; x++)
+            {
+                std::copy(
+                    pSource,
+                    pSource + this->TexelSize,
+                    pTarget + static_cast<uint64_t>(x) * this->TexelSize);
+            }
+            std::copy(pSource, pSource + rowSize, pTarget + static_cast<uint64_t>(lead[0]) * this->TexelSize);
+            for (uint32_t x{ lead[0] + width }; x < paddedWidth; x++)
+            {
+                std::copy(
+                    pSource + rowSize - this->TexelSize,
+                    pSource + rowSize,
+                    pTarget + static_cast<uint64_t>(x) * this->TexelSize);
+            }
+        }
+        this->PendingImages.push_back({
+            .Offset{ offset },
+            .Origin{ origin },
+            .Extent{ paddedWidth, paddedHeight },
+            .Target{ rect } });
+
+        return rect;
+    }
+
+    return std::nullopt;
+}
+
+auto DflMem::Atlas::Upload()
+-> const DflGen::Job<Image::Error>
+{
+    // the texels have to stay until the job is done, so they're kept aside,
+    // along with the images, which go back to pending if the write fails
+    this->UploadingTexels = std::move(this->PendingTexels);
+    this->PendingTexels.clear();
+    this->UploadingImages = std::move(this->PendingImages);
+    this->PendingImages.clear();
+
+    std::vector<Image::Patch> patches{ };
+    patches.reserve(this->UploadingImages.size());
+    for (const auto& pending : this->UploadingImages)
+    {
+        patches.push_back({
+            .Source{ std::span<const std::byte>(this->UploadingTexels).subspan(
+                        pending.Offset,
+                        static_cast<uint64_t>(pending.Extent[0]) * pending.Extent[1] * this->TexelSize) },
+            .RowPitch{ 0 },
+            .Target{
+                .Offset{ static_cast<int32_t>(pending.Origin[0]), static_cast<int32_t>(pending.Origin[1]), 0 },
+                .Extent{ pending.Extent[0], pending.Extent[1], 1 },
+                .Level{ 0 },
+                .Layer{ pending.Target.Layer } } });
+    }
+
+    std::unique_ptr<DflGen::Job<Image::Error>> pWrite{ new DflGen::Job<Image::Error>(
+                                                            this->Pages.Write(std::move(patches))) };
+
+    // never raised, so this job suspends until it's resumed, and resumes the write then
+    const auto pYield{ std::make_shared<const std::atomic_bool>(false) };
+    while (pWrite->GetState() != DflGen::Job<Image::Error>::RoutineState::Done)
+    {
+        co_await DflGen::Job<Image::Error>::Awaitable(pYield);
+        pWrite->Resume();
+    }
+
+    const Image::Error error{ *pWrite };
+    // the images go ahead of those added since, unless Clear threw them away
+    if ( error != Image::Error::Success
+         && !this->UploadingImages.empty() )
+    {
+        for (auto& pending : this->PendingImages)
+        {
+            pending.Offset += this->UploadingTexels.size();
+        }
+        this->PendingTexels.insert(
+            this->PendingTexels.begin(),
+            this->UploadingTexels.begin(),
+            this->UploadingTexels.end());
+        this->PendingImages.insert(
+            this->PendingImages.begin(),
+            this->UploadingImages.begin(),
+            this->UploadingImages.end());
+    }
+    this->UploadingImages.clear();
+
+    co_return error;
+}
+
+void DflMem::Atlas::Clear() noexcept
+{
+    for (auto& skyline : this->Skylines)
+    {
+        skyline = { { .X{ 0 }, .Y{ 0 }, .Width{ this->pInfo->PageSize } } };
+    }
+    this->UsedArea = 0;
+
+    this->PendingImages.clear();
+    this->PendingTexels.clear();
+    // the texels of an upload still running stay until it's done
+    this->UploadingImages.clear();
+}
+
+auto DflMem::Atlas::GetUV(const Rect& rect) const noexcept
+-> std::array<float, 4>
+{
+    const float pageSize{ static_cast<float>(this->pInfo->PageSize) };
+    return { rect.Offset[0] / pageSize,
+             rect.Offset[1] / pageSize,
+             (rect.Offset[0] + rect.Size[0]) / pageSize,
+             (rect.Offset[1] + rect.Size[1]) / pageSize };
+}
@@ -0,0 +1,139 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <array>
+#include <span>
+#include <optional>
+#include <cstddef>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "Dragonfly.h"
+
+#include "Dragonfly.Generics.hxx"
+#include "Dragonfly.Memory.Block.hxx"
+#include "Dragonfly.Memory.Buffer.hxx"
+
+namespace Dfl {
+    // Dragonfly.Memory
+    namespace Memory {
+        // Dragonfly.Memory.Atlas
+        // Packs many small images (icons, sprites, glyphs) into the layers of a
+        // single array image, so they share its handles and its allocation
+        // instead of taking one each. Every layer is a page packed bottom-left
+        // along its skyline: the top edge of what's been placed so far. Added
+        // images are kept on the host until Upload, which writes all of them in
+        // a single submission.
+        // Pages only fill up; Clear empties all of them at once.
+        class Atlas {
+        public:
+            using Image = Buffer<StorageType::Image>;
+
+            struct Info {
+                      Block&                MemoryBlock;
+
+                const std::vector<uint32_t> AccessingQueues;
+
+                const uint32_t              PageSize{ 2048 }; // the width and height of the layers, in texels
+                const uint32_t              Pages{ 4 }; // layers of the image
+                const VkFormat              Format{ VK_FORMAT_R8G8B8A8_UNORM }; // uncompressed
+                const uint32_t              Padding{ 1 }; // texels around every image, repeating its edges, against bleeding when filtering
+
+                const DflGen::BitFlag       Options{ VK_IMAGE_USAGE_SAMPLED_BIT }; // usage of the image
+            };
+
+            // Where an image was placed, in texels
+            struct Rect {
+                uint32_t                Layer{ 0 };
+                std::array<uint32_t, 2> Offset{ 0, 0 };
+                std::array<uint32_t, 2> Size{ 0, 0 };
+            };
+
+            // A run of a page's skyline, from X to X + Width, with its top at Y
+            struct Segment {
+                uint32_t X{ 0 };
+                uint32_t Y{ 0 };
+                uint32_t Width{ 0 };
+            };
+
+        protected:
+            struct Pending {
+                uint64_t                Offset{ 0 }; // of the texels in the pending ones
+                std::array<uint32_t, 2> Origin{ 0, 0 }; // of the image's padding
+                std::array<uint32_t, 2> Extent{ 0, 0 }; // of the image and its padding
+                Rect                    Target{ };
+            };
+
+            const std::unique_ptr<const Info> pInfo{ nullptr };
+
+            const Image                       Pages;
+            const uint32_t                    TexelSize{ 0 };
+
+                  std::vector<
+                    std::vector<Segment>>     Skylines{ };
+                  uint64_t                    UsedArea{ 0 };
+
+                  std::vector<Pending>        PendingImages{ };
+                  std::vector<std::byte>      PendingTexels{ };
+                  std::vector<Pending>        UploadingImages{ }; // of the last upload, until it's done
+                  std::vector<std::byte>      UploadingTexels{ }; // of the last upload, until it's done
+        public:
+            DFL_API DFL_CALL Atlas(const Info& info);
+            DFL_API DFL_CALL ~Atlas();
+
+            const Image&             GetImage() const noexcept {
+                                        return this->Pages; }
+            // The share of the pages' texels taken by images and their padding
+            const double             GetOccupancy() const noexcept {
+                                        return static_cast<double>(this->UsedArea)
+                                               / ( static_cast<double>(this->pInfo->PageSize) * this->pInfo->PageSize
+                                                   * this->pInfo->Pages ); }
+
+            // Places an image of width * height texels, tightly packed in the
+            // atlas' format, and keeps a copy of it, with its edge texels repeated
+            // over the padding around it, for the next upload. The rect is of the
+            // image itself. Returns nothing if no page has room for it, or source
+            // is too small.
+            DFL_API
+                  std::optional<Rect>
+            DFL_CALL                 Add(
+                                        const std::span<const std::byte> source,
+                                        const uint32_t                   width,
+                                        const uint32_t                   height);
+            // Writes every image added since the last upload. If the write fails,
+            // they're kept for the next one. The job of the last upload has to be
+            // done before the next one.
+            DFL_API
+            const DflGen::Job<Image::Error>
+            DFL_CALL                 Upload();
+            // Empties every page. Rects handed out so far are no longer valid.
+            DFL_API
+                  void
+            DFL_CALL                 Clear() noexcept;
+
+            // The corners of the rect in texture coordinates, as (u0, v0, u1, v1)
+            DFL_API
+                  std::array<float, 4>
+            DFL_CALL                 GetUV(const Rect& rect) const noexcept;
+        };
+    }
+    namespace DflMem = Dfl::Memory;
+}
@@ -71,17 +71,58 @@ static DflMem::Block::Handles INT_GetMemory(
 {
     VkDeviceMemory mainMemory{ nullptr };
     uint64_t       heapIndex{ 0 };
-    for (; heapIndex < device.GetCharacteristics().LocalHeaps.size(); heapIndex++) 
+    bool           isMappable{ false };
+    bool           isCoherent{ false };
+
+    // device local memory the host can see is preferred, since the host can then write
+    // to it directly. Every local type is like this on UMA devices, while discrete ones
+    // have it in a small heap, or everywhere with resizable BAR.
+    // Tried as { cached, coherent }, uncached first as the host mostly writes to it.
+    if (device.GetCharacteristics().HasMappableLocalMemory)
     {
-        mainMemory = device.BorrowMemory<DflHW::Device::MemoryType::Local>(
-                            heapIndex,
-                            false,
-                            false,
-                            false,
-                            false,
-                            memorySize);
+        constexpr std::array<std::array<bool, 2>, 4> hostProperties{ {
+            { false, true },
+            { true,  true },
+            { true,  false },
+            { false, false } } };
+        for (const auto& properties : hostProperties)
+        {
+            for (heapIndex = 0; heapIndex < device.GetCharacteristics().LocalHeaps.size(); heapIndex++)
+            {
+                mainMemory = device.BorrowMemory<DflHW::Device::MemoryType::Local>(
+                                    heapIndex,
+                                    true,
+                                    properties[0],
+                                    properties[1],
+                                    false,
+                                    memorySize);
+
+                if( mainMemory != nullptr ) { break; }
+            }
+
+            if( mainMemory != nullptr ) 
+            { 
+                isMappable = true;
+                isCoherent = properties[1];
+                break; 
+            }
+        }
+    }
 
-        if( mainMemory != nullptr ) { break; }
+    if (mainMemory == nullptr) 
+    {
+        for (heapIndex = 0; heapIndex < device.GetCharacteristics().LocalHeaps.size(); heapIndex++) 
+        {
+            mainMemory = device.BorrowMemory<DflHW::Device::MemoryType::Local>(
+                                heapIndex,
+                                false,
+                                false,
+                                false,
+                                false,
+                                memorySize);
+
+            if( mainMemory != nullptr ) { break; }
+        }
     }
 
     // if the above check fails, it is first assumed that there wasn't a heap that had 
@@ -97,6 +138,8 @@ static DflMem::Block::Handles INT_GetMemory(
                             false,
                             true,
                             memorySize);
+
+            if( mainMemory != nullptr ) { break; }
         }
     }
 
@@ -107,13 +150,28 @@ static DflMem::Block::Handles INT_GetMemory(
                 L"INT_GetMemory");
     }
 
+    // mapped once for the block's lifetime
+    void* pMap{ nullptr };
+    if ( isMappable 
+         && vkMapMemory(
+                device.GetDevice(),
+                mainMemory,
+                0,
+                VK_WHOLE_SIZE,
+                0,
+                &pMap) != VK_SUCCESS )
+    {
+        pMap = nullptr;
+    }
+
     const DflHW::Device::Queue queue{ device.BorrowQueue(DflHW::Device::Queue::Type::Transfer) };
 
     return { mainMemory, heapIndex, 
              queue, INT_GetCmdPool(
                         device.GetDevice(),
                         mainMemory,
-                        queue.FamilyIndex) };
+                        queue.FamilyIndex),
+             pMap, isCoherent };
 };
 
 DflMem::Block::Block(const Info& info)
@@ -134,6 +192,13 @@ DflMem::Block::~Block() {
         this->Memory.hCmdPool,
         nullptr);
 
+    if (this->Memory.pMap != nullptr)
+    {
+        vkUnmapMemory(
+            this->pInfo->Device.GetDevice(),
+            this->Memory);
+    }
+
     this->pInfo->Device.ReturnMemory<DflHW::Device::MemoryType::Local>(
                             this->Memory,
                             this->Memory.HeapIndex,
@@ -44,6 +44,9 @@ namespace Dfl {
                 const DflHW::Device::Queue TransferQueue{ };
                 const VkCommandPool        hCmdPool{ nullptr };
 
+                      void* const          pMap{ nullptr }; // the whole block, if it's host visible
+                const bool                 IsCoherent{ false };
+
                 operator VkDeviceMemory () const { return this->hMemory; }
             };
 
@@ -61,13 +64,23 @@ namespace Dfl {
                                             return this->Memory.TransferQueue; }
             const VkCommandPool         GetCmdPool() const noexcept {
                                             return this->Memory.hCmdPool; }
+            const VkDeviceMemory        GetMemory() const noexcept {
+                                            return this->Memory.hMemory; }
+            const uint64_t              GetSize() const noexcept {
+                                            return this->pInfo->Size; }
+            // Not null if the block is device local memory the host can see (on
+            // UMA devices, or with resizable BAR), so buffers in it skip staging
+                  void*                 GetMap() const noexcept {
+                                            return this->Memory.pMap; }
+            const bool                  IsCoherent() const noexcept {
+                                            return this->Memory.IsCoherent; }
 
             template< Dfl::Generics::VulkanStorage T >
                   auto                  Alloc(const T& buffer) noexcept
-                  -> std::optional< std::array<uint64_t, 2> >;
+                  -> std::optional< std::array<uint64_t, 3> >; // depth and position in the layout, offset in the block
             template< Dfl::Generics::VulkanStorage T >
                   void                  Free(
-                                            const std::array<uint64_t, 2>&  memoryID,
+                                            const std::array<uint64_t, 3>&  memoryID,
                                             const T&                        buffer) noexcept;
         };
    }
@@ -75,7 +88,7 @@ namespace Dfl {
 
 template< Dfl::Generics::VulkanStorage T >
 auto Dfl::Memory::Block::Alloc(const T& buffer) noexcept
--> std::optional< std::array<uint64_t, 2> > 
+-> std::optional< std::array<uint64_t, 3> > 
 {
     VkMemoryRequirements requirements;
     if constexpr ( Dfl::Generics::SameType<T, VkBuffer> )
@@ -134,6 +147,7 @@ auto Dfl::Memory::Block::Alloc(const T& buffer) noexcept
     }
 
     *pNode = *pNode - size;
+    offset -= offset % requirements.alignment;
 
     if constexpr ( Dfl::Generics::SameType<T, VkBuffer> )
     { 
@@ -141,22 +155,22 @@ auto Dfl::Memory::Block::Alloc(const T& buffer) noexcept
             this->GetDevice().GetDevice(),
             buffer,
             this->Memory,
-            (offset) - (offset % requirements.alignment));
+            offset);
     }
     else {
         vkBindImageMemory(
             this->GetDevice().GetDevice(),
             buffer,
             this->Memory,
-            (offset) - (offset % requirements.alignment));
+            offset);
     }
 
-    return std::array<uint64_t, 2>({ depth, position });
+    return std::array<uint64_t, 3>({ depth, position, offset });
 };
 
 template< Dfl::Generics::VulkanStorage T >
 void  Dfl::Memory::Block::Free(
-    const std::array<uint64_t, 2>& memoryID,
+    const std::array<uint64_t, 3>& memoryID,
     const T&                       buffer) noexcept
 {
     // we bring the ID of the memory allocation to the "front"
@@ -16,6 +16,11 @@
 
 #include "Dragonfly.Memory.Buffer.hxx"
 #include <vector>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <utility>
+#include <atomic>
 
 #include "Dragonfly.Memory.Block.hxx"
 
@@ -27,7 +32,8 @@ static inline VkBuffer INT_GetBuffer(
     const uint32_t               transferFamilyIndex,
     const std::vector<uint32_t>& familyIndices,
     const uint64_t&              size,
-    const uint32_t&              flags) 
+    const uint32_t&              flags,
+    const bool                   isImported) 
 {
     std::vector<uint32_t> indices{ familyIndices };
     if (familyIndices.empty() 
@@ -37,9 +43,14 @@ static inline VkBuffer INT_GetBuffer(
         indices.push_back(transferFamilyIndex);
     }
 
+    const VkExternalMemoryBufferCreateInfo externalInfo{
+        .sType{ VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO },
+        .pNext{ nullptr },
+        .handleTypes{ VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT }
+    };
     const VkBufferCreateInfo bufInfo{
         .sType{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO },
-        .pNext{ nullptr },
+        .pNext{ isImported ? &externalInfo : nullptr },
         .flags{ 0 },
         .size{ size },
         .usage{ VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
@@ -67,6 +78,17 @@ static inline VkBuffer INT_GetBuffer(
     return buff;
 }
 
+// mirrors the sharing mode INT_GetBuffer picks
+static inline bool INT_IsShared(
+    const uint32_t               transferFamilyIndex,
+    const std::vector<uint32_t>& familyIndices)
+{
+    return std::any_of(
+                familyIndices.begin(),
+                familyIndices.end(),
+                [&](const uint32_t index) { return index != transferFamilyIndex; });
+}
+
 static inline VkImage INT_GetImage(
     const VkDevice&              hGPU,
     const uint32_t               transferFamilyIndex,
@@ -76,8 +98,16 @@ static inline VkImage INT_GetImage(
     const uint32_t&              flags,
     const uint32_t               mipLevels,
     const uint32_t               layers,
-    const uint32_t               samples) 
+    const uint32_t               samples,
+    const VkFormat               format) 
 {
+    if (DflMem::Buffer< DflMem::StorageType::Image >::GetTexelBlock(format).Size == 0)
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create image of an unsupported format",
+                L"INT_GetImage");
+    }
+
     std::vector<uint32_t> indices{ familyIndices };
     if (familyIndices.empty() 
         || (std::find(familyIndices.begin(), familyIndices.end() + 1,
@@ -95,11 +125,11 @@ static inline VkImage INT_GetImage(
                     : ( size[2] == 0
                         ? VK_IMAGE_TYPE_2D
                         : VK_IMAGE_TYPE_3D )},
-        .format{ VK_FORMAT_R8G8B8A8_SNORM },
+        .format{ format },
         .extent{ VkExtent3D{ 
                     .width{ size[0] },
-                    .height{ size[1] },
-                    .depth{ size[2] } } },
+                    .height{ std::max(size[1], 1u) }, // dimensions the image doesn't have are 1
+                    .depth{ std::max(size[2], 1u) } } },
         .mipLevels{ mipLevels },
         .arrayLayers{ layers },
         .samples{ static_cast<VkSampleCountFlagBits>(samples) },
@@ -107,11 +137,11 @@ static inline VkImage INT_GetImage(
         .usage{ VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
                 VK_IMAGE_USAGE_TRANSFER_DST_BIT |
                 flags },
-        .sharingMode{ familyIndices.empty()
+        .sharingMode{ indices.size() == 1
                       ? VK_SHARING_MODE_EXCLUSIVE 
                       : VK_SHARING_MODE_CONCURRENT },
-        .queueFamilyIndexCount{ static_cast<uint32_t>(familyIndices.size()) },
-        .pQueueFamilyIndices{ familyIndices.data() },
+        .queueFamilyIndexCount{ static_cast<uint32_t>(indices.size()) },
+        .pQueueFamilyIndices{ indices.data() },
         .initialLayout{ VK_IMAGE_LAYOUT_UNDEFINED }
     };
 
@@ -180,25 +210,78 @@ static inline VkCommandBuffer INT_GetCmdBuffer(
 }
 
 static inline auto INT_GetBufferHandles(
-    const Dfl::Hardware::Device& gpu,
+          Dfl::Hardware::Device& gpu,
     const uint32_t               transferFamilyIndex,
     const VkCommandPool&         hPool,
     const std::vector<uint32_t>  familyIndices,
     const uint64_t&              size,
     const uint32_t&              flags,
     const VkBuffer&              stageBuffer,
-    const bool&                  isStageVisible) 
+    const bool&                  isStageVisible,
+          void*                  pHostMemory) 
 -> DflMem::Buffer< DflMem::StorageType::Buffer >::Handles
 {
-    const VkBuffer buffer{ INT_GetBuffer(
-                                gpu.GetDevice(),
-                                transferFamilyIndex,
-                                familyIndices,
+    // host memory is imported if the device can, else the
+    // buffer is made as usual and the memory is copied to it
+    VkBuffer       buffer{ nullptr };
+    VkDeviceMemory importedMemory{ nullptr };
+    if ( pHostMemory != nullptr 
+         && gpu.GetCharacteristics().HostPointerAlignment != 0 )
+    {
+        buffer = INT_GetBuffer(
+                    gpu.GetDevice(),
+                    transferFamilyIndex,
+                    familyIndices,
+                    size,
+                    flags,
+                    true);
+
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(
+            gpu.GetDevice(),
+            buffer,
+            &requirements);
+        importedMemory = gpu.ImportHostMemory(
+                                pHostMemory,
                                 size,
-                                flags) };
+                                requirements.memoryTypeBits);
+
+        if ( importedMemory != nullptr
+             && vkBindBufferMemory(
+                    gpu.GetDevice(),
+                    buffer,
+                    importedMemory,
+                    0) != VK_SUCCESS )
+        {
+            gpu.ReturnHostMemory(importedMemory);
+            importedMemory = nullptr;
+        }
+
+        if (importedMemory == nullptr)
+        {
+            vkDestroyBuffer(
+                gpu.GetDevice(),
+                buffer,
+                nullptr);
+            buffer = nullptr;
+        }
+    }
+
+    if (buffer == nullptr)
+    {
+        buffer = INT_GetBuffer(
+                    gpu.GetDevice(),
+                    transferFamilyIndex,
+                    familyIndices,
+                    size,
+                    flags,
+                    false);
+    }
     
     VkEvent event{ nullptr };
     VkCommandBuffer cmdBuffer{ nullptr};
+    VkCommandBuffer ownershipCmdBuffer{ nullptr };
+    DflHW::Device::TimelinePoint timeline{ };
     
     try {
         event = isStageVisible ? INT_GetEvent(gpu.GetDevice()) : nullptr;
@@ -207,6 +290,12 @@ static inline auto INT_GetBufferHandles(
                         gpu.GetDevice(),
                         hPool,
                         isStageVisible);
+        ownershipCmdBuffer = INT_GetCmdBuffer(
+                                gpu.GetDevice(),
+                                hPool,
+                                isStageVisible);
+
+        timeline = gpu.GetTimeline();
     } catch (Dfl::Error::HandleCreation& e) {
         vkDeviceWaitIdle(gpu.GetDevice());
         
@@ -215,6 +304,23 @@ static inline auto INT_GetBufferHandles(
             buffer,
             nullptr);
 
+        if (importedMemory != nullptr)
+        {
+            gpu.ReturnHostMemory(importedMemory);
+        }
+
+        for (const VkCommandBuffer& allocated : { cmdBuffer, ownershipCmdBuffer })
+        {
+            if (allocated != nullptr) 
+            {
+                vkFreeCommandBuffers(
+                    gpu.GetDevice(),
+                    hPool,
+                    1,
+                    &allocated);
+            }
+        }
+
         if (event != nullptr) 
         {
             vkDestroyEvent(
@@ -226,8 +332,99 @@ static inline auto INT_GetBufferHandles(
         throw;
     }
 
-    return { buffer,  
-             event, cmdBuffer };
+    return { buffer, importedMemory,
+             event, cmdBuffer, ownershipCmdBuffer,
+             timeline.hSemaphore, timeline.Value };
+}
+
+// Records the ownership transfers of a buffer in the family that owns it: acquiring
+// it back from the family that released it, and releasing it to another one.
+// The two are ordered, since the buffer can't be released before it's acquired.
+static inline bool INT_RecordOwnershipCommand(
+    const VkCommandBuffer&         cmdBuff,
+    const VkBuffer&                buffer,
+    const uint32_t                 familyIndex,
+    const std::optional<uint32_t>& acquireFrom,
+    const std::optional<uint32_t>& releaseTo,
+          DflHW::Profiler*         pProfiler)
+{
+    const VkCommandBufferBeginInfo cmdInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO },
+        .pNext{ nullptr },
+        .flags{ VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT },
+        .pInheritanceInfo{ nullptr }
+    };
+    if (vkBeginCommandBuffer(
+            cmdBuff,
+            &cmdInfo) != VK_SUCCESS) {
+        return false;
+    }
+
+    // the stage and access masks of the releasing side are ignored
+    // on acquisition, and vice versa
+    if (acquireFrom.has_value())
+    {
+        const VkBufferMemoryBarrier2 acquireBarrier{
+            .sType{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 },
+            .pNext{ nullptr },
+            .srcStageMask{ VK_PIPELINE_STAGE_2_NONE },
+            .srcAccessMask{ VK_ACCESS_2_NONE },
+            .dstStageMask{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT },
+            .dstAccessMask{ VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT },
+            .srcQueueFamilyIndex{ acquireFrom.value() },
+            .dstQueueFamilyIndex{ familyIndex },
+            .buffer{ buffer },
+            .offset{ 0 },
+            .size{ VK_WHOLE_SIZE }
+        };
+        const VkDependencyInfo acquireDependency{
+            .sType{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO },
+            .pNext{ nullptr },
+            .dependencyFlags{ 0 },
+            .bufferMemoryBarrierCount{ 1 },
+            .pBufferMemoryBarriers{ &acquireBarrier }
+        };
+        vkCmdPipelineBarrier2(
+            cmdBuff,
+            &acquireDependency);
+        if (pProfiler != nullptr)
+        {
+            pProfiler->Count(DflHW::Profiler::Counter::BarriersIssued, 1);
+        }
+    }
+
+    if (releaseTo.has_value())
+    {
+        const VkBufferMemoryBarrier2 releaseBarrier{
+            .sType{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 },
+            .pNext{ nullptr },
+            .srcStageMask{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT },
+            .srcAccessMask{ VK_ACCESS_2_MEMORY_WRITE_BIT },
+            .dstStageMask{ VK_PIPELINE_STAGE_2_NONE },
+            .dstAccessMask{ VK_ACCESS_2_NONE },
+            .srcQueueFamilyIndex{ familyIndex },
+            .dstQueueFamilyIndex{ releaseTo.value() },
+            .buffer{ buffer },
+            .offset{ 0 },
+            .size{ VK_WHOLE_SIZE }
+        };
+        const VkDependencyInfo releaseDependency{
+            .sType{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO },
+            .pNext{ nullptr },
+            .dependencyFlags{ 0 },
+            .bufferMemoryBarrierCount{ 1 },
+            .pBufferMemoryBarriers{ &releaseBarrier }
+        };
+        vkCmdPipelineBarrier2(
+            cmdBuff,
+            &releaseDependency);
+        if (pProfiler != nullptr)
+        {
+            pProfiler->Count(DflHW::Profiler::Counter::BarriersIssued, 1);
+        }
+    }
+
+    return vkEndCommandBuffer(cmdBuff) == VK_SUCCESS;
 }
 
 static inline auto INT_GetImageHandles(
@@ -240,6 +437,7 @@ static inline auto INT_GetImageHandles(
     const uint32_t&              mipLevels,
     const uint32_t&              layers,
     const uint32_t&              samples,
+    const VkFormat               format,
     const uint32_t&              flags,
     const VkBuffer&              stageBuffer,
     const bool&                  isStageVisible)
@@ -253,10 +451,12 @@ static inline auto INT_GetImageHandles(
                                 flags,
                                 mipLevels,
                                 layers,
-                                samples) };
+                                samples,
+                                format) };
     
     VkEvent event{ nullptr };
     VkCommandBuffer cmdBuffer{ nullptr};
+    std::vector<VkCommandBuffer> stageCmdBuffers(DflHW::Device::StageSlots, nullptr);
     
     try {
         event = isStageVisible ? INT_GetEvent(gpu.GetDevice()) : nullptr;
@@ -265,8 +465,28 @@ static inline auto INT_GetImageHandles(
                         gpu.GetDevice(),
                         hPool,
                         isStageVisible);
+        for (auto& stageCmdBuffer : stageCmdBuffers)
+        {
+            stageCmdBuffer = INT_GetCmdBuffer(
+                                gpu.GetDevice(),
+                                hPool,
+                                isStageVisible);
+        }
     } catch (Dfl::Error::HandleCreation& e) {
         vkDeviceWaitIdle(gpu.GetDevice());
+
+        stageCmdBuffers.push_back(cmdBuffer);
+        for (const auto& allocated : stageCmdBuffers)
+        {
+            if (allocated != nullptr)
+            {
+                vkFreeCommandBuffers(
+                    gpu.GetDevice(),
+                    hPool,
+                    1,
+                    &allocated);
+            }
+        }
         
         vkDestroyImage(
             gpu.GetDevice(),
@@ -284,8 +504,7 @@ static inline auto INT_GetImageHandles(
         throw;
     }
 
-    return { image, VK_IMAGE_LAYOUT_UNDEFINED,  
-             event, cmdBuffer };
+    return { image, event, cmdBuffer, stageCmdBuffers };
 }
 
 inline bool DflMem::Buffer< DflMem::StorageType::Buffer >::RecordWriteBufferCommand(
@@ -296,7 +515,9 @@ inline bool DflMem::Buffer< DflMem::StorageType::Buffer >::RecordWriteBufferComm
     const uint64_t         dstSize,
     const void*            pData,
     const uint64_t         sourceSize,
-    const uint64_t         sourceOffset)
+    const uint64_t         sourceOffset,
+    const uint32_t         family,
+          DflHW::Profiler* pProfiler)
 {
     {
         const VkCommandBufferBeginInfo cmdInfo{
@@ -313,6 +534,12 @@ inline bool DflMem::Buffer< DflMem::StorageType::Buffer >::RecordWriteBufferComm
     }
     
     {
+        DflHW::Profiler::Zone zone(
+                                pProfiler,
+                                cmdBuff,
+                                family,
+                                "Buffer::Write");
+
         uint64_t remainingSize{ sourceSize };
         uint64_t currentSourceOffset{ sourceOffset };
         uint64_t currentDstOffset{ dstOffset };
@@ -353,6 +580,10 @@ inline bool DflMem::Buffer< DflMem::StorageType::Buffer >::RecordWriteBufferComm
                 0, nullptr,
                 1, &stageBuffBarrier,
                 0, nullptr);
+            if (pProfiler != nullptr)
+            {
+                pProfiler->Count(DflHW::Profiler::Counter::BarriersIssued, 1);
+            }
 
             const VkBufferCopy copyRegion{
                 .srcOffset{ 0 },
@@ -369,6 +600,10 @@ inline bool DflMem::Buffer< DflMem::StorageType::Buffer >::RecordWriteBufferComm
                 &copyRegion);
 
             currentDstOffset += copyRegion.size/sizeof(char);
+            if (pProfiler != nullptr)
+            {
+                pProfiler->Count(DflHW::Profiler::Counter::BytesUploaded, copyRegion.size);
+            }
             remainingSize -= remainingSize > DflHW::Device::StageMemory
                                 ? DflHW::Device::StageMemory
                                 : remainingSize;
@@ -377,6 +612,10 @@ inline bool DflMem::Buffer< DflMem::StorageType::Buffer >::RecordWriteBufferComm
 
     if (vkEndCommandBuffer(
             cmdBuff) != VK_SUCCESS) {
+        if (pProfiler != nullptr)
+        {
+            pProfiler->Discard(cmdBuff);
+        }
         return !VK_SUCCESS;
     }
 
@@ -389,7 +628,9 @@ inline bool DflMem::Buffer< DflMem::StorageType::Buffer >::RecordReadBufferComma
     const VkBuffer&        stageBuff,
     const VkBuffer&        sourceBuff,
     const uint64_t         sourceSize,
-    const uint64_t         sourceOffset)
+    const uint64_t         sourceOffset,
+    const uint32_t         family,
+          DflHW::Profiler* pProfiler)
 {
     {
         const VkCommandBufferBeginInfo cmdInfo{
@@ -406,6 +647,12 @@ inline bool DflMem::Buffer< DflMem::StorageType::Buffer >::RecordReadBufferComma
     }
 
     {
+        DflHW::Profiler::Zone zone(
+                                pProfiler,
+                                cmdBuff,
+                                family,
+                                "Buffer::Read");
+
         uint64_t currentSourceOffset{ sourceOffset };
         while ( sizeof(char) * currentSourceOffset < sourceSize ) {
             const VkBufferMemoryBarrier cpuCopyFromStageBarrier{
@@ -454,6 +701,10 @@ inline bool DflMem::Buffer< DflMem::StorageType::Buffer >::RecordReadBufferComma
 
     if (vkEndCommandBuffer(
             cmdBuff) != VK_SUCCESS) {
+        if (pProfiler != nullptr)
+        {
+            pProfiler->Discard(cmdBuff);
+        }
         return !VK_SUCCESS;
     }
 
@@ -472,49 +723,284 @@ DflMem::Buffer< DflMem::StorageType::Buffer >::Buffer(const Info& info)
                 info.MemoryBlock.GetDevice().GetStageBuffer(),
                 info.MemoryBlock.GetDevice().GetStageMap() == nullptr ?
                     false :
-                    true) ),
-  MemoryLayoutID( this->pInfo->MemoryBlock.Alloc(this->Buffers.hBuffer).value() ),
+                    true,
+                info.pHostMemory) ),
+  MemoryLayoutID( this->Buffers.hImportedMemory != nullptr 
+                    ? std::array<uint64_t, 3>{ 0, 0, 0 }
+                    : this->pInfo->MemoryBlock.Alloc(this->Buffers.hBuffer).value() ),
   QueueAvailableFence( this->pInfo->MemoryBlock.GetDevice().GetFence(
                             this->pInfo->MemoryBlock.GetQueue().FamilyIndex,
-                            this->pInfo->MemoryBlock.GetQueue().Index)) {}
+                            this->pInfo->MemoryBlock.GetQueue().Index)),
+  IsShared( INT_IsShared(
+                info.MemoryBlock.GetQueue().FamilyIndex,
+                info.AccessingQueueFamilies) ),
+  pOwnership( new Ownership{ .TimelineValue{ this->Buffers.TimelineStart } } ),
+  pMap( this->Buffers.hImportedMemory != nullptr
+            ? static_cast<char*>(info.pHostMemory)
+            : info.MemoryBlock.GetMap() == nullptr 
+                ? nullptr 
+                : static_cast<char*>(info.MemoryBlock.GetMap()) + this->MemoryLayoutID[2] ) 
+{
+    if ( info.pHostMemory != nullptr 
+         && this->Buffers.hImportedMemory == nullptr
+         && this->Upload(info.pHostMemory) != VK_SUCCESS )
+    {
+        throw Dfl::Error::System(
+                L"Unable to copy the host memory to the buffer",
+                L"Buffer::Buffer");
+    }
+}
 
 DflMem::Buffer< DflMem::StorageType::Buffer >::~Buffer() {
     vkDeviceWaitIdle(this->pInfo->MemoryBlock.GetDevice().GetDevice());
 
+    const std::array<VkCommandBuffer, 2> cmdBuffers{
+        this->Buffers.hTransferCmdBuff,
+        this->Buffers.hOwnershipCmdBuff };
     vkFreeCommandBuffers(
         this->pInfo->MemoryBlock.GetDevice().GetDevice(),
         this->pInfo->MemoryBlock.GetCmdPool(),
-        1,
-        &this->Buffers.hTransferCmdBuff);
+        static_cast<uint32_t>(cmdBuffers.size()),
+        cmdBuffers.data());
 
     vkDestroyEvent(
         this->pInfo->MemoryBlock.GetDevice().GetDevice(),
         this->Buffers.hCPUTransferDone,
         nullptr);
 
-    this->pInfo->MemoryBlock.Free(this->MemoryLayoutID, this->Buffers.hBuffer);
+    if (this->Buffers.hImportedMemory == nullptr)
+    {
+        this->pInfo->MemoryBlock.Free(this->MemoryLayoutID, this->Buffers.hBuffer);
+    }
 
     vkDestroyBuffer(
         this->pInfo->MemoryBlock.GetDevice().GetDevice(),
         this->Buffers.hBuffer,
         nullptr);
+
+    if (this->Buffers.hImportedMemory != nullptr)
+    {
+        this->pInfo->MemoryBlock.GetDevice().ReturnHostMemory(this->Buffers.hImportedMemory);
+    }
+
+    this->pInfo->MemoryBlock.GetDevice().ReturnTimeline(this->Buffers.hTimeline);
 }
 
-inline bool DflMem::Buffer< DflMem::StorageType::Image >::RecordWriteImageCommand(
-    const VkCommandBuffer&         cmdBuff,
-    const VkBuffer&                stageBuff,
-    const VkBuffer&                intermBuff,
-    const VkImage&                 dstImage,
-    const uint32_t                 dstMipLevels,
-    const Dfl::Generics::BitFlag&  dstAspectFlag,
-    const uint32_t                 dstArrayLayer,
-    const std::array<int32_t, 3>&  dstOffset,
-    const std::array<uint32_t, 3>& dstSize,
-    const VkFilter                 dstFilter,
-    const void*                    pData,
-    const uint64_t                 sourceSize,
-    const uint64_t                 sourceOffset)
+uint32_t DflMem::Buffer< DflMem::StorageType::Buffer >::GetFamily() const noexcept
+{
+    return this->pInfo->MemoryBlock.GetQueue().FamilyIndex;
+}
+
+// the range, as an offset from the start of the memory, has to be aligned
+// to the atom size, and not go past the end unless it's VK_WHOLE_SIZE
+static inline VkMappedMemoryRange INT_GetMappedRange(
+    const DflMem::Block& block,
+    const uint64_t       offset,
+    const uint64_t       size)
+{
+    const uint64_t atomSize{ block.GetDevice().GetCharacteristics().NonCoherentAtomSize };
+    const uint64_t begin{ offset - offset % atomSize };
+    const uint64_t end{ ( (offset + size + atomSize - 1) / atomSize ) * atomSize };
+
+    return { .sType{ VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE },
+             .pNext{ nullptr },
+             .memory{ block.GetMemory() },
+             .offset{ begin },
+             .size{ end >= block.GetSize() ? VK_WHOLE_SIZE : end - begin } };
+}
+
+VkResult DflMem::Buffer< DflMem::StorageType::Buffer >::FlushMap(
+    const uint64_t offset,
+    const uint64_t size) const noexcept
+{
+    if (this->pInfo->pProfiler != nullptr)
+    {
+        this->pInfo->pProfiler->Count(DflHW::Profiler::Counter::BytesUploaded, size);
+    }
+
+    // imported memory is always coherent
+    if ( this->pInfo->MemoryBlock.IsCoherent()
+         || this->Buffers.hImportedMemory != nullptr ) 
+    { 
+        return VK_SUCCESS; 
+    }
+
+    const VkMappedMemoryRange range{ INT_GetMappedRange(
+                                        this->pInfo->MemoryBlock,
+                                        this->MemoryLayoutID[2] + offset,
+                                        size) };
+    return vkFlushMappedMemoryRanges(
+                this->pInfo->MemoryBlock.GetDevice().GetDevice(),
+                1,
+                &range);
+}
+
+VkResult DflMem::Buffer< DflMem::StorageType::Buffer >::InvalidateMap(
+    const uint64_t offset,
+    const uint64_t size) const noexcept
+{
+    // imported memory is always coherent
+    if ( this->pInfo->MemoryBlock.IsCoherent()
+         || this->Buffers.hImportedMemory != nullptr ) 
+    { 
+        return VK_SUCCESS; 
+    }
+
+    const VkMappedMemoryRange range{ INT_GetMappedRange(
+                                        this->pInfo->MemoryBlock,
+                                        this->MemoryLayoutID[2] + offset,
+                                        size) };
+    return vkInvalidateMappedMemoryRanges(
+                this->pInfo->MemoryBlock.GetDevice().GetDevice(),
+                1,
+                &range);
+}
+
+// A region, or the part of one, that goes through the stage
+struct INT_StagedRegion {
+    uint64_t HostOffset{ 0 };
+    uint64_t BufferOffset{ 0 };
+    uint64_t StageOffset{ 0 };
+    uint64_t Size{ 0 };
+};
+
+// Packs regions into as few fills of the stage as they need, splitting those
+// that don't fit. Offsets in the stage are kept to multiples of 4, as
+// vkCmdUpdateBuffer needs.
+static std::vector<std::vector<INT_StagedRegion>> INT_StageRegions(
+    const std::vector<DflMem::GenericBuffer::Region>& regions,
+    const bool                                        isWrite)
+{
+    std::vector<std::vector<INT_StagedRegion>> fills(1);
+    uint64_t stageOffset{ 0 };
+    for (const auto& region : regions)
+    {
+        uint64_t done{ 0 };
+        while (done < region.Size)
+        {
+            if (stageOffset >= DflHW::Device::StageMemory)
+            {
+                fills.emplace_back();
+                stageOffset = 0;
+            }
+
+            const uint64_t size{ std::min(region.Size - done, DflHW::Device::StageMemory - stageOffset) };
+            fills.back().push_back({
+                .HostOffset{ (isWrite ? region.SourceOffset : region.DstOffset) + done },
+                .BufferOffset{ (isWrite ? region.DstOffset : region.SourceOffset) + done },
+                .StageOffset{ stageOffset },
+                .Size{ size } });
+
+            done += size;
+            stageOffset = (stageOffset + size + 3) & ~static_cast<uint64_t>(3);
+        }
+    }
+
+    if (fills.back().empty()) { fills.pop_back(); }
+
+    return fills;
+}
+
+// every region has to be in both the host memory and the buffer
+static inline bool INT_AreRegionsValid(
+    const std::vector<DflMem::GenericBuffer::Region>& regions,
+    const uint64_t                                    sourceSize,
+    const uint64_t                                    dstSize)
+{
+    return std::all_of(
+                regions.begin(),
+                regions.end(),
+                [&](const DflMem::GenericBuffer::Region& region) {
+                    return region.SourceOffset <= sourceSize
+                           && region.Size <= sourceSize - region.SourceOffset
+                           && region.DstOffset <= dstSize
+                           && region.Size <= dstSize - region.DstOffset; });
+}
+
+VkResult DflMem::Buffer< DflMem::StorageType::Buffer >::Upload(const void* pData) const noexcept
+{
+    const VkDevice device{ this->pInfo->MemoryBlock.GetDevice().GetDevice() };
+
+    // the device may still be accessing the buffer, whether it's then written
+    // through the map or a transfer
+    vkWaitForFences(
+        device,
+        1,
+        &this->QueueAvailableFence,
+        VK_TRUE,
+        UINT64_MAX);
+
+    if (this->pMap != nullptr) 
+    {
+        DflMem::Copier::ToMapped(
+            this->pMap,
+            pData,
+            this->pInfo->Size);
+        return this->FlushMap(0, this->pInfo->Size);
+    }
+
+    if ( this->RecordWriteBufferCommand(
+            this->Buffers.hTransferCmdBuff,
+            this->pInfo->MemoryBlock.GetDevice().GetStageBuffer(),
+            this->Buffers.hBuffer,
+            0,
+            this->pInfo->Size,
+            pData,
+            this->pInfo->Size,
+            0,
+            this->GetFamily(),
+            this->pInfo->pProfiler) != VK_SUCCESS ) 
+    {
+        return VK_ERROR_UNKNOWN;
+    }
+
+    const VkResult result{ this->SubmitTransfer() };
+    if (result != VK_SUCCESS) 
+    {
+        return result;
+    }
+
+    vkWaitForFences(
+        device,
+        1,
+        &this->QueueAvailableFence,
+        VK_TRUE,
+        UINT64_MAX);
+    vkResetCommandBuffer(
+        this->Buffers.hTransferCmdBuff,
+        0);
+
+    return VK_SUCCESS;
+}
+
+auto DflMem::Buffer< DflMem::StorageType::Buffer >::CopyFrom(
+    const Buffer&  source,
+    const uint64_t sourceOffset,
+    const uint64_t dstOffset,
+    const uint64_t size) const noexcept
+-> const DflGen::Job<Error>
 {
+    if ( sourceOffset >= source.GetSize() 
+         || dstOffset >= this->pInfo->Size ) [[ unlikely ]]
+    {
+        co_return Error::WriteError;
+    }
+
+    if ( source.IsExclusive() 
+         && source.GetFamily() != this->GetFamily() ) [[ unlikely ]]
+    {
+        co_return Error::OwnershipError;
+    }
+
+    const VkDevice device{ this->pInfo->MemoryBlock.GetDevice().GetDevice() };
+
+    while (vkGetFenceStatus(device, this->QueueAvailableFence) != VK_SUCCESS)
+    {
+        co_await DflGen::Job<Error>::Awaitable(
+            device,
+            this->QueueAvailableFence);
+    }
+
     {
         const VkCommandBufferBeginInfo cmdInfo{
             .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO },
@@ -523,35 +1009,184 @@ inline bool DflMem::Buffer< DflMem::StorageType::Image >::RecordWriteImageComman
             .pInheritanceInfo{ nullptr }
         };
         if (vkBeginCommandBuffer(
-                cmdBuff,
-                &cmdInfo) != VK_SUCCESS) {
-            return !VK_SUCCESS;
+                this->Buffers.hTransferCmdBuff,
+                &cmdInfo) != VK_SUCCESS) 
+        {
+            co_return Error::RecordError;
         }
     }
-    
-    // first, we copy to the intermediate buffer
-    // and then we copy to the image
+
     {
-        uint64_t remainingSize{ dstSize[0] *
-                                (dstSize[1] == 0 ? 1 : dstSize[1]) *
-                                (dstSize[2] == 0 ? 1 : dstSize[2]) };
-        uint64_t currentSourceOffset{ sourceOffset };
-        uint64_t currentOffset{ 0 };
-        while ( remainingSize > 0 
-                && sizeof(char) * currentOffset < Dfl::Hardware::Device::IntermediateMemory)
+        DflHW::Profiler::Zone zone(
+                                this->pInfo->pProfiler,
+                                this->Buffers.hTransferCmdBuff,
+                                this->GetFamily(),
+                                "Buffer::CopyFrom");
+
+        const VkBufferCopy copyRegion{
+            .srcOffset{ sourceOffset },
+            .dstOffset{ dstOffset },
+            .size{ std::min({ size, 
+                              source.GetSize() - sourceOffset, 
+                              this->pInfo->Size - dstOffset }) }
+        };
+        vkCmdCopyBuffer(
+            this->Buffers.hTransferCmdBuff,
+            source.GetBuffer(),
+            this->Buffers.hBuffer,
+            1,
+            &copyRegion);
+
+        // only what comes from host memory counts as uploaded
+        if ( this->pInfo->pProfiler != nullptr 
+             && source.IsImported() )
+        {
+            this->pInfo->pProfiler->Count(DflHW::Profiler::Counter::BytesUploaded, copyRegion.size);
+        }
+    }
+
+    if (vkEndCommandBuffer(this->Buffers.hTransferCmdBuff) != VK_SUCCESS) 
+    {
+        if (this->pInfo->pProfiler != nullptr)
+        {
+            this->pInfo->pProfiler->Discard(this->Buffers.hTransferCmdBuff);
+        }
+        co_return Error::RecordError;
+    }
+
+    if (this->SubmitTransfer() != VK_SUCCESS) 
+    {
+        co_return Error::WriteError;
+    }
+
+    while (vkGetFenceStatus(device, this->QueueAvailableFence) != VK_SUCCESS)
+    {
+        co_await DflGen::Job<Error>::Awaitable(
+            device,
+            this->QueueAvailableFence);
+    }
+
+    vkResetCommandBuffer(
+        this->Buffers.hTransferCmdBuff,
+        0);
+
+    co_return Error::Success;
+}
+
+auto DflMem::Buffer< DflMem::StorageType::Buffer >::Write(
+    const std::span<const std::byte> source,
+    const std::vector<Region>&       regions) const noexcept
+-> const DflGen::Job<Error>
+{
+    if (!INT_AreRegionsValid(regions, source.size(), this->pInfo->Size)) [[ unlikely ]]
+    {
+        co_return Error::WriteError;
+    }
+
+    if (regions.empty()) { co_return Error::Success; }
+
+    const VkDevice device{ this->pInfo->MemoryBlock.GetDevice().GetDevice() };
+
+    if (this->pMap != nullptr) 
+    {
+        // the device may still be accessing the buffer; mapped copies wait for it like transfers do
+        while (vkGetFenceStatus(device, this->QueueAvailableFence) != VK_SUCCESS)
+        {
+            co_await DflGen::Job<Error>::Awaitable(
+                device,
+                this->QueueAvailableFence);
+        }
+
+        uint64_t begin{ this->pInfo->Size };
+        uint64_t end{ 0 };
+        for (const auto& region : regions)
+        {
+            DflMem::Copier::ToMapped(
+                this->pMap + region.DstOffset,
+                source.data() + region.SourceOffset,
+                region.Size);
+            begin = std::min(begin, region.DstOffset);
+            end = std::max(end, region.DstOffset + region.Size);
+        }
+
+        co_return this->FlushMap(begin, end - begin) == VK_SUCCESS
+                    ? Error::Success
+                    : Error::WriteError;
+    }
+
+    const VkBuffer stageBuff{ this->pInfo->MemoryBlock.GetDevice().GetStageBuffer() };
+
+    while (vkGetFenceStatus(device, this->QueueAvailableFence) != VK_SUCCESS)
+    {
+        co_await DflGen::Job<Error>::Awaitable(
+            device,
+            this->QueueAvailableFence);
+    }
+
+    {
+        const VkCommandBufferBeginInfo cmdInfo{
+            .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .pInheritanceInfo{ nullptr }
+        };
+        if (vkBeginCommandBuffer(
+                this->Buffers.hTransferCmdBuff,
+                &cmdInfo) != VK_SUCCESS) 
         {
+            co_return Error::RecordError;
+        }
+    }
+
+    {
+        DflHW::Profiler::Zone zone(
+                                this->pInfo->pProfiler,
+                                this->Buffers.hTransferCmdBuff,
+                                this->GetFamily(),
+                                "Buffer::Write");
+
+        const auto fills{ INT_StageRegions(regions, true) };
+        std::vector<std::byte>    packed{ };
+        std::vector<VkBufferCopy> copyRegions{ };
+        for (uint64_t i{ 0 }; i < fills.size(); i++)
+        {
+            const auto& fill{ fills[i] };
+            const INT_StagedRegion& last{ fill.back() };
+            packed.assign((last.StageOffset + last.Size + 3) & ~static_cast<uint64_t>(3), std::byte{ 0 });
+            copyRegions.clear();
+            uint64_t bytes{ 0 };
+            for (const auto& staged : fill)
+            {
+                bytes += staged.Size;
+                std::memcpy(
+                    packed.data() + staged.StageOffset,
+                    source.data() + staged.HostOffset,
+                    staged.Size);
+                copyRegions.push_back({
+                    .srcOffset{ staged.StageOffset },
+                    .dstOffset{ staged.BufferOffset },
+                    .size{ staged.Size } });
+            }
+
+            // the previous fill has to be copied out before the stage is overwritten
+            if (i > 0)
+            {
+                vkCmdPipelineBarrier(
+                    this->Buffers.hTransferCmdBuff,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    0,
+                    0, nullptr,
+                    0, nullptr,
+                    0, nullptr);
+            }
+
             vkCmdUpdateBuffer(
-                cmdBuff,
+                this->Buffers.hTransferCmdBuff,
                 stageBuff,
                 0,
-                remainingSize > DflHW::Device::StageMemory 
-                    ? DflHW::Device::StageMemory 
-                    : remainingSize,
-                &((char*)pData)[currentSourceOffset]);
-
-            currentSourceOffset += (remainingSize > DflHW::Device::StageMemory 
-                                        ? DflHW::Device::StageMemory 
-                                        : remainingSize)/sizeof(char);
+                packed.size(),
+                packed.data());
 
             const VkBufferMemoryBarrier stageBuffBarrier{
                 .sType{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER },
@@ -562,90 +1197,737 @@ inline bool DflMem::Buffer< DflMem::StorageType::Image >::RecordWriteImageComman
                 .dstQueueFamilyIndex{ VK_QUEUE_FAMILY_IGNORED },
                 .buffer{ stageBuff },
                 .offset{ 0 },
-                .size{ remainingSize > DflHW::Device::StageMemory 
-                            ? DflHW::Device::StageMemory
-                            : remainingSize }
+                .size{ packed.size() }
             };
             vkCmdPipelineBarrier(
-                cmdBuff,
+                this->Buffers.hTransferCmdBuff,
                 VK_PIPELINE_STAGE_TRANSFER_BIT,
                 VK_PIPELINE_STAGE_TRANSFER_BIT,
                 0,
-                0,
-                nullptr,
-                1,
-                &stageBuffBarrier,
-                0,
-                nullptr);
+                0, nullptr,
+                1, &stageBuffBarrier,
+                0, nullptr);
 
-            const VkBufferCopy copyRegion{
-                .srcOffset{ 0 },
-                .dstOffset{ sizeof(char)*currentOffset },
-                .size{ DflHW::Device::StageMemory > DflHW::Device::IntermediateMemory - sizeof(char) * currentOffset
-                        ? DflHW::Device::IntermediateMemory - sizeof(char) * currentOffset
-                        : DflHW::Device::StageMemory }
-            };
             vkCmdCopyBuffer(
-                cmdBuff,
+                this->Buffers.hTransferCmdBuff,
                 stageBuff,
-                intermBuff,
-                1,
-                &copyRegion);
+                this->Buffers.hBuffer,
+                static_cast<uint32_t>(copyRegions.size()),
+                copyRegions.data());
+
+            if (this->pInfo->pProfiler != nullptr)
+            {
+                this->pInfo->pProfiler->Count(DflHW::Profiler::Counter::BarriersIssued, i > 0 ? 2 : 1);
+                this->pInfo->pProfiler->Count(DflHW::Profiler::Counter::BytesUploaded, bytes);
+            }
+        }
+    }
 
-            remainingSize -= remainingSize > DflHW::Device::StageMemory 
-                                    ? DflHW::Device::StageMemory
-                                    : remainingSize;
-            currentOffset += copyRegion.size/sizeof(char);
+    if (vkEndCommandBuffer(this->Buffers.hTransferCmdBuff) != VK_SUCCESS) 
+    {
+        if (this->pInfo->pProfiler != nullptr)
+        {
+            this->pInfo->pProfiler->Discard(this->Buffers.hTransferCmdBuff);
         }
+        co_return Error::RecordError;
+    }
 
-        const VkBufferMemoryBarrier intermBuffBarrier{
+    if (this->SubmitTransfer() != VK_SUCCESS) 
+    {
+        co_return Error::WriteError;
+    }
+
+    while (vkGetFenceStatus(device, this->QueueAvailableFence) != VK_SUCCESS)
+    {
+        co_await DflGen::Job<Error>::Awaitable(
+            device,
+            this->QueueAvailableFence);
+    }
+
+    vkResetCommandBuffer(
+        this->Buffers.hTransferCmdBuff,
+        0);
+
+    co_return Error::Success;
+}
+
+auto DflMem::Buffer< DflMem::StorageType::Buffer >::Read(
+    const std::span<std::byte> destination,
+    const std::vector<Region>& regions) const noexcept
+-> const DflGen::Job<Error>
+{
+    if (!INT_AreRegionsValid(regions, this->pInfo->Size, destination.size())) [[ unlikely ]]
+    {
+        co_return Error::ReadError;
+    }
+
+    if (regions.empty()) { co_return Error::Success; }
+
+    const DflHW::Device& gpu{ this->pInfo->MemoryBlock.GetDevice() };
+    const VkDevice device{ gpu.GetDevice() };
+
+    if (this->pMap != nullptr) 
+    {
+        // the device may still be writing what is read from the map
+        while (vkGetFenceStatus(device, this->QueueAvailableFence) != VK_SUCCESS)
+        {
+            co_await DflGen::Job<Error>::Awaitable(
+                device,
+                this->QueueAvailableFence);
+        }
+
+        for (const auto& region : regions)
+        {
+            if (this->InvalidateMap(region.SourceOffset, region.Size) != VK_SUCCESS) 
+            {
+                co_return Error::ReadError;
+            }
+            DflMem::Copier::FromMapped(
+                destination.data() + region.DstOffset,
+                this->pMap + region.SourceOffset,
+                region.Size);
+        }
+
+        co_return Error::Success;
+    }
+
+    if (gpu.GetStageMap() == nullptr) [[ unlikely ]] 
+    {
+        co_return Error::UnreadableError;
+    }
+
+    // the stage is read by the host after every fill, so each is its own submission
+    for (const auto& fill : INT_StageRegions(regions, false))
+    {
+        while (vkGetFenceStatus(device, this->QueueAvailableFence) != VK_SUCCESS)
+        {
+            co_await DflGen::Job<Error>::Awaitable(
+                device,
+                this->QueueAvailableFence);
+        }
+
+        {
+            const VkCommandBufferBeginInfo cmdInfo{
+                .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO },
+                .pNext{ nullptr },
+                .flags{ 0 },
+                .pInheritanceInfo{ nullptr }
+            };
+            if (vkBeginCommandBuffer(
+                    this->Buffers.hTransferCmdBuff,
+                    &cmdInfo) != VK_SUCCESS) 
+            {
+                co_return Error::RecordError;
+            }
+        }
+
+        {
+            DflHW::Profiler::Zone zone(
+                                    this->pInfo->pProfiler,
+                                    this->Buffers.hTransferCmdBuff,
+                                    this->GetFamily(),
+                                    "Buffer::Read");
+
+            std::vector<VkBufferCopy> copyRegions{ };
+            for (const auto& staged : fill)
+            {
+                copyRegions.push_back({
+                    .srcOffset{ staged.BufferOffset },
+                    .dstOffset{ staged.StageOffset },
+                    .size{ staged.Size } });
+            }
+            vkCmdCopyBuffer(
+                this->Buffers.hTransferCmdBuff,
+                this->Buffers.hBuffer,
+                gpu.GetStageBuffer(),
+                static_cast<uint32_t>(copyRegions.size()),
+                copyRegions.data());
+
+            const VkBufferMemoryBarrier stageBuffBarrier{
                 .sType{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER },
                 .pNext{ nullptr },
                 .srcAccessMask{ VK_ACCESS_TRANSFER_WRITE_BIT },
-                .dstAccessMask{ VK_ACCESS_TRANSFER_READ_BIT },
+                .dstAccessMask{ VK_ACCESS_HOST_READ_BIT },
                 .srcQueueFamilyIndex{ VK_QUEUE_FAMILY_IGNORED },
                 .dstQueueFamilyIndex{ VK_QUEUE_FAMILY_IGNORED },
-                .buffer{ intermBuff },
+                .buffer{ gpu.GetStageBuffer() },
                 .offset{ 0 },
-                .size{ dstSize[0] *
-                       (dstSize[1] == 0 ? 1 : dstSize[1]) *
-                       (dstSize[2] == 0 ? 1 : dstSize[2]) }
-        };
-        vkCmdPipelineBarrier(
-            cmdBuff,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            0,
+                .size{ VK_WHOLE_SIZE }
+            };
+            vkCmdPipelineBarrier(
+                this->Buffers.hTransferCmdBuff,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_HOST_BIT,
+                0,
+                0, nullptr,
+                1, &stageBuffBarrier,
+                0, nullptr);
+            if (this->pInfo->pProfiler != nullptr)
+            {
+                this->pInfo->pProfiler->Count(DflHW::Profiler::Counter::BarriersIssued, 1);
+            }
+        }
+
+        if (vkEndCommandBuffer(this->Buffers.hTransferCmdBuff) != VK_SUCCESS) 
+        {
+            if (this->pInfo->pProfiler != nullptr)
+            {
+                this->pInfo->pProfiler->Discard(this->Buffers.hTransferCmdBuff);
+            }
+            co_return Error::RecordError;
+        }
+
+        if (this->SubmitTransfer() != VK_SUCCESS) 
+        {
+            co_return Error::ReadError;
+        }
+
+        while (vkGetFenceStatus(device, this->QueueAvailableFence) != VK_SUCCESS)
+        {
+            co_await DflGen::Job<Error>::Awaitable(
+                device,
+                this->QueueAvailableFence);
+        }
+
+        for (const auto& staged : fill)
+        {
+            DflMem::Copier::FromMapped(
+                destination.data() + staged.HostOffset,
+                static_cast<const std::byte*>(gpu.GetStageMap()) + staged.StageOffset,
+                staged.Size);
+        }
+
+        vkResetCommandBuffer(
+            this->Buffers.hTransferCmdBuff,
+            0);
+    }
+
+    co_return Error::Success;
+}
+
+VkResult DflMem::Buffer< DflMem::StorageType::Buffer >::SubmitTransfer() const noexcept
+{
+    std::lock_guard<std::mutex> lock(this->pOwnership->Lock);
+    auto& ownership{ *this->pOwnership };
+
+    std::vector<VkCommandBufferSubmitInfo> cmdBuffers{ };
+    std::vector<VkSemaphoreSubmitInfo>     waits{ };
+    if (ownership.ReturnedBy.has_value()) 
+    {
+        if (!INT_RecordOwnershipCommand(
+                this->Buffers.hOwnershipCmdBuff,
+                this->Buffers.hBuffer,
+                this->GetFamily(),
+                ownership.ReturnedBy,
+                std::nullopt,
+                this->pInfo->pProfiler)) 
+        {
+            if (this->pInfo->pProfiler != nullptr)
+            {
+                this->pInfo->pProfiler->Discard(this->Buffers.hTransferCmdBuff);
+            }
+            // the fence was never reset, so it's still signaled
+            return VK_ERROR_UNKNOWN;
+        }
+
+        cmdBuffers.push_back({
+            .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO },
+            .pNext{ nullptr },
+            .commandBuffer{ this->Buffers.hOwnershipCmdBuff },
+            .deviceMask{ 0 } });
+        waits.push_back({
+            .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO },
+            .pNext{ nullptr },
+            .semaphore{ ownership.ReturnPoint.hSemaphore },
+            .value{ ownership.ReturnPoint.Value },
+            .stageMask{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT },
+            .deviceIndex{ 0 } });
+    }
+    cmdBuffers.push_back({
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO },
+        .pNext{ nullptr },
+        .commandBuffer{ this->Buffers.hTransferCmdBuff },
+        .deviceMask{ 0 } });
+
+    const VkSemaphoreSubmitInfo signal{
+        .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO },
+        .pNext{ nullptr },
+        .semaphore{ this->Buffers.hTimeline },
+        .value{ ownership.TimelineValue + 1 },
+        .stageMask{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT },
+        .deviceIndex{ 0 }
+    };
+    const VkSubmitInfo2 submitInfo{
+        .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .waitSemaphoreInfoCount{ static_cast<uint32_t>(waits.size()) },
+        .pWaitSemaphoreInfos{ waits.data() },
+        .commandBufferInfoCount{ static_cast<uint32_t>(cmdBuffers.size()) },
+        .pCommandBufferInfos{ cmdBuffers.data() },
+        .signalSemaphoreInfoCount{ 1 },
+        .pSignalSemaphoreInfos{ &signal }
+    };
+
+    // the fence is shared by every buffer on the queue, so it's reset only
+    // once nothing can keep it from being signaled
+    vkResetFences(
+        this->pInfo->MemoryBlock.GetDevice().GetDevice(),
+        1,
+        &this->QueueAvailableFence);
+    const VkResult result{ vkQueueSubmit2(
+                                this->pInfo->MemoryBlock.GetQueue(),
+                                1,
+                                &submitInfo,
+                                this->QueueAvailableFence) };
+    if (result == VK_SUCCESS) 
+    {
+        ownership.TimelineValue++;
+        ownership.ReturnedBy.reset();
+    }
+    else
+    {
+        // the fence still has to be signaled, or every buffer on the queue would wait forever
+        vkQueueSubmit2(
+            this->pInfo->MemoryBlock.GetQueue(),
             0,
             nullptr,
+            this->QueueAvailableFence);
+        if (this->pInfo->pProfiler != nullptr)
+        {
+            this->pInfo->pProfiler->Discard(this->Buffers.hTransferCmdBuff);
+        }
+    }
+
+    return result;
+}
+
+auto DflMem::Buffer< DflMem::StorageType::Buffer >::Release(const uint32_t dstFamily) const noexcept
+-> std::optional<DflHW::Device::TimelinePoint>
+{
+    const VkDevice& device{ this->pInfo->MemoryBlock.GetDevice().GetDevice() };
+
+    std::lock_guard<std::mutex> lock(this->pOwnership->Lock);
+    auto& ownership{ *this->pOwnership };
+
+    // the ownership command buffer may still be executing a previous transfer
+    if (vkWaitForFences(
+            device,
             1,
-            &intermBuffBarrier,
+            &this->QueueAvailableFence,
+            VK_TRUE,
+            UINT64_MAX) != VK_SUCCESS) 
+    {
+        return std::nullopt;
+    }
+
+    if (!INT_RecordOwnershipCommand(
+            this->Buffers.hOwnershipCmdBuff,
+            this->Buffers.hBuffer,
+            this->GetFamily(),
+            ownership.ReturnedBy,
+            dstFamily,
+            this->pInfo->pProfiler)) 
+    {
+        return std::nullopt;
+    }
+
+    const VkCommandBufferSubmitInfo cmdBuffer{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO },
+        .pNext{ nullptr },
+        .commandBuffer{ this->Buffers.hOwnershipCmdBuff },
+        .deviceMask{ 0 }
+    };
+    const VkSemaphoreSubmitInfo wait{
+        .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO },
+        .pNext{ nullptr },
+        .semaphore{ ownership.ReturnPoint.hSemaphore },
+        .value{ ownership.ReturnPoint.Value },
+        .stageMask{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT },
+        .deviceIndex{ 0 }
+    };
+    const VkSemaphoreSubmitInfo signal{
+        .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO },
+        .pNext{ nullptr },
+        .semaphore{ this->Buffers.hTimeline },
+        .value{ ownership.TimelineValue + 1 },
+        .stageMask{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT },
+        .deviceIndex{ 0 }
+    };
+    const VkSubmitInfo2 submitInfo{
+        .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .waitSemaphoreInfoCount{ ownership.ReturnedBy.has_value() ? 1u : 0u },
+        .pWaitSemaphoreInfos{ &wait },
+        .commandBufferInfoCount{ 1 },
+        .pCommandBufferInfos{ &cmdBuffer },
+        .signalSemaphoreInfoCount{ 1 },
+        .pSignalSemaphoreInfos{ &signal }
+    };
+
+    vkResetFences(
+        device,
+        1,
+        &this->QueueAvailableFence);
+    if (vkQueueSubmit2(
+            this->pInfo->MemoryBlock.GetQueue(),
+            1,
+            &submitInfo,
+            this->QueueAvailableFence) != VK_SUCCESS) 
+    {
+        // the fence still has to be signaled, or the next transfer would wait forever
+        vkQueueSubmit2(
+            this->pInfo->MemoryBlock.GetQueue(),
             0,
-            nullptr);
+            nullptr,
+            this->QueueAvailableFence);
+        return std::nullopt;
+    }
 
-        const VkBufferImageCopy copyRegion{
-            .bufferRowLength{ 0 },
-            .bufferImageHeight{ 0 },
-            .bufferOffset{ 0 },
+    ownership.TimelineValue++;
+    ownership.ReturnedBy.reset();
+
+    return DflHW::Device::TimelinePoint{
+                .hSemaphore{ this->Buffers.hTimeline },
+                .Value{ ownership.TimelineValue } };
+}
+
+void DflMem::Buffer< DflMem::StorageType::Buffer >::Return(
+    const uint32_t                      srcFamily,
+    const DflHW::Device::TimelinePoint& point) const noexcept
+{
+    std::lock_guard<std::mutex> lock(this->pOwnership->Lock);
+
+    this->pOwnership->ReturnedBy = srcFamily;
+    this->pOwnership->ReturnPoint = point;
+}
+
+// Accesses that leave something for later accesses to wait for
+static constexpr VkAccessFlags2 INT_WriteAccess{
+    VK_ACCESS_2_SHADER_WRITE_BIT
+    | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+    | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT
+    | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+    | VK_ACCESS_2_TRANSFER_WRITE_BIT
+    | VK_ACCESS_2_HOST_WRITE_BIT
+    | VK_ACCESS_2_MEMORY_WRITE_BIT };
+
+static inline VkImageAspectFlags INT_GetAspect(const VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    case VK_FORMAT_S8_UINT:
+        return VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+// Barriers that can cover each other's subresources
+static inline bool INT_IsSameTransition(
+    const VkImageMemoryBarrier2& first,
+    const VkImageMemoryBarrier2& second)
+{
+    return first.image == second.image
+           && first.srcStageMask == second.srcStageMask
+           && first.srcAccessMask == second.srcAccessMask
+           && first.dstStageMask == second.dstStageMask
+           && first.dstAccessMask == second.dstAccessMask
+           && first.oldLayout == second.oldLayout
+           && first.newLayout == second.newLayout;
+}
+
+static inline void INT_RecordTransitions(
+    const VkCommandBuffer&                    cmdBuff,
+    const std::vector<VkImageMemoryBarrier2>& transitions)
+{
+    if (transitions.empty()) { return; }
+
+    const VkDependencyInfo dependency{
+        .sType{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO },
+        .pNext{ nullptr },
+        .dependencyFlags{ 0 },
+        .memoryBarrierCount{ 0 },
+        .pMemoryBarriers{ nullptr },
+        .bufferMemoryBarrierCount{ 0 },
+        .pBufferMemoryBarriers{ nullptr },
+        .imageMemoryBarrierCount{ static_cast<uint32_t>(transitions.size()) },
+        .pImageMemoryBarriers{ transitions.data() }
+    };
+    vkCmdPipelineBarrier2(
+        cmdBuff,
+        &dependency);
+}
+
+// The corners of the region at offset of the given size, as it is in a mip level.
+// Dimensions the image doesn't have (of size 0) span the single texel they hold.
+static inline std::array<VkOffset3D, 2> INT_GetMipBounds(
+    const std::array<int32_t, 3>&  offset,
+    const std::array<uint32_t, 3>& size,
+    const uint32_t                 mipLevel)
+{
+    std::array<int32_t, 3> begin{ 0, 0, 0 };
+    std::array<int32_t, 3> end{ 1, 1, 1 };
+    for (uint32_t i{ 0 }; i < 3; i++)
+    {
+        if (size[i] == 0) { continue; }
+
+        // the end is rounded up, so a texel the region covers in part is still written
+        begin[i] = offset[i] >> mipLevel;
+        end[i] = std::max(
+                    (offset[i] + static_cast<int32_t>(size[i]) + (1 << mipLevel) - 1) >> mipLevel,
+                    begin[i] + 1);
+    }
+
+    return { VkOffset3D{ begin[0], begin[1], begin[2] },
+             VkOffset3D{ end[0], end[1], end[2] } };
+}
+
+// A tile of one of the regions of a write, in texel blocks, and where it goes in the stage
+struct INT_StagedTile {
+    uint32_t Patch{ 0 };
+    uint32_t X{ 0 };
+    uint32_t Y{ 0 };
+    uint32_t Z{ 0 };
+    uint32_t Width{ 0 };
+    uint32_t Height{ 0 };
+    uint64_t StageOffset{ 0 };
+};
+
+// Splits regions of the given sizes in texel blocks into tiles of as many whole
+// rows as fit in a slot of the stage ring (or of parts of a row, if not even one
+// does), and packs the tiles of all of them into as few fills of a slot as they
+// need. Offsets in the slot are kept to multiples of the block size and of 4, as
+// copies need.
+static std::vector<std::vector<INT_StagedTile>> INT_StageTiles(
+    const std::vector<std::array<uint32_t, 3>>& regions,
+    const uint32_t                              blockSize)
+{
+    const uint64_t alignment{ std::lcm<uint64_t>(blockSize, 4) };
+
+    std::vector<std::vector<INT_StagedTile>> fills(1);
+    uint64_t stageOffset{ 0 };
+    for (uint32_t patch{ 0 }; patch < regions.size(); patch++)
+    {
+        const std::array<uint32_t, 3>& blocks{ regions[patch] };
+        const uint32_t width{ static_cast<uint32_t>(
+                                std::min<uint64_t>(blocks[0], DflHW::Device::StageSlotMemory / blockSize) ) };
+        const uint32_t height{ static_cast<uint32_t>(
+                                std::clamp<uint64_t>(
+                                    DflHW::Device::StageSlotMemory / (static_cast<uint64_t>(width) * blockSize),
+                                    1,
+                                    blocks[1]) ) };
+
+        for (uint32_t z{ 0 }; z < blocks[2]; z++)
+        {
+            for (uint32_t y{ 0 }; y < blocks[1]; y += height)
+            {
+                for (uint32_t x{ 0 }; x < blocks[0]; x += width)
+                {
+                    INT_StagedTile tile{
+                        .Patch{ patch },
+                        .X{ x },
+                        .Y{ y },
+                        .Z{ z },
+                        .Width{ std::min(width, blocks[0] - x) },
+                        .Height{ std::min(height, blocks[1] - y) } };
+
+                    const uint64_t size{ static_cast<uint64_t>(tile.Width) * tile.Height * blockSize };
+                    if (stageOffset + size > DflHW::Device::StageSlotMemory)
+                    {
+                        fills.emplace_back();
+                        stageOffset = 0;
+                    }
+
+                    tile.StageOffset = stageOffset;
+                    fills.back().push_back(tile);
+                    stageOffset = (stageOffset + size + alignment - 1) / alignment * alignment;
+                }
+            }
+        }
+    }
+
+    if (fills.back().empty()) { fills.pop_back(); }
+
+    return fills;
+}
+
+// the region is inside the level, and on whole blocks but at the level's edges
+static inline bool INT_IsRegionValid(
+    const DflMem::Buffer< DflMem::StorageType::Image >::Region&     region,
+    const DflMem::Buffer< DflMem::StorageType::Image >::TexelBlock& block,
+    const std::array<uint32_t, 3>&                                 size,
+    const uint32_t                                                 mipLevels,
+    const uint32_t                                                 layers)
+{
+    if (region.Level >= mipLevels || region.Layer >= layers || block.Size == 0) { return false; }
+
+    for (uint32_t i{ 0 }; i < 3; i++)
+    {
+        const uint64_t levelSize{ std::max(std::max(size[i], 1u) >> region.Level, 1u) };
+        const uint64_t extent{ std::max(region.Extent[i], 1u) };
+        const uint32_t granularity{ i == 0 ? block.Width : (i == 1 ? block.Height : 1) };
+        if ( region.Offset[i] < 0
+             || region.Offset[i] + extent > levelSize
+             || region.Offset[i] % granularity != 0
+             || (extent % granularity != 0 && region.Offset[i] + extent != levelSize) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Copies a fill of tiles of the patches to the claimed slot of the stage ring, and
+// submits their copy to the image, after the transitions, with the slot's fence.
+// Rows of blocks in a patch's source are its row pitch apart, which can't be 0,
+// and each slice follows the last row of the one before it.
+static VkResult INT_SubmitTiles(
+    const DflHW::Device&                                           gpu,
+    const VkQueue                                                  queue,
+    const VkCommandBuffer&                                         cmdBuff,
+    const DflHW::Device::StageSlot&                                slot,
+    const VkImage&                                                 dstImage,
+    const VkImageAspectFlags                                       aspect,
+    const DflMem::Buffer< DflMem::StorageType::Image >::TexelBlock& block,
+    const std::vector<
+            DflMem::Buffer< DflMem::StorageType::Image >::Patch>&   patches,
+    const std::vector<std::array<uint32_t, 3>>&                    blocks,
+    const std::vector<INT_StagedTile>&                             tiles,
+    const std::vector<VkImageMemoryBarrier2>&                      transitions)
+{
+    std::vector<VkBufferImageCopy> copies{ };
+    for (const auto& tile : tiles)
+    {
+        const auto& patch{ patches[tile.Patch] };
+        const auto& region{ patch.Target };
+
+        const uint64_t tileRowSize{ static_cast<uint64_t>(tile.Width) * block.Size };
+        for (uint32_t row{ 0 }; row < tile.Height; row++)
+        {
+            std::memcpy(
+                static_cast<std::byte*>(slot.pMap) + tile.StageOffset + row * tileRowSize,
+                patch.Source.data()
+                    + (static_cast<uint64_t>(tile.Z) * blocks[tile.Patch][1] + tile.Y + row) * patch.RowPitch
+                    + static_cast<uint64_t>(tile.X) * block.Size,
+                tileRowSize);
+        }
+
+        // rows of blocks, in texels, while the extent stops at the region's
+        // edges, which don't have to be on whole blocks
+        copies.push_back({
+            .bufferOffset{ slot.Offset + tile.StageOffset },
+            .bufferRowLength{ tile.Width * block.Width },
+            .bufferImageHeight{ tile.Height * block.Height },
             .imageSubresource{
-                .aspectMask{ dstAspectFlag.GetValue() },
-                .mipLevel{ 0 },
-                .baseArrayLayer{ dstArrayLayer },
+                .aspectMask{ aspect },
+                .mipLevel{ region.Level },
+                .baseArrayLayer{ region.Layer },
                 .layerCount{ 1 } },
-            .imageOffset{ VkOffset3D{ dstOffset[0], dstOffset[1], dstOffset[2] } },
-            .imageExtent{ VkExtent3D{ dstSize[0], dstSize[1], dstSize[2] } }
-        };
-        vkCmdCopyBufferToImage(
-            cmdBuff,
-            intermBuff,
-            dstImage,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            1,
-            &copyRegion);
+            .imageOffset{ VkOffset3D{
+                region.Offset[0] + static_cast<int32_t>(tile.X * block.Width),
+                region.Offset[1] + static_cast<int32_t>(tile.Y * block.Height),
+                region.Offset[2] + static_cast<int32_t>(tile.Z) } },
+            .imageExtent{ VkExtent3D{
+                std::min(tile.Width * block.Width, std::max(region.Extent[0], 1u) - tile.X * block.Width),
+                std::min(tile.Height * block.Height, std::max(region.Extent[1], 1u) - tile.Y * block.Height),
+                1 } } });
+    }
+
+    // the stage isn't necessarily coherent
+    const VkMappedMemoryRange range{
+        .sType{ VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE },
+        .pNext{ nullptr },
+        .memory{ gpu.GetStageMemory() },
+        .offset{ slot.Offset },
+        .size{ DflHW::Device::StageSlotMemory }
+    };
+    const VkCommandBufferBeginInfo cmdInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO },
+        .pNext{ nullptr },
+        .flags{ VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT },
+        .pInheritanceInfo{ nullptr }
+    };
+    if ( vkFlushMappedMemoryRanges(gpu.GetDevice(), 1, &range) != VK_SUCCESS
+         || vkResetCommandBuffer(cmdBuff, 0) != VK_SUCCESS
+         || vkBeginCommandBuffer(cmdBuff, &cmdInfo) != VK_SUCCESS )
+    {
+        return VK_ERROR_UNKNOWN;
+    }
+
+    INT_RecordTransitions(
+        cmdBuff,
+        transitions);
+    vkCmdCopyBufferToImage(
+        cmdBuff,
+        gpu.GetStageBuffer(),
+        dstImage,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(copies.size()),
+        copies.data());
+
+    if (vkEndCommandBuffer(cmdBuff) != VK_SUCCESS)
+    {
+        return VK_ERROR_UNKNOWN;
     }
 
-    // we then create mips of the copied data
-    for( uint32_t i{ 1 }; i < dstMipLevels; i++)
+    const VkSubmitInfo submitInfo{
+        .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO },
+        .pNext{ nullptr },
+        .waitSemaphoreCount{ 0 },
+        .pWaitSemaphores{ nullptr },
+        .pWaitDstStageMask{ nullptr },
+        .commandBufferCount{ 1 },
+        .pCommandBuffers{ &cmdBuff },
+        .signalSemaphoreCount{ 0 },
+        .pSignalSemaphores{ nullptr }
+    };
+    vkResetFences(
+        gpu.GetDevice(),
+        1,
+        &slot.hFence);
+    const VkResult result{ vkQueueSubmit(
+                                queue,
+                                1,
+                                &submitInfo,
+                                slot.hFence) };
+    // the fence still has to be signaled, or the slot would never be free again
+    if (result != VK_SUCCESS)
+    {
+        vkQueueSubmit(
+            queue,
+            0,
+            nullptr,
+            slot.hFence);
+    }
+
+    return result;
+}
+
+// Records the blits of the levels of the layer after the first, each from the one
+// before it, over the bounds of the region in each. Compressed formats can't be
+// blitted to, so their levels have to be written one by one.
+static inline void INT_RecordBlits(
+    const VkCommandBuffer&         cmdBuff,
+    const VkImage&                 dstImage,
+    const VkImageAspectFlags       aspect,
+    const uint32_t                 dstArrayLayer,
+    const std::array<int32_t, 3>&  dstOffset,
+    const std::array<uint32_t, 3>& dstSize,
+    const uint32_t                 blittedLevels,
+    const VkFilter                 dstFilter)
+{
+    for( uint32_t i{ 1 }; i < blittedLevels; i++)
     { 
         const VkImageMemoryBarrier imageBarrier{
             .sType{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER },
@@ -658,7 +1940,7 @@ inline bool DflMem::Buffer< DflMem::StorageType::Image >::RecordWriteImageComman
             .dstQueueFamilyIndex{ VK_QUEUE_FAMILY_IGNORED },
             .image{ dstImage },
             .subresourceRange{
-                .aspectMask{ dstAspectFlag.GetValue() },
+                .aspectMask{ aspect },
                 .baseMipLevel{ i - 1 },
                 .levelCount{ 1 },
                 .baseArrayLayer{ dstArrayLayer },
@@ -675,25 +1957,21 @@ inline bool DflMem::Buffer< DflMem::StorageType::Image >::RecordWriteImageComman
             
         const VkImageBlit imgBlit{
             .srcSubresource{
-                .aspectMask{ dstAspectFlag.GetValue() },
+                .aspectMask{ aspect },
                 .mipLevel{ i - 1 },
                 .baseArrayLayer{ dstArrayLayer },
                 .layerCount{ 1 }},
             .srcOffsets{
-                VkOffset3D{ 0, 0, 0 },
-                VkOffset3D{ static_cast<int>(dstSize[0] >> (i - 1)),
-                            dstSize[1] == 0 ? 0 : static_cast<int>(dstSize[1] >> (i - 1)),
-                            dstSize[2] == 0 ? 0 : static_cast<int>(dstSize[2] >> (i - 1)) }},
+                INT_GetMipBounds(dstOffset, dstSize, i - 1)[0],
+                INT_GetMipBounds(dstOffset, dstSize, i - 1)[1] },
             .dstSubresource{
-                .aspectMask{ dstAspectFlag.GetValue() },
+                .aspectMask{ aspect },
                 .mipLevel{ i },
                 .baseArrayLayer{ dstArrayLayer },
                 .layerCount{ 1 }},
             .dstOffsets{
-                VkOffset3D{ 0, 0, 0 },
-                VkOffset3D{ static_cast<int>(dstSize[0] >> i),
-                            dstSize[1] == 0 ? 0 : static_cast<int>(dstSize[1] >> i),
-                            dstSize[2] == 0 ? 0 : static_cast<int>(dstSize[2] >> i) } }};
+                INT_GetMipBounds(dstOffset, dstSize, i)[0],
+                INT_GetMipBounds(dstOffset, dstSize, i)[1] } };
         vkCmdBlitImage(
             cmdBuff,
             dstImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
@@ -702,13 +1980,35 @@ inline bool DflMem::Buffer< DflMem::StorageType::Image >::RecordWriteImageComman
             dstFilter);
     }
 
-    if (vkEndCommandBuffer(
-            cmdBuff) != VK_SUCCESS) 
+    // the levels that were blitted from go back, so the whole image is in one layout
+    if (blittedLevels > 1)
     {
-        return !VK_SUCCESS;
+        const VkImageMemoryBarrier imageBarrier{
+            .sType{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER },
+            .pNext{ nullptr },
+            .srcAccessMask{ VK_ACCESS_TRANSFER_READ_BIT },
+            .dstAccessMask{ VK_ACCESS_TRANSFER_WRITE_BIT },
+            .oldLayout{ VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL },
+            .newLayout{ VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL },
+            .srcQueueFamilyIndex{ VK_QUEUE_FAMILY_IGNORED },
+            .dstQueueFamilyIndex{ VK_QUEUE_FAMILY_IGNORED },
+            .image{ dstImage },
+            .subresourceRange{
+                .aspectMask{ aspect },
+                .baseMipLevel{ 0 },
+                .levelCount{ blittedLevels - 1 },
+                .baseArrayLayer{ dstArrayLayer },
+                .layerCount{ 1 } },
+        };
+        vkCmdPipelineBarrier(
+            cmdBuff,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &imageBarrier );
     }
-
-    return VK_SUCCESS;
 }
 
 inline bool DflMem::Buffer< DflMem::StorageType::Image >::RecordReadImageCommand(
@@ -717,6 +2017,9 @@ inline bool DflMem::Buffer< DflMem::StorageType::Image >::RecordReadImageCommand
     const VkBuffer&                stageBuff,
     const VkBuffer&                intermBuff,
     const VkImage&                 sourceImage,
+    const std::vector<
+            VkImageMemoryBarrier2>&
+                                   sourceTransitions,
     const std::array<
             uint32_t, 3>&          sourceSize,
     const std::array<
@@ -738,6 +2041,10 @@ inline bool DflMem::Buffer< DflMem::StorageType::Image >::RecordReadImageCommand
         }
     }
 
+    INT_RecordTransitions(
+        cmdBuff,
+        sourceTransitions);
+
     {
         const VkBufferImageCopy copyRegion{
             .bufferRowLength{ 0 },
@@ -849,6 +2156,7 @@ DflMem::Buffer< DflMem::StorageType::Image >::Buffer(const Info& info)
                 info.MipLevels,
                 info.Layers,
                 info.Samples,
+                info.Format,
                 info.Options.GetValue(),
                 info.MemoryBlock.GetDevice().GetStageBuffer(),
                 info.MemoryBlock.GetDevice().GetStageMap() == nullptr ?
@@ -857,7 +2165,12 @@ DflMem::Buffer< DflMem::StorageType::Image >::Buffer(const Info& info)
   MemoryLayoutID( this->pInfo->MemoryBlock.Alloc(this->Buffers.hImage).value() ),
   QueueAvailableFence( this->pInfo->MemoryBlock.GetDevice().GetFence(
                             this->pInfo->MemoryBlock.GetQueue().FamilyIndex,
-                            this->pInfo->MemoryBlock.GetQueue().Index)) {}
+                            this->pInfo->MemoryBlock.GetQueue().Index)),
+  IsShared( INT_IsShared(
+                info.MemoryBlock.GetQueue().FamilyIndex,
+                info.AccessingQueues) ),
+  pTracker( new Tracker{ .Subresources{ std::vector<Tracker::Subresource>(info.MipLevels * info.Layers) } } ),
+  FormatBlock( GetTexelBlock(info.Format) ) {}
 
 DflMem::Buffer< DflMem::StorageType::Image >::~Buffer() {
     vkDeviceWaitIdle(this->pInfo->MemoryBlock.GetDevice().GetDevice());
@@ -867,6 +2180,11 @@ DflMem::Buffer< DflMem::StorageType::Image >::~Buffer() {
         this->pInfo->MemoryBlock.GetCmdPool(),
         1,
         &this->Buffers.hTransferCmdBuff);
+    vkFreeCommandBuffers(
+        this->pInfo->MemoryBlock.GetDevice().GetDevice(),
+        this->pInfo->MemoryBlock.GetCmdPool(),
+        static_cast<uint32_t>(this->Buffers.StageCmdBuffs.size()),
+        this->Buffers.StageCmdBuffs.data());
 
     vkDestroyEvent(
         this->pInfo->MemoryBlock.GetDevice().GetDevice(),
@@ -879,4 +2197,525 @@ DflMem::Buffer< DflMem::StorageType::Image >::~Buffer() {
         this->pInfo->MemoryBlock.GetDevice().GetDevice(),
         this->Buffers.hImage,
         nullptr);
-}
\ No newline at end of file
+}
+
+uint32_t DflMem::Buffer< DflMem::StorageType::Image >::GetFamily() const noexcept
+{
+    return this->pInfo->MemoryBlock.GetQueue().FamilyIndex;
+}
+
+VkImageLayout DflMem::Buffer< DflMem::StorageType::Image >::GetLayout(
+    const uint32_t level,
+    const uint32_t layer) const noexcept
+{
+    if ( level >= this->pInfo->MipLevels
+         || layer >= this->pInfo->Layers ) [[ unlikely ]]
+    {
+        return VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+
+    std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+    return this->pTracker->Subresources[layer * this->pInfo->MipLevels + level].Layout;
+}
+
+std::vector<DflMem::Buffer< DflMem::StorageType::Image >::Tracker::Subresource> DflMem::Buffer< DflMem::StorageType::Image >::SaveStates() const noexcept
+{
+    std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+    return this->pTracker->Subresources;
+}
+
+void DflMem::Buffer< DflMem::StorageType::Image >::RestoreStates(
+    const std::vector<Tracker::Subresource>& states) const noexcept
+{
+    std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+    if (states.size() == this->pTracker->Subresources.size()) [[ likely ]]
+    {
+        this->pTracker->Subresources = states;
+    }
+}
+
+uint32_t DflMem::Buffer< DflMem::StorageType::Image >::Transition(
+    const Subresources&                 subresources,
+    const State&                        state,
+    const bool                          isDiscarding,
+          std::vector<
+            VkImageMemoryBarrier2>&     barriers) const noexcept
+{
+    const uint32_t levels{ this->pInfo->MipLevels };
+    const uint32_t lastLevel{ subresources.Levels == VK_REMAINING_MIP_LEVELS
+                                ? levels
+                                : std::min(subresources.BaseLevel + subresources.Levels, levels) };
+    const uint32_t lastLayer{ subresources.Layers == VK_REMAINING_ARRAY_LAYERS
+                                ? this->pInfo->Layers
+                                : std::min(subresources.BaseLayer + subresources.Layers, this->pInfo->Layers) };
+    const bool isWriting{ (state.Access & INT_WriteAccess) != 0 };
+
+    // one barrier per run of levels of a layer, merged across layers afterwards
+    std::vector<VkImageMemoryBarrier2> runs{ };
+    {
+        std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+        for (uint32_t layer{ subresources.BaseLayer }; layer < lastLayer; layer++)
+        {
+            for (uint32_t level{ subresources.BaseLevel }; level < lastLevel; level++)
+            {
+                Tracker::Subresource& current{ this->pTracker->Subresources[layer * levels + level] };
+                VkImageMemoryBarrier2 barrier{
+                    .sType{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 },
+                    .pNext{ nullptr },
+                    .srcStageMask{ current.WriteStages | current.ReadStages },
+                    .srcAccessMask{ current.WriteAccess },
+                    .dstStageMask{ state.Stages },
+                    .dstAccessMask{ state.Access },
+                    .oldLayout{ isDiscarding ? VK_IMAGE_LAYOUT_UNDEFINED : current.Layout },
+                    .newLayout{ state.Layout },
+                    .srcQueueFamilyIndex{ VK_QUEUE_FAMILY_IGNORED },
+                    .dstQueueFamilyIndex{ VK_QUEUE_FAMILY_IGNORED },
+                    .image{ this->Buffers.hImage },
+                    .subresourceRange{
+                        .aspectMask{ INT_GetAspect(this->pInfo->Format) },
+                        .baseMipLevel{ level },
+                        .levelCount{ 1 },
+                        .baseArrayLayer{ layer },
+                        .layerCount{ 1 } }
+                };
+
+                if (current.Layout == state.Layout)
+                {
+                    // reads only wait for the last write, and only once per stage
+                    if (!isWriting)
+                    {
+                        const bool isWaiting{ current.WriteStages != VK_PIPELINE_STAGE_2_NONE
+                                              && (state.Stages & ~current.ReadStages) != 0 };
+                        current.ReadStages |= state.Stages;
+                        if (!isWaiting) { continue; }
+
+                        barrier.srcStageMask = current.WriteStages;
+                        barrier.oldLayout = current.Layout;
+                    }
+                    else if (barrier.srcStageMask == VK_PIPELINE_STAGE_2_NONE)
+                    {
+                        current = { state.Layout, state.Stages, state.Access & INT_WriteAccess, VK_PIPELINE_STAGE_2_NONE };
+                        continue;
+                    }
+                    else
+                    {
+                        current = { state.Layout, state.Stages, state.Access & INT_WriteAccess, VK_PIPELINE_STAGE_2_NONE };
+                    }
+                }
+                else
+                {
+                    // the transition itself is a write the later stages have to wait for
+                    current = { state.Layout,
+                                state.Stages,
+                                state.Access & INT_WriteAccess,
+                                isWriting ? VK_PIPELINE_STAGE_2_NONE : state.Stages };
+                }
+
+                if ( !runs.empty()
+                     && INT_IsSameTransition(runs.back(), barrier)
+                     && runs.back().subresourceRange.baseArrayLayer == layer
+                     && runs.back().subresourceRange.baseMipLevel + runs.back().subresourceRange.levelCount == level )
+                {
+                    runs.back().subresourceRange.levelCount++;
+                    continue;
+                }
+                runs.push_back(barrier);
+            }
+        }
+    }
+
+    const uint64_t first{ barriers.size() };
+    for (const auto& run : runs)
+    {
+        if ( barriers.size() > first
+             && INT_IsSameTransition(barriers.back(), run)
+             && barriers.back().subresourceRange.baseMipLevel == run.subresourceRange.baseMipLevel
+             && barriers.back().subresourceRange.levelCount == run.subresourceRange.levelCount
+             && barriers.back().subresourceRange.baseArrayLayer
+                    + barriers.back().subresourceRange.layerCount == run.subresourceRange.baseArrayLayer )
+        {
+            barriers.back().subresourceRange.layerCount++;
+            continue;
+        }
+        barriers.push_back(run);
+    }
+
+    return static_cast<uint32_t>(barriers.size() - first);
+}
+
+auto DflMem::Buffer< DflMem::StorageType::Image >::Write(
+    const std::span<const std::byte> source,
+    const uint32_t                   dstArrayLayer,
+    const Filter                     dstFilter) const noexcept
+-> const DflGen::Job<Error>
+{
+    return this->StreamPatches(
+                { { .Source{ source },
+                    .RowPitch{ 0 },
+                    .Target{ .Extent{ this->pInfo->Size }, .Level{ 0 }, .Layer{ dstArrayLayer } } } },
+                true,
+                dstFilter,
+                VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
+auto DflMem::Buffer< DflMem::StorageType::Image >::Write(
+    const std::span<const std::byte> source,
+    const uint64_t                   rowPitch,
+    const Region&                    region) const noexcept
+-> const DflGen::Job<Error>
+{
+    return this->Write(std::vector<Patch>{ { .Source{ source }, .RowPitch{ rowPitch }, .Target{ region } } });
+}
+
+auto DflMem::Buffer< DflMem::StorageType::Image >::Write(std::vector<Patch> patches) const noexcept
+-> const DflGen::Job<Error>
+{
+    return this->StreamPatches(
+                std::move(patches),
+                false,
+                Filter::Nearest,
+                INT_GetAspect(this->pInfo->Format));
+}
+
+auto DflMem::Buffer< DflMem::StorageType::Image >::StreamPatches(
+          std::vector<Patch>       patches,
+    const bool                     isBlitting,
+    const Filter                   filter,
+    const VkImageAspectFlags       aspect) const noexcept
+-> const DflGen::Job<Error>
+{
+    const DflHW::Device& gpu{ this->pInfo->MemoryBlock.GetDevice() };
+    const VkDevice device{ gpu.GetDevice() };
+
+    // every patch is in the image, and its source covers the last row of its region
+    for (auto& patch : patches)
+    {
+        const std::array<uint32_t, 3> extent{
+            std::max(patch.Target.Extent[0], 1u),
+            std::max(patch.Target.Extent[1], 1u),
+            std::max(patch.Target.Extent[2], 1u) };
+        const uint64_t rowSize{ static_cast<uint64_t>( (extent[0] + this->FormatBlock.Width - 1) / this->FormatBlock.Width )
+                                * this->FormatBlock.Size };
+        const uint64_t rows{ static_cast<uint64_t>( (extent[1] + this->FormatBlock.Height - 1) / this->FormatBlock.Height )
+                             * extent[2] };
+        patch.RowPitch = patch.RowPitch == 0 ? rowSize : patch.RowPitch;
+        if ( !INT_IsRegionValid(
+                patch.Target,
+                this->FormatBlock,
+                this->pInfo->Size,
+                this->pInfo->MipLevels,
+                this->pInfo->Layers)
+             || patch.RowPitch < rowSize
+             || patch.Source.size() < (rows - 1) * patch.RowPitch + rowSize ) [[ unlikely ]]
+        {
+            co_return Error::WriteError;
+        }
+    }
+    if (patches.empty()) { co_return Error::Success; }
+
+    // the tiles are written to the stage by the host
+    if (gpu.GetStageMap() == nullptr) [[ unlikely ]]
+    {
+        co_return Error::WriteError;
+    }
+
+    const uint32_t blittedLevels{ isBlitting && !this->FormatBlock.IsCompressed() ? this->pInfo->MipLevels : 1 };
+
+    const auto states{ this->SaveStates() };
+    std::vector<VkImageMemoryBarrier2> transitions{ };
+    if (blittedLevels > 1)
+    {
+        // every level of the layer is written, by the copy or the blits
+        const Region& region{ patches[0].Target };
+        bool isWholeLevel{ true };
+        for (uint32_t i{ 0 }; i < 3; i++)
+        {
+            isWholeLevel = isWholeLevel
+                           && region.Offset[i] == 0
+                           && std::max(region.Extent[i], 1u) == std::max(this->pInfo->Size[i], 1u);
+        }
+
+        this->Transition(
+            { .BaseLayer{ region.Layer }, .Layers{ 1 } },
+            { .Layout{ VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL },
+              .Stages{ VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT },
+              .Access{ VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT } },
+            isWholeLevel,
+            transitions);
+    }
+    else
+    {
+        // every level of a layer that is written gets a single transition, which
+        // doesn't need what was in the level before if a patch covers all of it
+        std::vector<std::pair<Subresources, bool>> written{ };
+        for (const auto& patch : patches)
+        {
+            bool isWholeLevel{ true };
+            for (uint32_t i{ 0 }; i < 3; i++)
+            {
+                isWholeLevel = isWholeLevel
+                               && patch.Target.Offset[i] == 0
+                               && std::max(patch.Target.Extent[i], 1u)
+                                    == std::max(std::max(this->pInfo->Size[i], 1u) >> patch.Target.Level, 1u);
+            }
+
+            auto level{ std::find_if(
+                            written.begin(),
+                            written.end(),
+                            [&patch](const auto& subresource) {
+                                return subresource.first.BaseLevel == patch.Target.Level
+                                       && subresource.first.BaseLayer == patch.Target.Layer; }) };
+            if (level == written.end())
+            {
+                written.push_back({
+                    { .BaseLevel{ patch.Target.Level }, .Levels{ 1 }, .BaseLayer{ patch.Target.Layer }, .Layers{ 1 } },
+                    isWholeLevel });
+            }
+            else
+            {
+                level->second = level->second || isWholeLevel;
+            }
+        }
+
+        for (const auto& [subresources, isWholeLevel] : written)
+        {
+            this->Transition(
+                subresources,
+                { .Layout{ VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL },
+                  .Stages{ VK_PIPELINE_STAGE_2_COPY_BIT },
+                  .Access{ VK_ACCESS_2_TRANSFER_WRITE_BIT } },
+                isWholeLevel,
+                transitions);
+        }
+    }
+
+    std::vector<std::array<uint32_t, 3>> blocks{ };
+    for (const auto& patch : patches)
+    {
+        blocks.push_back({
+            (std::max(patch.Target.Extent[0], 1u) + this->FormatBlock.Width - 1) / this->FormatBlock.Width,
+            (std::max(patch.Target.Extent[1], 1u) + this->FormatBlock.Height - 1) / this->FormatBlock.Height,
+            std::max(patch.Target.Extent[2], 1u) });
+    }
+
+    // every fill takes the next free slot of the ring, so the host writes one
+    // while the device copies out of the ones before it. Later fills are on the
+    // same queue, so the transitions, which go with the first, come before them too.
+    const auto fills{ INT_StageTiles(blocks, this->FormatBlock.Size) };
+    Error error{ Error::Success };
+    std::vector<VkFence> submitted{ };
+    // never raised, so waiting on it only suspends the job once
+    const auto pYield{ std::make_shared<const std::atomic_bool>(false) };
+    for (uint64_t i{ 0 }; i < fills.size(); i++)
+    {
+        DflHW::Device::StageSlot slot{ gpu.ClaimStageSlot() };
+        while (!slot.IsClaimed)
+        {
+            // a slot another writer holds is signaled until it submits out of
+            // it, so then the job yields instead of spinning on the fence
+            if (vkGetFenceStatus(device, slot.hFence) == VK_SUCCESS)
+            {
+                co_await DflGen::Job<Error>::Awaitable(pYield);
+            }
+            else
+            {
+                co_await DflGen::Job<Error>::Awaitable(
+                    device,
+                    slot.hFence);
+            }
+            slot = gpu.ClaimStageSlot();
+        }
+
+        const VkResult result{ INT_SubmitTiles(
+                                    gpu,
+                                    this->pInfo->MemoryBlock.GetQueue(),
+                                    this->Buffers.StageCmdBuffs[slot.Index],
+                                    slot,
+                                    this->Buffers.hImage,
+                                    aspect,
+                                    this->FormatBlock,
+                                    patches,
+                                    blocks,
+                                    fills[i],
+                                    i == 0 ? transitions : std::vector<VkImageMemoryBarrier2>{ }) };
+        gpu.ReturnStageSlot(slot);
+
+        if (result != VK_SUCCESS)
+        {
+            if (i == 0) { this->RestoreStates(states); }
+            error = Error::WriteError;
+            break;
+        }
+        submitted.push_back(slot.hFence);
+    }
+
+    // the blits come after the copies on the same queue, in the image's own command buffer
+    if ( error == Error::Success
+         && blittedLevels > 1 )
+    {
+        while (vkGetFenceStatus(device, this->QueueAvailableFence) == VK_NOT_READY)
+        {
+            co_await DflGen::Job<Error>::Awaitable(
+                        device,
+                        this->QueueAvailableFence);
+        }
+
+        const VkCommandBufferBeginInfo cmdInfo{
+            .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO },
+            .pNext{ nullptr },
+            .flags{ VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT },
+            .pInheritanceInfo{ nullptr }
+        };
+        const Region& region{ patches[0].Target };
+        if ( vkResetCommandBuffer(this->Buffers.hTransferCmdBuff, 0) != VK_SUCCESS
+             || vkBeginCommandBuffer(this->Buffers.hTransferCmdBuff, &cmdInfo) != VK_SUCCESS )
+        {
+            error = Error::RecordError;
+        }
+        else
+        {
+            INT_RecordBlits(
+                this->Buffers.hTransferCmdBuff,
+                this->Buffers.hImage,
+                aspect,
+                region.Layer,
+                region.Offset,
+                { std::max(region.Extent[0], 1u), std::max(region.Extent[1], 1u), std::max(region.Extent[2], 1u) },
+                blittedLevels,
+                static_cast<VkFilter>(filter));
+
+            if (vkEndCommandBuffer(this->Buffers.hTransferCmdBuff) != VK_SUCCESS)
+            {
+                error = Error::RecordError;
+            }
+        }
+
+        if (error == Error::Success)
+        {
+            const VkSubmitInfo subInfo{
+                .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO },
+                .pNext{ nullptr },
+                .waitSemaphoreCount{ 0 },
+                .pWaitSemaphores{ nullptr },
+                .pWaitDstStageMask{ nullptr },
+                .commandBufferCount{ 1 },
+                .pCommandBuffers{ &this->Buffers.hTransferCmdBuff },
+                .signalSemaphoreCount{ 0 },
+                .pSignalSemaphores{ nullptr }
+            };
+
+            vkResetFences(
+                device,
+                1,
+                &this->QueueAvailableFence);
+            if (vkQueueSubmit(
+                    this->pInfo->MemoryBlock.GetQueue(),
+                    1,
+                    &subInfo,
+                    this->QueueAvailableFence) != VK_SUCCESS) 
+            {
+                // the fence is signalled anyway, so later writes don't wait forever
+                vkQueueSubmit(
+                    this->pInfo->MemoryBlock.GetQueue(),
+                    0,
+                    nullptr,
+                    this->QueueAvailableFence);
+                error = Error::WriteError;
+            }
+            submitted.push_back(this->QueueAvailableFence);
+        }
+    }
+
+    // the sources only have to outlive the job, so it ends once the device is done
+    for (const auto& fence : submitted)
+    {
+        while (vkGetFenceStatus(device, fence) == VK_NOT_READY)
+        {
+            co_await DflGen::Job<Error>::Awaitable(
+                        device,
+                        fence);
+        }
+    }
+
+    co_return error;
+}
+
+auto DflMem::Buffer< DflMem::StorageType::Image >::GetTexelBlock(const VkFormat format) noexcept
+-> TexelBlock
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SNORM:
+    case VK_FORMAT_R8_UINT:
+    case VK_FORMAT_R8_SINT:
+    case VK_FORMAT_R8_SRGB:
+        return { 1, 1, 1 };
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R8G8_SNORM:
+    case VK_FORMAT_R8G8_UINT:
+    case VK_FORMAT_R8G8_SINT:
+    case VK_FORMAT_R8G8_SRGB:
+    case VK_FORMAT_R16_UNORM:
+    case VK_FORMAT_R16_SNORM:
+    case VK_FORMAT_R16_UINT:
+    case VK_FORMAT_R16_SINT:
+    case VK_FORMAT_R16_SFLOAT:
+    case VK_FORMAT_D16_UNORM:
+        return { 1, 1, 2 };
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SNORM:
+    case VK_FORMAT_R8G8B8A8_UINT:
+    case VK_FORMAT_R8G8B8A8_SINT:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+    case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+    case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:
+    case VK_FORMAT_R16G16_UNORM:
+    case VK_FORMAT_R16G16_SNORM:
+    case VK_FORMAT_R16G16_UINT:
+    case VK_FORMAT_R16G16_SINT:
+    case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R32_UINT:
+    case VK_FORMAT_R32_SINT:
+    case VK_FORMAT_R32_SFLOAT:
+    case VK_FORMAT_D32_SFLOAT:
+        return { 1, 1, 4 };
+    case VK_FORMAT_R16G16B16A16_UNORM:
+    case VK_FORMAT_R16G16B16A16_SNORM:
+    case VK_FORMAT_R16G16B16A16_UINT:
+    case VK_FORMAT_R16G16B16A16_SINT:
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+    case VK_FORMAT_R32G32_UINT:
+    case VK_FORMAT_R32G32_SINT:
+    case VK_FORMAT_R32G32_SFLOAT:
+        return { 1, 1, 8 };
+    case VK_FORMAT_R32G32B32A32_UINT:
+    case VK_FORMAT_R32G32B32A32_SINT:
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return { 1, 1, 16 };
+    // BC1 and BC4 take 8 B per 4x4 block, the rest 16 B
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+        return { 4, 4, 8 };
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return { 4, 4, 16 };
+    default:
+        return { 1, 1, 0 };
+    }
+}
@@ -18,6 +18,13 @@
 
 #include <memory>
 #include <array>
+#include <mutex>
+#include <optional>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <span>
+#include <vector>
 
 #define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan/vulkan.h>
@@ -26,6 +33,8 @@
 
 #include "Dragonfly.Generics.hxx"
 #include "Dragonfly.Hardware.Device.hxx"
+#include "Dragonfly.Hardware.Profiler.hxx"
+#include "Dragonfly.Memory.Copier.hxx"
 
 namespace Dfl {
     // Dragonfly.Memory
@@ -51,26 +60,59 @@ namespace Dfl {
                 const uint64_t              Size{ 0 }; // if type == Buffer, the 2 other dimensions are ignored
 
                 const DflGen::BitFlag       Options{ 0 };
+
+                // If not null, the device uses this host memory of Size bytes as the buffer's,
+                // when both are aligned to the device's HostPointerAlignment. It has to outlive
+                // the buffer. Otherwise, the buffer is allocated as usual and starts as a copy of it.
+                      void*                 pHostMemory{ nullptr };
+
+                      DflHW::Profiler*      pProfiler{ nullptr }; // if not null, transfers are timed
             };
 
             struct Handles {
                 const VkBuffer        hBuffer{ nullptr };
+                const VkDeviceMemory  hImportedMemory{ nullptr }; // if the buffer is the host memory it was given
 
                 // CmdBuffers
 
                 const VkEvent         hCPUTransferDone{ nullptr };
                 const VkCommandBuffer hTransferCmdBuff{ nullptr };
+                const VkCommandBuffer hOwnershipCmdBuff{ nullptr }; // for queue family ownership transfers
+
+                const VkSemaphore     hTimeline{ nullptr }; // signaled by every submission on the block's queue
+                const uint64_t        TimelineStart{ 0 }; // the value it had reached when it was lent
 
                 operator const VkBuffer() { return this->hBuffer; }
             };
 
+            // An exclusive buffer belongs to the memory block's family. Other families
+            // borrow it through Release, and give it back through Return. What was
+            // given back is acquired by the next submission on the block's queue.
+            struct Ownership {
+                std::mutex                   Lock;
+
+                std::optional<uint32_t>      ReturnedBy{ std::nullopt }; // family that released the buffer back, if not yet acquired
+                DflHW::Device::TimelinePoint ReturnPoint{ }; // reached once that family's release is done
+
+                uint64_t                     TimelineValue{ 0 };
+            };
+
+            // A part of a scattered write or gathered read. Offsets are in the host
+            // memory for the side that is read from, and in the buffer for the other.
+            struct Region {
+                uint64_t SourceOffset{ 0 };
+                uint64_t DstOffset{ 0 };
+                uint64_t Size{ 0 };
+            };
+
             enum class Error {
                 Success = 0,
                 WriteError = -1,
                 UnreadableError = -2,
                 ReadError = -3,
                 EventSetError = -4,
-                RecordError = -5    
+                RecordError = -5,
+                OwnershipError = -6 // the source of a copy belongs to another family
             };
 
         protected:
@@ -78,9 +120,38 @@ namespace Dfl {
 
             const Handles                     Buffers{ };
 
-            const std::array<uint64_t, 2>     MemoryLayoutID{ 0, 0 };
+            const std::array<uint64_t, 3>     MemoryLayoutID{ 0, 0, 0 };
             const VkFence                     QueueAvailableFence{ nullptr };
 
+            const bool                        IsShared{ false }; // concurrent buffers need no ownership transfers
+            const std::unique_ptr<Ownership>  pOwnership{ nullptr };
+
+                  char* const                 pMap{ nullptr }; // where the host sees the buffer, if the block is mapped or the buffer imported
+
+            // Makes mapped writes visible to the device, and device writes
+            // visible to the host. Only non-coherent memory needs it.
+            DFL_API
+                  VkResult
+            DFL_CALL                          FlushMap(
+                                                const uint64_t offset,
+                                                const uint64_t size) const noexcept;
+            DFL_API
+                  VkResult
+            DFL_CALL                          InvalidateMap(
+                                                const uint64_t offset,
+                                                const uint64_t size) const noexcept;
+            // Copies Size bytes of pData to the buffer and waits for it to be done
+            DFL_API
+                  VkResult
+            DFL_CALL                          Upload(const void* pData) const noexcept;
+
+            // Submits the transfer command buffer, acquiring
+            // the buffer first if it was given back. The queue fence is
+            // reset only here, and signaled even if the submission fails.
+            DFL_API
+                  VkResult
+            DFL_CALL                          SubmitTransfer() const noexcept;
+
             DFL_API
             static inline 
                   bool
@@ -92,7 +163,9 @@ namespace Dfl {
                                                 const uint64_t         dstSize,
                                                 const void*            pData,
                                                 const uint64_t         sourceSize,
-                                                const uint64_t         sourceOffset);
+                                                const uint64_t         sourceOffset,
+                                                const uint32_t         family,
+                                                      DflHW::Profiler* pProfiler);
 
             DFL_API
             static inline 
@@ -103,11 +176,70 @@ namespace Dfl {
                                                 const VkBuffer&        stageBuff,
                                                 const VkBuffer&        sourceBuff,
                                                 const uint64_t         sourceSize,
-                                                const uint64_t         sourceOffset);
+                                                const uint64_t         sourceOffset,
+                                                const uint32_t         family,
+                                                      DflHW::Profiler* pProfiler);
         public:
             DFL_API DFL_CALL Buffer(const Info& info);
             DFL_API DFL_CALL ~Buffer();
 
+            const VkBuffer           GetBuffer() const noexcept {
+                                        return this->Buffers.hBuffer; }
+            const uint64_t           GetSize() const noexcept {
+                                        return this->pInfo->Size; }
+            const bool               IsExclusive() const noexcept {
+                                        return !this->IsShared; }
+            // Mapped buffers are written and read by the host directly, without staging
+            const bool               IsMapped() const noexcept {
+                                        return this->pMap != nullptr; }
+            // Whether the buffer is the host memory given in its info, rather than a copy
+            const bool               IsImported() const noexcept {
+                                        return this->Buffers.hImportedMemory != nullptr; }
+            // The family of the memory block's queue, which owns the buffer
+            DFL_API
+                  uint32_t
+            DFL_CALL                 GetFamily() const noexcept;
+
+            // Lends an exclusive buffer to dstFamily, which has to acquire it once the
+            // returned point is reached. Blocks until the block's queue is free.
+            DFL_API
+                  std::optional<DflHW::Device::TimelinePoint>
+            DFL_CALL                 Release(const uint32_t dstFamily) const noexcept;
+            // Gives a lent buffer back. srcFamily has to have released it
+            // to the block's family, with point reached when it's done.
+            DFL_API
+                  void
+            DFL_CALL                 Return(
+                                        const uint32_t                      srcFamily,
+                                        const DflHW::Device::TimelinePoint& point) const noexcept;
+
+            // Copies size bytes of another buffer with a single command on the block's
+            // queue, e.g. from an imported one without the host copying anything.
+            // source has to belong to the same family, or be shared.
+            DFL_API
+            const DflGen::Job<Error>
+            DFL_CALL                 CopyFrom(
+                                        const Buffer&  source,
+                                        const uint64_t sourceOffset,
+                                        const uint64_t dstOffset,
+                                        const uint64_t size) const noexcept;
+
+            // Copies every region of source to the buffer. The regions are packed into
+            // the stage, and what fits in it goes in a single copy command, so many
+            // small updates cost one command and one submission.
+            DFL_API
+            const DflGen::Job<Error>
+            DFL_CALL                 Write(
+                                        const std::span<const std::byte> source,
+                                        const std::vector<Region>&       regions) const noexcept;
+            // Copies every region of the buffer to destination, one command per
+            // stage's worth of regions
+            DFL_API
+            const DflGen::Job<Error>
+            DFL_CALL                 Read(
+                                        const std::span<std::byte> destination,
+                                        const std::vector<Region>& regions) const noexcept;
+
             template< Dfl::Generics::Complete T >
             const DflGen::Job<Error> Write(
                                         const T&       source,
@@ -148,22 +280,90 @@ namespace Dfl {
                 const uint32_t              MipLevels{ 1 }; // levels of detail of the image
                 const uint32_t              Layers{ 1 }; // array layers of the image
                 const uint32_t              Samples{ 1 }; // samples of the image per pixel
+                const VkFormat              Format{ VK_FORMAT_R8G8B8A8_SNORM };
 
                 const DflGen::BitFlag Options{ 0 };
             };
 
+            // The smallest unit a format stores: a texel, or a block of texels
+            // for compressed formats, like the 4x4 blocks of BC1-BC7
+            struct TexelBlock {
+                uint32_t Width{ 1 }; // in texels
+                uint32_t Height{ 1 }; // in texels
+                uint32_t Size{ 0 }; // in B. 0 if the format isn't supported
+
+                bool     IsCompressed() const noexcept {
+                            return this->Width > 1 || this->Height > 1; }
+                // Of a region of the given size in texels, tightly packed in blocks
+                uint64_t GetCopySize(const std::array<uint32_t, 3>& extent) const noexcept {
+                            return static_cast<uint64_t>( (std::max(extent[0], 1u) + this->Width - 1) / this->Width )
+                                   * ( (std::max(extent[1], 1u) + this->Height - 1) / this->Height )
+                                   * std::max(extent[2], 1u)
+                                   * this->Size; }
+            };
+
             struct Handles {
                 const VkImage         hImage{ nullptr };
-                      VkImageLayout   Layout{  };
 
                 // CmdBuffers
 
                 const VkEvent         hCPUTransferDone{ nullptr };
                 const VkCommandBuffer hTransferCmdBuff{ nullptr };
+                const std::vector<
+                        VkCommandBuffer> StageCmdBuffs{ }; // one per slot of the device's stage ring
 
                 operator const VkImage() { return this->hImage; }
             };
 
+            // How the work about to be recorded uses a subresource
+            struct State {
+                VkImageLayout         Layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+                VkPipelineStageFlags2 Stages{ VK_PIPELINE_STAGE_2_NONE };
+                VkAccessFlags2        Access{ VK_ACCESS_2_NONE };
+            };
+
+            // Levels and layers of the image. Counts past its end stop at it.
+            struct Subresources {
+                uint32_t BaseLevel{ 0 };
+                uint32_t Levels{ VK_REMAINING_MIP_LEVELS };
+                uint32_t BaseLayer{ 0 };
+                uint32_t Layers{ VK_REMAINING_ARRAY_LAYERS };
+            };
+
+            // A box of texels in a level of a layer. Dimensions of 0 span a single
+            // texel. On compressed images it starts on a block, and ends on one too,
+            // unless it ends at the edge of the level.
+            struct Region {
+                std::array<int32_t, 3>  Offset{ 0, 0, 0 };
+                std::array<uint32_t, 3> Extent{ 0, 0, 0 };
+                uint32_t                Level{ 0 };
+                uint32_t                Layer{ 0 };
+            };
+
+            // Texels for a region, as Write takes them. Rows of texel blocks are
+            // RowPitch bytes apart (tightly packed if it's 0), and slices follow
+            // the region's last row.
+            struct Patch {
+                std::span<const std::byte> Source{ };
+                uint64_t                   RowPitch{ 0 };
+                Region                     Target{ };
+            };
+
+            // Where every level of every layer will be once all the work recorded on
+            // it so far is done: its layout, the stages of the last write and the
+            // stages that have waited for that write since
+            struct Tracker {
+                struct Subresource {
+                    VkImageLayout         Layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+                    VkPipelineStageFlags2 WriteStages{ VK_PIPELINE_STAGE_2_NONE };
+                    VkAccessFlags2        WriteAccess{ VK_ACCESS_2_NONE };
+                    VkPipelineStageFlags2 ReadStages{ VK_PIPELINE_STAGE_2_NONE };
+                };
+
+                std::mutex               Lock;
+                std::vector<Subresource> Subresources{ }; // layer after layer, level after level
+            };
+
             enum class Error {
                 Success = 0,
                 WriteError = -1,
@@ -177,26 +377,26 @@ namespace Dfl {
 
             const Handles                     Buffers{ };
 
-            const std::array<uint64_t, 2>     MemoryLayoutID{ 0, 0 };
+            const std::array<uint64_t, 3>     MemoryLayoutID{ 0, 0, 0 };
             const VkFence                     QueueAvailableFence{ nullptr };
 
+            const bool                        IsShared{ false };
+            const std::unique_ptr<Tracker>    pTracker{ nullptr };
+            const TexelBlock                  FormatBlock{ };
+
+            // Copies the patches to the image through the device's stage ring, the
+            // tiles that fit in a slot at a time, so a slot is written again only once
+            // the device is done copying out of it. If isBlitting, and the format isn't
+            // compressed, the rest of the levels of the first patch's layer are then
+            // blitted from the patch. Nothing is tracked unless the first slot's copy,
+            // which carries the transitions, is submitted.
             DFL_API
-            static inline 
-                  bool
-            DFL_CALL                          RecordWriteImageCommand(
-                                                const VkCommandBuffer&         cmdBuff,
-                                                const VkBuffer&                stageBuff,
-                                                const VkBuffer&                intermBuff,
-                                                const VkImage&                 dstImage,
-                                                const uint32_t                 dstMipLevels,
-                                                const Dfl::Generics::BitFlag&  dstAspectFlag,
-                                                const uint32_t                 dstArrayLayer,
-                                                const std::array<int32_t, 3>&  dstOffset,
-                                                const std::array<uint32_t, 3>& dstSize,
-                                                const VkFilter                 dstFilter,
-                                                const void*                    pData,
-                                                const uint64_t                 sourceSize,
-                                                const uint64_t                 sourceOffset);
+            const DflGen::Job<Error>
+            DFL_CALL                          StreamPatches(
+                                                      std::vector<Patch>       patches,
+                                                const bool                     isBlitting,
+                                                const Filter                   filter,
+                                                const VkImageAspectFlags       aspect) const noexcept;
             DFL_API
             static inline 
                   bool
@@ -206,6 +406,9 @@ namespace Dfl {
                                                 const VkBuffer&                stageBuff,
                                                 const VkBuffer&                intermBuff,
                                                 const VkImage&                 sourceImage,
+                                                const std::vector<
+                                                        VkImageMemoryBarrier2>&
+                                                                               sourceTransitions,
                                                 const std::array<
                                                         uint32_t, 3>&          sourceSize,
                                                 const std::array<
@@ -216,6 +419,90 @@ namespace Dfl {
             DFL_API DFL_CALL Buffer(const Info& info);
             DFL_API DFL_CALL ~Buffer();
 
+            const VkImage            GetImage() const noexcept {
+                                        return this->Buffers.hImage; }
+            const std::array<
+                    uint32_t, 3>&    GetSize() const noexcept {
+                                        return this->pInfo->Size; }
+            const uint32_t           GetMipLevels() const noexcept {
+                                        return this->pInfo->MipLevels; }
+            const uint32_t           GetLayers() const noexcept {
+                                        return this->pInfo->Layers; }
+            const VkFormat           GetFormat() const noexcept {
+                                        return this->pInfo->Format; }
+            const TexelBlock&        GetTexelBlock() const noexcept {
+                                        return this->FormatBlock; }
+            const DflGen::BitFlag&   GetOptions() const noexcept {
+                                        return this->pInfo->Options; }
+            const bool               IsExclusive() const noexcept {
+                                        return !this->IsShared; }
+            // The family of the memory block's queue, which owns the image
+            DFL_API
+                  uint32_t
+            DFL_CALL                 GetFamily() const noexcept;
+            // The layout a level of a layer will be in once the work recorded on it so far is done
+            DFL_API
+                  VkImageLayout
+            DFL_CALL                 GetLayout(
+                                        const uint32_t level,
+                                        const uint32_t layer) const noexcept;
+            // For whoever records work on the subresources: adds to barriers what has
+            // to come before it, and tracks the state it leaves them in. Subresources
+            // already in the layout, whose last write the stages have waited for, need
+            // nothing. Subresources the work overwrites entirely can discard their
+            // contents, and skip keeping them through the transition. Neighbouring
+            // subresources with the same transition share a barrier. Returns the
+            // barriers added.
+            DFL_API
+                  uint32_t
+            DFL_CALL                 Transition(
+                                        const Subresources&                 subresources,
+                                        const State&                        state,
+                                        const bool                          isDiscarding,
+                                              std::vector<
+                                                VkImageMemoryBarrier2>&     barriers) const noexcept;
+            // The tracked state of every subresource, for whoever records transitions
+            // on work that may never be submitted, to put back with RestoreStates
+            DFL_API
+                  std::vector<Tracker::Subresource>
+            DFL_CALL                 SaveStates() const noexcept;
+            DFL_API
+                  void
+            DFL_CALL                 RestoreStates(
+                                        const std::vector<
+                                                Tracker::Subresource>&      states) const noexcept;
+            // Of the uncompressed formats of 1 to 4 components of 8 to 32 bits, and of BC1-BC7
+            DFL_API
+            static
+                  TexelBlock
+            DFL_CALL                 GetTexelBlock(const VkFormat format) noexcept;
+
+            // Copies source, whole texel blocks tightly packed (e.g. the output of
+            // Encoder), to the first level of the layer, and blits the rest of the
+            // levels from it if the format isn't compressed
+            DFL_API
+            const DflGen::Job<Error>
+            DFL_CALL                 Write(
+                                        const std::span<const std::byte> source,
+                                        const uint32_t                   dstArrayLayer,
+                                        const Filter                     dstFilter = Filter::Linear) const noexcept;
+            // Copies source to the region alone, leaving the rest of the image and
+            // its other levels as they are. Rows of texel blocks in source are
+            // rowPitch bytes apart (tightly packed if it's 0), so a region can be
+            // copied out of a larger image, and slices follow the region's last row.
+            DFL_API
+            const DflGen::Job<Error>
+            DFL_CALL                 Write(
+                                        const std::span<const std::byte> source,
+                                        const uint64_t                   rowPitch,
+                                        const Region&                    region) const noexcept;
+            // Copies every patch through the device's stage ring, packing small ones
+            // into a slot together. Patches shouldn't overlap. Their sources have to
+            // outlive the job.
+            DFL_API
+            const DflGen::Job<Error>
+            DFL_CALL                 Write(std::vector<Patch> patches) const noexcept;
+
             template< Dfl::Generics::Complete T >
             const DflGen::Job<Error> Write(
                                         const T&                       source,
@@ -248,7 +535,41 @@ auto Dfl::Memory::Buffer< Dfl::Memory::StorageType::Buffer >::Write(
 -> const DflGen::Job<Error>
 {
     const VkDevice& device = this->pInfo->MemoryBlock.GetDevice().GetDevice();
-    
+
+    if (this->pMap != nullptr) 
+    {
+        if (sourceOffset >= sizeof(T) || dstOffset >= this->pInfo->Size) [[ unlikely ]]
+        {
+            co_return Error::WriteError;
+        }
+
+        // a previous transfer or dispatch may still be using the buffer
+        while (vkGetFenceStatus(device, this->QueueAvailableFence) != VK_SUCCESS)
+        {
+            co_await DflGen::Job<Error>::Awaitable(
+                device,
+                this->QueueAvailableFence);
+        }
+
+        const uint64_t size{ std::min<uint64_t>(sizeof(T) - sourceOffset, this->pInfo->Size - dstOffset) };
+        DflMem::Copier::ToMapped(
+            this->pMap + dstOffset,
+            reinterpret_cast<const char*>(&source) + sourceOffset,
+            size);
+
+        co_return this->FlushMap(dstOffset, size) == VK_SUCCESS
+                    ? Error::Success
+                    : Error::WriteError;
+    }
+
+    // the command buffer may still be in use by the previous transfer
+    while (vkGetFenceStatus(device, this->QueueAvailableFence) != VK_SUCCESS)
+    {
+        co_await DflGen::Job<Error>::Awaitable(
+            device,
+            this->QueueAvailableFence);
+    }
+
     if( this->RecordWriteBufferCommand(
             this->Buffers.hTransferCmdBuff,
             this->pInfo->MemoryBlock.GetDevice().GetStageBuffer(),
@@ -257,49 +578,25 @@ auto Dfl::Memory::Buffer< Dfl::Memory::StorageType::Buffer >::Write(
             this->pInfo->Size,
             &source,
             sizeof(T),
-            sourceOffset) != VK_SUCCESS ) 
+            sourceOffset,
+            this->GetFamily(),
+            this->pInfo->pProfiler) != VK_SUCCESS ) 
     {
         co_return Error::RecordError;      
     };
 
-    VkSubmitInfo subInfo{
-        .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO },
-        .pNext{ nullptr },
-        .waitSemaphoreCount{ 0 },
-        .pWaitSemaphores{ nullptr },
-        .pWaitDstStageMask{ nullptr },
-        .commandBufferCount{ 1 },
-        .pCommandBuffers{ &this->Buffers.hTransferCmdBuff },
-        .signalSemaphoreCount{ 0 },
-        .pSignalSemaphores{ nullptr }
-    };
-
-    co_await DflGen::Job<Error>::Awaitable(
-                device,
-                this->QueueAvailableFence);
-
-    vkResetFences(
-        device,
-        1,
-        &this->QueueAvailableFence);
-
-    if (vkQueueSubmit(
-            this->pInfo->MemoryBlock.GetQueue(),
-            1,
-            &subInfo,
-            this->QueueAvailableFence) != VK_SUCCESS) 
+    if (this->SubmitTransfer() != VK_SUCCESS) 
     {
         co_return Error::WriteError;
     }
 
-    co_await DflGen::Job<Error>::Awaitable(
-        device,
-        this->QueueAvailableFence);
-
-    while (vkGetFenceStatus(device, this->QueueAvailableFence) != VK_SUCCESS) 
-    { 
-        std::this_thread::sleep_for(std::chrono::nanoseconds(10)); 
+    while (vkGetFenceStatus(device, this->QueueAvailableFence) != VK_SUCCESS)
+    {
+        co_await DflGen::Job<Error>::Awaitable(
+            device,
+            this->QueueAvailableFence);
     }
+
     vkResetCommandBuffer(
         this->Buffers.hTransferCmdBuff,
         0);
@@ -316,47 +613,60 @@ auto Dfl::Memory::Buffer< Dfl::Memory::StorageType::Buffer >::Read(
 {
     const DflHW::Device& gpu{ this->pInfo->MemoryBlock.GetDevice() };
 
+    if (this->pMap != nullptr) 
+    {
+        if (dstOffset >= sizeof(T) || sourceOffset >= this->pInfo->Size) [[ unlikely ]]
+        {
+            co_return Error::ReadError;
+        }
+
+        // the device may still be writing what is read from the map
+        while (vkGetFenceStatus(gpu.GetDevice(), this->QueueAvailableFence) != VK_SUCCESS)
+        {
+            co_await DflGen::Job<Error>::Awaitable(
+                gpu.GetDevice(),
+                this->QueueAvailableFence);
+        }
+
+        const uint64_t size{ std::min<uint64_t>(sizeof(T) - dstOffset, this->pInfo->Size - sourceOffset) };
+        if (this->InvalidateMap(sourceOffset, size) != VK_SUCCESS) 
+        {
+            co_return Error::ReadError;
+        }
+        DflMem::Copier::FromMapped(
+            reinterpret_cast<char*>(&destination) + dstOffset,
+            this->pMap + sourceOffset,
+            size);
+
+        co_return Error::Success;
+    }
+
     if (gpu.GetStageMap() == nullptr) [[ unlikely ]] 
     {
         co_return Error::UnreadableError;
     }
 
+    // the command buffer may still be in use by the previous transfer
+    while (vkGetFenceStatus(gpu.GetDevice(), this->QueueAvailableFence) != VK_SUCCESS)
+    {
+        co_await DflGen::Job<Error>::Awaitable(
+            gpu.GetDevice(),
+            this->QueueAvailableFence);
+    }
+
     if( this->RecordReadBufferCommand(
             this->Buffers.hTransferCmdBuff,
             this->Buffers.hCPUTransferDone,
             gpu.GetStageBuffer(),
             this->Buffers.hBuffer,
             this->pInfo->Size,
-            sourceOffset) != VK_SUCCESS ) {
+            sourceOffset,
+            this->GetFamily(),
+            this->pInfo->pProfiler) != VK_SUCCESS ) {
         co_return Error::RecordError;
     }
 
-    VkSubmitInfo subInfo{
-        .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO },
-        .pNext{ nullptr },
-        .waitSemaphoreCount{ 0 },
-        .pWaitSemaphores{ nullptr },
-        .pWaitDstStageMask{ nullptr },
-        .commandBufferCount{ 1 },
-        .pCommandBuffers{ &this->Buffers.hTransferCmdBuff },
-        .signalSemaphoreCount{ 0 },
-        .pSignalSemaphores{ nullptr }
-    };
-
-    co_await DflGen::Job<Error>::Awaitable(
-        gpu.GetDevice(),
-        this->QueueAvailableFence);
-
-    vkResetFences(
-        gpu.GetDevice(),
-        1,
-        &this->QueueAvailableFence);
-
-    if (vkQueueSubmit(
-            this->pInfo->MemoryBlock.GetQueue(),
-            1,
-            &subInfo,
-            this->QueueAvailableFence) != VK_SUCCESS) 
+    if (this->SubmitTransfer() != VK_SUCCESS) 
     {
         co_return Error::ReadError;
     }
@@ -382,9 +692,8 @@ auto Dfl::Memory::Buffer< Dfl::Memory::StorageType::Buffer >::Read(
             {
                 std::this_thread::sleep_for(std::chrono::milliseconds(10));
             }
-            memcpy_s(
+            DflMem::Copier::FromMapped(
                 (char*)&destination + currentOffset,
-                remainingSize > stageSize ? stageSize : remainingSize,
                 gpu.GetStageMap(),
                 remainingSize > stageSize ? stageSize : remainingSize);
             if (vkSetEvent(
@@ -410,66 +719,20 @@ auto Dfl::Memory::Buffer< Dfl::Memory::StorageType::Image >::Write(
                     const Filter                   dstFilter) const noexcept 
 -> const DflGen::Job<Error>
 {
-    const VkDevice& device = this->pInfo->MemoryBlock.GetDevice().GetDevice();
-    
-    if( this->RecordWriteImageCommand(
-            this->Buffers.hTransferCmdBuff,
-            this->pInfo->MemoryBlock.GetDevice().GetStageBuffer(),
-            this->Buffers.hImage,
-            dstAspectFlag,
-            dstOffset,
-            this->pInfo->Size,
-            &source,
-            sizeof(T),
-            sourceOffset) != VK_SUCCESS ) 
-    {
-        co_return Error::RecordError;      
-    };
-
-    VkSubmitInfo subInfo{
-        .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO },
-        .pNext{ nullptr },
-        .waitSemaphoreCount{ 0 },
-        .pWaitSemaphores{ nullptr },
-        .pWaitDstStageMask{ nullptr },
-        .commandBufferCount{ 1 },
-        .pCommandBuffers{ &this->Buffers.hTransferCmdBuff },
-        .signalSemaphoreCount{ 0 },
-        .pSignalSemaphores{ nullptr }
-    };
-
-    co_await DflGen::Job<Error>::Awaitable(
-                device,
-                this->QueueAvailableFence);
-
-    vkResetFences(
-        device,
-        1,
-        &this->QueueAvailableFence);
-
-    if (vkQueueSubmit(
-            this->pInfo->MemoryBlock.GetQueue(),
-            1,
-            &subInfo,
-            this->QueueAvailableFence) != VK_SUCCESS) 
-    {
-        co_return Error::WriteError;
-    }
-
-    co_await DflGen::Job<Error>::Awaitable(
-        device,
-        this->QueueAvailableFence);
-
-    while (vkGetFenceStatus(device, this->QueueAvailableFence) != VK_SUCCESS) 
-    { 
-        std::this_thread::sleep_for(std::chrono::nanoseconds(10)); 
-    }
-    vkResetCommandBuffer(
-        this->Buffers.hTransferCmdBuff,
-        0);
-
-    this->Buffers.Layout = dstLayout;
-    co_return Error::Success;
+    // an offset past the end of source leaves nothing to copy, which fails the write
+    const uint64_t offset{ std::min<uint64_t>(sourceOffset, sizeof(T)) };
+    return this->StreamPatches(
+                { { .Source{ reinterpret_cast<const std::byte*>(&source) + offset, sizeof(T) - offset },
+                    .RowPitch{ 0 },
+                    .Target{ .Offset{ static_cast<int32_t>(dstOffset[0]),
+                                      static_cast<int32_t>(dstOffset[1]),
+                                      static_cast<int32_t>(dstOffset[2]) },
+                             .Extent{ this->pInfo->Size },
+                             .Level{ 0 },
+                             .Layer{ 0 } } } },
+                true,
+                dstFilter,
+                dstAspectFlag.GetValue());
 }
 
 template< Dfl::Generics::Complete T >
@@ -486,14 +749,43 @@ auto Dfl::Memory::Buffer< Dfl::Memory::StorageType::Image >::Read(
     {
         co_return Error::UnreadableError;
     }
+    if (sourceOffset.size() < 3) [[ unlikely ]]
+    {
+        co_return Error::ReadError;
+    }
+
+    // the command buffer may still be in use by the previous transfer
+    while (vkGetFenceStatus(gpu.GetDevice(), this->QueueAvailableFence) != VK_SUCCESS)
+    {
+        co_await DflGen::Job<Error>::Awaitable(
+            gpu.GetDevice(),
+            this->QueueAvailableFence);
+    }
+
+    const auto states{ this->SaveStates() };
+    std::vector<VkImageMemoryBarrier2> transitions{ };
+    this->Transition(
+        { .Levels{ 1 }, .Layers{ 1 } },
+        { .Layout{ VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL },
+          .Stages{ VK_PIPELINE_STAGE_2_COPY_BIT },
+          .Access{ VK_ACCESS_2_TRANSFER_READ_BIT } },
+        false,
+        transitions);
 
     if( this->RecordReadImageCommand(
             this->Buffers.hTransferCmdBuff,
             this->Buffers.hCPUTransferDone,
             gpu.GetStageBuffer(),
+            gpu.GetIntermediateBuffer(),
             this->Buffers.hImage,
+            transitions,
             this->pInfo->Size,
-            sourceOffset) != VK_SUCCESS ) {
+            { static_cast<int32_t>(sourceOffset[0]),
+              static_cast<int32_t>(sourceOffset[1]),
+              static_cast<int32_t>(sourceOffset[2]) },
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            0) != VK_SUCCESS ) {
+        this->RestoreStates(states);
         co_return Error::RecordError;
     }
 
@@ -509,10 +801,6 @@ auto Dfl::Memory::Buffer< Dfl::Memory::StorageType::Image >::Read(
         .pSignalSemaphores{ nullptr }
     };
 
-    co_await DflGen::Job<Error>::Awaitable(
-        gpu.GetDevice(),
-        this->QueueAvailableFence);
-
     vkResetFences(
         gpu.GetDevice(),
         1,
@@ -524,6 +812,12 @@ auto Dfl::Memory::Buffer< Dfl::Memory::StorageType::Image >::Read(
             &subInfo,
             this->QueueAvailableFence) != VK_SUCCESS) 
     {
+        vkQueueSubmit(
+            this->pInfo->MemoryBlock.GetQueue(),
+            0,
+            nullptr,
+            this->QueueAvailableFence);
+        this->RestoreStates(states);
         co_return Error::ReadError;
     }
 
@@ -548,9 +842,8 @@ auto Dfl::Memory::Buffer< Dfl::Memory::StorageType::Image >::Read(
             {
                 std::this_thread::sleep_for(std::chrono::milliseconds(10));
             }
-            memcpy_s(
+            DflMem::Copier::FromMapped(
                 (char*)&destination + currentOffset,
-                remainingSize > stageSize ? stageSize : remainingSize,
                 gpu.GetStageMap(),
                 remainingSize > stageSize ? stageSize : remainingSize);
             if (vkSetEvent(
@@ -0,0 +1,1004 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Dragonfly.Memory.Converter.hxx"
+
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <optional>
+
+namespace DflHW = Dfl::Hardware;
+namespace DflMem = Dfl::Memory;
+namespace DflGen = Dfl::Generics;
+
+// Internal for Converter
+
+// as laid out in the shader
+static constexpr uint32_t INT_GroupSize{ 256 };
+
+struct INT_ConvertParameters {
+    uint32_t TexelCount{ 0 };
+    uint32_t SourceFormat{ 0 };
+    uint32_t SourceSize{ 0 };
+    uint32_t DestinationFormat{ 0 };
+    uint32_t Swizzle{ 0 };
+    uint32_t IsEncoded{ 0 };
+};
+
+// What the shader writes for a format. Size is 0 for the formats it can't write.
+struct INT_Destination {
+    uint32_t Format{ 0 };
+    uint32_t Size{ 0 }; // in B
+    bool     IsSRGB{ false };
+};
+
+static inline INT_Destination INT_GetDestination(const VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+        return { 0, 4, false };
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        return { 0, 4, true };
+    case VK_FORMAT_B8G8R8A8_UNORM:
+        return { 1, 4, false };
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        return { 1, 4, true };
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return { 2, 8, false };
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return { 3, 16, false };
+    default:
+        return { };
+    }
+}
+
+static inline bool INT_IsFloat(const DflMem::Converter::Source format)
+{
+    return format == DflMem::Converter::Source::RGB16F
+           || format == DflMem::Converter::Source::RGBA16F
+           || format == DflMem::Converter::Source::RGB32F
+           || format == DflMem::Converter::Source::RGBA32F;
+}
+
+static VkShaderModule INT_GetModule(
+    const VkDevice&              hGPU,
+    const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        throw Dfl::Error::NoData(
+                L"Unable to open conversion shader file",
+                L"INT_GetModule",
+                Dfl::API::None);
+    }
+
+    // SPIR-V is made of 32-bit words
+    std::vector<uint32_t> code(static_cast<uint64_t>(file.tellg()) / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(code.data()), code.size() * sizeof(uint32_t));
+
+    const VkShaderModuleCreateInfo moduleInfo{
+        .sType{ VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .codeSize{ code.size() * sizeof(uint32_t) },
+        .pCode{ code.data() }
+    };
+
+    VkShaderModule module{ nullptr };
+    if ( vkCreateShaderModule(
+            hGPU,
+            &moduleInfo,
+            nullptr,
+            &module) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create conversion shader module",
+                L"INT_GetModule");
+    }
+
+    return module;
+}
+
+static DflMem::Converter::Handles INT_GetHandles(
+          DflHW::Device&            gpu,
+    const DflMem::Converter::Info&  info)
+{
+    const VkDevice& hGPU{ gpu.GetDevice() };
+
+    const DflHW::Device::Queue queue{ gpu.BorrowQueue(DflHW::Device::Queue::Type::Compute) };
+    if (queue.hQueue == nullptr)
+    {
+        throw Dfl::Error::NoData(
+                L"Unable to find a compute queue",
+                L"INT_GetHandles",
+                Dfl::API::None);
+    }
+
+    VkCommandPool         cmdPool{ nullptr };
+    VkShaderModule        module{ nullptr };
+    VkDescriptorSetLayout setLayout{ nullptr };
+    VkPipelineLayout      layout{ nullptr };
+    VkPipeline            pipeline{ nullptr };
+    VkDescriptorPool      descriptorPool{ nullptr };
+    try {
+        const VkCommandPoolCreateInfo poolInfo{
+            .sType{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT },
+            .queueFamilyIndex{ queue.FamilyIndex }
+        };
+        if ( vkCreateCommandPool(
+                hGPU,
+                &poolInfo,
+                nullptr,
+                &cmdPool) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create command pool",
+                    L"INT_GetHandles");
+        }
+
+        module = INT_GetModule(hGPU, info.ShaderDirectory / L"convert.spv");
+
+        // the raw texels in a slot of the stage, and the converted ones in the
+        // slot's intermediate memory
+        const std::array<VkDescriptorSetLayoutBinding, 2> bindings{
+            VkDescriptorSetLayoutBinding{
+                .binding{ 0 },
+                .descriptorType{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+                .descriptorCount{ 1 },
+                .stageFlags{ VK_SHADER_STAGE_COMPUTE_BIT },
+                .pImmutableSamplers{ nullptr } },
+            VkDescriptorSetLayoutBinding{
+                .binding{ 1 },
+                .descriptorType{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+                .descriptorCount{ 1 },
+                .stageFlags{ VK_SHADER_STAGE_COMPUTE_BIT },
+                .pImmutableSamplers{ nullptr } } };
+        const VkDescriptorSetLayoutCreateInfo setLayoutInfo{
+            .sType{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .bindingCount{ static_cast<uint32_t>(bindings.size()) },
+            .pBindings{ bindings.data() }
+        };
+        if ( vkCreateDescriptorSetLayout(
+                hGPU,
+                &setLayoutInfo,
+                nullptr,
+                &setLayout) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create descriptor set layout",
+                    L"INT_GetHandles");
+        }
+
+        const VkPushConstantRange pushRange{
+            .stageFlags{ VK_SHADER_STAGE_COMPUTE_BIT },
+            .offset{ 0 },
+            .size{ sizeof(INT_ConvertParameters) }
+        };
+        const VkPipelineLayoutCreateInfo layoutInfo{
+            .sType{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .setLayoutCount{ 1 },
+            .pSetLayouts{ &setLayout },
+            .pushConstantRangeCount{ 1 },
+            .pPushConstantRanges{ &pushRange }
+        };
+        if ( vkCreatePipelineLayout(
+                hGPU,
+                &layoutInfo,
+                nullptr,
+                &layout) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create conversion pipeline layout",
+                    L"INT_GetHandles");
+        }
+
+        const VkComputePipelineCreateInfo pipelineInfo{
+            .sType{ VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .stage{
+                .sType{ VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO },
+                .pNext{ nullptr },
+                .flags{ 0 },
+                .stage{ VK_SHADER_STAGE_COMPUTE_BIT },
+                .module{ module },
+                .pName{ "main" },
+                .pSpecializationInfo{ nullptr } },
+            .layout{ layout },
+            .basePipelineHandle{ nullptr },
+            .basePipelineIndex{ -1 }
+        };
+        if ( vkCreateComputePipelines(
+                hGPU,
+                nullptr,
+                1,
+                &pipelineInfo,
+                nullptr,
+                &pipeline) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create conversion pipeline",
+                    L"INT_GetHandles");
+        }
+
+        const VkDescriptorPoolSize poolSize{
+            .type{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+            .descriptorCount{ 2 * DflMem::Converter::Slots } };
+        const VkDescriptorPoolCreateInfo descriptorPoolInfo{
+            .sType{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .maxSets{ DflMem::Converter::Slots },
+            .poolSizeCount{ 1 },
+            .pPoolSizes{ &poolSize }
+        };
+        if ( vkCreateDescriptorPool(
+                hGPU,
+                &descriptorPoolInfo,
+                nullptr,
+                &descriptorPool) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create descriptor pool",
+                    L"INT_GetHandles");
+        }
+    }
+    catch (Dfl::Error::Generic& err) {
+        if (descriptorPool != nullptr) { vkDestroyDescriptorPool(hGPU, descriptorPool, nullptr); }
+        if (pipeline != nullptr) { vkDestroyPipeline(hGPU, pipeline, nullptr); }
+        if (layout != nullptr) { vkDestroyPipelineLayout(hGPU, layout, nullptr); }
+        if (setLayout != nullptr) { vkDestroyDescriptorSetLayout(hGPU, setLayout, nullptr); }
+        if (module != nullptr) { vkDestroyShaderModule(hGPU, module, nullptr); }
+        if (cmdPool != nullptr) { vkDestroyCommandPool(hGPU, cmdPool, nullptr); }
+
+        gpu.ReturnQueue(queue);
+
+        throw;
+    }
+
+    return { queue,
+             cmdPool,
+             module,
+             setLayout,
+             layout,
+             pipeline,
+             descriptorPool };
+}
+
+// Host visible and coherent memory of a type in typeBits, so the texels are
+// copied straight into it
+template< DflHW::Device::MemoryType type >
+static inline std::optional<uint64_t> INT_BorrowStageMemory(
+          DflHW::Device&  device,
+          VkDeviceMemory& memory,
+    const uint64_t        size,
+    const uint32_t        typeBits)
+{
+    const auto& heaps{ [&]() -> const auto& {
+                          if constexpr (type == DflHW::Device::MemoryType::Local) { return device.GetCharacteristics().LocalHeaps; }
+                          else { return device.GetCharacteristics().SharedHeaps; } }() };
+    for (const bool isHostCached : { false, true })
+    {
+        for (uint64_t heapIndex{ 0 }; heapIndex < heaps.size(); heapIndex++)
+        {
+            for (const auto& property : heaps[heapIndex].MemProperties)
+            {
+                if ( !(typeBits & (1u << property.TypeIndex))
+                     || !property.IsHostVisible
+                     || !property.IsHostCoherent
+                     || property.IsHostCached != isHostCached )
+                {
+                    continue;
+                }
+
+                memory = device.BorrowMemory<type>(
+                            heapIndex,
+                            property.TypeIndex,
+                            size);
+                if (memory != nullptr) { return heapIndex; }
+            }
+        }
+    }
+
+    return std::nullopt;
+}
+
+// Local memory of a type in typeBits; only the device touches it, so types
+// that aren't host visible are preferred
+static inline std::optional<uint64_t> INT_BorrowIntermediateMemory(
+          DflHW::Device&  device,
+          VkDeviceMemory& memory,
+    const uint64_t        size,
+    const uint32_t        typeBits)
+{
+    const auto& heaps{ device.GetCharacteristics().LocalHeaps };
+    for (const bool isHostVisible : { false, true })
+    {
+        for (uint64_t heapIndex{ 0 }; heapIndex < heaps.size(); heapIndex++)
+        {
+            for (const auto& property : heaps[heapIndex].MemProperties)
+            {
+                if ( !(typeBits & (1u << property.TypeIndex))
+                     || property.IsHostVisible != isHostVisible )
+                {
+                    continue;
+                }
+
+                memory = device.BorrowMemory<DflHW::Device::MemoryType::Local>(
+                            heapIndex,
+                            property.TypeIndex,
+                            size);
+                if (memory != nullptr) { return heapIndex; }
+            }
+        }
+    }
+
+    return std::nullopt;
+}
+
+static inline void INT_ReturnMemory(
+          DflHW::Device&             device,
+    const VkDeviceMemory             memory,
+    const DflHW::Device::MemoryType  type,
+    const uint64_t                   heapIndex,
+    const uint64_t                   size)
+{
+    if (type == DflHW::Device::MemoryType::Shared)
+    {
+        device.ReturnMemory<DflHW::Device::MemoryType::Shared>(memory, heapIndex, size);
+    }
+    else
+    {
+        device.ReturnMemory<DflHW::Device::MemoryType::Local>(memory, heapIndex, size);
+    }
+}
+
+static DflMem::Converter::Ring INT_GetRing(
+          DflHW::Device&               device,
+    const DflMem::Converter::Handles&  program)
+{
+    const VkDevice gpu{ device.GetDevice() };
+    constexpr uint32_t slots{ DflMem::Converter::Slots };
+
+    VkBuffer                     stage{ nullptr };
+    VkDeviceMemory               stageMemory{ nullptr };
+    DflHW::Device::MemoryType    stageType{ DflHW::Device::MemoryType::Shared };
+    std::optional<uint64_t>      stageHeap{ std::nullopt };
+    uint64_t                     stageSize{ 0 };
+    void*                        pMap{ nullptr };
+    VkBuffer                     intermediate{ nullptr };
+    VkDeviceMemory               intermediateMemory{ nullptr };
+    std::optional<uint64_t>      intermediateHeap{ std::nullopt };
+    uint64_t                     intermediateSize{ 0 };
+    std::vector<VkCommandBuffer> cmdBuffers(slots, nullptr);
+    std::vector<VkFence>         fences(slots, nullptr);
+    std::vector<VkDescriptorSet> sets(slots, nullptr);
+    try {
+        const VkBufferCreateInfo stageInfo{
+            .sType{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .size{ DflHW::Device::StageMemory * slots },
+            .usage{ VK_BUFFER_USAGE_STORAGE_BUFFER_BIT },
+            .sharingMode{ VK_SHARING_MODE_EXCLUSIVE },
+            .queueFamilyIndexCount{ 0 },
+            .pQueueFamilyIndices{ nullptr }
+        };
+        if ( vkCreateBuffer(
+                gpu,
+                &stageInfo,
+                nullptr,
+                &stage) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create the conversion stage",
+                    L"INT_GetRing");
+        }
+
+        VkMemoryRequirements requirements{ };
+        vkGetBufferMemoryRequirements(gpu, stage, &requirements);
+        stageSize = requirements.size;
+        stageHeap = INT_BorrowStageMemory<DflHW::Device::MemoryType::Shared>(
+                        device,
+                        stageMemory,
+                        stageSize,
+                        requirements.memoryTypeBits);
+        if (!stageHeap.has_value())
+        {
+            stageType = DflHW::Device::MemoryType::Local;
+            stageHeap = INT_BorrowStageMemory<DflHW::Device::MemoryType::Local>(
+                            device,
+                            stageMemory,
+                            stageSize,
+                            requirements.memoryTypeBits);
+        }
+        if ( !stageHeap.has_value()
+             || vkBindBufferMemory(gpu, stage, stageMemory, 0) != VK_SUCCESS
+             || vkMapMemory(gpu, stageMemory, 0, VK_WHOLE_SIZE, 0, &pMap) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to get host visible memory for the conversion stage",
+                    L"INT_GetRing");
+        }
+
+        const VkBufferCreateInfo intermediateInfo{
+            .sType{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .size{ DflHW::Device::IntermediateMemory * slots },
+            .usage{ VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT },
+            .sharingMode{ VK_SHARING_MODE_EXCLUSIVE },
+            .queueFamilyIndexCount{ 0 },
+            .pQueueFamilyIndices{ nullptr }
+        };
+        if ( vkCreateBuffer(
+                gpu,
+                &intermediateInfo,
+                nullptr,
+                &intermediate) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create the conversion intermediate buffer",
+                    L"INT_GetRing");
+        }
+
+        vkGetBufferMemoryRequirements(gpu, intermediate, &requirements);
+        intermediateSize = requirements.size;
+        intermediateHeap = INT_BorrowIntermediateMemory(
+                                device,
+                                intermediateMemory,
+                                intermediateSize,
+                                requirements.memoryTypeBits);
+        if ( !intermediateHeap.has_value()
+             || vkBindBufferMemory(gpu, intermediate, intermediateMemory, 0) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to get memory for the conversion intermediate buffer",
+                    L"INT_GetRing");
+        }
+
+        const VkCommandBufferAllocateInfo cmdBuffInfo{
+            .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO },
+            .pNext{ nullptr },
+            .commandPool{ program.hCmdPool },
+            .level{ VK_COMMAND_BUFFER_LEVEL_PRIMARY },
+            .commandBufferCount{ slots }
+        };
+        if ( vkAllocateCommandBuffers(
+                gpu,
+                &cmdBuffInfo,
+                cmdBuffers.data()) != VK_SUCCESS )
+        {
+            cmdBuffers.assign(slots, nullptr);
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to allocate command buffers for the conversion",
+                    L"INT_GetRing");
+        }
+
+        // signaled, since every slot starts out free
+        const VkFenceCreateInfo fenceInfo{
+            .sType{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ VK_FENCE_CREATE_SIGNALED_BIT }
+        };
+        for (auto& fence : fences)
+        {
+            if ( vkCreateFence(
+                    gpu,
+                    &fenceInfo,
+                    nullptr,
+                    &fence) != VK_SUCCESS )
+            {
+                throw Dfl::Error::HandleCreation(
+                        L"Unable to create fences for the conversion",
+                        L"INT_GetRing");
+            }
+        }
+
+        const std::vector<VkDescriptorSetLayout> setLayouts(slots, program.hSetLayout);
+        const VkDescriptorSetAllocateInfo setInfo{
+            .sType{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO },
+            .pNext{ nullptr },
+            .descriptorPool{ program.hDescriptorPool },
+            .descriptorSetCount{ slots },
+            .pSetLayouts{ setLayouts.data() }
+        };
+        if ( vkAllocateDescriptorSets(
+                gpu,
+                &setInfo,
+                sets.data()) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to allocate descriptor sets for the conversion",
+                    L"INT_GetRing");
+        }
+    }
+    catch (Dfl::Error::Generic& err) {
+        for (const auto& fence : fences)
+        {
+            if (fence != nullptr) { vkDestroyFence(gpu, fence, nullptr); }
+        }
+        if (cmdBuffers[0] != nullptr)
+        {
+            vkFreeCommandBuffers(gpu, program.hCmdPool, slots, cmdBuffers.data());
+        }
+        if (intermediate != nullptr) { vkDestroyBuffer(gpu, intermediate, nullptr); }
+        if (intermediateHeap.has_value())
+        {
+            INT_ReturnMemory(device, intermediateMemory, DflHW::Device::MemoryType::Local, intermediateHeap.value(), intermediateSize);
+        }
+        if (stage != nullptr) { vkDestroyBuffer(gpu, stage, nullptr); }
+        if (stageHeap.has_value())
+        {
+            if (pMap != nullptr) { vkUnmapMemory(gpu, stageMemory); }
+            INT_ReturnMemory(device, stageMemory, stageType, stageHeap.value(), stageSize);
+        }
+
+        throw;
+    }
+
+    // each slot's set sees its own part of the stage and of the intermediate memory
+    std::vector<VkDescriptorBufferInfo> bufferInfos(2 * slots);
+    std::vector<VkWriteDescriptorSet> writes(2 * slots);
+    for (uint32_t i{ 0 }; i < writes.size(); i++)
+    {
+        const uint32_t slot{ i / 2 };
+        const uint32_t binding{ i % 2 };
+        bufferInfos[i] = binding == 0
+                         ? VkDescriptorBufferInfo{
+                                .buffer{ stage },
+                                .offset{ slot * DflHW::Device::StageMemory },
+                                .range{ DflHW::Device::StageMemory } }
+                         : VkDescriptorBufferInfo{
+                                .buffer{ intermediate },
+                                .offset{ slot * DflHW::Device::IntermediateMemory },
+                                .range{ DflHW::Device::IntermediateMemory } };
+        writes[i] = {
+            .sType{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET },
+            .pNext{ nullptr },
+            .dstSet{ sets[slot] },
+            .dstBinding{ binding },
+            .dstArrayElement{ 0 },
+            .descriptorCount{ 1 },
+            .descriptorType{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+            .pImageInfo{ nullptr },
+            .pBufferInfo{ &bufferInfos[i] },
+            .pTexelBufferView{ nullptr } };
+    }
+    vkUpdateDescriptorSets(
+        gpu,
+        static_cast<uint32_t>(writes.size()),
+        writes.data(),
+        0,
+        nullptr);
+
+    return { stage, stageMemory, stageType, stageHeap.value(), stageSize, static_cast<std::byte*>(pMap),
+             intermediate, intermediateMemory, DflHW::Device::MemoryType::Local, intermediateHeap.value(), intermediateSize,
+             cmdBuffers, fences, sets };
+}
+
+static inline bool INT_BeginTile(const VkCommandBuffer& cmdBuff)
+{
+    const VkCommandBufferBeginInfo cmdInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO },
+        .pNext{ nullptr },
+        .flags{ VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT },
+        .pInheritanceInfo{ nullptr }
+    };
+    return vkResetCommandBuffer(cmdBuff, 0) == VK_SUCCESS
+           && vkBeginCommandBuffer(cmdBuff, &cmdInfo) == VK_SUCCESS;
+}
+
+// Dragonfly.Memory.Converter
+
+DflMem::Converter::Converter(const Info& info)
+: pInfo( new Info(info) ),
+  Program( INT_GetHandles(
+             info.Device,
+             info) ),
+  Staging( INT_GetRing(
+             info.Device,
+             this->Program) )
+{
+}
+
+DflMem::Converter::~Converter()
+{
+    const VkDevice& device{ this->pInfo->Device.GetDevice() };
+    vkWaitForFences(
+        device,
+        static_cast<uint32_t>(this->Staging.Fences.size()),
+        this->Staging.Fences.data(),
+        VK_TRUE,
+        UINT64_MAX);
+
+    for (const auto& fence : this->Staging.Fences)
+    {
+        vkDestroyFence(device, fence, nullptr);
+    }
+    vkDestroyBuffer(device, this->Staging.hIntermediate, nullptr);
+    INT_ReturnMemory(
+        this->pInfo->Device,
+        this->Staging.hIntermediateMemory,
+        this->Staging.IntermediateHeapType,
+        this->Staging.IntermediateHeapIndex,
+        this->Staging.IntermediateSize);
+    vkDestroyBuffer(device, this->Staging.hStage, nullptr);
+    vkUnmapMemory(device, this->Staging.hStageMemory);
+    INT_ReturnMemory(
+        this->pInfo->Device,
+        this->Staging.hStageMemory,
+        this->Staging.StageHeapType,
+        this->Staging.StageHeapIndex,
+        this->Staging.StageSize);
+
+    vkDestroyDescriptorPool(device, this->Program.hDescriptorPool, nullptr);
+    vkDestroyPipeline(device, this->Program.hPipeline, nullptr);
+    vkDestroyPipelineLayout(device, this->Program.hLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, this->Program.hSetLayout, nullptr);
+    vkDestroyShaderModule(device, this->Program.hModule, nullptr);
+    vkDestroyCommandPool(device, this->Program.hCmdPool, nullptr);
+
+    this->pInfo->Device.ReturnQueue(this->Program.AssignedQueue);
+}
+
+void DflMem::Converter::RecordConversion(
+    const uint32_t           slot,
+    const Conversion&        conversion,
+    const Image&             destination,
+    const VkBufferImageCopy& copy) const noexcept
+{
+    const VkCommandBuffer& cmdBuffer{ this->Staging.CmdBuffers[slot] };
+    const INT_Destination dstFormat{ INT_GetDestination(destination.GetFormat()) };
+
+    INT_ConvertParameters parameters{
+        .TexelCount{ copy.imageExtent.width * copy.imageExtent.height },
+        .SourceFormat{ static_cast<uint32_t>(conversion.Format) },
+        .SourceSize{ GetTexelSize(conversion.Format) },
+        .DestinationFormat{ dstFormat.Format },
+        .IsEncoded{ dstFormat.IsSRGB && INT_IsFloat(conversion.Format) ? 1u : 0u } };
+    for (uint32_t i{ 0 }; i < 4; i++)
+    {
+        parameters.Swizzle |= static_cast<uint32_t>(conversion.Swizzle[i]) << (4 * i);
+    }
+
+    vkCmdBindPipeline(
+        cmdBuffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        this->Program.hPipeline);
+    vkCmdBindDescriptorSets(
+        cmdBuffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        this->Program.hLayout,
+        0,
+        1,
+        &this->Staging.Sets[slot],
+        0,
+        nullptr);
+    vkCmdPushConstants(
+        cmdBuffer,
+        this->Program.hLayout,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        0,
+        sizeof(INT_ConvertParameters),
+        &parameters);
+    // the raw texels were written by the host before the submission, which
+    // makes them visible, and the slot's last copy is done, since its fence is
+    vkCmdDispatch(
+        cmdBuffer,
+        (parameters.TexelCount + INT_GroupSize - 1) / INT_GroupSize,
+        1,
+        1);
+
+    // the converted texels are in the slot's intermediate memory
+    Transitions barrier{ };
+    barrier.Wait(
+                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT,
+                VK_ACCESS_2_TRANSFER_READ_BIT)
+           .Record(
+                cmdBuffer,
+                this->pInfo->pProfiler);
+
+    vkCmdCopyBufferToImage(
+        cmdBuffer,
+        this->Staging.hIntermediate,
+        destination.GetImage(),
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1,
+        &copy);
+}
+
+VkResult DflMem::Converter::Submit(const uint32_t slot) const noexcept
+{
+    const VkSubmitInfo submitInfo{
+        .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO },
+        .pNext{ nullptr },
+        .waitSemaphoreCount{ 0 },
+        .pWaitSemaphores{ nullptr },
+        .pWaitDstStageMask{ nullptr },
+        .commandBufferCount{ 1 },
+        .pCommandBuffers{ &this->Staging.CmdBuffers[slot] },
+        .signalSemaphoreCount{ 0 },
+        .pSignalSemaphores{ nullptr }
+    };
+
+    vkResetFences(
+        this->pInfo->Device.GetDevice(),
+        1,
+        &this->Staging.Fences[slot]);
+    const VkResult result{ vkQueueSubmit(
+                                this->Program.AssignedQueue,
+                                1,
+                                &submitInfo,
+                                this->Staging.Fences[slot]) };
+    // the fence still has to be signaled, or the slot would never be free again
+    if (result != VK_SUCCESS)
+    {
+        vkQueueSubmit(
+            this->Program.AssignedQueue,
+            0,
+            nullptr,
+            this->Staging.Fences[slot]);
+    }
+
+    return result;
+}
+
+auto DflMem::Converter::Write(
+    const std::span<const std::byte> source,
+    const uint64_t                   rowPitch,
+    const Conversion&                conversion,
+    const Image&                     destination,
+    const Image::Region&             region)
+-> DflGen::Job<Error>
+{
+    if ( destination.IsExclusive()
+         && destination.GetFamily() != this->Program.AssignedQueue.FamilyIndex ) [[ unlikely ]]
+    {
+        co_return Error::OwnershipError;
+    }
+
+    const uint32_t sourceSize{ GetTexelSize(conversion.Format) };
+    if ( !IsSupported(destination.GetFormat())
+         || sourceSize == 0 ) [[ unlikely ]]
+    {
+        co_return Error::CapabilityError;
+    }
+
+    // the region is inside the level, and source covers every row of it
+    const std::array<uint32_t, 3>& size{ destination.GetSize() };
+    bool isInRange{ region.Level < destination.GetMipLevels() && region.Layer < destination.GetLayers() };
+    for (uint32_t i{ 0 }; i < 3; i++)
+    {
+        isInRange = isInRange
+                    && region.Offset[i] >= 0
+                    && region.Offset[i] + static_cast<uint64_t>(std::max(region.Extent[i], 1u))
+                        <= std::max(std::max(size[i], 1u) >> region.Level, 1u);
+    }
+    const uint64_t rowSize{ static_cast<uint64_t>(std::max(region.Extent[0], 1u)) * sourceSize };
+    const uint64_t pitch{ rowPitch == 0 ? rowSize : rowPitch };
+    const uint64_t rows{ static_cast<uint64_t>(std::max(region.Extent[1], 1u)) * std::max(region.Extent[2], 1u) };
+    if ( !isInRange
+         || pitch < rowSize
+         || source.size() < (rows - 1) * pitch + rowSize ) [[ unlikely ]]
+    {
+        co_return Error::RangeError;
+    }
+
+    // the slots, and their command buffers, are the converter's
+    if (this->IsWriting.exchange(true)) [[ unlikely ]]
+    {
+        co_return Error::BusyError;
+    }
+
+    const VkDevice gpu{ this->pInfo->Device.GetDevice() };
+
+    const std::array<uint32_t, 3> extent{
+        std::max(region.Extent[0], 1u),
+        std::max(region.Extent[1], 1u),
+        std::max(region.Extent[2], 1u) };
+
+    // a region covering the whole level doesn't need what was in it before
+    bool isWholeLevel{ true };
+    for (uint32_t i{ 0 }; i < 3; i++)
+    {
+        isWholeLevel = isWholeLevel
+                       && region.Offset[i] == 0
+                       && extent[i] == std::max(std::max(size[i], 1u) >> region.Level, 1u);
+    }
+
+    // tiles of as many whole rows as a slot's stage and intermediate memory
+    // fit, or of parts of a row, if not even one does
+    const uint64_t tileTexels{ std::min(
+                                DflHW::Device::StageMemory / sourceSize,
+                                DflHW::Device::IntermediateMemory / INT_GetDestination(destination.GetFormat()).Size) };
+    const uint32_t width{ static_cast<uint32_t>( std::min<uint64_t>(extent[0], tileTexels) ) };
+    const uint32_t height{ static_cast<uint32_t>( std::clamp<uint64_t>(tileTexels / width, 1, extent[1]) ) };
+
+    // the destination's tracked layouts are put back if the first tile isn't submitted
+    DflMem::Transitions transitions{ };
+    Error error{ Error::Success };
+    uint64_t tile{ 0 };
+    for (uint32_t z{ 0 }; z < extent[2] && error == Error::Success; z++)
+    {
+        for (uint32_t y{ 0 }; y < extent[1] && error == Error::Success; y += height)
+        {
+            for (uint32_t x{ 0 }; x < extent[0]; x += width, tile++)
+            {
+                const uint32_t slot{ static_cast<uint32_t>(tile % Slots) };
+                const uint32_t tileWidth{ std::min(width, extent[0] - x) };
+                const uint32_t tileHeight{ std::min(height, extent[1] - y) };
+                const uint64_t tileRowSize{ static_cast<uint64_t>(tileWidth) * sourceSize };
+
+                // the slot is free once the device is done with its previous tile
+                while (vkGetFenceStatus(gpu, this->Staging.Fences[slot]) == VK_NOT_READY)
+                {
+                    co_await DflGen::Job<Error>::Awaitable(
+                        gpu,
+                        this->Staging.Fences[slot]);
+                }
+
+                const VkCommandBuffer& cmdBuff{ this->Staging.CmdBuffers[slot] };
+                if (!INT_BeginTile(cmdBuff))
+                {
+                    error = Error::RecordError;
+                    break;
+                }
+
+                {
+                    DflHW::Profiler::Zone zone(
+                                            this->pInfo->pProfiler,
+                                            cmdBuff,
+                                            this->Program.AssignedQueue.FamilyIndex,
+                                            "Converter::Write");
+
+                    // the tiles write texels of their own, so they don't wait for each other
+                    if (tile == 0)
+                    {
+                        transitions
+                            .Use(
+                                destination,
+                                { .Layout{ VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL },
+                                  .Stages{ VK_PIPELINE_STAGE_2_COPY_BIT },
+                                  .Access{ VK_ACCESS_2_TRANSFER_WRITE_BIT } },
+                                { .BaseLevel{ region.Level }, .Levels{ 1 }, .BaseLayer{ region.Layer }, .Layers{ 1 } },
+                                isWholeLevel)
+                            .Record(
+                                cmdBuff,
+                                this->pInfo->pProfiler);
+                    }
+
+                    this->RecordConversion(
+                            slot,
+                            conversion,
+                            destination,
+                            { .bufferOffset{ slot * DflHW::Device::IntermediateMemory },
+                              .bufferRowLength{ tileWidth },
+                              .bufferImageHeight{ tileHeight },
+                              .imageSubresource{
+                                .aspectMask{ VK_IMAGE_ASPECT_COLOR_BIT },
+                                .mipLevel{ region.Level },
+                                .baseArrayLayer{ region.Layer },
+                                .layerCount{ 1 } },
+                              .imageOffset{ VkOffset3D{
+                                region.Offset[0] + static_cast<int32_t>(x),
+                                region.Offset[1] + static_cast<int32_t>(y),
+                                region.Offset[2] + static_cast<int32_t>(z) } },
+                              .imageExtent{ VkExtent3D{ tileWidth, tileHeight, 1 } } });
+                }
+
+                if (vkEndCommandBuffer(cmdBuff) != VK_SUCCESS)
+                {
+                    if (this->pInfo->pProfiler != nullptr)
+                    {
+                        this->pInfo->pProfiler->Discard(cmdBuff);
+                    }
+                    error = Error::RecordError;
+                    break;
+                }
+
+                std::byte* const pStage{ this->Staging.pMap + slot * DflHW::Device::StageMemory };
+                for (uint32_t row{ 0 }; row < tileHeight; row++)
+                {
+                    std::memcpy(
+                        pStage + row * tileRowSize,
+                        source.data()
+                            + (static_cast<uint64_t>(z) * extent[1] + y + row) * pitch
+                            + static_cast<uint64_t>(x) * sourceSize,
+                        tileRowSize);
+                }
+
+                if (this->Submit(slot) != VK_SUCCESS)
+                {
+                    if (this->pInfo->pProfiler != nullptr)
+                    {
+                        this->pInfo->pProfiler->Discard(cmdBuff);
+                    }
+                    error = Error::SubmitError;
+                    break;
+                }
+            }
+        }
+    }
+
+    // the transition only happens if the first tile is submitted
+    if ( error != Error::Success
+         && tile == 0 )
+    {
+        transitions.Revert();
+    }
+
+    for (const auto& fence : this->Staging.Fences)
+    {
+        while (vkGetFenceStatus(gpu, fence) == VK_NOT_READY)
+        {
+            co_await DflGen::Job<Error>::Awaitable(
+                gpu,
+                fence);
+        }
+    }
+    this->IsWriting = false;
+
+    co_return error;
+}
+
+uint32_t DflMem::Converter::GetTexelSize(const Source format) noexcept
+{
+    switch (format)
+    {
+    case Source::R8:
+        return 1;
+    case Source::RG8:
+    case Source::R5G6B5:
+    case Source::R4G4B4A4:
+        return 2;
+    case Source::RGB8:
+    case Source::BGR8:
+        return 3;
+    case Source::RGBA8:
+    case Source::BGRA8:
+    case Source::A2B10G10R10:
+        return 4;
+    case Source::RGB16F:
+        return 6;
+    case Source::RGBA16F:
+        return 8;
+    case Source::RGB32F:
+        return 12;
+    case Source::RGBA32F:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+bool DflMem::Converter::IsSupported(const VkFormat format) noexcept
+{
+    return INT_GetDestination(format).Size != 0;
+}
@@ -0,0 +1,198 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <memory>
+#include <array>
+#include <vector>
+#include <atomic>
+#include <span>
+#include <cstddef>
+#include <filesystem>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "Dragonfly.h"
+
+#include "Dragonfly.Generics.hxx"
+#include "Dragonfly.Hardware.Device.hxx"
+#include "Dragonfly.Hardware.Profiler.hxx"
+#include "Dragonfly.Memory.Buffer.hxx"
+#include "Dragonfly.Memory.Transitions.hxx"
+
+namespace Dfl {
+    // Dragonfly.Memory
+    namespace Memory {
+        // Dragonfly.Memory.Converter
+        // Writes texels of another format to an image, converting them on the
+        // device, so the host only copies the raw bytes. Each tile of the region
+        // is copied to a slot of the converter's own stage ring, converted by a
+        // compute dispatch into the slot's part of the converter's intermediate
+        // memory, and copied from there to the image, in a submission of its own
+        // on a compute queue, so a tile is staged while the last one converts.
+        // The shader is Shaders/Convert.glsl, compiled to SPIR-V as convert.spv
+        // (e.g. glslc -fshader-stage=compute --target-env=vulkan1.3 Convert.glsl
+        // -o convert.spv).
+        class Converter {
+        public:
+            struct Info {
+                      DflHW::Device&        Device;
+                const std::filesystem::path ShaderDirectory{ L"Shaders" };
+
+                      DflHW::Profiler*      pProfiler{ nullptr }; // if not null, conversions are timed
+            };
+
+            struct Handles {
+                const DflHW::Device::Queue  AssignedQueue{ };
+                const VkCommandPool         hCmdPool{ nullptr };
+
+                const VkShaderModule        hModule{ nullptr };
+                const VkDescriptorSetLayout hSetLayout{ nullptr };
+                const VkPipelineLayout      hLayout{ nullptr };
+                const VkPipeline            hPipeline{ nullptr };
+
+                const VkDescriptorPool      hDescriptorPool{ nullptr };
+            };
+
+            // Each slot has StageMemory of the stage, and IntermediateMemory of
+            // the intermediate memory, at slot times that
+            struct Ring {
+                const VkBuffer                     hStage{ nullptr }; // raw texels, host visible
+                const VkDeviceMemory               hStageMemory{ nullptr };
+                const DflHW::Device::MemoryType    StageHeapType{ DflHW::Device::MemoryType::Shared };
+                const uint64_t                     StageHeapIndex{ 0 };
+                const uint64_t                     StageSize{ 0 };
+                      std::byte* const             pMap{ nullptr };
+
+                const VkBuffer                     hIntermediate{ nullptr }; // converted texels
+                const VkDeviceMemory               hIntermediateMemory{ nullptr };
+                const DflHW::Device::MemoryType    IntermediateHeapType{ DflHW::Device::MemoryType::Local };
+                const uint64_t                     IntermediateHeapIndex{ 0 };
+                const uint64_t                     IntermediateSize{ 0 };
+
+                const std::vector<VkCommandBuffer> CmdBuffers{ }; // one per slot
+                const std::vector<VkFence>         Fences{ }; // one per slot
+                const std::vector<VkDescriptorSet> Sets{ }; // one per slot, on its parts of the buffers
+            };
+
+            // As in the shader. Channels are in the order of the name, in memory;
+            // packed formats are little endian words, with the first channel in
+            // the most significant bits, as their VkFormat counterparts.
+            enum class Source : uint32_t {
+                R8 = 0,
+                RG8 = 1,
+                RGB8 = 2,
+                BGR8 = 3,
+                RGBA8 = 4,
+                BGRA8 = 5,
+                RGB16F = 6,
+                RGBA16F = 7,
+                RGB32F = 8,
+                RGBA32F = 9,
+                R5G6B5 = 10,
+                R4G4B4A4 = 11,
+                A2B10G10R10 = 12
+            };
+
+            // Where a channel of the destination comes from
+            enum class Channel : uint32_t {
+                R = 0,
+                G = 1,
+                B = 2,
+                A = 3,
+                Zero = 4,
+                One = 5
+            };
+
+            // Channels the source doesn't have are read as (0, 0, 0, 1), so e.g. a
+            // grey R8 source becomes RGBA with the swizzle (R, R, R, One).
+            // Integer sources are written as they are, even to sRGB destinations,
+            // since they're taken to be encoded already; float ones are linear,
+            // and are encoded to sRGB destinations.
+            struct Conversion {
+                Source                 Format{ Source::RGBA8 };
+                std::array<Channel, 4> Swizzle{ Channel::R, Channel::G, Channel::B, Channel::A };
+            };
+
+            enum class Error {
+                Success = 0,
+                RecordError = -1,
+                SubmitError = -2,
+                CapabilityError = -3, // the destination's format isn't one the shader writes
+                OwnershipError = -4, // the image belongs to another family
+                RangeError = -5, // the region isn't in the image, or source is smaller than it
+                BusyError = -6 // another write is still running
+            };
+
+            static constexpr uint32_t Slots{ 2 }; // tiles in flight
+
+            using Image = Buffer<StorageType::Image>;
+
+        protected:
+            const std::unique_ptr<const Info> pInfo{ nullptr };
+
+            const Handles                     Program{ };
+            const Ring                        Staging{ };
+
+                  std::atomic_bool            IsWriting{ false };
+
+            // Records the conversion of the tile in the slot's stage, and its copy
+            // to the destination, which has to be in TRANSFER_DST already
+                  void                        RecordConversion(
+                                                const uint32_t           slot,
+                                                const Conversion&        conversion,
+                                                const Image&             destination,
+                                                const VkBufferImageCopy& copy) const noexcept;
+            // Submits the slot's command buffer with its fence, which is signaled
+            // even if the submission fails
+                  VkResult                    Submit(const uint32_t slot) const noexcept;
+        public:
+            DFL_API DFL_CALL Converter(const Info& info);
+            DFL_API DFL_CALL ~Converter();
+
+            const DflHW::Device::Queue& GetQueue() const noexcept {
+                                            return this->Program.AssignedQueue; }
+
+            // Converts source to the destination's format and copies it to the
+            // region, like Image::Write does: rows of source are rowPitch bytes
+            // apart (tightly packed if it's 0), and slices follow the region's
+            // last row. The image has to belong to the converter's family, or be
+            // shared with it. Only one write runs at a time.
+            DFL_API
+                  DflGen::Job<Error>
+            DFL_CALL                    Write(
+                                            const std::span<const std::byte> source,
+                                            const uint64_t                   rowPitch,
+                                            const Conversion&                conversion,
+                                            const Image&                     destination,
+                                            const Image::Region&             region);
+
+            // In B
+            DFL_API
+            static
+                  uint32_t
+            DFL_CALL                    GetTexelSize(const Source format) noexcept;
+            // RGBA8 and BGRA8, in UNORM or sRGB, RGBA16F and RGBA32F
+            DFL_API
+            static
+                  bool
+            DFL_CALL                    IsSupported(const VkFormat format) noexcept;
+        };
+    }
+    namespace DflMem = Dfl::Memory;
+}
@@ -0,0 +1,308 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Dragonfly.Memory.Copier.hxx"
+
+#include <array>
+#include <algorithm>
+#include <cstring>
+
+#include <intrin.h>
+#include <immintrin.h>
+
+namespace DflMem = Dfl::Memory;
+
+// Internal for Copier
+
+// below this, setting up the streams costs more than they save
+static constexpr uint64_t INT_MinStreamSize{ 256 };
+
+// Bytes to copy plainly before p is aligned to alignment
+static inline uint64_t INT_GetHead(
+    const void*    p,
+    const uint64_t alignment,
+    const uint64_t size)
+{
+    return std::min(
+            (alignment - reinterpret_cast<uintptr_t>(p) % alignment) % alignment,
+            size);
+}
+
+// Streamed stores need an aligned destination; the source is read as it is.
+// Four registers go per iteration, so loads and stores overlap.
+static void INT_ToMappedSSE41(
+          std::byte* pMapped,
+    const std::byte* pSource,
+          uint64_t   size)
+{
+    const uint64_t head{ INT_GetHead(pMapped, 16, size) };
+    std::memcpy(pMapped, pSource, head);
+    pMapped += head;
+    pSource += head;
+    size -= head;
+
+    for (; size >= 64; size -= 64, pMapped += 64, pSource += 64)
+    {
+        const __m128i a{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource)) };
+        const __m128i b{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + 16)) };
+        const __m128i c{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + 32)) };
+        const __m128i d{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + 48)) };
+        _mm_stream_si128(reinterpret_cast<__m128i*>(pMapped), a);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(pMapped + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(pMapped + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(pMapped + 48), d);
+    }
+    _mm_sfence();
+
+    std::memcpy(pMapped, pSource, size);
+}
+
+static void INT_ToMappedAVX2(
+          std::byte* pMapped,
+    const std::byte* pSource,
+          uint64_t   size)
+{
+    const uint64_t head{ INT_GetHead(pMapped, 32, size) };
+    std::memcpy(pMapped, pSource, head);
+    pMapped += head;
+    pSource += head;
+    size -= head;
+
+    for (; size >= 128; size -= 128, pMapped += 128, pSource += 128)
+    {
+        const __m256i a{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSource)) };
+        const __m256i b{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSource + 32)) };
+        const __m256i c{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSource + 64)) };
+        const __m256i d{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSource + 96)) };
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(pMapped), a);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(pMapped + 32), b);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(pMapped + 64), c);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(pMapped + 96), d);
+    }
+    _mm_sfence();
+
+    std::memcpy(pMapped, pSource, size);
+}
+
+static void INT_ToMappedAVX512(
+          std::byte* pMapped,
+    const std::byte* pSource,
+          uint64_t   size)
+{
+    const uint64_t head{ INT_GetHead(pMapped, 64, size) };
+    std::memcpy(pMapped, pSource, head);
+    pMapped += head;
+    pSource += head;
+    size -= head;
+
+    for (; size >= 256; size -= 256, pMapped += 256, pSource += 256)
+    {
+        const __m512i a{ _mm512_loadu_si512(pSource) };
+        const __m512i b{ _mm512_loadu_si512(pSource + 64) };
+        const __m512i c{ _mm512_loadu_si512(pSource + 128) };
+        const __m512i d{ _mm512_loadu_si512(pSource + 192) };
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(pMapped), a);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(pMapped + 64), b);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(pMapped + 128), c);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(pMapped + 192), d);
+    }
+    _mm_sfence();
+
+    std::memcpy(pMapped, pSource, size);
+}
+
+// Streaming loads need an aligned source; the destination is written as it
+// is. On memory that isn't write-combined they are ordinary loads.
+static void INT_FromMappedSSE41(
+          std::byte* pDestination,
+    const std::byte* pMapped,
+          uint64_t   size)
+{
+    const uint64_t head{ INT_GetHead(pMapped, 16, size) };
+    std::memcpy(pDestination, pMapped, head);
+    pDestination += head;
+    pMapped += head;
+    size -= head;
+
+    for (; size >= 64; size -= 64, pDestination += 64, pMapped += 64)
+    {
+        const __m128i a{ _mm_stream_load_si128(reinterpret_cast<__m128i*>(const_cast<std::byte*>(pMapped))) };
+        const __m128i b{ _mm_stream_load_si128(reinterpret_cast<__m128i*>(const_cast<std::byte*>(pMapped + 16))) };
+        const __m128i c{ _mm_stream_load_si128(reinterpret_cast<__m128i*>(const_cast<std::byte*>(pMapped + 32))) };
+        const __m128i d{ _mm_stream_load_si128(reinterpret_cast<__m128i*>(const_cast<std::byte*>(pMapped + 48))) };
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination), a);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + 16), b);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + 32), c);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDestination + 48), d);
+    }
+
+    std::memcpy(pDestination, pMapped, size);
+}
+
+static void INT_FromMappedAVX2(
+          std::byte* pDestination,
+    const std::byte* pMapped,
+          uint64_t   size)
+{
+    const uint64_t head{ INT_GetHead(pMapped, 32, size) };
+    std::memcpy(pDestination, pMapped, head);
+    pDestination += head;
+    pMapped += head;
+    size -= head;
+
+    for (; size >= 128; size -= 128, pDestination += 128, pMapped += 128)
+    {
+        const __m256i a{ _mm256_stream_load_si256(reinterpret_cast<const __m256i*>(pMapped)) };
+        const __m256i b{ _mm256_stream_load_si256(reinterpret_cast<const __m256i*>(pMapped + 32)) };
+        const __m256i c{ _mm256_stream_load_si256(reinterpret_cast<const __m256i*>(pMapped + 64)) };
+        const __m256i d{ _mm256_stream_load_si256(reinterpret_cast<const __m256i*>(pMapped + 96)) };
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDestination), a);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDestination + 32), b);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDestination + 64), c);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pDestination + 96), d);
+    }
+
+    std::memcpy(pDestination, pMapped, size);
+}
+
+static void INT_FromMappedAVX512(
+          std::byte* pDestination,
+    const std::byte* pMapped,
+          uint64_t   size)
+{
+    const uint64_t head{ INT_GetHead(pMapped, 64, size) };
+    std::memcpy(pDestination, pMapped, head);
+    pDestination += head;
+    pMapped += head;
+    size -= head;
+
+    for (; size >= 256; size -= 256, pDestination += 256, pMapped += 256)
+    {
+        const __m512i a{ _mm512_stream_load_si512(const_cast<std::byte*>(pMapped)) };
+        const __m512i b{ _mm512_stream_load_si512(const_cast<std::byte*>(pMapped + 64)) };
+        const __m512i c{ _mm512_stream_load_si512(const_cast<std::byte*>(pMapped + 128)) };
+        const __m512i d{ _mm512_stream_load_si512(const_cast<std::byte*>(pMapped + 192)) };
+        _mm512_storeu_si512(pDestination, a);
+        _mm512_storeu_si512(pDestination + 64, b);
+        _mm512_storeu_si512(pDestination + 128, c);
+        _mm512_storeu_si512(pDestination + 192, d);
+    }
+
+    std::memcpy(pDestination, pMapped, size);
+}
+
+// AVX registers also need the system to save them on context switches, and
+// AVX-512 ones the upper halves and mask registers on top of those
+static DflMem::Copier::Kernel INT_FindKernel()
+{
+    std::array<int, 4> registers{ };
+    __cpuid(registers.data(), 0);
+    const int leaves{ registers[0] };
+
+    __cpuid(registers.data(), 1);
+    const bool hasSSE41{ (registers[2] & (1 << 19)) != 0 };
+    const bool hasXSave{ (registers[2] & (1 << 27)) != 0 };
+    const uint64_t savedState{ hasXSave ? _xgetbv(0) : 0 };
+    const bool hasAVX{ (registers[2] & (1 << 28)) != 0
+                       && (savedState & 0x6) == 0x6 };
+
+    bool hasAVX2{ false };
+    bool hasAVX512{ false };
+    if ( leaves >= 7
+         && hasAVX )
+    {
+        __cpuidex(registers.data(), 7, 0);
+        hasAVX2 = (registers[1] & (1 << 5)) != 0;
+        hasAVX512 = (registers[1] & (1 << 16)) != 0
+                    && (savedState & 0xE6) == 0xE6;
+    }
+
+    if (hasAVX512) { return DflMem::Copier::Kernel::AVX512; }
+    if (hasAVX2) { return DflMem::Copier::Kernel::AVX2; }
+    if (hasSSE41) { return DflMem::Copier::Kernel::SSE41; }
+    return DflMem::Copier::Kernel::Scalar;
+}
+
+// Dragonfly.Memory.Copier
+
+auto DflMem::Copier::GetKernel() noexcept
+-> Kernel
+{
+    static const Kernel kernel{ INT_FindKernel() };
+    return kernel;
+}
+
+void DflMem::Copier::ToMapped(
+          void*          pMapped,
+    const void*          pSource,
+    const uint64_t       size,
+    const Kernel         kernel) noexcept
+{
+    std::byte* pTo{ static_cast<std::byte*>(pMapped) };
+    const std::byte* pFrom{ static_cast<const std::byte*>(pSource) };
+    if (size < INT_MinStreamSize)
+    {
+        std::memcpy(pTo, pFrom, size);
+        return;
+    }
+
+    switch (std::min(kernel, GetKernel()))
+    {
+    case Kernel::AVX512:
+        INT_ToMappedAVX512(pTo, pFrom, size);
+        break;
+    case Kernel::AVX2:
+        INT_ToMappedAVX2(pTo, pFrom, size);
+        break;
+    case Kernel::SSE41:
+        INT_ToMappedSSE41(pTo, pFrom, size);
+        break;
+    default:
+        std::memcpy(pTo, pFrom, size);
+        break;
+    }
+}
+
+void DflMem::Copier::FromMapped(
+          void*          pDestination,
+    const void*          pMapped,
+    const uint64_t       size,
+    const Kernel         kernel) noexcept
+{
+    std::byte* pTo{ static_cast<std::byte*>(pDestination) };
+    const std::byte* pFrom{ static_cast<const std::byte*>(pMapped) };
+    if (size < INT_MinStreamSize)
+    {
+        std::memcpy(pTo, pFrom, size);
+        return;
+    }
+
+    switch (std::min(kernel, GetKernel()))
+    {
+    case Kernel::AVX512:
+        INT_FromMappedAVX512(pTo, pFrom, size);
+        break;
+    case Kernel::AVX2:
+        INT_FromMappedAVX2(pTo, pFrom, size);
+        break;
+    case Kernel::SSE41:
+        INT_FromMappedSSE41(pTo, pFrom, size);
+        break;
+    default:
+        std::memcpy(pTo, pFrom, size);
+        break;
+    }
+}
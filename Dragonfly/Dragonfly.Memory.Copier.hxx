@@ -0,0 +1,71 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "Dragonfly.h"
+
+namespace Dfl {
+    // Dragonfly.Memory
+    namespace Memory {
+        // Dragonfly.Memory.Copier
+        // Copies between host memory and memory the device mapped. Mapped device
+        // memory is often write-combined or uncached, which ordinary copies are
+        // slow on: writes to it are streamed, so they fill whole lines without
+        // reading them first, and reads from it are streaming loads, which
+        // fetch a line at a time. The widest kernel the processor has is found
+        // once, through cpuid; small copies go through memcpy.
+        class Copier {
+        public:
+            enum class Kernel {
+                Scalar = 0, // memcpy
+                SSE41 = 1,
+                AVX2 = 2,
+                AVX512 = 3
+            };
+
+            // The widest kernel the processor and the system support
+            DFL_API
+            static
+                  Kernel
+            DFL_CALL                 GetKernel() noexcept;
+
+            // Copies size bytes of pSource to mapped memory. Streamed writes are
+            // fenced before returning, so they're done before any flush or
+            // submission that follows.
+            DFL_API
+            static
+                  void
+            DFL_CALL                 ToMapped(
+                                        void*          pMapped,
+                                        const void*    pSource,
+                                        const uint64_t size,
+                                        const Kernel   kernel = GetKernel()) noexcept;
+            // Copies size bytes of mapped memory to pDestination
+            DFL_API
+            static
+                  void
+            DFL_CALL                 FromMapped(
+                                        void*          pDestination,
+                                        const void*    pMapped,
+                                        const uint64_t size,
+                                        const Kernel   kernel = GetKernel()) noexcept;
+        };
+    }
+    namespace DflMem = Dfl::Memory;
+}
@@ -0,0 +1,801 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Dragonfly.Memory.Downsampler.hxx"
+
+#include <fstream>
+#include <algorithm>
+
+namespace DflHW = Dfl::Hardware;
+namespace DflMem = Dfl::Memory;
+namespace DflGen = Dfl::Generics;
+
+// Internal for Downsampler
+
+// as laid out in the shader
+static constexpr uint32_t INT_TileSize{ 64 };
+static constexpr uint32_t INT_MaxSize{ 4096 };
+
+// The shader's levels are float images, which integer formats can't be bound to
+static inline bool INT_IsInteger(const VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8_UINT:
+    case VK_FORMAT_R8_SINT:
+    case VK_FORMAT_R8G8_UINT:
+    case VK_FORMAT_R8G8_SINT:
+    case VK_FORMAT_R8G8B8A8_UINT:
+    case VK_FORMAT_R8G8B8A8_SINT:
+    case VK_FORMAT_B8G8R8A8_UINT:
+    case VK_FORMAT_B8G8R8A8_SINT:
+    case VK_FORMAT_A8B8G8R8_UINT_PACK32:
+    case VK_FORMAT_A8B8G8R8_SINT_PACK32:
+    case VK_FORMAT_A2R10G10B10_UINT_PACK32:
+    case VK_FORMAT_A2B10G10R10_UINT_PACK32:
+    case VK_FORMAT_R16_UINT:
+    case VK_FORMAT_R16_SINT:
+    case VK_FORMAT_R16G16_UINT:
+    case VK_FORMAT_R16G16_SINT:
+    case VK_FORMAT_R16G16B16A16_UINT:
+    case VK_FORMAT_R16G16B16A16_SINT:
+    case VK_FORMAT_R32_UINT:
+    case VK_FORMAT_R32_SINT:
+    case VK_FORMAT_R32G32_UINT:
+    case VK_FORMAT_R32G32_SINT:
+    case VK_FORMAT_R32G32B32A32_UINT:
+    case VK_FORMAT_R32G32B32A32_SINT:
+    case VK_FORMAT_R64_UINT:
+    case VK_FORMAT_R64_SINT:
+    case VK_FORMAT_R64G64_UINT:
+    case VK_FORMAT_R64G64_SINT:
+    case VK_FORMAT_R64G64B64A64_UINT:
+    case VK_FORMAT_R64G64B64A64_SINT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+struct INT_DownsampleParameters {
+    uint32_t LevelCount{ 0 };
+    uint32_t GroupsPerLayer{ 0 };
+    uint32_t Filter{ 0 };
+};
+
+static VkShaderModule INT_GetModule(
+    const VkDevice&              hGPU,
+    const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        throw Dfl::Error::NoData(
+                L"Unable to open downsampling shader file",
+                L"INT_GetModule",
+                Dfl::API::None);
+    }
+
+    // SPIR-V is made of 32-bit words
+    std::vector<uint32_t> code(static_cast<uint64_t>(file.tellg()) / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(code.data()), code.size() * sizeof(uint32_t));
+
+    const VkShaderModuleCreateInfo moduleInfo{
+        .sType{ VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .codeSize{ code.size() * sizeof(uint32_t) },
+        .pCode{ code.data() }
+    };
+
+    VkShaderModule module{ nullptr };
+    if ( vkCreateShaderModule(
+            hGPU,
+            &moduleInfo,
+            nullptr,
+            &module) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create downsampling shader module",
+                L"INT_GetModule");
+    }
+
+    return module;
+}
+
+static DflMem::Downsampler::Handles INT_GetHandles(
+          DflHW::Device&              gpu,
+    const DflMem::Downsampler::Info&  info)
+{
+    const VkDevice& hGPU{ gpu.GetDevice() };
+
+    const DflHW::Device::Queue queue{ gpu.BorrowQueue(DflHW::Device::Queue::Type::Compute) };
+    if (queue.hQueue == nullptr)
+    {
+        throw Dfl::Error::NoData(
+                L"Unable to find a compute queue",
+                L"INT_GetHandles",
+                Dfl::API::None);
+    }
+
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(gpu.GetPhysicalDevice(), &features);
+
+    VkCommandPool         cmdPool{ nullptr };
+    VkCommandBuffer       cmdBuffer{ nullptr };
+    VkFence               fence{ nullptr };
+    VkShaderModule        module{ nullptr };
+    VkDescriptorSetLayout setLayout{ nullptr };
+    VkPipelineLayout      layout{ nullptr };
+    VkPipeline            pipeline{ nullptr };
+    VkDescriptorPool      descriptorPool{ nullptr };
+    VkDescriptorSet       set{ nullptr };
+    try {
+        const VkCommandPoolCreateInfo poolInfo{
+            .sType{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT },
+            .queueFamilyIndex{ queue.FamilyIndex }
+        };
+        if ( vkCreateCommandPool(
+                hGPU,
+                &poolInfo,
+                nullptr,
+                &cmdPool) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create command pool",
+                    L"INT_GetHandles");
+        }
+
+        const VkCommandBufferAllocateInfo bufferInfo{
+            .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO },
+            .pNext{ nullptr },
+            .commandPool{ cmdPool },
+            .level{ VK_COMMAND_BUFFER_LEVEL_PRIMARY },
+            .commandBufferCount{ 1 }
+        };
+        if ( vkAllocateCommandBuffers(
+                hGPU,
+                &bufferInfo,
+                &cmdBuffer) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to allocate command buffer",
+                    L"INT_GetHandles");
+        }
+
+        // signaled, so that the first downsampling doesn't wait
+        const VkFenceCreateInfo fenceInfo{
+            .sType{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ VK_FENCE_CREATE_SIGNALED_BIT }
+        };
+        if ( vkCreateFence(
+                hGPU,
+                &fenceInfo,
+                nullptr,
+                &fence) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create fence",
+                    L"INT_GetHandles");
+        }
+
+        module = INT_GetModule(hGPU, info.ShaderDirectory / L"downsample.spv");
+
+        // a view per level, and the counters
+        const std::array<VkDescriptorSetLayoutBinding, 2> bindings{
+            VkDescriptorSetLayoutBinding{
+                .binding{ 0 },
+                .descriptorType{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE },
+                .descriptorCount{ DflMem::Downsampler::MaxLevels },
+                .stageFlags{ VK_SHADER_STAGE_COMPUTE_BIT },
+                .pImmutableSamplers{ nullptr } },
+            VkDescriptorSetLayoutBinding{
+                .binding{ 1 },
+                .descriptorType{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+                .descriptorCount{ 1 },
+                .stageFlags{ VK_SHADER_STAGE_COMPUTE_BIT },
+                .pImmutableSamplers{ nullptr } } };
+        const VkDescriptorSetLayoutCreateInfo setLayoutInfo{
+            .sType{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .bindingCount{ static_cast<uint32_t>(bindings.size()) },
+            .pBindings{ bindings.data() }
+        };
+        if ( vkCreateDescriptorSetLayout(
+                hGPU,
+                &setLayoutInfo,
+                nullptr,
+                &setLayout) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create descriptor set layout",
+                    L"INT_GetHandles");
+        }
+
+        const VkPushConstantRange pushRange{
+            .stageFlags{ VK_SHADER_STAGE_COMPUTE_BIT },
+            .offset{ 0 },
+            .size{ sizeof(INT_DownsampleParameters) }
+        };
+        const VkPipelineLayoutCreateInfo layoutInfo{
+            .sType{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .setLayoutCount{ 1 },
+            .pSetLayouts{ &setLayout },
+            .pushConstantRangeCount{ 1 },
+            .pPushConstantRanges{ &pushRange }
+        };
+        if ( vkCreatePipelineLayout(
+                hGPU,
+                &layoutInfo,
+                nullptr,
+                &layout) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create downsampling pipeline layout",
+                    L"INT_GetHandles");
+        }
+
+        const VkComputePipelineCreateInfo pipelineInfo{
+            .sType{ VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .stage{
+                .sType{ VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO },
+                .pNext{ nullptr },
+                .flags{ 0 },
+                .stage{ VK_SHADER_STAGE_COMPUTE_BIT },
+                .module{ module },
+                .pName{ "main" },
+                .pSpecializationInfo{ nullptr } },
+            .layout{ layout },
+            .basePipelineHandle{ nullptr },
+            .basePipelineIndex{ -1 }
+        };
+        if ( vkCreateComputePipelines(
+                hGPU,
+                nullptr,
+                1,
+                &pipelineInfo,
+                nullptr,
+                &pipeline) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create downsampling pipeline",
+                    L"INT_GetHandles");
+        }
+
+        const std::array<VkDescriptorPoolSize, 2> poolSizes{
+            VkDescriptorPoolSize{
+                .type{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE },
+                .descriptorCount{ DflMem::Downsampler::MaxLevels } },
+            VkDescriptorPoolSize{
+                .type{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+                .descriptorCount{ 1 } } };
+        const VkDescriptorPoolCreateInfo descriptorPoolInfo{
+            .sType{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .maxSets{ 1 },
+            .poolSizeCount{ static_cast<uint32_t>(poolSizes.size()) },
+            .pPoolSizes{ poolSizes.data() }
+        };
+        if ( vkCreateDescriptorPool(
+                hGPU,
+                &descriptorPoolInfo,
+                nullptr,
+                &descriptorPool) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create descriptor pool",
+                    L"INT_GetHandles");
+        }
+
+        const VkDescriptorSetAllocateInfo setInfo{
+            .sType{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO },
+            .pNext{ nullptr },
+            .descriptorPool{ descriptorPool },
+            .descriptorSetCount{ 1 },
+            .pSetLayouts{ &setLayout }
+        };
+        if ( vkAllocateDescriptorSets(
+                hGPU,
+                &setInfo,
+                &set) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to allocate descriptor set",
+                    L"INT_GetHandles");
+        }
+    }
+    catch (Dfl::Error::Generic& err) {
+        if (descriptorPool != nullptr) { vkDestroyDescriptorPool(hGPU, descriptorPool, nullptr); }
+        if (pipeline != nullptr) { vkDestroyPipeline(hGPU, pipeline, nullptr); }
+        if (layout != nullptr) { vkDestroyPipelineLayout(hGPU, layout, nullptr); }
+        if (setLayout != nullptr) { vkDestroyDescriptorSetLayout(hGPU, setLayout, nullptr); }
+        if (module != nullptr) { vkDestroyShaderModule(hGPU, module, nullptr); }
+        if (fence != nullptr) { vkDestroyFence(hGPU, fence, nullptr); }
+        if (cmdPool != nullptr) { vkDestroyCommandPool(hGPU, cmdPool, nullptr); }
+
+        gpu.ReturnQueue(queue);
+
+        throw;
+    }
+
+    return { queue,
+             gpu.GetQueueFamilies()[queue.FamilyIndex].QueueType,
+             cmdPool,
+             cmdBuffer,
+             fence,
+             module,
+             setLayout,
+             layout,
+             pipeline,
+             descriptorPool,
+             set,
+             features.shaderStorageImageArrayDynamicIndexing == VK_TRUE };
+}
+
+static inline VkOffset3D INT_GetCorner(
+    const std::array<uint32_t, 3>& size,
+    const uint32_t                 mipLevel)
+{
+    return { static_cast<int32_t>(std::max(size[0] >> mipLevel, 1u)),
+             static_cast<int32_t>(std::max(size[1] >> mipLevel, 1u)),
+             static_cast<int32_t>(std::max(size[2] >> mipLevel, 1u)) };
+}
+
+static inline VkImageSubresourceRange INT_GetLevels(
+    const uint32_t baseLevel,
+    const uint32_t levelCount)
+{
+    return { .aspectMask{ VK_IMAGE_ASPECT_COLOR_BIT },
+             .baseMipLevel{ baseLevel },
+             .levelCount{ levelCount },
+             .baseArrayLayer{ 0 },
+             .layerCount{ VK_REMAINING_ARRAY_LAYERS } };
+}
+
+// Dragonfly.Memory.Downsampler
+
+DflMem::Downsampler::Downsampler(const Info& info)
+: pInfo( new Info(info) ),
+  Program( INT_GetHandles(
+             info.Device,
+             info) ),
+  Counters({ .MemoryBlock{ info.MemoryBlock },
+             .AccessingQueueFamilies{ this->Program.AssignedQueue.FamilyIndex },
+             .Size{ sizeof(uint32_t) * std::max(info.MaxLayers, 1u) },
+             .Options{ VK_BUFFER_USAGE_STORAGE_BUFFER_BIT },
+             .pProfiler{ info.pProfiler } })
+{
+    // the counters never change, unlike the views of the levels
+    const VkDescriptorBufferInfo bufferInfo{
+        .buffer{ this->Counters.GetBuffer() },
+        .offset{ 0 },
+        .range{ VK_WHOLE_SIZE }
+    };
+    const VkWriteDescriptorSet write{
+        .sType{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET },
+        .pNext{ nullptr },
+        .dstSet{ this->Program.hSet },
+        .dstBinding{ 1 },
+        .dstArrayElement{ 0 },
+        .descriptorCount{ 1 },
+        .descriptorType{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+        .pImageInfo{ nullptr },
+        .pBufferInfo{ &bufferInfo },
+        .pTexelBufferView{ nullptr }
+    };
+    vkUpdateDescriptorSets(
+        info.Device.GetDevice(),
+        1,
+        &write,
+        0,
+        nullptr);
+}
+
+DflMem::Downsampler::~Downsampler()
+{
+    const VkDevice& device{ this->pInfo->Device.GetDevice() };
+    vkWaitForFences(
+        device,
+        1,
+        &this->Program.hFence,
+        VK_TRUE,
+        UINT64_MAX);
+
+    vkDestroyDescriptorPool(device, this->Program.hDescriptorPool, nullptr);
+    vkDestroyPipeline(device, this->Program.hPipeline, nullptr);
+    vkDestroyPipelineLayout(device, this->Program.hLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, this->Program.hSetLayout, nullptr);
+    vkDestroyShaderModule(device, this->Program.hModule, nullptr);
+    vkDestroyFence(device, this->Program.hFence, nullptr);
+    vkDestroyCommandPool(device, this->Program.hCmdPool, nullptr);
+
+    this->pInfo->Device.ReturnQueue(this->Program.AssignedQueue);
+}
+
+bool DflMem::Downsampler::IsDispatchable(const Image& image) const noexcept
+{
+    const std::array<uint32_t, 3>& size{ image.GetSize() };
+    if ( !this->Program.CanDispatch
+         || size[1] == 0 // 1D
+         || size[2] != 0 // 3D
+         || std::max(size[0], size[1]) > INT_MaxSize
+         || image.GetMipLevels() > MaxLevels
+         || image.GetLayers() > this->pInfo->MaxLayers
+         || !(image.GetOptions() & VK_IMAGE_USAGE_STORAGE_BIT)
+         || INT_IsInteger(image.GetFormat()) )
+    {
+        return false;
+    }
+
+    // the shader doesn't declare the levels' format, so the format has to be
+    // readable and writable without one (sRGB formats usually aren't storable at all)
+    VkFormatProperties3 properties3{
+        .sType{ VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3 },
+        .pNext{ nullptr }
+    };
+    VkFormatProperties2 properties{
+        .sType{ VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2 },
+        .pNext{ &properties3 }
+    };
+    vkGetPhysicalDeviceFormatProperties2(
+        this->pInfo->Device.GetPhysicalDevice(),
+        image.GetFormat(),
+        &properties);
+
+    constexpr VkFormatFeatureFlags2 required{ 
+        VK_FORMAT_FEATURE_2_STORAGE_IMAGE_BIT
+        | VK_FORMAT_FEATURE_2_STORAGE_READ_WITHOUT_FORMAT_BIT
+        | VK_FORMAT_FEATURE_2_STORAGE_WRITE_WITHOUT_FORMAT_BIT };
+    return (properties3.optimalTilingFeatures & required) == required;
+}
+
+void DflMem::Downsampler::RecordDispatch(
+    const Image&                    image,
+    const std::vector<VkImageView>& views,
+    const Filter                    filter,
+          Transitions&              transitions) const noexcept
+{
+    const VkCommandBuffer& cmdBuffer{ this->Program.hCmdBuffer };
+    const std::array<uint32_t, 3>& size{ image.GetSize() };
+
+    // the counters start at 0 for every layer
+    vkCmdFillBuffer(
+        cmdBuffer,
+        this->Counters.GetBuffer(),
+        0,
+        sizeof(uint32_t) * image.GetLayers(),
+        0);
+
+    // the first level is only read, and the rest are overwritten
+    transitions
+        .Wait(
+            VK_PIPELINE_STAGE_2_CLEAR_BIT,
+            VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT)
+        .Use(
+            image,
+            { .Layout{ VK_IMAGE_LAYOUT_GENERAL },
+              .Stages{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT },
+              .Access{ VK_ACCESS_2_SHADER_STORAGE_READ_BIT } },
+            { .Levels{ 1 } })
+        .Use(
+            image,
+            { .Layout{ VK_IMAGE_LAYOUT_GENERAL },
+              .Stages{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT },
+              .Access{ VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT } },
+            { .BaseLevel{ 1 } },
+            true)
+        .Record(
+            cmdBuffer,
+            this->pInfo->pProfiler);
+
+    const uint32_t groupsX{ (size[0] + INT_TileSize - 1) / INT_TileSize };
+    const uint32_t groupsY{ (size[1] + INT_TileSize - 1) / INT_TileSize };
+    const INT_DownsampleParameters parameters{
+        .LevelCount{ static_cast<uint32_t>(views.size()) },
+        .GroupsPerLayer{ groupsX * groupsY },
+        .Filter{ static_cast<uint32_t>(filter) }
+    };
+
+    vkCmdBindPipeline(
+        cmdBuffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        this->Program.hPipeline);
+    vkCmdBindDescriptorSets(
+        cmdBuffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        this->Program.hLayout,
+        0,
+        1,
+        &this->Program.hSet,
+        0,
+        nullptr);
+    vkCmdPushConstants(
+        cmdBuffer,
+        this->Program.hLayout,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        0,
+        sizeof(INT_DownsampleParameters),
+        &parameters);
+    vkCmdDispatch(
+        cmdBuffer,
+        groupsX,
+        groupsY,
+        image.GetLayers());
+}
+
+void DflMem::Downsampler::RecordBlits(
+    const Image&        image,
+    const Filter        filter,
+          Transitions&  transitions) const noexcept
+{
+    const VkCommandBuffer& cmdBuffer{ this->Program.hCmdBuffer };
+    const uint32_t levels{ image.GetMipLevels() };
+
+    const Image::State sourceState{
+        .Layout{ VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL },
+        .Stages{ VK_PIPELINE_STAGE_2_BLIT_BIT },
+        .Access{ VK_ACCESS_2_TRANSFER_READ_BIT } };
+    const Image::State dstState{
+        .Layout{ VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL },
+        .Stages{ VK_PIPELINE_STAGE_2_BLIT_BIT },
+        .Access{ VK_ACCESS_2_TRANSFER_WRITE_BIT } };
+
+    // the first level keeps its contents, the rest are overwritten. Their
+    // transition goes with the first level's, in the first barrier.
+    transitions.Use(image, dstState, { .BaseLevel{ 1 } }, true);
+
+    for (uint32_t level{ 1 }; level < levels; level++)
+    {
+        // the level before is done being written, and is read from now on
+        transitions.Use(image, sourceState, { .BaseLevel{ level - 1 }, .Levels{ 1 } })
+                   .Record(
+                        cmdBuffer,
+                        this->pInfo->pProfiler);
+
+        const VkImageBlit blitRegion{
+            .srcSubresource{
+                .aspectMask{ VK_IMAGE_ASPECT_COLOR_BIT },
+                .mipLevel{ level - 1 },
+                .baseArrayLayer{ 0 },
+                .layerCount{ image.GetLayers() } },
+            .srcOffsets{
+                VkOffset3D{ 0, 0, 0 },
+                INT_GetCorner(image.GetSize(), level - 1) },
+            .dstSubresource{
+                .aspectMask{ VK_IMAGE_ASPECT_COLOR_BIT },
+                .mipLevel{ level },
+                .baseArrayLayer{ 0 },
+                .layerCount{ image.GetLayers() } },
+            .dstOffsets{
+                VkOffset3D{ 0, 0, 0 },
+                INT_GetCorner(image.GetSize(), level) }
+        };
+        vkCmdBlitImage(
+            cmdBuffer,
+            image.GetImage(),
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            image.GetImage(),
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1,
+            &blitRegion,
+            filter == Filter::Nearest ? VK_FILTER_NEAREST : VK_FILTER_LINEAR);
+    }
+}
+
+auto DflMem::Downsampler::Generate(
+    const Image&  image,
+    const Filter  filter)
+-> DflGen::Job<Error>
+{
+    if ( image.IsExclusive()
+         && image.GetFamily() != this->Program.AssignedQueue.FamilyIndex ) [[ unlikely ]]
+    {
+        co_return Error::OwnershipError;
+    }
+
+    const uint32_t levels{ image.GetMipLevels() };
+    if (levels <= 1) { co_return Error::Success; }
+
+    // compressed formats, for one, can't be blitted
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(
+        this->pInfo->Device.GetPhysicalDevice(),
+        image.GetFormat(),
+        &properties);
+    const VkFormatFeatureFlags blitFeatures{ VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT };
+
+    const bool isDispatched{ this->IsDispatchable(image) };
+    const bool canBlit{ ( this->Program.Capabilities & DflHW::Device::Queue::Type::Graphics ).GetValue() != 0
+                        && (properties.optimalTilingFeatures & blitFeatures) == blitFeatures
+                        && filter != Filter::Min
+                        && filter != Filter::Max };
+    if (!isDispatched && !canBlit) [[ unlikely ]]
+    {
+        co_return Error::CapabilityError;
+    }
+
+    const VkDevice gpu{ this->pInfo->Device.GetDevice() };
+
+    // the set and the command buffer may be in use by the previous downsampling
+    while (vkGetFenceStatus(gpu, this->Program.hFence) == VK_NOT_READY)
+    {
+        co_await DflGen::Job<Error>::Awaitable(
+            gpu,
+            this->Program.hFence);
+    }
+
+    std::vector<VkImageView> views{ };
+    if (isDispatched)
+    {
+        for (uint32_t level{ 0 }; level < levels; level++)
+        {
+            const VkImageViewCreateInfo viewInfo{
+                .sType{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO },
+                .pNext{ nullptr },
+                .flags{ 0 },
+                .image{ image.GetImage() },
+                .viewType{ VK_IMAGE_VIEW_TYPE_2D_ARRAY },
+                .format{ image.GetFormat() },
+                .components{ },
+                .subresourceRange{ INT_GetLevels(level, 1) }
+            };
+            VkImageView view{ nullptr };
+            if ( vkCreateImageView(
+                    gpu,
+                    &viewInfo,
+                    nullptr,
+                    &view) != VK_SUCCESS )
+            {
+                for (const auto& createdView : views) { vkDestroyImageView(gpu, createdView, nullptr); }
+                co_return Error::RecordError;
+            }
+            views.push_back(view);
+        }
+
+        // the levels past the last are never accessed, but have to be bound
+        std::vector<VkDescriptorImageInfo> imageInfos(MaxLevels);
+        for (uint32_t level{ 0 }; level < MaxLevels; level++)
+        {
+            imageInfos[level] = {
+                .sampler{ nullptr },
+                .imageView{ views[std::min(level, levels - 1)] },
+                .imageLayout{ VK_IMAGE_LAYOUT_GENERAL } };
+        }
+        const VkWriteDescriptorSet write{
+            .sType{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET },
+            .pNext{ nullptr },
+            .dstSet{ this->Program.hSet },
+            .dstBinding{ 0 },
+            .dstArrayElement{ 0 },
+            .descriptorCount{ MaxLevels },
+            .descriptorType{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE },
+            .pImageInfo{ imageInfos.data() },
+            .pBufferInfo{ nullptr },
+            .pTexelBufferView{ nullptr }
+        };
+        vkUpdateDescriptorSets(
+            gpu,
+            1,
+            &write,
+            0,
+            nullptr);
+    }
+
+    // the image's tracked layouts are put back if the work isn't submitted
+    DflMem::Transitions transitions{ };
+    Error error{ Error::Success };
+    const VkCommandBufferBeginInfo beginInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO },
+        .pNext{ nullptr },
+        .flags{ VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT },
+        .pInheritanceInfo{ nullptr }
+    };
+    if ( vkResetCommandBuffer(this->Program.hCmdBuffer, 0) != VK_SUCCESS
+         || vkBeginCommandBuffer(this->Program.hCmdBuffer, &beginInfo) != VK_SUCCESS )
+    {
+        error = Error::RecordError;
+    }
+    else
+    {
+        {
+            DflHW::Profiler::Zone zone(
+                                    this->pInfo->pProfiler,
+                                    this->Program.hCmdBuffer,
+                                    this->Program.AssignedQueue.FamilyIndex,
+                                    "Downsampler::Generate");
+
+            if (isDispatched)
+            {
+                this->RecordDispatch(image, views, filter, transitions);
+            }
+            else
+            {
+                this->RecordBlits(image, filter, transitions);
+            }
+        }
+
+        if (vkEndCommandBuffer(this->Program.hCmdBuffer) != VK_SUCCESS)
+        {
+            if (this->pInfo->pProfiler != nullptr)
+            {
+                this->pInfo->pProfiler->Discard(this->Program.hCmdBuffer);
+            }
+            transitions.Revert();
+            error = Error::RecordError;
+        }
+    }
+
+    if (error == Error::Success)
+    {
+        const VkSubmitInfo submitInfo{
+            .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO },
+            .pNext{ nullptr },
+            .waitSemaphoreCount{ 0 },
+            .pWaitSemaphores{ nullptr },
+            .pWaitDstStageMask{ nullptr },
+            .commandBufferCount{ 1 },
+            .pCommandBuffers{ &this->Program.hCmdBuffer },
+            .signalSemaphoreCount{ 0 },
+            .pSignalSemaphores{ nullptr }
+        };
+        vkResetFences(
+            gpu,
+            1,
+            &this->Program.hFence);
+        if ( vkQueueSubmit(
+                this->Program.AssignedQueue,
+                1,
+                &submitInfo,
+                this->Program.hFence) != VK_SUCCESS )
+        {
+            // the fence still has to be signaled, or the next downsampling would wait forever
+            vkQueueSubmit(
+                this->Program.AssignedQueue,
+                0,
+                nullptr,
+                this->Program.hFence);
+            if (this->pInfo->pProfiler != nullptr)
+            {
+                this->pInfo->pProfiler->Discard(this->Program.hCmdBuffer);
+            }
+            transitions.Revert();
+            error = Error::SubmitError;
+        }
+
+        while (vkGetFenceStatus(gpu, this->Program.hFence) == VK_NOT_READY)
+        {
+            co_await DflGen::Job<Error>::Awaitable(
+                gpu,
+                this->Program.hFence);
+        }
+    }
+
+    for (const auto& view : views) { vkDestroyImageView(gpu, view, nullptr); }
+
+    co_return error;
+}
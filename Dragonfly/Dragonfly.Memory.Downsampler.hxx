@@ -0,0 +1,133 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <filesystem>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "Dragonfly.h"
+
+#include "Dragonfly.Generics.hxx"
+#include "Dragonfly.Hardware.Device.hxx"
+#include "Dragonfly.Hardware.Profiler.hxx"
+#include "Dragonfly.Memory.Buffer.hxx"
+#include "Dragonfly.Memory.Transitions.hxx"
+
+namespace Dfl {
+    // Dragonfly.Memory
+    namespace Memory {
+        // Dragonfly.Memory.Downsampler
+        // Generates the mip levels of an image from its first one. 2D images of
+        // up to 4096x4096 texels that can be used as storage images get their
+        // whole chain, for every layer, from a single compute dispatch, as long
+        // as their float, unorm or snorm format can be stored to without being
+        // declared in the shader. The rest (e.g. sRGB images) get a chain of
+        // blits, one level after the other, which needs a graphics queue.
+        // The shader is Shaders/Downsample.glsl, compiled to SPIR-V as
+        // downsample.spv (e.g. glslc -fshader-stage=compute
+        // --target-env=vulkan1.3 Downsample.glsl -o downsample.spv).
+        class Downsampler {
+        public:
+            struct Info {
+                      DflHW::Device&        Device;
+                      DflMem::Block&        MemoryBlock; // the layers' counters are allocated here
+                const std::filesystem::path ShaderDirectory{ L"Shaders" };
+                const uint32_t              MaxLayers{ 16 }; // of any image downsampled by dispatch
+
+                      DflHW::Profiler*      pProfiler{ nullptr }; // if not null, downsampling is timed
+            };
+
+            static constexpr uint32_t MaxLevels{ 13 }; // that a dispatch generates, as in the shader
+
+            struct Handles {
+                const DflHW::Device::Queue  AssignedQueue{ };
+                const DflGen::BitFlag       Capabilities{ 0 }; // of the queue's family
+                const VkCommandPool         hCmdPool{ nullptr };
+                const VkCommandBuffer       hCmdBuffer{ nullptr };
+                const VkFence               hFence{ nullptr };
+
+                const VkShaderModule        hModule{ nullptr };
+                const VkDescriptorSetLayout hSetLayout{ nullptr };
+                const VkPipelineLayout      hLayout{ nullptr };
+                const VkPipeline            hPipeline{ nullptr };
+
+                const VkDescriptorPool      hDescriptorPool{ nullptr };
+                const VkDescriptorSet       hSet{ nullptr };
+
+                const bool                  CanDispatch{ false }; // the device can index storage images in a loop
+            };
+
+            // How the 2x2 texels of a level become 1 texel of the next
+            enum class Filter : uint32_t {
+                Average = 0,
+                Min = 1, // e.g. for hierarchical depth
+                Max = 2,
+                Nearest = 3 // the top left texel
+            };
+
+            enum class Error {
+                Success = 0,
+                RecordError = -1,
+                SubmitError = -2,
+                CapabilityError = -3, // the image can't be dispatched on, and the queue can't blit
+                OwnershipError = -4 // the image belongs to another family
+            };
+
+            using Image = Buffer<StorageType::Image>;
+
+        protected:
+            const std::unique_ptr<const Info> pInfo{ nullptr };
+
+            const Handles                     Program{ };
+            const DflMem::GenericBuffer       Counters;
+
+                  bool                        IsDispatchable(const Image& image) const noexcept;
+                  void                        RecordDispatch(
+                                                const Image&                image,
+                                                const std::vector<
+                                                        VkImageView>&       views,
+                                                const Filter                filter,
+                                                      Transitions&          transitions) const noexcept;
+                  void                        RecordBlits(
+                                                const Image&                image,
+                                                const Filter                filter,
+                                                      Transitions&          transitions) const noexcept;
+        public:
+            DFL_API DFL_CALL Downsampler(const Info& info);
+            DFL_API DFL_CALL ~Downsampler();
+
+            const DflHW::Device::Queue& GetQueue() const noexcept {
+                                            return this->Program.AssignedQueue; }
+
+            // Overwrites every level of the image past the first. The image has
+            // to belong to the downsampler's family, or be shared with it. Its
+            // levels are left in whatever layout the work needed, which the
+            // image tracks. The blits can only average (or take the nearest
+            // texel), so other filters need the dispatch.
+            DFL_API
+                  DflGen::Job<Error>
+            DFL_CALL                    Generate(
+                                            const Image&  image,
+                                            const Filter  filter = Filter::Average);
+        };
+    }
+    namespace DflMem = Dfl::Memory;
+}
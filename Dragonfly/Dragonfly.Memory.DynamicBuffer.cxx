@@ -0,0 +1,259 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Dragonfly.Memory.DynamicBuffer.hxx"
+
+#include <algorithm>
+#include <optional>
+
+namespace DflHW = Dfl::Hardware;
+namespace DflMem = Dfl::Memory;
+namespace DflGen = Dfl::Generics;
+
+// Internal for DynamicBuffer
+
+// Host visible and coherent memory of a type in typeBits, so writes need no
+// flushing; uncached types are tried first, since the host only writes
+template< DflHW::Device::MemoryType type >
+static inline std::optional<uint64_t> INT_BorrowMappedMemory(
+          DflHW::Device&  device,
+          VkDeviceMemory& memory,
+    const uint64_t        size,
+    const uint32_t        typeBits)
+{
+    const auto& heaps{ [&]() -> const auto& {
+                          if constexpr (type == DflHW::Device::MemoryType::Local) { return device.GetCharacteristics().LocalHeaps; }
+                          else { return device.GetCharacteristics().SharedHeaps; } }() };
+    for (const bool isHostCached : { false, true })
+    {
+        for (uint64_t heapIndex{ 0 }; heapIndex < heaps.size(); heapIndex++)
+        {
+            for (const auto& property : heaps[heapIndex].MemProperties)
+            {
+                if ( !(typeBits & (1u << property.TypeIndex))
+                     || !property.IsHostVisible
+                     || !property.IsHostCoherent
+                     || property.IsHostCached != isHostCached )
+                {
+                    continue;
+                }
+
+                memory = device.BorrowMemory<type>(
+                            heapIndex,
+                            property.TypeIndex,
+                            size);
+                if (memory != nullptr) { return heapIndex; }
+            }
+        }
+    }
+
+    return std::nullopt;
+}
+
+// Dynamic offsets have to be multiples of the device's alignment for the
+// kind of buffer they bind
+static inline uint64_t INT_GetStride(
+          DflHW::Device&                    device,
+    const DflMem::DynamicBuffer::Info&      info)
+{
+    VkPhysicalDeviceProperties properties{ };
+    vkGetPhysicalDeviceProperties(
+        device.GetPhysicalDevice(),
+        &properties);
+
+    uint64_t alignment{ 1 };
+    if (info.Options & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+    {
+        alignment = std::max<uint64_t>(alignment, properties.limits.minUniformBufferOffsetAlignment);
+    }
+    if (info.Options & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+    {
+        alignment = std::max<uint64_t>(alignment, properties.limits.minStorageBufferOffsetAlignment);
+    }
+
+    return ( (info.Size + alignment - 1) / alignment ) * alignment;
+}
+
+static DflMem::DynamicBuffer::Handles INT_GetHandles(
+          DflHW::Device&                    device,
+    const DflMem::DynamicBuffer::Info&      info)
+{
+    if ( info.Size == 0
+         || info.Frames == 0 )
+    {
+        throw Dfl::Error::Limit(
+                L"Dynamic buffer has no copies to write",
+                L"INT_GetHandles",
+                Dfl::API::None);
+    }
+
+    const VkDevice gpu{ device.GetDevice() };
+    const uint64_t stride{ INT_GetStride(device, info) };
+    if (stride * (info.Frames - 1) > UINT32_MAX)
+    {
+        throw Dfl::Error::Limit(
+                L"Dynamic offsets of the copies don't fit in 32 bits",
+                L"INT_GetHandles",
+                Dfl::API::None);
+    }
+
+    const bool isShared{ info.AccessingQueueFamilies.size() > 1 };
+    const VkBufferCreateInfo bufInfo{
+        .sType{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .size{ stride * info.Frames },
+        .usage{ info.Options },
+        .sharingMode{ isShared ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE },
+        .queueFamilyIndexCount{ isShared ? static_cast<uint32_t>(info.AccessingQueueFamilies.size()) : 0 },
+        .pQueueFamilyIndices{ isShared ? info.AccessingQueueFamilies.data() : nullptr }
+    };
+    VkBuffer buffer{ nullptr };
+    if ( vkCreateBuffer(
+            gpu,
+            &bufInfo,
+            nullptr,
+            &buffer) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create the dynamic buffer",
+                L"INT_GetHandles");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(
+        gpu,
+        buffer,
+        &requirements);
+
+    // local memory the host can see (UMA, or resizable BAR) is read fastest
+    // by the device, so it's tried before shared memory
+    VkDeviceMemory memory{ nullptr };
+    DflHW::Device::MemoryType memoryType{ DflHW::Device::MemoryType::Local };
+    std::optional<uint64_t> heapIndex{ INT_BorrowMappedMemory<DflHW::Device::MemoryType::Local>(
+                                            device,
+                                            memory,
+                                            requirements.size,
+                                            requirements.memoryTypeBits) };
+    if (!heapIndex.has_value())
+    {
+        memoryType = DflHW::Device::MemoryType::Shared;
+        heapIndex = INT_BorrowMappedMemory<DflHW::Device::MemoryType::Shared>(
+                        device,
+                        memory,
+                        requirements.size,
+                        requirements.memoryTypeBits);
+    }
+    if (!heapIndex.has_value())
+    {
+        vkDestroyBuffer(gpu, buffer, nullptr);
+        throw Dfl::Error::Limit(
+                L"Unable to find host visible memory of a type the dynamic buffer can use",
+                L"INT_GetHandles",
+                Dfl::API::None);
+    }
+
+    void* pMap{ nullptr };
+    if ( vkBindBufferMemory(gpu, buffer, memory, 0) != VK_SUCCESS
+         || vkMapMemory(gpu, memory, 0, VK_WHOLE_SIZE, 0, &pMap) != VK_SUCCESS )
+    {
+        if (memoryType == DflHW::Device::MemoryType::Shared)
+        {
+            device.ReturnMemory<DflHW::Device::MemoryType::Shared>(memory, heapIndex.value(), requirements.size);
+        }
+        else
+        {
+            device.ReturnMemory<DflHW::Device::MemoryType::Local>(memory, heapIndex.value(), requirements.size);
+        }
+        vkDestroyBuffer(gpu, buffer, nullptr);
+        throw Dfl::Error::HandleCreation(
+                L"Unable to bind or map the dynamic buffer's memory",
+                L"INT_GetHandles");
+    }
+
+    return { buffer, memory, memoryType, heapIndex.value(), requirements.size, static_cast<std::byte*>(pMap), stride };
+}
+
+// Dragonfly.Memory.DynamicBuffer
+
+DflMem::DynamicBuffer::DynamicBuffer(const Info& info)
+: pInfo( new Info(info) ),
+  Buffers( INT_GetHandles(
+             info.Device,
+             info) )
+{ }
+
+DflMem::DynamicBuffer::~DynamicBuffer()
+{
+    vkDestroyBuffer(
+        this->pInfo->Device.GetDevice(),
+        this->Buffers.hBuffer,
+        nullptr);
+
+    // freeing mapped memory unmaps it
+    if (this->Buffers.HeapType == DflHW::Device::MemoryType::Shared)
+    {
+        this->pInfo->Device.ReturnMemory<DflHW::Device::MemoryType::Shared>(
+            this->Buffers.hMemory,
+            this->Buffers.HeapIndex,
+            this->Buffers.Size);
+    }
+    else
+    {
+        this->pInfo->Device.ReturnMemory<DflHW::Device::MemoryType::Local>(
+            this->Buffers.hMemory,
+            this->Buffers.HeapIndex,
+            this->Buffers.Size);
+    }
+}
+
+std::vector<VkDescriptorBufferInfo> DflMem::DynamicBuffer::GetDescriptors() const noexcept
+{
+    std::vector<VkDescriptorBufferInfo> descriptors(this->pInfo->Frames);
+    for (uint32_t frame{ 0 }; frame < this->pInfo->Frames; frame++)
+    {
+        descriptors[frame] = {
+            .buffer{ this->Buffers.hBuffer },
+            .offset{ frame * this->Buffers.Stride },
+            .range{ this->pInfo->Size } };
+    }
+
+    return descriptors;
+}
+
+auto DflMem::DynamicBuffer::Write(
+    const std::span<const std::byte> source,
+    const uint64_t                   offset) noexcept
+-> Error
+{
+    if ( offset > this->pInfo->Size
+         || source.size() > this->pInfo->Size - offset ) [[ unlikely ]]
+    {
+        return Error::RangeError;
+    }
+
+    DflMem::Copier::ToMapped(
+        this->Buffers.pMap + this->Frame * this->Buffers.Stride + offset,
+        source.data(),
+        source.size());
+
+    if (this->pInfo->pProfiler != nullptr)
+    {
+        this->pInfo->pProfiler->Count(DflHW::Profiler::Counter::BytesUploaded, source.size());
+    }
+
+    return Error::Success;
+}
@@ -0,0 +1,140 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <span>
+#include <cstddef>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "Dragonfly.h"
+
+#include "Dragonfly.Generics.hxx"
+#include "Dragonfly.Hardware.Device.hxx"
+#include "Dragonfly.Hardware.Profiler.hxx"
+#include "Dragonfly.Memory.Copier.hxx"
+
+namespace Dfl {
+    // Dragonfly.Memory
+    namespace Memory {
+        // Dragonfly.Memory.DynamicBuffer
+        // A buffer whose contents change every frame, e.g. camera data or
+        // instance transforms. It holds a copy per frame in flight, in memory
+        // that stays mapped and coherent, so the host writes the copy of the
+        // next frame while the device reads that of the current one, without
+        // staging, flushing or waiting on anything.
+        // The copy of a frame can be written once the device is done with the
+        // frame that used it before, which the renderer's fence of that frame
+        // already ensures, so frames have to be at least as many as the
+        // renderer has in flight, and the buffer has to follow its frame index.
+        // Shaders reach the copy of a frame through a dynamic offset, or
+        // through a descriptor of every copy in a bindless array.
+        class DynamicBuffer {
+        public:
+            struct Info {
+                      DflHW::Device&        Device;
+
+                const std::vector<uint32_t> AccessingQueueFamilies; // families that read the buffer
+                const uint64_t              Size{ 0 }; // in B, of a frame's copy
+                const uint32_t              Frames{ 2 }; // copies, as many as frames in flight
+
+                const DflGen::BitFlag       Options{ VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT };
+
+                      DflHW::Profiler*      pProfiler{ nullptr }; // if not null, written bytes are counted
+            };
+
+            struct Handles {
+                const VkBuffer                  hBuffer{ nullptr };
+                const VkDeviceMemory            hMemory{ nullptr };
+                const DflHW::Device::MemoryType HeapType{ DflHW::Device::MemoryType::Local };
+                const uint64_t                  HeapIndex{ 0 };
+                const uint64_t                  Size{ 0 }; // of the memory
+                      std::byte* const          pMap{ nullptr };
+                const uint64_t                  Stride{ 0 }; // between copies, aligned for dynamic offsets
+
+                operator const VkBuffer() { return this->hBuffer; }
+            };
+
+            enum class Error {
+                Success = 0,
+                RangeError = -1 // the write goes past the end of the copy
+            };
+
+        protected:
+            const std::unique_ptr<const Info> pInfo{ nullptr };
+
+            const Handles                     Buffers{ };
+
+                  uint32_t                    Frame{ 0 };
+        public:
+            DFL_API DFL_CALL DynamicBuffer(const Info& info);
+            DFL_API DFL_CALL ~DynamicBuffer();
+
+            const VkBuffer           GetBuffer() const noexcept {
+                                        return this->Buffers.hBuffer; }
+            const uint64_t           GetSize() const noexcept {
+                                        return this->pInfo->Size; }
+            const uint64_t           GetStride() const noexcept {
+                                        return this->Buffers.Stride; }
+            // The copy that writes go to
+            const uint32_t           GetFrame() const noexcept {
+                                        return this->Frame; }
+            // To bind the buffer with, for a descriptor of type
+            // UNIFORM_BUFFER_DYNAMIC or STORAGE_BUFFER_DYNAMIC whose range is
+            // the size of a copy
+            const uint32_t           GetDynamicOffset() const noexcept {
+                                        return static_cast<uint32_t>(this->Frame * this->Buffers.Stride); }
+            // The current copy, to write in place
+            const std::span<std::byte> GetMap() const noexcept {
+                                        return { this->Buffers.pMap + this->Frame * this->Buffers.Stride, this->pInfo->Size }; }
+
+            // Moves writes to the copy of frame, e.g. the renderer's frame index,
+            // wrapping around the copies
+                  void               SetFrame(const uint64_t frame) noexcept {
+                                        this->Frame = static_cast<uint32_t>(frame % this->pInfo->Frames); }
+            // Moves writes to the next copy, and returns its index
+                  uint32_t           Advance() noexcept {
+                                        this->Frame = (this->Frame + 1) % this->pInfo->Frames;
+                                        return this->Frame; }
+
+            // Descriptors of every copy, in order, e.g. for consecutive elements of
+            // a bindless array, of which the frame's is the first plus GetFrame()
+            DFL_API
+                  std::vector<VkDescriptorBufferInfo>
+            DFL_CALL                 GetDescriptors() const noexcept;
+
+            // Copies source to [offset, offset + source's size) of the current copy
+            DFL_API
+                  Error
+            DFL_CALL                 Write(
+                                        const std::span<const std::byte> source,
+                                        const uint64_t                   offset) noexcept;
+
+            template< Dfl::Generics::Complete T >
+                  Error              Write(
+                                        const T&       source,
+                                        const uint64_t offset) noexcept {
+                                        return this->Write(
+                                                std::span<const std::byte>(reinterpret_cast<const std::byte*>(&source), sizeof(T)),
+                                                offset); }
+        };
+    }
+    namespace DflMem = Dfl::Memory;
+}
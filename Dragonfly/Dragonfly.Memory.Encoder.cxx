@@ -0,0 +1,872 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Dragonfly.Memory.Encoder.hxx"
+
+#include <algorithm>
+#include <array>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <intrin.h>
+#include <immintrin.h>
+
+namespace DflHW = Dfl::Hardware;
+namespace DflMem = Dfl::Memory;
+
+// Internal for Encoder
+
+// The 16 texels of a block, RGBA8, row after row
+using INT_Texels = std::array<uint8_t, 64>;
+
+// The parts of encoding a block every texel goes through. The nearest
+// palette entry is by squared distance over all 4 channels, so channels
+// that don't matter have to be the same (e.g. 0) in texels and palette.
+struct INT_Kernels {
+    void (*GetBounds)(
+            const uint8_t* pTexels,
+                  uint8_t* pMin,
+                  uint8_t* pMax);
+    void (*GetNearest)(
+            const uint8_t* pTexels,
+            const uint8_t* pPalette,
+            const uint32_t count,
+                  uint8_t* pIndices);
+};
+
+static void INT_GetBoundsScalar(
+    const uint8_t* pTexels,
+          uint8_t* pMin,
+          uint8_t* pMax)
+{
+    for (uint32_t c{ 0 }; c < 4; c++)
+    {
+        pMin[c] = 255;
+        pMax[c] = 0;
+    }
+    for (uint32_t i{ 0 }; i < 16; i++)
+    {
+        for (uint32_t c{ 0 }; c < 4; c++)
+        {
+            pMin[c] = std::min(pMin[c], pTexels[4 * i + c]);
+            pMax[c] = std::max(pMax[c], pTexels[4 * i + c]);
+        }
+    }
+}
+
+static void INT_GetNearestScalar(
+    const uint8_t* pTexels,
+    const uint8_t* pPalette,
+    const uint32_t count,
+          uint8_t* pIndices)
+{
+    for (uint32_t i{ 0 }; i < 16; i++)
+    {
+        uint32_t best{ std::numeric_limits<uint32_t>::max() };
+        for (uint32_t j{ 0 }; j < count; j++)
+        {
+            uint32_t distance{ 0 };
+            for (uint32_t c{ 0 }; c < 4; c++)
+            {
+                const int32_t difference{ pTexels[4 * i + c] - pPalette[4 * j + c] };
+                distance += difference * difference;
+            }
+            if (distance < best)
+            {
+                best = distance;
+                pIndices[i] = static_cast<uint8_t>(j);
+            }
+        }
+    }
+}
+
+static void INT_GetBoundsSSE41(
+    const uint8_t* pTexels,
+          uint8_t* pMin,
+          uint8_t* pMax)
+{
+    const __m128i* pRows{ reinterpret_cast<const __m128i*>(pTexels) };
+
+    __m128i min{ _mm_loadu_si128(pRows) };
+    __m128i max{ min };
+    for (uint32_t i{ 1 }; i < 4; i++)
+    {
+        const __m128i row{ _mm_loadu_si128(pRows + i) };
+        min = _mm_min_epu8(min, row);
+        max = _mm_max_epu8(max, row);
+    }
+
+    // the 4 texels of the register fold onto the first one
+    min = _mm_min_epu8(min, _mm_srli_si128(min, 8));
+    min = _mm_min_epu8(min, _mm_srli_si128(min, 4));
+    max = _mm_max_epu8(max, _mm_srli_si128(max, 8));
+    max = _mm_max_epu8(max, _mm_srli_si128(max, 4));
+
+    const int32_t minTexel{ _mm_cvtsi128_si32(min) };
+    const int32_t maxTexel{ _mm_cvtsi128_si32(max) };
+    std::memcpy(pMin, &minTexel, 4);
+    std::memcpy(pMax, &maxTexel, 4);
+}
+
+// 4 texels at a time, widened to 16 bits, so a multiply-add of the differences
+// and a horizontal add give the 4 distances
+static void INT_GetNearestSSE41(
+    const uint8_t* pTexels,
+    const uint8_t* pPalette,
+    const uint32_t count,
+          uint8_t* pIndices)
+{
+    for (uint32_t i{ 0 }; i < 16; i += 4)
+    {
+        const __m128i texels{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(pTexels + 4 * i)) };
+        const __m128i low{ _mm_cvtepu8_epi16(texels) };
+        const __m128i high{ _mm_cvtepu8_epi16(_mm_srli_si128(texels, 8)) };
+
+        __m128i best{ _mm_set1_epi32(std::numeric_limits<int32_t>::max()) };
+        __m128i bestIndex{ _mm_setzero_si128() };
+        for (uint32_t j{ 0 }; j < count; j++)
+        {
+            int32_t colour{ 0 };
+            std::memcpy(&colour, pPalette + 4 * j, 4);
+            const __m128i entry{ _mm_cvtepu8_epi16(_mm_set1_epi32(colour)) };
+
+            const __m128i lowDifference{ _mm_sub_epi16(low, entry) };
+            const __m128i highDifference{ _mm_sub_epi16(high, entry) };
+            const __m128i distance{ _mm_hadd_epi32(
+                                        _mm_madd_epi16(lowDifference, lowDifference),
+                                        _mm_madd_epi16(highDifference, highDifference)) };
+
+            const __m128i isCloser{ _mm_cmpgt_epi32(best, distance) };
+            best = _mm_min_epi32(best, distance);
+            bestIndex = _mm_blendv_epi8(bestIndex, _mm_set1_epi32(static_cast<int32_t>(j)), isCloser);
+        }
+
+        const __m128i indices{ _mm_packus_epi16(
+                                _mm_packus_epi32(bestIndex, bestIndex),
+                                _mm_setzero_si128()) };
+        const int32_t packed{ _mm_cvtsi128_si32(indices) };
+        std::memcpy(pIndices + i, &packed, 4);
+    }
+}
+
+static void INT_GetBoundsAVX2(
+    const uint8_t* pTexels,
+          uint8_t* pMin,
+          uint8_t* pMax)
+{
+    const __m256i* pRows{ reinterpret_cast<const __m256i*>(pTexels) };
+
+    const __m256i first{ _mm256_loadu_si256(pRows) };
+    const __m256i second{ _mm256_loadu_si256(pRows + 1) };
+    const __m256i wideMin{ _mm256_min_epu8(first, second) };
+    const __m256i wideMax{ _mm256_max_epu8(first, second) };
+
+    __m128i min{ _mm_min_epu8(_mm256_castsi256_si128(wideMin), _mm256_extracti128_si256(wideMin, 1)) };
+    __m128i max{ _mm_max_epu8(_mm256_castsi256_si128(wideMax), _mm256_extracti128_si256(wideMax, 1)) };
+    min = _mm_min_epu8(min, _mm_srli_si128(min, 8));
+    min = _mm_min_epu8(min, _mm_srli_si128(min, 4));
+    max = _mm_max_epu8(max, _mm_srli_si128(max, 8));
+    max = _mm_max_epu8(max, _mm_srli_si128(max, 4));
+
+    const int32_t minTexel{ _mm_cvtsi128_si32(min) };
+    const int32_t maxTexel{ _mm_cvtsi128_si32(max) };
+    std::memcpy(pMin, &minTexel, 4);
+    std::memcpy(pMax, &maxTexel, 4);
+}
+
+// 8 texels at a time. The horizontal add works within 128 bit lanes, so the
+// distances come out as texels 0, 1, 4, 5 | 2, 3, 6, 7 and the indices are
+// put back in order at the end.
+static void INT_GetNearestAVX2(
+    const uint8_t* pTexels,
+    const uint8_t* pPalette,
+    const uint32_t count,
+          uint8_t* pIndices)
+{
+    for (uint32_t i{ 0 }; i < 16; i += 8)
+    {
+        const __m256i texels{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pTexels + 4 * i)) };
+        const __m256i low{ _mm256_cvtepu8_epi16(_mm256_castsi256_si128(texels)) };
+        const __m256i high{ _mm256_cvtepu8_epi16(_mm256_extracti128_si256(texels, 1)) };
+
+        __m256i best{ _mm256_set1_epi32(std::numeric_limits<int32_t>::max()) };
+        __m256i bestIndex{ _mm256_setzero_si256() };
+        for (uint32_t j{ 0 }; j < count; j++)
+        {
+            int32_t colour{ 0 };
+            std::memcpy(&colour, pPalette + 4 * j, 4);
+            const __m256i entry{ _mm256_cvtepu8_epi16(_mm_set1_epi32(colour)) };
+
+            const __m256i lowDifference{ _mm256_sub_epi16(low, entry) };
+            const __m256i highDifference{ _mm256_sub_epi16(high, entry) };
+            const __m256i distance{ _mm256_hadd_epi32(
+                                        _mm256_madd_epi16(lowDifference, lowDifference),
+                                        _mm256_madd_epi16(highDifference, highDifference)) };
+
+            const __m256i isCloser{ _mm256_cmpgt_epi32(best, distance) };
+            best = _mm256_min_epi32(best, distance);
+            bestIndex = _mm256_blendv_epi8(bestIndex, _mm256_set1_epi32(static_cast<int32_t>(j)), isCloser);
+        }
+
+        bestIndex = _mm256_permute4x64_epi64(bestIndex, _MM_SHUFFLE(3, 1, 2, 0));
+        const __m128i words{ _mm_packus_epi32(
+                                _mm256_castsi256_si128(bestIndex),
+                                _mm256_extracti128_si256(bestIndex, 1)) };
+        _mm_storel_epi64(
+            reinterpret_cast<__m128i*>(pIndices + i),
+            _mm_packus_epi16(words, words));
+    }
+}
+
+// AVX registers also need the system to save them on context switches
+static DflMem::Encoder::Kernel INT_GetKernel(const DflMem::Encoder::Kernel maxKernel)
+{
+    std::array<int, 4> registers{ };
+    __cpuid(registers.data(), 0);
+    const int leaves{ registers[0] };
+
+    __cpuid(registers.data(), 1);
+    const bool hasSSE41{ (registers[2] & (1 << 19)) != 0 };
+    const bool hasAVX{ (registers[2] & (1 << 27)) != 0
+                       && (registers[2] & (1 << 28)) != 0
+                       && (_xgetbv(0) & 0x6) == 0x6 };
+
+    bool hasAVX2{ false };
+    if ( leaves >= 7
+         && hasAVX )
+    {
+        __cpuidex(registers.data(), 7, 0);
+        hasAVX2 = (registers[1] & (1 << 5)) != 0;
+    }
+
+    if ( hasAVX2
+         && maxKernel == DflMem::Encoder::Kernel::AVX2 )
+    {
+        return DflMem::Encoder::Kernel::AVX2;
+    }
+    if ( hasSSE41
+         && maxKernel != DflMem::Encoder::Kernel::Scalar )
+    {
+        return DflMem::Encoder::Kernel::SSE41;
+    }
+    return DflMem::Encoder::Kernel::Scalar;
+}
+
+static INT_Kernels INT_GetKernels(const DflMem::Encoder::Kernel kernel)
+{
+    switch (kernel)
+    {
+    case DflMem::Encoder::Kernel::AVX2:
+        return { INT_GetBoundsAVX2, INT_GetNearestAVX2 };
+    case DflMem::Encoder::Kernel::SSE41:
+        return { INT_GetBoundsSSE41, INT_GetNearestSSE41 };
+    default:
+        return { INT_GetBoundsScalar, INT_GetNearestScalar };
+    }
+}
+
+// The block at (x, y), in blocks. Past the edges of the image, the last
+// row and column are repeated.
+static void INT_GetBlock(
+    const uint8_t*    pSource,
+    const uint32_t    width,
+    const uint32_t    height,
+    const uint32_t    x,
+    const uint32_t    y,
+          INT_Texels& texels)
+{
+    for (uint32_t row{ 0 }; row < 4; row++)
+    {
+        const uint8_t* pRow{ pSource + 4ull * std::min(4 * y + row, height - 1) * width };
+        if (4 * x + 4 <= width)
+        {
+            std::memcpy(texels.data() + 16 * row, pRow + 16ull * x, 16);
+            continue;
+        }
+        for (uint32_t column{ 0 }; column < 4; column++)
+        {
+            std::memcpy(
+                texels.data() + 16 * row + 4 * column,
+                pRow + 4ull * std::min(4 * x + column, width - 1),
+                4);
+        }
+    }
+}
+
+// The diagonal of the bounding box that follows the texels: every channel goes
+// from its minimum to its maximum, unless it falls as the widest one rises.
+// Both ends are moved in by 1/16 of the range, since the texels rarely sit on
+// the corners.
+static void INT_GetEndpoints(
+    const INT_Texels& texels,
+    const uint8_t*    pMin,
+    const uint8_t*    pMax,
+    const uint32_t    channels,
+          uint8_t*    pStart,
+          uint8_t*    pEnd)
+{
+    uint32_t widest{ 0 };
+    std::array<int32_t, 4> sums{ 0, 0, 0, 0 };
+    for (uint32_t c{ 0 }; c < channels; c++)
+    {
+        if (pMax[c] - pMin[c] > pMax[widest] - pMin[widest]) { widest = c; }
+        for (uint32_t i{ 0 }; i < 16; i++) { sums[c] += texels[4 * i + c]; }
+    }
+
+    for (uint32_t c{ 0 }; c < channels; c++)
+    {
+        int64_t covariance{ 0 };
+        for (uint32_t i{ 0 }; i < 16; i++)
+        {
+            covariance += static_cast<int64_t>(16 * texels[4 * i + widest] - sums[widest])
+                          * (16 * texels[4 * i + c] - sums[c]);
+        }
+
+        const uint8_t inset{ static_cast<uint8_t>((pMax[c] - pMin[c]) >> 4) };
+        const uint8_t low{ static_cast<uint8_t>(pMin[c] + inset) };
+        const uint8_t high{ static_cast<uint8_t>(pMax[c] - inset) };
+        pStart[c] = covariance < 0 ? high : low;
+        pEnd[c] = covariance < 0 ? low : high;
+    }
+}
+
+static uint16_t INT_To565(const uint8_t* pColour)
+{
+    return static_cast<uint16_t>( ((pColour[0] * 31 + 127) / 255) << 11
+                                  | ((pColour[1] * 63 + 127) / 255) << 5
+                                  | ((pColour[2] * 31 + 127) / 255) );
+}
+
+static void INT_From565(
+    const uint16_t colour,
+          uint8_t* pColour)
+{
+    const uint32_t red{ static_cast<uint32_t>(colour >> 11) & 31 };
+    const uint32_t green{ static_cast<uint32_t>(colour >> 5) & 63 };
+    const uint32_t blue{ static_cast<uint32_t>(colour) & 31 };
+    pColour[0] = static_cast<uint8_t>(red << 3 | red >> 2);
+    pColour[1] = static_cast<uint8_t>(green << 2 | green >> 4);
+    pColour[2] = static_cast<uint8_t>(blue << 3 | blue >> 2);
+    pColour[3] = 255;
+}
+
+// The 4 colours of a BC1 block. Blocks with the first endpoint at most the
+// second have 3 colours and black; BC3's colour blocks always have 4.
+static void INT_GetBC1Palette(
+    const uint16_t colour0,
+    const uint16_t colour1,
+    const bool     hasFourColours,
+          uint8_t* pPalette)
+{
+    INT_From565(colour0, pPalette);
+    INT_From565(colour1, pPalette + 4);
+    for (uint32_t c{ 0 }; c < 3; c++)
+    {
+        const uint32_t first{ pPalette[c] };
+        const uint32_t second{ pPalette[4 + c] };
+        if (hasFourColours)
+        {
+            pPalette[8 + c] = static_cast<uint8_t>((2 * first + second) / 3);
+            pPalette[12 + c] = static_cast<uint8_t>((first + 2 * second) / 3);
+        }
+        else
+        {
+            pPalette[8 + c] = static_cast<uint8_t>((first + second) / 2);
+            pPalette[12 + c] = 0;
+        }
+    }
+    pPalette[11] = 255;
+    pPalette[15] = hasFourColours ? 255 : 0;
+}
+
+// The 8 values of a BC4 block. Blocks with the first endpoint at most the
+// second have 6 and then 0 and 255.
+static void INT_GetBC4Palette(
+    const uint8_t  value0,
+    const uint8_t  value1,
+          uint8_t* pPalette)
+{
+    pPalette[0] = value0;
+    pPalette[1] = value1;
+    if (value0 > value1)
+    {
+        for (uint32_t i{ 1 }; i < 7; i++)
+        {
+            pPalette[i + 1] = static_cast<uint8_t>(((7 - i) * value0 + i * value1 + 3) / 7);
+        }
+        return;
+    }
+    for (uint32_t i{ 1 }; i < 5; i++)
+    {
+        pPalette[i + 1] = static_cast<uint8_t>(((5 - i) * value0 + i * value1 + 2) / 5);
+    }
+    pPalette[6] = 0;
+    pPalette[7] = 255;
+}
+
+static constexpr std::array<uint32_t, 16> INT_BC7Weights{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static void INT_GetBC7Palette(
+    const uint8_t* pStart,
+    const uint8_t* pEnd,
+          uint8_t* pPalette)
+{
+    for (uint32_t i{ 0 }; i < 16; i++)
+    {
+        for (uint32_t c{ 0 }; c < 4; c++)
+        {
+            pPalette[4 * i + c] = static_cast<uint8_t>(
+                                    ((64 - INT_BC7Weights[i]) * pStart[c] + INT_BC7Weights[i] * pEnd[c] + 32) >> 6);
+        }
+    }
+}
+
+static void INT_EncodeBC1(
+    const INT_Kernels& kernels,
+    const INT_Texels&  texels,
+    const uint8_t*     pMin,
+    const uint8_t*     pMax,
+          uint8_t*     pBlock)
+{
+    std::array<uint8_t, 4> start{ };
+    std::array<uint8_t, 4> end{ };
+    INT_GetEndpoints(texels, pMin, pMax, 3, start.data(), end.data());
+
+    // the larger endpoint goes first, so the block has 4 colours
+    uint16_t colour0{ INT_To565(start.data()) };
+    uint16_t colour1{ INT_To565(end.data()) };
+    if (colour0 < colour1) { std::swap(colour0, colour1); }
+
+    std::array<uint8_t, 16> indices{ };
+    if (colour0 != colour1)
+    {
+        std::array<uint8_t, 16> palette{ };
+        INT_GetBC1Palette(colour0, colour1, true, palette.data());
+
+        // alpha isn't kept, so it's left out of the distances
+        INT_Texels colours{ texels };
+        for (uint32_t i{ 0 }; i < 16; i++) { colours[4 * i + 3] = 0; }
+        for (uint32_t i{ 0 }; i < 4; i++) { palette[4 * i + 3] = 0; }
+        kernels.GetNearest(colours.data(), palette.data(), 4, indices.data());
+    }
+
+    uint32_t bits{ 0 };
+    for (uint32_t i{ 0 }; i < 16; i++) { bits |= static_cast<uint32_t>(indices[i]) << (2 * i); }
+    std::memcpy(pBlock, &colour0, 2);
+    std::memcpy(pBlock + 2, &colour1, 2);
+    std::memcpy(pBlock + 4, &bits, 4);
+}
+
+// A single channel of the texels. Its minimum and maximum are the endpoints,
+// largest first, so the block has 8 values.
+static void INT_EncodeBC4(
+    const INT_Kernels& kernels,
+    const INT_Texels&  texels,
+    const uint32_t     channel,
+    const uint8_t*     pMin,
+    const uint8_t*     pMax,
+          uint8_t*     pBlock)
+{
+    const uint8_t value0{ pMax[channel] };
+    const uint8_t value1{ pMin[channel] };
+
+    std::array<uint8_t, 16> indices{ };
+    if (value0 != value1)
+    {
+        // the values are compared as the first channel of otherwise black texels
+        std::array<uint8_t, 32> palette{ };
+        std::array<uint8_t, 8> values{ };
+        INT_GetBC4Palette(value0, value1, values.data());
+        for (uint32_t i{ 0 }; i < 8; i++) { palette[4 * i] = values[i]; }
+
+        INT_Texels channelTexels{ };
+        for (uint32_t i{ 0 }; i < 16; i++) { channelTexels[4 * i] = texels[4 * i + channel]; }
+        kernels.GetNearest(channelTexels.data(), palette.data(), 8, indices.data());
+    }
+
+    uint64_t bits{ 0 };
+    for (uint32_t i{ 0 }; i < 16; i++) { bits |= static_cast<uint64_t>(indices[i]) << (3 * i); }
+    pBlock[0] = value0;
+    pBlock[1] = value1;
+    std::memcpy(pBlock + 2, &bits, 6);
+}
+
+// Mode 6: a single pair of RGBA endpoints of 7 bits per channel, each with
+// its own lowest bit, and 4 bit indices
+static void INT_EncodeBC7(
+    const INT_Kernels& kernels,
+    const INT_Texels&  texels,
+    const uint8_t*     pMin,
+    const uint8_t*     pMax,
+          uint8_t*     pBlock)
+{
+    std::array<std::array<uint8_t, 4>, 2> endpoints{ };
+    INT_GetEndpoints(texels, pMin, pMax, 4, endpoints[0].data(), endpoints[1].data());
+
+    // each endpoint takes the lowest bit that moves it the least
+    std::array<std::array<uint8_t, 4>, 2> quantised{ };
+    std::array<uint32_t, 2> lowestBits{ 0, 0 };
+    for (uint32_t e{ 0 }; e < 2; e++)
+    {
+        uint32_t bestError{ std::numeric_limits<uint32_t>::max() };
+        for (uint32_t bit{ 0 }; bit < 2; bit++)
+        {
+            std::array<uint8_t, 4> values{ };
+            uint32_t error{ 0 };
+            for (uint32_t c{ 0 }; c < 4; c++)
+            {
+                values[c] = static_cast<uint8_t>(std::min<uint32_t>((endpoints[e][c] + 1 - bit) >> 1, 127));
+                const int32_t difference{ static_cast<int32_t>(values[c] << 1 | bit) - endpoints[e][c] };
+                error += difference * difference;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                quantised[e] = values;
+                lowestBits[e] = bit;
+            }
+        }
+    }
+
+    std::array<std::array<uint8_t, 4>, 2> expanded{ };
+    for (uint32_t e{ 0 }; e < 2; e++)
+    {
+        for (uint32_t c{ 0 }; c < 4; c++)
+        {
+            expanded[e][c] = static_cast<uint8_t>(quantised[e][c] << 1 | lowestBits[e]);
+        }
+    }
+
+    std::array<uint8_t, 64> palette{ };
+    INT_GetBC7Palette(expanded[0].data(), expanded[1].data(), palette.data());
+    std::array<uint8_t, 16> indices{ };
+    kernels.GetNearest(texels.data(), palette.data(), 16, indices.data());
+
+    // the first index is stored without its highest bit, which has to be 0
+    if (indices[0] >= 8)
+    {
+        std::swap(quantised[0], quantised[1]);
+        std::swap(lowestBits[0], lowestBits[1]);
+        for (auto& index : indices) { index = static_cast<uint8_t>(15 - index); }
+    }
+
+    std::array<uint64_t, 2> bits{ 0, 0 };
+    uint32_t offset{ 0 };
+    const auto write{ [&bits, &offset](const uint64_t value, const uint32_t count) {
+        bits[offset / 64] |= value << (offset % 64);
+        if (offset % 64 + count > 64) { bits[offset / 64 + 1] |= value >> (64 - offset % 64); }
+        offset += count; } };
+
+    write(1 << 6, 7);
+    for (uint32_t c{ 0 }; c < 4; c++)
+    {
+        write(quantised[0][c], 7);
+        write(quantised[1][c], 7);
+    }
+    write(lowestBits[0], 1);
+    write(lowestBits[1], 1);
+    write(indices[0], 3);
+    for (uint32_t i{ 1 }; i < 16; i++) { write(indices[i], 4); }
+
+    std::memcpy(pBlock, bits.data(), 16);
+}
+
+static void INT_EncodeRows(
+    const INT_Kernels&                   kernels,
+    const DflMem::Encoder::Format        format,
+    const uint8_t*                       pSource,
+    const uint32_t                       width,
+    const uint32_t                       height,
+    const uint32_t                       firstRow,
+    const uint32_t                       lastRow,
+          uint8_t*                       pDestination)
+{
+    const uint32_t blocksWide{ (width + 3) / 4 };
+    const uint32_t blockSize{ DflMem::Encoder::GetBlockSize(format) };
+
+    INT_Texels texels{ };
+    std::array<uint8_t, 4> min{ };
+    std::array<uint8_t, 4> max{ };
+    for (uint32_t y{ firstRow }; y < lastRow; y++)
+    {
+        for (uint32_t x{ 0 }; x < blocksWide; x++)
+        {
+            uint8_t* pBlock{ pDestination + (static_cast<uint64_t>(y) * blocksWide + x) * blockSize };
+
+            INT_GetBlock(pSource, width, height, x, y, texels);
+            kernels.GetBounds(texels.data(), min.data(), max.data());
+            switch (format)
+            {
+            case DflMem::Encoder::Format::BC1:
+                INT_EncodeBC1(kernels, texels, min.data(), max.data(), pBlock);
+                break;
+            case DflMem::Encoder::Format::BC3:
+                INT_EncodeBC4(kernels, texels, 3, min.data(), max.data(), pBlock);
+                INT_EncodeBC1(kernels, texels, min.data(), max.data(), pBlock + 8);
+                break;
+            case DflMem::Encoder::Format::BC5:
+                INT_EncodeBC4(kernels, texels, 0, min.data(), max.data(), pBlock);
+                INT_EncodeBC4(kernels, texels, 1, min.data(), max.data(), pBlock + 8);
+                break;
+            case DflMem::Encoder::Format::BC7:
+                INT_EncodeBC7(kernels, texels, min.data(), max.data(), pBlock);
+                break;
+            }
+        }
+    }
+}
+
+static void INT_DecodeBC1(
+    const uint8_t*    pBlock,
+    const bool        isColourOfBC3,
+          INT_Texels& texels)
+{
+    uint16_t colour0{ 0 };
+    uint16_t colour1{ 0 };
+    uint32_t bits{ 0 };
+    std::memcpy(&colour0, pBlock, 2);
+    std::memcpy(&colour1, pBlock + 2, 2);
+    std::memcpy(&bits, pBlock + 4, 4);
+
+    std::array<uint8_t, 16> palette{ };
+    INT_GetBC1Palette(colour0, colour1, isColourOfBC3 || colour0 > colour1, palette.data());
+    for (uint32_t i{ 0 }; i < 16; i++)
+    {
+        std::memcpy(texels.data() + 4 * i, palette.data() + 4 * ((bits >> (2 * i)) & 3), 3);
+    }
+}
+
+static void INT_DecodeBC4(
+    const uint8_t*    pBlock,
+    const uint32_t    channel,
+          INT_Texels& texels)
+{
+    uint64_t bits{ 0 };
+    std::memcpy(&bits, pBlock + 2, 6);
+
+    std::array<uint8_t, 8> palette{ };
+    INT_GetBC4Palette(pBlock[0], pBlock[1], palette.data());
+    for (uint32_t i{ 0 }; i < 16; i++)
+    {
+        texels[4 * i + channel] = palette[(bits >> (3 * i)) & 7];
+    }
+}
+
+// Only mode 6 blocks, the ones the encoder writes. The rest decode to black.
+static void INT_DecodeBC7(
+    const uint8_t*    pBlock,
+          INT_Texels& texels)
+{
+    std::array<uint64_t, 2> bits{ 0, 0 };
+    std::memcpy(bits.data(), pBlock, 16);
+    uint32_t offset{ 0 };
+    const auto read{ [&bits, &offset](const uint32_t count) {
+        uint64_t value{ bits[offset / 64] >> (offset % 64) };
+        if (offset % 64 + count > 64) { value |= bits[offset / 64 + 1] << (64 - offset % 64); }
+        offset += count;
+        return static_cast<uint32_t>(value & ((1ull << count) - 1)); } };
+
+    texels.fill(0);
+    if (read(7) != 1 << 6) { return; }
+
+    std::array<std::array<uint8_t, 4>, 2> endpoints{ };
+    for (uint32_t c{ 0 }; c < 4; c++)
+    {
+        endpoints[0][c] = static_cast<uint8_t>(read(7) << 1);
+        endpoints[1][c] = static_cast<uint8_t>(read(7) << 1);
+    }
+    for (uint32_t e{ 0 }; e < 2; e++)
+    {
+        const uint32_t bit{ read(1) };
+        for (auto& value : endpoints[e]) { value = static_cast<uint8_t>(value | bit); }
+    }
+
+    std::array<uint8_t, 64> palette{ };
+    INT_GetBC7Palette(endpoints[0].data(), endpoints[1].data(), palette.data());
+    for (uint32_t i{ 0 }; i < 16; i++)
+    {
+        const uint32_t index{ read(i == 0 ? 3 : 4) };
+        std::memcpy(texels.data() + 4 * i, palette.data() + 4 * index, 4);
+    }
+}
+
+// Dragonfly.Memory.Encoder
+
+DflMem::Encoder::Encoder(const Info& info)
+: pInfo( new Info(info) ),
+  ChosenKernel( INT_GetKernel(info.MaxKernel) ),
+  WorkersNumber( info.WorkersNumber != 0
+                    ? info.WorkersNumber
+                    : std::max(std::thread::hardware_concurrency(), 1u) )
+{
+}
+
+DflMem::Encoder::~Encoder()
+{
+}
+
+std::vector<std::byte> DflMem::Encoder::Encode(
+    const std::span<const std::byte> source,
+    const uint32_t                   width,
+    const uint32_t                   height,
+    const Format                     format)
+{
+    DflHW::Profiler::CPUZone zone(this->pInfo->pProfiler, "Encoder::Encode");
+
+    if ( width == 0
+         || height == 0
+         || source.size() < 4ull * width * height ) [[ unlikely ]]
+    {
+        return { };
+    }
+
+    const auto start{ std::chrono::steady_clock::now() };
+
+    const uint32_t blocksHigh{ (height + 3) / 4 };
+    std::vector<std::byte> encoded(static_cast<uint64_t>((width + 3) / 4) * blocksHigh * GetBlockSize(format));
+
+    const INT_Kernels kernels{ INT_GetKernels(this->ChosenKernel) };
+    const uint8_t* pSource{ reinterpret_cast<const uint8_t*>(source.data()) };
+    uint8_t* pDestination{ reinterpret_cast<uint8_t*>(encoded.data()) };
+
+    // every worker gets whole rows of blocks, so no two write next to each other.
+    // This thread takes the first share.
+    const uint32_t workersNumber{ std::min(this->WorkersNumber, blocksHigh) };
+    {
+        std::vector<std::jthread> workers{ };
+        workers.reserve(workersNumber - 1);
+        for (uint32_t i{ 1 }; i < workersNumber; i++)
+        {
+            workers.emplace_back(
+                INT_EncodeRows,
+                std::cref(kernels),
+                format,
+                pSource,
+                width,
+                height,
+                static_cast<uint32_t>(static_cast<uint64_t>(blocksHigh) * i / workersNumber),
+                static_cast<uint32_t>(static_cast<uint64_t>(blocksHigh) * (i + 1) / workersNumber),
+                pDestination);
+        }
+        INT_EncodeRows(
+            kernels,
+            format,
+            pSource,
+            width,
+            height,
+            0,
+            blocksHigh / workersNumber,
+            pDestination);
+    }
+
+    this->LastEncode = { .Texels{ static_cast<uint64_t>(width) * height },
+                         .Seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() } };
+
+    return encoded;
+}
+
+VkFormat DflMem::Encoder::GetFormat(const Format format) noexcept
+{
+    switch (format)
+    {
+    case Format::BC1:
+        return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    case Format::BC3:
+        return VK_FORMAT_BC3_UNORM_BLOCK;
+    case Format::BC5:
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+    case Format::BC7:
+        return VK_FORMAT_BC7_UNORM_BLOCK;
+    default:
+        return VK_FORMAT_UNDEFINED;
+    }
+}
+
+uint32_t DflMem::Encoder::GetBlockSize(const Format format) noexcept
+{
+    return format == Format::BC1 ? 8 : 16;
+}
+
+double DflMem::Encoder::GetPSNR(
+    const std::span<const std::byte> original,
+    const std::span<const std::byte> encoded,
+    const uint32_t                   width,
+    const uint32_t                   height,
+    const Format                     format) noexcept
+{
+    const uint32_t blocksWide{ (width + 3) / 4 };
+    const uint32_t blocksHigh{ (height + 3) / 4 };
+    if ( width == 0
+         || height == 0
+         || original.size() < 4ull * width * height
+         || encoded.size() < static_cast<uint64_t>(blocksWide) * blocksHigh * GetBlockSize(format) ) [[ unlikely ]]
+    {
+        return 0;
+    }
+
+    const uint32_t channels{ format == Format::BC1 ? 3u : (format == Format::BC5 ? 2u : 4u) };
+    const uint8_t* pOriginal{ reinterpret_cast<const uint8_t*>(original.data()) };
+
+    uint64_t squaredError{ 0 };
+    INT_Texels texels{ };
+    for (uint32_t y{ 0 }; y < blocksHigh; y++)
+    {
+        for (uint32_t x{ 0 }; x < blocksWide; x++)
+        {
+            const uint8_t* pBlock{ reinterpret_cast<const uint8_t*>(encoded.data())
+                                   + (static_cast<uint64_t>(y) * blocksWide + x) * GetBlockSize(format) };
+            switch (format)
+            {
+            case Format::BC1:
+                INT_DecodeBC1(pBlock, false, texels);
+                break;
+            case Format::BC3:
+                INT_DecodeBC4(pBlock, 3, texels);
+                INT_DecodeBC1(pBlock + 8, true, texels);
+                break;
+            case Format::BC5:
+                INT_DecodeBC4(pBlock, 0, texels);
+                INT_DecodeBC4(pBlock + 8, 1, texels);
+                break;
+            case Format::BC7:
+                INT_DecodeBC7(pBlock, texels);
+                break;
+            }
+
+            // the repeated texels past the edges don't count
+            for (uint32_t row{ 0 }; row < 4 && 4 * y + row < height; row++)
+            {
+                for (uint32_t column{ 0 }; column < 4 && 4 * x + column < width; column++)
+                {
+                    const uint8_t* pTexel{ pOriginal + 4 * ((4ull * y + row) * width + 4 * x + column) };
+                    for (uint32_t c{ 0 }; c < channels; c++)
+                    {
+                        const int32_t difference{ pTexel[c] - texels[16 * row + 4 * column + c] };
+                        squaredError += difference * difference;
+                    }
+                }
+            }
+        }
+    }
+
+    if (squaredError == 0) { return std::numeric_limits<double>::infinity(); }
+
+    const double meanError{ static_cast<double>(squaredError) / (static_cast<double>(width) * height * channels) };
+    return 10 * std::log10(255.0 * 255.0 / meanError);
+}
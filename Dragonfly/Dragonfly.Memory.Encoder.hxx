@@ -0,0 +1,125 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <span>
+#include <cstddef>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "Dragonfly.h"
+
+#include "Dragonfly.Hardware.Profiler.hxx"
+
+namespace Dfl {
+    // Dragonfly.Memory
+    namespace Memory {
+        // Dragonfly.Memory.Encoder
+        // Compresses RGBA8 images to BC1, BC3, BC5 or BC7 on the host, when
+        // they're loaded. Rows of blocks are split between threads, and each
+        // block goes through the widest kernel the processor has (AVX2, then
+        // SSE4.1, then plain C++). The output is the blocks, row after row,
+        // tightly packed, as Buffer<StorageType::Image>::Write and Stream::Load
+        // expect them for an image of the matching format.
+        // The encoder favours speed: endpoints come from the block's bounding
+        // box, and BC7 blocks are always in mode 6.
+        class Encoder {
+        public:
+            enum class Kernel {
+                Scalar = 0,
+                SSE41 = 1,
+                AVX2 = 2
+            };
+
+            struct Info {
+                const uint32_t          WorkersNumber{ 0 }; // threads encoding an image. If 0, the processor count is used
+                const Kernel            MaxKernel{ Kernel::AVX2 }; // the widest kernel to use, even if the processor has wider ones
+
+                      DflHW::Profiler*  pProfiler{ nullptr }; // if not null, encoding is timed
+            };
+
+            enum class Format {
+                BC1 = 0, // RGB, 8 B per block
+                BC3 = 1, // RGBA, 16 B per block
+                BC5 = 2, // RG, 16 B per block
+                BC7 = 3 // RGBA, 16 B per block
+            };
+
+            struct Statistics {
+                uint64_t Texels{ 0 };
+                double   Seconds{ 0 };
+
+                double   GetThroughput() const noexcept { // in MPixels/s
+                            return this->Seconds > 0 ? this->Texels / (this->Seconds * 1e6) : 0; }
+            };
+
+        protected:
+            const std::unique_ptr<const Info> pInfo{ nullptr };
+
+            const Kernel                      ChosenKernel{ Kernel::Scalar };
+            const uint32_t                    WorkersNumber{ 1 };
+
+                  Statistics                  LastEncode{ };
+        public:
+            DFL_API DFL_CALL Encoder(const Info& info);
+            DFL_API DFL_CALL ~Encoder();
+
+            const Kernel             GetKernel() const noexcept {
+                                        return this->ChosenKernel; }
+            const Statistics&        GetStatistics() const noexcept {
+                                        return this->LastEncode; }
+
+            // The texels of source are RGBA8, row after row. Widths and heights that
+            // aren't multiples of 4 have their last row and column repeated. If source
+            // is smaller than width * height texels, nothing is encoded and the
+            // result is empty.
+            DFL_API
+                  std::vector<std::byte>
+            DFL_CALL                 Encode(
+                                        const std::span<const std::byte> source,
+                                        const uint32_t                   width,
+                                        const uint32_t                   height,
+                                        const Format                     format);
+
+            // The UNORM format images of the encoded blocks should have
+            DFL_API
+            static
+                  VkFormat
+            DFL_CALL                 GetFormat(const Format format) noexcept;
+            DFL_API
+            static
+                  uint32_t
+            DFL_CALL                 GetBlockSize(const Format format) noexcept;
+            // The peak signal to noise ratio, in dB, of the encoded image against
+            // the original, over the channels the format keeps. Identical images
+            // give infinity.
+            DFL_API
+            static
+                  double
+            DFL_CALL                 GetPSNR(
+                                        const std::span<const std::byte> original,
+                                        const std::span<const std::byte> encoded,
+                                        const uint32_t                   width,
+                                        const uint32_t                   height,
+                                        const Format                     format) noexcept;
+        };
+    }
+    namespace DflMem = Dfl::Memory;
+}
@@ -0,0 +1,688 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Dragonfly.Memory.Stream.hxx"
+
+#include <algorithm>
+#include <optional>
+#include <chrono>
+#include <cstring>
+
+namespace DflHW = Dfl::Hardware;
+namespace DflMem = Dfl::Memory;
+namespace DflGen = Dfl::Generics;
+
+// Internal for Stream
+
+static DflMem::Stream::Handles INT_MapFile(const std::filesystem::path& path)
+{
+    // sequential scanning makes the system read further ahead on its own
+    const HANDLE file{ CreateFileW(
+                        path.c_str(),
+                        GENERIC_READ,
+                        FILE_SHARE_READ,
+                        nullptr,
+                        OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                        nullptr) };
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw Dfl::Error::System(
+                L"Unable to open the file to stream",
+                L"INT_MapFile",
+                Dfl::API::Win32);
+    }
+
+    LARGE_INTEGER size{ };
+    if ( !GetFileSizeEx(file, &size)
+         || size.QuadPart == 0 )
+    {
+        CloseHandle(file);
+        throw Dfl::Error::NoData(
+                L"Unable to stream an empty file",
+                L"INT_MapFile",
+                Dfl::API::Win32);
+    }
+
+    const HANDLE mapping{ CreateFileMappingW(
+                            file,
+                            nullptr,
+                            PAGE_READONLY,
+                            0,
+                            0,
+                            nullptr) };
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create a mapping of the file",
+                L"INT_MapFile",
+                Dfl::API::Win32);
+    }
+
+    const void* view{ MapViewOfFile(
+                        mapping,
+                        FILE_MAP_READ,
+                        0,
+                        0,
+                        0) };
+    if (view == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw Dfl::Error::HandleCreation(
+                L"Unable to map the file",
+                L"INT_MapFile",
+                Dfl::API::Win32);
+    }
+
+    return { file, mapping,
+             static_cast<const char*>(view), static_cast<uint64_t>(size.QuadPart) };
+}
+
+// The ring is host visible memory, coherent so that chunks need no flushing.
+// Shared memory is preferred, though UMA devices may only have local heaps.
+template< DflHW::Device::MemoryType type >
+static inline std::optional<uint64_t> INT_BorrowRingMemory(
+          DflHW::Device&  device,
+          VkDeviceMemory& memory,
+    const uint64_t        size)
+{
+    const uint64_t heapCount{ type == DflHW::Device::MemoryType::Local
+                                ? device.GetCharacteristics().LocalHeaps.size()
+                                : device.GetCharacteristics().SharedHeaps.size() };
+    for (const bool isHostCached : { false, true })
+    {
+        for (uint64_t heapIndex{ 0 }; heapIndex < heapCount; heapIndex++)
+        {
+            memory = device.BorrowMemory<type>(
+                        heapIndex,
+                        true,
+                        isHostCached,
+                        true,
+                        false,
+                        size);
+            if (memory != nullptr) { return heapIndex; }
+        }
+    }
+
+    return std::nullopt;
+}
+
+static DflMem::Stream::Ring INT_GetRing(
+          DflHW::Device& device,
+    const uint64_t       chunkSize,
+    const uint32_t       chunksInFlight)
+{
+    const VkDevice gpu{ device.GetDevice() };
+
+    const DflHW::Device::Queue queue{ device.BorrowQueue(DflHW::Device::Queue::Type::Transfer) };
+    if (queue.hQueue == nullptr)
+    {
+        throw Dfl::Error::NoData(
+                L"Unable to find a transfer queue for the stream",
+                L"INT_GetRing",
+                Dfl::API::None);
+    }
+
+    const VkBufferCreateInfo bufInfo{
+        .sType{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .size{ chunkSize * chunksInFlight },
+        .usage{ VK_BUFFER_USAGE_TRANSFER_SRC_BIT },
+        .sharingMode{ VK_SHARING_MODE_EXCLUSIVE },
+        .queueFamilyIndexCount{ 0 },
+        .pQueueFamilyIndices{ nullptr }
+    };
+    VkBuffer buffer{ nullptr };
+    if ( vkCreateBuffer(
+            gpu,
+            &bufInfo,
+            nullptr,
+            &buffer) != VK_SUCCESS )
+    {
+        device.ReturnQueue(queue);
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create the staging ring",
+                L"INT_GetRing");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(
+        gpu,
+        buffer,
+        &requirements);
+
+    VkDeviceMemory memory{ nullptr };
+    DflHW::Device::MemoryType memoryType{ DflHW::Device::MemoryType::Shared };
+    std::optional<uint64_t> heapIndex{ INT_BorrowRingMemory<DflHW::Device::MemoryType::Shared>(
+                                            device,
+                                            memory,
+                                            requirements.size) };
+    if (!heapIndex.has_value())
+    {
+        memoryType = DflHW::Device::MemoryType::Local;
+        heapIndex = INT_BorrowRingMemory<DflHW::Device::MemoryType::Local>(
+                        device,
+                        memory,
+                        requirements.size);
+    }
+
+    void* pMap{ nullptr };
+    if ( !heapIndex.has_value()
+         || vkBindBufferMemory(gpu, buffer, memory, 0) != VK_SUCCESS
+         || vkMapMemory(gpu, memory, 0, VK_WHOLE_SIZE, 0, &pMap) != VK_SUCCESS )
+    {
+        if (heapIndex.has_value())
+        {
+            if (memoryType == DflHW::Device::MemoryType::Shared)
+            {
+                device.ReturnMemory<DflHW::Device::MemoryType::Shared>(memory, heapIndex.value(), requirements.size);
+            }
+            else
+            {
+                device.ReturnMemory<DflHW::Device::MemoryType::Local>(memory, heapIndex.value(), requirements.size);
+            }
+        }
+        vkDestroyBuffer(gpu, buffer, nullptr);
+        device.ReturnQueue(queue);
+        throw Dfl::Error::HandleCreation(
+                L"Unable to get host visible memory for the staging ring",
+                L"INT_GetRing");
+    }
+
+    const VkCommandPoolCreateInfo cmdPoolInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT },
+        .queueFamilyIndex{ queue.FamilyIndex }
+    };
+    VkCommandPool cmdPool{ nullptr };
+    std::vector<VkCommandBuffer> cmdBuffers(chunksInFlight);
+    std::vector<VkFence> fences(chunksInFlight, nullptr);
+    if ( vkCreateCommandPool(
+            gpu,
+            &cmdPoolInfo,
+            nullptr,
+            &cmdPool) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create command pool for the stream",
+                L"INT_GetRing");
+    }
+
+    const VkCommandBufferAllocateInfo cmdBuffInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO },
+        .pNext{ nullptr },
+        .commandPool{ cmdPool },
+        .level{ VK_COMMAND_BUFFER_LEVEL_PRIMARY },
+        .commandBufferCount{ chunksInFlight }
+    };
+    if ( vkAllocateCommandBuffers(
+            gpu,
+            &cmdBuffInfo,
+            cmdBuffers.data()) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to allocate command buffers for the stream",
+                L"INT_GetRing");
+    }
+
+    // signaled, since every slot starts out free
+    const VkFenceCreateInfo fenceInfo{
+        .sType{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ VK_FENCE_CREATE_SIGNALED_BIT }
+    };
+    for (auto& fence : fences)
+    {
+        if ( vkCreateFence(
+                gpu,
+                &fenceInfo,
+                nullptr,
+                &fence) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create fences for the stream",
+                    L"INT_GetRing");
+        }
+    }
+
+    return { buffer, memory, memoryType, heapIndex.value(), requirements.size, static_cast<char*>(pMap),
+             queue, cmdPool, cmdBuffers, fences };
+}
+
+static inline bool INT_BeginChunk(const VkCommandBuffer& cmdBuff)
+{
+    const VkCommandBufferBeginInfo cmdInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO },
+        .pNext{ nullptr },
+        .flags{ VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT },
+        .pInheritanceInfo{ nullptr }
+    };
+    return vkResetCommandBuffer(cmdBuff, 0) == VK_SUCCESS
+           && vkBeginCommandBuffer(cmdBuff, &cmdInfo) == VK_SUCCESS;
+}
+
+// Dragonfly.Memory.Stream
+
+DflMem::Stream::Stream(const Info& info)
+: pInfo( new Info(info) ),
+  File( INT_MapFile(info.File) ),
+  Staging( INT_GetRing(
+            info.Device,
+            info.ChunkSize,
+            std::max(info.ChunksInFlight, 1u)) )
+{
+}
+
+DflMem::Stream::~Stream()
+{
+    const VkDevice gpu{ this->pInfo->Device.GetDevice() };
+
+    vkWaitForFences(
+        gpu,
+        static_cast<uint32_t>(this->Staging.Fences.size()),
+        this->Staging.Fences.data(),
+        VK_TRUE,
+        UINT64_MAX);
+
+    for (const auto& fence : this->Staging.Fences)
+    {
+        vkDestroyFence(gpu, fence, nullptr);
+    }
+    vkDestroyCommandPool(gpu, this->Staging.hCmdPool, nullptr);
+    this->pInfo->Device.ReturnQueue(this->Staging.TransferQueue);
+
+    vkDestroyBuffer(gpu, this->Staging.hBuffer, nullptr);
+    vkUnmapMemory(gpu, this->Staging.hMemory);
+    if (this->Staging.HeapType == DflHW::Device::MemoryType::Shared)
+    {
+        this->pInfo->Device.ReturnMemory<DflHW::Device::MemoryType::Shared>(
+                                this->Staging.hMemory,
+                                this->Staging.HeapIndex,
+                                this->Staging.Size);
+    }
+    else
+    {
+        this->pInfo->Device.ReturnMemory<DflHW::Device::MemoryType::Local>(
+                                this->Staging.hMemory,
+                                this->Staging.HeapIndex,
+                                this->Staging.Size);
+    }
+
+    UnmapViewOfFile(this->File.pView);
+    CloseHandle(this->File.hMapping);
+    CloseHandle(this->File.hFile);
+}
+
+void DflMem::Stream::Prefetch(
+    const uint64_t offset,
+    const uint64_t size) const noexcept
+{
+    if (offset >= this->File.FileSize) { return; }
+
+    // the system reads the pages in the background, so they're
+    // resident by the time the chunk is copied to the ring
+    WIN32_MEMORY_RANGE_ENTRY range{
+        .VirtualAddress{ const_cast<char*>(this->File.pView) + offset },
+        .NumberOfBytes{ static_cast<SIZE_T>(std::min(size, this->File.FileSize - offset)) }
+    };
+    PrefetchVirtualMemory(
+        GetCurrentProcess(),
+        1,
+        &range,
+        0);
+}
+
+void DflMem::Stream::Stage(
+    const uint64_t chunk,
+    const uint64_t fileOffset,
+    const uint64_t size) const noexcept
+{
+    const uint64_t slot{ chunk % this->Staging.Fences.size() };
+
+    // the pages of the chunks after the ring are fetched while this one is copied
+    this->Prefetch(
+        fileOffset + this->Staging.Fences.size() * this->pInfo->ChunkSize,
+        this->pInfo->ChunkSize);
+
+    DflMem::Copier::ToMapped(
+        this->Staging.pMap + slot * this->pInfo->ChunkSize,
+        this->File.pView + fileOffset,
+        size);
+}
+
+VkResult DflMem::Stream::Submit(const uint64_t chunk) const noexcept
+{
+    const uint64_t slot{ chunk % this->Staging.Fences.size() };
+
+    const VkSubmitInfo submitInfo{
+        .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO },
+        .pNext{ nullptr },
+        .waitSemaphoreCount{ 0 },
+        .pWaitSemaphores{ nullptr },
+        .pWaitDstStageMask{ nullptr },
+        .commandBufferCount{ 1 },
+        .pCommandBuffers{ &this->Staging.CmdBuffers[slot] },
+        .signalSemaphoreCount{ 0 },
+        .pSignalSemaphores{ nullptr }
+    };
+
+    vkResetFences(
+        this->pInfo->Device.GetDevice(),
+        1,
+        &this->Staging.Fences[slot]);
+    const VkResult result{ vkQueueSubmit(
+                                this->Staging.TransferQueue,
+                                1,
+                                &submitInfo,
+                                this->Staging.Fences[slot]) };
+    // the fence still has to be signaled, or the slot would never be free again
+    if (result != VK_SUCCESS)
+    {
+        vkQueueSubmit(
+            this->Staging.TransferQueue,
+            0,
+            nullptr,
+            this->Staging.Fences[slot]);
+    }
+
+    return result;
+}
+
+auto DflMem::Stream::Load(
+    const GenericBuffer& destination,
+    const uint64_t       fileOffset,
+    const uint64_t       dstOffset,
+    const uint64_t       size)
+-> DflGen::Job<Error>
+{
+    if ( fileOffset + size > this->File.FileSize
+         || dstOffset + size > destination.GetSize() ) [[ unlikely ]]
+    {
+        co_return Error::FileError;
+    }
+
+    if ( destination.IsExclusive()
+         && destination.GetFamily() != this->GetFamily() ) [[ unlikely ]]
+    {
+        co_return Error::OwnershipError;
+    }
+
+    if (this->IsLoading.exchange(true)) [[ unlikely ]]
+    {
+        co_return Error::BusyError;
+    }
+
+    const VkDevice gpu{ this->pInfo->Device.GetDevice() };
+    const auto start{ std::chrono::steady_clock::now() };
+
+    this->Prefetch(fileOffset, this->Staging.Fences.size() * this->pInfo->ChunkSize);
+
+    Error error{ Error::Success };
+    const uint64_t chunkCount{ (size + this->pInfo->ChunkSize - 1) / this->pInfo->ChunkSize };
+    for (uint64_t chunk{ 0 }; chunk < chunkCount && error == Error::Success; chunk++)
+    {
+        const uint64_t slot{ chunk % this->Staging.Fences.size() };
+        const uint64_t offset{ chunk * this->pInfo->ChunkSize };
+        const uint64_t chunkSize{ std::min(this->pInfo->ChunkSize, size - offset) };
+
+        // the slot is free once the device is done with its previous chunk
+        while (vkGetFenceStatus(gpu, this->Staging.Fences[slot]) == VK_NOT_READY)
+        {
+            co_await DflGen::Job<Error>::Awaitable(
+                gpu,
+                this->Staging.Fences[slot]);
+        }
+
+        const VkCommandBuffer& cmdBuff{ this->Staging.CmdBuffers[slot] };
+        if (!INT_BeginChunk(cmdBuff))
+        {
+            error = Error::RecordError;
+            break;
+        }
+
+        {
+            DflHW::Profiler::Zone zone(
+                                    this->pInfo->pProfiler,
+                                    cmdBuff,
+                                    this->Staging.TransferQueue.FamilyIndex,
+                                    "Stream::Load");
+
+            const VkBufferCopy copyRegion{
+                .srcOffset{ slot * this->pInfo->ChunkSize },
+                .dstOffset{ dstOffset + offset },
+                .size{ chunkSize }
+            };
+            vkCmdCopyBuffer(
+                cmdBuff,
+                this->Staging.hBuffer,
+                destination.GetBuffer(),
+                1,
+                &copyRegion);
+        }
+
+        if (vkEndCommandBuffer(cmdBuff) != VK_SUCCESS)
+        {
+            if (this->pInfo->pProfiler != nullptr)
+            {
+                this->pInfo->pProfiler->Discard(cmdBuff);
+            }
+            error = Error::RecordError;
+            break;
+        }
+
+        this->Stage(chunk, fileOffset + offset, chunkSize);
+        if (this->Submit(chunk) != VK_SUCCESS)
+        {
+            if (this->pInfo->pProfiler != nullptr)
+            {
+                this->pInfo->pProfiler->Discard(cmdBuff);
+            }
+            error = Error::SubmitError;
+            break;
+        }
+
+        if (this->pInfo->pProfiler != nullptr)
+        {
+            this->pInfo->pProfiler->Count(DflHW::Profiler::Counter::BytesUploaded, chunkSize);
+        }
+    }
+
+    for (const auto& fence : this->Staging.Fences)
+    {
+        while (vkGetFenceStatus(gpu, fence) == VK_NOT_READY)
+        {
+            co_await DflGen::Job<Error>::Awaitable(
+                gpu,
+                fence);
+        }
+    }
+
+    if (error == Error::Success)
+    {
+        this->LastLoad = { .Bytes{ size },
+                           .Seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() } };
+    }
+    this->IsLoading = false;
+
+    co_return error;
+}
+
+auto DflMem::Stream::Load(
+    const Buffer<StorageType::Image>& destination,
+    const uint64_t                    fileOffset,
+    const uint32_t                    dstArrayLayer)
+-> DflGen::Job<Error>
+{
+    // a chunk is as many whole rows of texel blocks of a slice as fit in it;
+    // a row of blocks is a row of texels, unless the image is compressed
+    const std::array<uint32_t, 3>& extent{ destination.GetSize() };
+    const Buffer<StorageType::Image>::TexelBlock& block{ destination.GetTexelBlock() };
+    const uint32_t width{ std::max(extent[0], 1u) };
+    const uint32_t height{ std::max(extent[1], 1u) };
+    const uint32_t depth{ std::max(extent[2], 1u) };
+    const uint32_t blockRows{ (height + block.Height - 1) / block.Height };
+    const uint64_t rowSize{ block.GetCopySize({ width, 1, 1 }) };
+    const uint64_t size{ block.GetCopySize(extent) };
+    const uint32_t rowsPerChunk{ static_cast<uint32_t>(std::min<uint64_t>(this->pInfo->ChunkSize / rowSize, blockRows)) };
+
+    if ( fileOffset + size > this->File.FileSize
+         || rowsPerChunk == 0 ) [[ unlikely ]]
+    {
+        co_return Error::FileError;
+    }
+
+    if (this->IsLoading.exchange(true)) [[ unlikely ]]
+    {
+        co_return Error::BusyError;
+    }
+
+    const VkDevice gpu{ this->pInfo->Device.GetDevice() };
+    const auto start{ std::chrono::steady_clock::now() };
+
+    this->Prefetch(fileOffset, this->Staging.Fences.size() * this->pInfo->ChunkSize);
+
+    DflMem::Transitions transitions{ };
+    Error error{ Error::Success };
+    uint64_t chunk{ 0 };
+    uint64_t offset{ 0 };
+    for (uint32_t z{ 0 }; z < depth && error == Error::Success; z++)
+    {
+        for (uint32_t y{ 0 }; y < blockRows; y += rowsPerChunk, chunk++)
+        {
+            const uint64_t slot{ chunk % this->Staging.Fences.size() };
+            const uint32_t rows{ std::min(rowsPerChunk, blockRows - y) };
+            // the last rows of blocks may go past the edge, which copies allow
+            const uint32_t texelY{ y * block.Height };
+            const uint32_t texelRows{ std::min(rows * block.Height, height - texelY) };
+
+            while (vkGetFenceStatus(gpu, this->Staging.Fences[slot]) == VK_NOT_READY)
+            {
+                co_await DflGen::Job<Error>::Awaitable(
+                    gpu,
+                    this->Staging.Fences[slot]);
+            }
+
+            const VkCommandBuffer& cmdBuff{ this->Staging.CmdBuffers[slot] };
+            if (!INT_BeginChunk(cmdBuff))
+            {
+                error = Error::RecordError;
+                break;
+            }
+
+            {
+                DflHW::Profiler::Zone zone(
+                                        this->pInfo->pProfiler,
+                                        cmdBuff,
+                                        this->Staging.TransferQueue.FamilyIndex,
+                                        "Stream::Load");
+
+                // the whole level is overwritten, so whatever it held is discarded.
+                // The chunks write rows of their own, so they don't wait for each other.
+                if (chunk == 0)
+                {
+                    transitions
+                        .Use(
+                            destination,
+                            { .Layout{ VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL },
+                              .Stages{ VK_PIPELINE_STAGE_2_COPY_BIT },
+                              .Access{ VK_ACCESS_2_TRANSFER_WRITE_BIT } },
+                            { .Levels{ 1 }, .BaseLayer{ dstArrayLayer }, .Layers{ 1 } },
+                            true)
+                        .Record(
+                            cmdBuff,
+                            this->pInfo->pProfiler);
+                }
+
+                const VkBufferImageCopy copyRegion{
+                    .bufferOffset{ slot * this->pInfo->ChunkSize },
+                    .bufferRowLength{ 0 },
+                    .bufferImageHeight{ 0 },
+                    .imageSubresource{
+                        .aspectMask{ VK_IMAGE_ASPECT_COLOR_BIT },
+                        .mipLevel{ 0 },
+                        .baseArrayLayer{ dstArrayLayer },
+                        .layerCount{ 1 } },
+                    .imageOffset{ VkOffset3D{ 0, static_cast<int32_t>(texelY), static_cast<int32_t>(z) } },
+                    .imageExtent{ VkExtent3D{ width, texelRows, 1 } }
+                };
+                vkCmdCopyBufferToImage(
+                    cmdBuff,
+                    this->Staging.hBuffer,
+                    destination.GetImage(),
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    1,
+                    &copyRegion);
+            }
+
+            if (vkEndCommandBuffer(cmdBuff) != VK_SUCCESS)
+            {
+                if (this->pInfo->pProfiler != nullptr)
+                {
+                    this->pInfo->pProfiler->Discard(cmdBuff);
+                }
+                error = Error::RecordError;
+                break;
+            }
+
+            this->Stage(chunk, fileOffset + offset, rows * rowSize);
+            if (this->Submit(chunk) != VK_SUCCESS)
+            {
+                if (this->pInfo->pProfiler != nullptr)
+                {
+                    this->pInfo->pProfiler->Discard(cmdBuff);
+                }
+                error = Error::SubmitError;
+                break;
+            }
+
+            if (this->pInfo->pProfiler != nullptr)
+            {
+                this->pInfo->pProfiler->Count(DflHW::Profiler::Counter::BytesUploaded, rows * rowSize);
+            }
+            offset += rows * rowSize;
+        }
+    }
+
+    // the transition only happens if the first chunk is submitted
+    if ( error != Error::Success
+         && chunk == 0 )
+    {
+        transitions.Revert();
+    }
+
+    for (const auto& fence : this->Staging.Fences)
+    {
+        while (vkGetFenceStatus(gpu, fence) == VK_NOT_READY)
+        {
+            co_await DflGen::Job<Error>::Awaitable(
+                gpu,
+                fence);
+        }
+    }
+
+    if (error == Error::Success)
+    {
+        this->LastLoad = { .Bytes{ size },
+                           .Seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() } };
+    }
+    this->IsLoading = false;
+
+    co_return error;
+}
@@ -0,0 +1,149 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <filesystem>
+
+#include <Windows.h>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "Dragonfly.h"
+
+#include "Dragonfly.Generics.hxx"
+#include "Dragonfly.Hardware.Device.hxx"
+#include "Dragonfly.Hardware.Profiler.hxx"
+#include "Dragonfly.Memory.Buffer.hxx"
+#include "Dragonfly.Memory.Transitions.hxx"
+
+namespace Dfl {
+    // Dragonfly.Memory
+    namespace Memory {
+        // Dragonfly.Memory.Stream
+        // Loads a file into buffers and images without reading it into memory first.
+        // The file is mapped, and its pages are prefetched ahead of the chunk being
+        // copied to a ring of staging memory, while the chunks before it are copied
+        // to the destination by the device. At most ChunksInFlight chunks are in the
+        // ring at once, which bounds the memory a load takes, however large the file.
+        class Stream {
+        public:
+            struct Info {
+                      DflHW::Device&        Device;
+                const std::filesystem::path File;
+
+                const uint64_t              ChunkSize{ 4 * 1024 * 1024 }; // in B
+                const uint32_t              ChunksInFlight{ 4 };
+
+                      DflHW::Profiler*      pProfiler{ nullptr }; // if not null, chunk copies are timed
+            };
+
+            struct Handles {
+                const HANDLE                       hFile{ nullptr };
+                const HANDLE                       hMapping{ nullptr };
+                const char*                        pView{ nullptr };
+                const uint64_t                     FileSize{ 0 };
+            };
+
+            struct Ring {
+                const VkBuffer                     hBuffer{ nullptr };
+                const VkDeviceMemory               hMemory{ nullptr };
+                const DflHW::Device::MemoryType    HeapType{ DflHW::Device::MemoryType::Shared };
+                const uint64_t                     HeapIndex{ 0 };
+                const uint64_t                     Size{ 0 };
+                      char* const                  pMap{ nullptr };
+
+                const DflHW::Device::Queue         TransferQueue{ };
+                const VkCommandPool                hCmdPool{ nullptr };
+                const std::vector<VkCommandBuffer> CmdBuffers{ }; // one per chunk in flight
+                const std::vector<VkFence>         Fences{ }; // one per chunk in flight
+            };
+
+            // Of the last load that finished
+            struct Statistics {
+                uint64_t Bytes{ 0 };
+                double   Seconds{ 0.0 };
+
+                double   GetThroughput() const noexcept { // in GB/s
+                            return this->Seconds > 0.0 ? this->Bytes / this->Seconds / 1e9 : 0.0; }
+            };
+
+            enum class Error {
+                Success = 0,
+                FileError = -1, // the range isn't in the file
+                RecordError = -2,
+                SubmitError = -3,
+                BusyError = -4, // another load is still running
+                OwnershipError = -5 // the destination belongs to another family
+            };
+
+        protected:
+            const std::unique_ptr<const Info> pInfo{ nullptr };
+
+            const Handles                     File{ };
+            const Ring                        Staging{ };
+
+                  std::atomic_bool            IsLoading{ false };
+                  Statistics                  LastLoad{ };
+
+            // Prefetches the pages of the file in [offset, offset + size)
+                  void                        Prefetch(
+                                                const uint64_t offset,
+                                                const uint64_t size) const noexcept;
+            // Copies a chunk of the file to its slot of the ring, which has to be free
+                  void                        Stage(
+                                                const uint64_t chunk,
+                                                const uint64_t fileOffset,
+                                                const uint64_t size) const noexcept;
+            // Submits the chunk's copy, which frees its slot once done
+                  VkResult                    Submit(const uint64_t chunk) const noexcept;
+        public:
+            DFL_API DFL_CALL Stream(const Info& info);
+            DFL_API DFL_CALL ~Stream();
+
+            const uint64_t           GetFileSize() const noexcept {
+                                        return this->File.FileSize; }
+            const uint32_t           GetFamily() const noexcept {
+                                        return this->Staging.TransferQueue.FamilyIndex; }
+            const Statistics&        GetStatistics() const noexcept {
+                                        return this->LastLoad; }
+
+            // Copies size bytes of the file, starting at fileOffset, to the buffer. The
+            // buffer has to belong to the stream's family, or be shared with it.
+            DFL_API
+                  DflGen::Job<Error>
+            DFL_CALL                 Load(
+                                        const GenericBuffer& destination,
+                                        const uint64_t       fileOffset,
+                                        const uint64_t       dstOffset,
+                                        const uint64_t       size);
+            // Copies the first mip level of an array layer of the image, tightly packed
+            // in the file at fileOffset in rows of texel blocks (e.g. the 4x4 blocks of
+            // BC formats). The image is left in TRANSFER_DST_OPTIMAL.
+            DFL_API
+                  DflGen::Job<Error>
+            DFL_CALL                 Load(
+                                        const Buffer<StorageType::Image>& destination,
+                                        const uint64_t                    fileOffset,
+                                        const uint32_t                    dstArrayLayer);
+        };
+    }
+    namespace DflMem = Dfl::Memory;
+}
@@ -0,0 +1,507 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Dragonfly.Memory.Transfer.hxx"
+
+#include <algorithm>
+#include <utility>
+
+namespace DflHW = Dfl::Hardware;
+namespace DflMem = Dfl::Memory;
+namespace DflGen = Dfl::Generics;
+
+// Internal for Transfer
+
+using INT_QueueType = DflHW::Device::Queue::Type;
+
+static DflMem::Transfer::Handles INT_GetBatch(
+          DflHW::Device&      device,
+    const INT_QueueType       type)
+{
+    const VkDevice gpu{ device.GetDevice() };
+
+    const DflHW::Device::Queue queue{ device.BorrowQueue(type) };
+    if (queue.hQueue == nullptr)
+    {
+        throw Dfl::Error::NoData(
+                L"Unable to find a queue for the transfers",
+                L"INT_GetBatch",
+                Dfl::API::None);
+    }
+
+    const VkCommandPoolCreateInfo cmdPoolInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT },
+        .queueFamilyIndex{ queue.FamilyIndex }
+    };
+    VkCommandPool cmdPool{ nullptr };
+    if ( vkCreateCommandPool(
+            gpu,
+            &cmdPoolInfo,
+            nullptr,
+            &cmdPool) != VK_SUCCESS )
+    {
+        device.ReturnQueue(queue);
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create command pool for the transfers",
+                L"INT_GetBatch");
+    }
+
+    const VkCommandBufferAllocateInfo cmdBuffInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO },
+        .pNext{ nullptr },
+        .commandPool{ cmdPool },
+        .level{ VK_COMMAND_BUFFER_LEVEL_PRIMARY },
+        .commandBufferCount{ 1 }
+    };
+    VkCommandBuffer cmdBuffer{ nullptr };
+    // signaled, since no batch is running yet
+    const VkFenceCreateInfo fenceInfo{
+        .sType{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ VK_FENCE_CREATE_SIGNALED_BIT }
+    };
+    VkFence fence{ nullptr };
+    if ( vkAllocateCommandBuffers(
+            gpu,
+            &cmdBuffInfo,
+            &cmdBuffer) != VK_SUCCESS
+         || vkCreateFence(
+                gpu,
+                &fenceInfo,
+                nullptr,
+                &fence) != VK_SUCCESS )
+    {
+        vkDestroyCommandPool(gpu, cmdPool, nullptr);
+        device.ReturnQueue(queue);
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create the command buffer of the transfers",
+                L"INT_GetBatch");
+    }
+
+    return { queue, device.GetQueueFamilies()[queue.FamilyIndex].QueueType,
+             cmdPool, cmdBuffer, fence };
+}
+
+// What the copies, fills, clears and blits do with the images they use
+static constexpr DflMem::Transfer::Image::State INT_SourceState{
+    .Layout{ VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL },
+    .Stages{ VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT },
+    .Access{ VK_ACCESS_2_TRANSFER_READ_BIT } };
+static constexpr DflMem::Transfer::Image::State INT_DestinationState{
+    .Layout{ VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL },
+    .Stages{ VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT },
+    .Access{ VK_ACCESS_2_TRANSFER_WRITE_BIT } };
+
+static inline VkExtent3D INT_GetExtent(
+    const std::array<uint32_t, 3>& size,
+    const uint32_t                 mipLevel)
+{
+    return { std::max(size[0] >> mipLevel, 1u),
+             std::max(size[1] >> mipLevel, 1u),
+             std::max(size[2] >> mipLevel, 1u) };
+}
+
+// Dragonfly.Memory.Transfer
+
+DflMem::Transfer::Transfer(const Info& info)
+: pInfo( new Info(info) ),
+  Batch( INT_GetBatch(info.Device, info.QueueType) )
+{
+}
+
+DflMem::Transfer::~Transfer()
+{
+    const VkDevice gpu{ this->pInfo->Device.GetDevice() };
+
+    vkWaitForFences(
+        gpu,
+        1,
+        &this->Batch.hFence,
+        VK_TRUE,
+        UINT64_MAX);
+
+    vkDestroyFence(gpu, this->Batch.hFence, nullptr);
+    vkDestroyCommandPool(gpu, this->Batch.hCmdPool, nullptr);
+    this->pInfo->Device.ReturnQueue(this->Batch.TransferQueue);
+}
+
+DflMem::Transfer& DflMem::Transfer::Queue(
+    const DflGen::BitFlag& needs,
+    const bool             isOwned,
+    const bool             isInRange,
+          Operation&&      operation)
+{
+    if (this->Status != Error::Success) { return *this; }
+
+    if (!(this->Batch.Capabilities & needs)) [[ unlikely ]]
+    {
+        this->Status = Error::CapabilityError;
+    }
+    else if (!isOwned) [[ unlikely ]]
+    {
+        this->Status = Error::OwnershipError;
+    }
+    else if (!isInRange) [[ unlikely ]]
+    {
+        this->Status = Error::RangeError;
+    }
+    else
+    {
+        this->Operations.push_back(std::move(operation));
+    }
+
+    return *this;
+}
+
+bool DflMem::Transfer::IsOwned(const GenericBuffer& buffer) const noexcept
+{
+    return !buffer.IsExclusive() || buffer.GetFamily() == this->GetFamily();
+}
+
+bool DflMem::Transfer::IsOwned(const Image& image) const noexcept
+{
+    return !image.IsExclusive() || image.GetFamily() == this->GetFamily();
+}
+
+DflMem::Transfer& DflMem::Transfer::Copy(
+    const GenericBuffer& source,
+    const GenericBuffer& destination,
+    const uint64_t       sourceOffset,
+    const uint64_t       dstOffset,
+    const uint64_t       size)
+{
+    const VkBuffer sourceBuffer{ source.GetBuffer() };
+    const VkBuffer dstBuffer{ destination.GetBuffer() };
+
+    return this->Queue(
+            DflGen::BitFlag(INT_QueueType::Graphics) | INT_QueueType::Compute | INT_QueueType::Transfer,
+            this->IsOwned(source) && this->IsOwned(destination),
+            size > 0
+            && sourceOffset + size <= source.GetSize()
+            && dstOffset + size <= destination.GetSize(),
+            {
+              .IsOnBuffers{ true },
+              .Record{ [=](const VkCommandBuffer& cmdBuff) {
+                const VkBufferCopy copyRegion{
+                    .srcOffset{ sourceOffset },
+                    .dstOffset{ dstOffset },
+                    .size{ size }
+                };
+                vkCmdCopyBuffer(
+                    cmdBuff,
+                    sourceBuffer,
+                    dstBuffer,
+                    1,
+                    &copyRegion);
+              } } });
+}
+
+DflMem::Transfer& DflMem::Transfer::Fill(
+    const GenericBuffer& destination,
+    const uint64_t       offset,
+    const uint64_t       size,
+    const uint32_t       value)
+{
+    const VkBuffer dstBuffer{ destination.GetBuffer() };
+
+    return this->Queue(
+            DflGen::BitFlag(INT_QueueType::Graphics) | INT_QueueType::Compute | INT_QueueType::Transfer,
+            this->IsOwned(destination),
+            size > 0
+            && offset % 4 == 0
+            && size % 4 == 0
+            && offset + size <= destination.GetSize(),
+            {
+              .IsOnBuffers{ true },
+              .Record{ [=](const VkCommandBuffer& cmdBuff) {
+                vkCmdFillBuffer(
+                    cmdBuff,
+                    dstBuffer,
+                    offset,
+                    size,
+                    value);
+              } } });
+}
+
+DflMem::Transfer& DflMem::Transfer::Clear(
+    const Image&                destination,
+    const std::array<float, 4>& colour)
+{
+    // compressed images can't be cleared on any queue
+    return this->Queue(
+            destination.GetTexelBlock().IsCompressed()
+                ? DflGen::BitFlag(0)
+                : DflGen::BitFlag(INT_QueueType::Graphics) | INT_QueueType::Compute,
+            this->IsOwned(destination),
+            true,
+            {
+              // the whole image is overwritten, so whatever it held is discarded
+              .Prepare{ [&destination](Transitions& transitions) {
+                transitions.Use(destination, INT_DestinationState, { }, true);
+              } },
+              .Record{ [&destination, colour](const VkCommandBuffer& cmdBuff) {
+                const VkClearColorValue clearValue{
+                    .float32{ colour[0], colour[1], colour[2], colour[3] }
+                };
+                const VkImageSubresourceRange range{
+                    .aspectMask{ VK_IMAGE_ASPECT_COLOR_BIT },
+                    .baseMipLevel{ 0 },
+                    .levelCount{ VK_REMAINING_MIP_LEVELS },
+                    .baseArrayLayer{ 0 },
+                    .layerCount{ VK_REMAINING_ARRAY_LAYERS }
+                };
+                vkCmdClearColorImage(
+                    cmdBuff,
+                    destination.GetImage(),
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    &clearValue,
+                    1,
+                    &range);
+              } } });
+}
+
+DflMem::Transfer& DflMem::Transfer::Copy(
+    const Image& source,
+    const Image& destination)
+{
+    return this->Queue(
+            DflGen::BitFlag(INT_QueueType::Graphics) | INT_QueueType::Compute | INT_QueueType::Transfer,
+            this->IsOwned(source) && this->IsOwned(destination),
+            &source != &destination
+            && source.GetSize() == destination.GetSize(),
+            {
+              .Prepare{ [&source, &destination](Transitions& transitions) {
+                const Image::Subresources common{
+                    .Levels{ std::min(source.GetMipLevels(), destination.GetMipLevels()) },
+                    .Layers{ std::min(source.GetLayers(), destination.GetLayers()) } };
+                transitions.Use(source, INT_SourceState, common)
+                           .Use(destination, INT_DestinationState, common);
+              } },
+              .Record{ [&source, &destination](const VkCommandBuffer& cmdBuff) {
+                const uint32_t layers{ std::min(source.GetLayers(), destination.GetLayers()) };
+                std::vector<VkImageCopy> copyRegions;
+                for ( uint32_t mipLevel{ 0 };
+                      mipLevel < std::min(source.GetMipLevels(), destination.GetMipLevels());
+                      mipLevel++ )
+                {
+                    const VkImageSubresourceLayers subresource{
+                        .aspectMask{ VK_IMAGE_ASPECT_COLOR_BIT },
+                        .mipLevel{ mipLevel },
+                        .baseArrayLayer{ 0 },
+                        .layerCount{ layers }
+                    };
+                    copyRegions.push_back({
+                        .srcSubresource{ subresource },
+                        .srcOffset{ 0, 0, 0 },
+                        .dstSubresource{ subresource },
+                        .dstOffset{ 0, 0, 0 },
+                        .extent{ INT_GetExtent(source.GetSize(), mipLevel) } });
+                }
+                vkCmdCopyImage(
+                    cmdBuff,
+                    source.GetImage(),
+                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    destination.GetImage(),
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    static_cast<uint32_t>(copyRegions.size()),
+                    copyRegions.data());
+              } } });
+}
+
+DflMem::Transfer& DflMem::Transfer::Blit(
+    const Image&        source,
+    const Image&        destination,
+    const Image::Filter filter)
+{
+    DflHW::Profiler* const pProfiler{ this->pInfo->pProfiler };
+
+    // nor blitted
+    return this->Queue(
+            source.GetTexelBlock().IsCompressed() || destination.GetTexelBlock().IsCompressed()
+                ? DflGen::BitFlag(0)
+                : DflGen::BitFlag(INT_QueueType::Graphics),
+            this->IsOwned(source) && this->IsOwned(destination),
+            &source != &destination,
+            {
+              .Prepare{ [&source, &destination](Transitions& transitions) {
+                const Image::Subresources common{
+                    .Levels{ 1 },
+                    .Layers{ std::min(source.GetLayers(), destination.GetLayers()) } };
+                transitions.Use(source, INT_SourceState, common)
+                           .Use(destination, INT_DestinationState, common);
+              } },
+              .Record{ [&source, &destination, filter](const VkCommandBuffer& cmdBuff) {
+                const VkExtent3D sourceExtent{ INT_GetExtent(source.GetSize(), 0) };
+                const VkExtent3D dstExtent{ INT_GetExtent(destination.GetSize(), 0) };
+                const uint32_t layers{ std::min(source.GetLayers(), destination.GetLayers()) };
+                const VkImageBlit blitRegion{
+                    .srcSubresource{
+                        .aspectMask{ VK_IMAGE_ASPECT_COLOR_BIT },
+                        .mipLevel{ 0 },
+                        .baseArrayLayer{ 0 },
+                        .layerCount{ layers } },
+                    .srcOffsets{
+                        VkOffset3D{ 0, 0, 0 },
+                        VkOffset3D{ static_cast<int32_t>(sourceExtent.width),
+                                    static_cast<int32_t>(sourceExtent.height),
+                                    static_cast<int32_t>(sourceExtent.depth) } },
+                    .dstSubresource{
+                        .aspectMask{ VK_IMAGE_ASPECT_COLOR_BIT },
+                        .mipLevel{ 0 },
+                        .baseArrayLayer{ 0 },
+                        .layerCount{ layers } },
+                    .dstOffsets{
+                        VkOffset3D{ 0, 0, 0 },
+                        VkOffset3D{ static_cast<int32_t>(dstExtent.width),
+                                    static_cast<int32_t>(dstExtent.height),
+                                    static_cast<int32_t>(dstExtent.depth) } }
+                };
+                vkCmdBlitImage(
+                    cmdBuff,
+                    source.GetImage(),
+                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    destination.GetImage(),
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    1,
+                    &blitRegion,
+                    static_cast<VkFilter>(filter));
+              } } });
+}
+
+auto DflMem::Transfer::Submit()
+-> DflGen::Job<Error>
+{
+    // the batch is emptied whatever happens, so a failed one can't be submitted again
+    const std::vector<Operation> operations{ std::move(this->Operations) };
+    const Error status{ std::exchange(this->Status, Error::Success) };
+    this->Operations.clear();
+
+    if (status != Error::Success) [[ unlikely ]]
+    {
+        co_return status;
+    }
+    if (operations.empty()) { co_return Error::Success; }
+
+    const VkDevice gpu{ this->pInfo->Device.GetDevice() };
+
+    // the previous batch is done with the command buffer
+    while (vkGetFenceStatus(gpu, this->Batch.hFence) == VK_NOT_READY)
+    {
+        co_await DflGen::Job<Error>::Awaitable(
+            gpu,
+            this->Batch.hFence);
+    }
+
+    const VkCommandBufferBeginInfo cmdInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO },
+        .pNext{ nullptr },
+        .flags{ VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT },
+        .pInheritanceInfo{ nullptr }
+    };
+    if ( vkResetCommandBuffer(this->Batch.hCmdBuffer, 0) != VK_SUCCESS
+         || vkBeginCommandBuffer(this->Batch.hCmdBuffer, &cmdInfo) != VK_SUCCESS )
+    {
+        co_return Error::RecordError;
+    }
+
+    // every operation gets a single barrier, right before it, with what it needs.
+    // The images' tracked layouts are put back if the batch isn't submitted
+    Transitions transitions{ };
+    {
+        DflHW::Profiler::Zone zone(
+                                this->pInfo->pProfiler,
+                                this->Batch.hCmdBuffer,
+                                this->Batch.TransferQueue.FamilyIndex,
+                                "Transfer::Submit");
+
+        bool isBufferWritten{ false };
+        for (const auto& operation : operations)
+        {
+            if ( operation.IsOnBuffers
+                 && isBufferWritten )
+            {
+                transitions.Wait(
+                    VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT,
+                    VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT,
+                    VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT);
+            }
+            if (operation.Prepare) { operation.Prepare(transitions); }
+            transitions.Record(
+                this->Batch.hCmdBuffer,
+                this->pInfo->pProfiler);
+
+            operation.Record(this->Batch.hCmdBuffer);
+            isBufferWritten = isBufferWritten || operation.IsOnBuffers;
+        }
+    }
+
+    if (vkEndCommandBuffer(this->Batch.hCmdBuffer) != VK_SUCCESS)
+    {
+        if (this->pInfo->pProfiler != nullptr)
+        {
+            this->pInfo->pProfiler->Discard(this->Batch.hCmdBuffer);
+        }
+        transitions.Revert();
+        co_return Error::RecordError;
+    }
+
+    const VkSubmitInfo submitInfo{
+        .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO },
+        .pNext{ nullptr },
+        .waitSemaphoreCount{ 0 },
+        .pWaitSemaphores{ nullptr },
+        .pWaitDstStageMask{ nullptr },
+        .commandBufferCount{ 1 },
+        .pCommandBuffers{ &this->Batch.hCmdBuffer },
+        .signalSemaphoreCount{ 0 },
+        .pSignalSemaphores{ nullptr }
+    };
+    vkResetFences(
+        gpu,
+        1,
+        &this->Batch.hFence);
+    if ( vkQueueSubmit(
+            this->Batch.TransferQueue,
+            1,
+            &submitInfo,
+            this->Batch.hFence) != VK_SUCCESS )
+    {
+        // the fence still has to be signaled, or the next batch would wait forever
+        vkQueueSubmit(
+            this->Batch.TransferQueue,
+            0,
+            nullptr,
+            this->Batch.hFence);
+        if (this->pInfo->pProfiler != nullptr)
+        {
+            this->pInfo->pProfiler->Discard(this->Batch.hCmdBuffer);
+        }
+        transitions.Revert();
+        co_return Error::SubmitError;
+    }
+
+    while (vkGetFenceStatus(gpu, this->Batch.hFence) == VK_NOT_READY)
+    {
+        co_await DflGen::Job<Error>::Awaitable(
+            gpu,
+            this->Batch.hFence);
+    }
+
+    co_return Error::Success;
+}
@@ -0,0 +1,150 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <array>
+#include <functional>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "Dragonfly.h"
+
+#include "Dragonfly.Generics.hxx"
+#include "Dragonfly.Hardware.Device.hxx"
+#include "Dragonfly.Hardware.Profiler.hxx"
+#include "Dragonfly.Memory.Buffer.hxx"
+#include "Dragonfly.Memory.Transitions.hxx"
+
+namespace Dfl {
+    // Dragonfly.Memory
+    namespace Memory {
+        // Dragonfly.Memory.Transfer
+        // A batch of copies, fills and clears between buffers and images, done by
+        // the device alone, so the data never goes through the host. Operations
+        // are queued and run in order with a single submission. Each one waits
+        // for the ones before it, so later operations can use earlier results:
+        // images through the layouts they track, so operations on different
+        // images don't wait for each other, and buffers through a memory barrier.
+        // The resources of an operation have to outlive the batch's submission.
+        class Transfer {
+        public:
+            struct Info {
+                      DflHW::Device&                    Device;
+                // Blits and clears need a graphics queue (clears can also go on a compute
+                // one), while copies and fills can go on any
+                const DflHW::Device::Queue::Type        QueueType{ DflHW::Device::Queue::Type::Transfer };
+
+                      DflHW::Profiler*                  pProfiler{ nullptr }; // if not null, batches are timed
+            };
+
+            struct Handles {
+                const DflHW::Device::Queue              TransferQueue{ };
+                const DflGen::BitFlag                   Capabilities{ 0 }; // of the queue's family
+
+                const VkCommandPool                     hCmdPool{ nullptr };
+                const VkCommandBuffer                   hCmdBuffer{ nullptr };
+                const VkFence                           hFence{ nullptr };
+            };
+
+            enum class Error {
+                Success = 0,
+                RecordError = -1,
+                SubmitError = -2,
+                CapabilityError = -3, // an operation can't run on the batch's queue, or on a compressed image
+                OwnershipError = -4, // a resource belongs to another family
+                RangeError = -5 // an operation goes past the end of a resource
+            };
+
+            using Image = Buffer<StorageType::Image>;
+
+            struct Operation {
+                bool                                         IsOnBuffers{ false }; // waits for the earlier operations on buffers
+                std::function<void(Transitions&)>            Prepare{ }; // adds the transitions of the images it uses
+                std::function<void(const VkCommandBuffer&)>  Record{ };
+            };
+
+        protected:
+            const std::unique_ptr<const Info> pInfo{ nullptr };
+
+            const Handles                     Batch{ };
+
+                  std::vector<Operation>      Operations{ };
+                  Error                       Status{ Error::Success }; // the first error while queueing
+
+                  Transfer&                   Queue(
+                                                const Dfl::Generics::BitFlag& needs,
+                                                const bool                    isOwned,
+                                                const bool                    isInRange,
+                                                      Operation&&             operation);
+                  bool                        IsOwned(const GenericBuffer& buffer) const noexcept;
+                  bool                        IsOwned(const Image& image) const noexcept;
+        public:
+            DFL_API DFL_CALL Transfer(const Info& info);
+            DFL_API DFL_CALL ~Transfer();
+
+            const uint32_t           GetFamily() const noexcept {
+                                        return this->Batch.TransferQueue.FamilyIndex; }
+
+            DFL_API
+                  Transfer&
+            DFL_CALL                 Copy(
+                                        const GenericBuffer& source,
+                                        const GenericBuffer& destination,
+                                        const uint64_t       sourceOffset,
+                                        const uint64_t       dstOffset,
+                                        const uint64_t       size);
+            // Sets size bytes from offset to value. Both have to be multiples of 4.
+            DFL_API
+                  Transfer&
+            DFL_CALL                 Fill(
+                                        const GenericBuffer& destination,
+                                        const uint64_t       offset,
+                                        const uint64_t       size,
+                                        const uint32_t       value);
+            // Clears every level and layer of the image
+            DFL_API
+                  Transfer&
+            DFL_CALL                 Clear(
+                                        const Image&                destination,
+                                        const std::array<float, 4>& colour);
+            // Copies every level and layer the two images have in common. They have
+            // to be the same size.
+            DFL_API
+                  Transfer&
+            DFL_CALL                 Copy(
+                                        const Image& source,
+                                        const Image& destination);
+            // Scales the first level of every common layer of source onto destination
+            DFL_API
+                  Transfer&
+            DFL_CALL                 Blit(
+                                        const Image&        source,
+                                        const Image&        destination,
+                                        const Image::Filter filter);
+
+            // Runs the queued operations and empties the batch. If queueing one of
+            // them failed, nothing runs and the error is returned.
+            DFL_API
+                  DflGen::Job<Error>
+            DFL_CALL                 Submit();
+        };
+    }
+    namespace DflMem = Dfl::Memory;
+}
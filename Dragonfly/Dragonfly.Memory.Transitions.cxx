@@ -0,0 +1,108 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Dragonfly.Memory.Transitions.hxx"
+
+#include <algorithm>
+
+namespace DflHW = Dfl::Hardware;
+namespace DflMem = Dfl::Memory;
+
+// Dragonfly.Memory.Transitions
+
+DflMem::Transitions& DflMem::Transitions::Use(
+    const Image&               image,
+    const Image::State&        state,
+    const Image::Subresources& subresources,
+    const bool                 isDiscarding) noexcept
+{
+    if (std::find_if(
+            this->Saved.begin(),
+            this->Saved.end(),
+            [&image](const auto& saved) { return saved.first == &image; }) == this->Saved.end())
+    {
+        this->Saved.push_back({ &image, image.SaveStates() });
+    }
+
+    image.Transition(
+        subresources,
+        state,
+        isDiscarding,
+        this->ImageBarriers);
+
+    return *this;
+}
+
+DflMem::Transitions& DflMem::Transitions::Wait(
+    const VkPipelineStageFlags2 srcStages,
+    const VkAccessFlags2        srcAccess,
+    const VkPipelineStageFlags2 dstStages,
+    const VkAccessFlags2        dstAccess) noexcept
+{
+    this->MemoryBarriers.push_back({
+        .sType{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 },
+        .pNext{ nullptr },
+        .srcStageMask{ srcStages },
+        .srcAccessMask{ srcAccess },
+        .dstStageMask{ dstStages },
+        .dstAccessMask{ dstAccess } });
+
+    return *this;
+}
+
+uint32_t DflMem::Transitions::Record(
+    const VkCommandBuffer& cmdBuff,
+          DflHW::Profiler* pProfiler) noexcept
+{
+    if (this->IsEmpty()) { return 0; }
+
+    const VkDependencyInfo dependency{
+        .sType{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO },
+        .pNext{ nullptr },
+        .dependencyFlags{ 0 },
+        .memoryBarrierCount{ static_cast<uint32_t>(this->MemoryBarriers.size()) },
+        .pMemoryBarriers{ this->MemoryBarriers.data() },
+        .bufferMemoryBarrierCount{ 0 },
+        .pBufferMemoryBarriers{ nullptr },
+        .imageMemoryBarrierCount{ static_cast<uint32_t>(this->ImageBarriers.size()) },
+        .pImageMemoryBarriers{ this->ImageBarriers.data() }
+    };
+    vkCmdPipelineBarrier2(
+        cmdBuff,
+        &dependency);
+
+    const uint32_t count{ static_cast<uint32_t>(this->MemoryBarriers.size() + this->ImageBarriers.size()) };
+    if (pProfiler != nullptr)
+    {
+        pProfiler->Count(DflHW::Profiler::Counter::BarriersIssued, count);
+    }
+
+    this->ImageBarriers.clear();
+    this->MemoryBarriers.clear();
+
+    return count;
+}
+
+void DflMem::Transitions::Revert() noexcept
+{
+    for (const auto& [pImage, states] : this->Saved)
+    {
+        pImage->RestoreStates(states);
+    }
+    this->Saved.clear();
+    this->ImageBarriers.clear();
+    this->MemoryBarriers.clear();
+}
@@ -0,0 +1,88 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <vector>
+#include <utility>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "Dragonfly.h"
+
+#include "Dragonfly.Hardware.Profiler.hxx"
+#include "Dragonfly.Memory.Buffer.hxx"
+
+namespace Dfl {
+    // Dragonfly.Memory
+    namespace Memory {
+        // Dragonfly.Memory.Transitions
+        // The barriers the next piece of work needs, gathered from any number of
+        // images (and buffers) and recorded together, right before the work, in a
+        // single vkCmdPipelineBarrier2. The images track every level of every
+        // layer, so only the subresources that aren't ready get a barrier, and it
+        // waits only for the stages that last used them.
+        class Transitions {
+        public:
+            using Image = Buffer<StorageType::Image>;
+
+        protected:
+            std::vector<VkImageMemoryBarrier2> ImageBarriers{ };
+            std::vector<VkMemoryBarrier2>      MemoryBarriers{ };
+            // what every image tracked before its first Use, for Revert
+            std::vector<std::pair<
+                const Image*,
+                std::vector<Image::Tracker::Subresource>>> Saved{ };
+        public:
+            const bool               IsEmpty() const noexcept {
+                                        return this->ImageBarriers.empty() && this->MemoryBarriers.empty(); }
+
+            // The work about to be recorded uses the subresources of the image as
+            // state says. See Image::Transition.
+            DFL_API
+                  Transitions&
+            DFL_CALL                 Use(
+                                        const Image&               image,
+                                        const Image::State&        state,
+                                        const Image::Subresources& subresources = { },
+                                        const bool                 isDiscarding = false) noexcept;
+            // The work about to be recorded waits for everything earlier in the given
+            // stages, e.g. for buffers, which aren't tracked
+            DFL_API
+                  Transitions&
+            DFL_CALL                 Wait(
+                                        const VkPipelineStageFlags2 srcStages,
+                                        const VkAccessFlags2        srcAccess,
+                                        const VkPipelineStageFlags2 dstStages,
+                                        const VkAccessFlags2        dstAccess) noexcept;
+
+            // Records the gathered barriers, if there are any, and empties the batch.
+            // Returns how many there were.
+            DFL_API
+                  uint32_t
+            DFL_CALL                 Record(
+                                        const VkCommandBuffer& cmdBuff,
+                                              DflHW::Profiler* pProfiler = nullptr) noexcept;
+            // The work won't be submitted after all: the images go back to tracking
+            // what they did before the first Use of this batch, even if it was recorded
+            DFL_API
+                  void
+            DFL_CALL                 Revert() noexcept;
+        };
+    }
+    namespace DflMem = Dfl::Memory;
+}
@@ -0,0 +1,434 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Dragonfly.Memory.UploadCache.hxx"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <iterator>
+#include <atomic>
+
+#include <intrin.h>
+#include <immintrin.h>
+
+namespace DflMem = Dfl::Memory;
+namespace DflGen = Dfl::Generics;
+
+// Internal for UploadCache
+
+// odd, so multiplying by it loses nothing
+static constexpr uint64_t INT_Scramble{ 0x9E3779B97F4A7C15 };
+
+// CRC32C, reflected, as the CRC32 instruction computes it
+static constexpr std::array<uint32_t, 256> INT_CRCTable{ []() {
+    std::array<uint32_t, 256> table{ };
+    for (uint32_t i{ 0 }; i < 256; i++)
+    {
+        uint32_t crc{ i };
+        for (uint32_t bit{ 0 }; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (crc & 1 ? 0x82F63B78 : 0);
+        }
+        table[i] = crc;
+    }
+    return table; }() };
+
+static inline uint32_t INT_CRCScalar(
+          uint32_t crc,
+    const uint64_t word)
+{
+    for (uint32_t i{ 0 }; i < 8; i++)
+    {
+        crc = INT_CRCTable[(crc ^ (word >> (8 * i))) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static inline uint64_t INT_LoadTail(
+    const std::byte* pData,
+    const uint64_t   size)
+{
+    uint64_t word{ 0 };
+    std::memcpy(&word, pData, size);
+    return word;
+}
+
+// The two lanes depend on nothing but themselves, so they overlap in the
+// pipeline. The last word is padded with zeroes, and the size goes in
+// after it, so trailing zeroes still change the hash.
+static uint64_t INT_HashScalar(
+    const std::byte* pData,
+    const uint64_t   size)
+{
+    uint32_t plain{ 0xFFFFFFFF };
+    uint32_t scrambled{ 0xFFFFFFFF };
+    uint64_t i{ 0 };
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word{ 0 };
+        std::memcpy(&word, pData + i, sizeof(word));
+        plain = INT_CRCScalar(plain, word);
+        scrambled = INT_CRCScalar(scrambled, word * INT_Scramble);
+    }
+    const uint64_t tail{ INT_LoadTail(pData + i, size - i) };
+    plain = INT_CRCScalar(INT_CRCScalar(plain, tail), size);
+    scrambled = INT_CRCScalar(INT_CRCScalar(scrambled, tail * INT_Scramble), size);
+
+    return (static_cast<uint64_t>(static_cast<uint32_t>(~scrambled)) << 32) | static_cast<uint32_t>(~plain);
+}
+
+static uint64_t INT_HashSSE42(
+    const std::byte* pData,
+    const uint64_t   size)
+{
+    uint64_t plain{ 0xFFFFFFFF };
+    uint64_t scrambled{ 0xFFFFFFFF };
+    uint64_t i{ 0 };
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word{ 0 };
+        std::memcpy(&word, pData + i, sizeof(word));
+        plain = _mm_crc32_u64(plain, word);
+        scrambled = _mm_crc32_u64(scrambled, word * INT_Scramble);
+    }
+    const uint64_t tail{ INT_LoadTail(pData + i, size - i) };
+    plain = _mm_crc32_u64(_mm_crc32_u64(plain, tail), size);
+    scrambled = _mm_crc32_u64(_mm_crc32_u64(scrambled, tail * INT_Scramble), size);
+
+    return (static_cast<uint64_t>(static_cast<uint32_t>(~scrambled)) << 32) | static_cast<uint32_t>(~plain);
+}
+
+static DflMem::UploadCache::Kernel INT_GetKernel(const DflMem::UploadCache::Kernel maxKernel)
+{
+    std::array<int, 4> registers{ };
+    __cpuid(registers.data(), 1);
+    const bool hasSSE42{ (registers[2] & (1 << 20)) != 0 };
+
+    if ( hasSSE42
+         && maxKernel == DflMem::UploadCache::Kernel::SSE42 )
+    {
+        return DflMem::UploadCache::Kernel::SSE42;
+    }
+    return DflMem::UploadCache::Kernel::Scalar;
+}
+
+// Whether two regions of an image share a texel. Dimensions of 0 span one.
+static inline bool INT_DoOverlap(
+    const DflMem::UploadCache::Image::Region& a,
+    const DflMem::UploadCache::Image::Region& b)
+{
+    if (a.Level != b.Level || a.Layer != b.Layer) { return false; }
+
+    for (uint32_t i{ 0 }; i < 3; i++)
+    {
+        const int64_t aEnd{ a.Offset[i] + static_cast<int64_t>(std::max(a.Extent[i], 1u)) };
+        const int64_t bEnd{ b.Offset[i] + static_cast<int64_t>(std::max(b.Extent[i], 1u)) };
+        if (a.Offset[i] >= bEnd || b.Offset[i] >= aEnd) { return false; }
+    }
+    return true;
+}
+
+static inline bool INT_IsSame(
+    const DflMem::UploadCache::Image::Region& a,
+    const DflMem::UploadCache::Image::Region& b)
+{
+    return a.Offset == b.Offset
+           && a.Extent == b.Extent
+           && a.Level == b.Level
+           && a.Layer == b.Layer;
+}
+
+// A job that is done as soon as it starts, for writes that are skipped
+template< typename E >
+static DflGen::Job<E> INT_Skip()
+{
+    co_return E::Success;
+}
+
+// Dragonfly.Memory.UploadCache
+
+DflMem::UploadCache::UploadCache(const Info& info)
+: pInfo( new Info(info) ),
+  ChosenKernel( INT_GetKernel(info.MaxKernel) )
+{ }
+
+DflMem::UploadCache::~UploadCache()
+{ }
+
+template< typename P >
+void DflMem::UploadCache::Drop(
+    const void* destination,
+    P           isDropped) noexcept
+{
+    const auto found{ this->Entries.find(destination) };
+    if (found == this->Entries.end()) { return; }
+
+    std::vector<std::list<Entry>::iterator>& entries{ found->second };
+    for (uint64_t i{ 0 }; i < entries.size();)
+    {
+        const Entry& entry{ *entries[i] };
+        if (!isDropped(entry))
+        {
+            i++;
+            continue;
+        }
+
+        const auto location{ this->Locations.find(entry.Hash) };
+        if ( location != this->Locations.end()
+             && location->second.pBuffer == destination
+             && location->second.Offset == entry.Offset )
+        {
+            this->Locations.erase(location);
+        }
+
+        this->Recent.erase(entries[i]);
+        entries[i] = entries.back();
+        entries.pop_back();
+    }
+
+    if (entries.empty()) { this->Entries.erase(found); }
+}
+
+void DflMem::UploadCache::Remember(const Entry& entry) noexcept
+{
+    if (this->pInfo->MaxEntries == 0) { return; }
+
+    if (this->Recent.size() >= this->pInfo->MaxEntries)
+    {
+        const auto oldest{ std::prev(this->Recent.end()) };
+        this->Drop(
+            oldest->Destination,
+            [&oldest](const Entry& remembered) { return &remembered == &*oldest; });
+    }
+
+    this->Recent.push_front(entry);
+    this->Entries[entry.Destination].push_back(this->Recent.begin());
+}
+
+template< typename E >
+auto DflMem::UploadCache::Follow(
+          std::unique_ptr<
+            DflGen::Job<E>> pWrite,
+    const Entry             entry,
+    const bool              isBuffer) noexcept
+-> DflGen::Job<E>
+{
+    // never raised, so this job suspends until it's resumed, and resumes the write then
+    const auto pYield{ std::make_shared<const std::atomic_bool>(false) };
+    while (pWrite->GetState() != DflGen::Job<E>::RoutineState::Done)
+    {
+        co_await typename DflGen::Job<E>::Awaitable(pYield);
+        pWrite->Resume();
+    }
+
+    const E error{ *pWrite };
+    if (error != E::Success) { co_return error; }
+
+    std::lock_guard<std::mutex> lock(this->Lock);
+    // writes issued since may have been remembered first; this one is
+    // the one done last, so what it overlaps goes
+    this->Drop(
+        entry.Destination,
+        [&entry, isBuffer](const Entry& remembered) {
+            return isBuffer
+                   ? remembered.Offset < entry.Offset + entry.Size && entry.Offset < remembered.Offset + remembered.Size
+                   : INT_DoOverlap(remembered.Region, entry.Region); });
+    this->Remember(entry);
+    // the first buffer to hold the bytes stays their source
+    if (isBuffer)
+    {
+        this->Locations.try_emplace(
+            entry.Hash,
+            Location{ static_cast<const GenericBuffer*>(entry.Destination), entry.Offset, entry.Size });
+    }
+
+    co_return E::Success;
+}
+
+auto DflMem::UploadCache::Write(
+    const GenericBuffer&             destination,
+    const std::span<const std::byte> source,
+    const uint64_t                   dstOffset) noexcept
+-> const DflGen::Job<GenericBuffer::Error>
+{
+    const uint64_t size{ source.size() };
+    const std::vector<GenericBuffer::Region> regions{ { .SourceOffset{ 0 }, .DstOffset{ dstOffset }, .Size{ size } } };
+    if (size < this->pInfo->MinSize)
+    {
+        // it isn't remembered, but what it overlaps is no longer there
+        {
+            std::lock_guard<std::mutex> lock(this->Lock);
+            this->Drop(
+                &destination,
+                [dstOffset, size](const Entry& entry) {
+                    return entry.Offset < dstOffset + size && dstOffset < entry.Offset + entry.Size; });
+        }
+        return destination.Write(source, regions);
+    }
+
+    const uint64_t hash{ this->Hash(source) };
+
+    std::optional<Location> copySource{ std::nullopt };
+    {
+        std::lock_guard<std::mutex> lock(this->Lock);
+
+        const auto found{ this->Entries.find(&destination) };
+        if (found != this->Entries.end())
+        {
+            for (const auto& entry : found->second)
+            {
+                if ( entry->Offset == dstOffset
+                     && entry->Size == size
+                     && entry->Hash == hash )
+                {
+                    this->Recent.splice(this->Recent.begin(), this->Recent, entry);
+                    this->Totals.Hits++;
+                    this->Totals.SkippedBytes += size;
+                    return INT_Skip<GenericBuffer::Error>();
+                }
+            }
+        }
+
+        // what the write overlaps is no longer there, even before it's done
+        this->Drop(
+            &destination,
+            [dstOffset, size](const Entry& entry) {
+                return entry.Offset < dstOffset + size && dstOffset < entry.Offset + entry.Size; });
+
+        const auto location{ this->Locations.find(hash) };
+        if ( this->pInfo->DoDeviceCopies
+             && location != this->Locations.end()
+             && location->second.Size == size
+             && ( !location->second.pBuffer->IsExclusive()
+                  || location->second.pBuffer->GetFamily() == destination.GetFamily() ) )
+        {
+            copySource = location->second;
+            this->Totals.DeviceCopies++;
+            this->Totals.CopiedBytes += size;
+        }
+        else
+        {
+            this->Totals.Misses++;
+            this->Totals.UploadedBytes += size;
+        }
+    }
+
+    // the write runs outside the lock, so other writes go on meanwhile
+    std::unique_ptr<DflGen::Job<GenericBuffer::Error>> pWrite{ copySource.has_value()
+        ? new DflGen::Job<GenericBuffer::Error>(destination.CopyFrom(
+                                                    *copySource->pBuffer,
+                                                    copySource->Offset,
+                                                    dstOffset,
+                                                    size))
+        : new DflGen::Job<GenericBuffer::Error>(destination.Write(source, regions)) };
+
+    return this->Follow(
+                std::move(pWrite),
+                { .Destination{ &destination }, .Offset{ dstOffset }, .Size{ size }, .Hash{ hash } },
+                true);
+}
+
+auto DflMem::UploadCache::Write(
+    const Image&                     destination,
+    const std::span<const std::byte> source,
+    const uint64_t                   rowPitch,
+    const Image::Region&             region) noexcept
+-> const DflGen::Job<Image::Error>
+{
+    const uint64_t size{ source.size() };
+    if (size < this->pInfo->MinSize)
+    {
+        // it isn't remembered, but what it overlaps is no longer there
+        {
+            std::lock_guard<std::mutex> lock(this->Lock);
+            this->Drop(
+                &destination,
+                [&region](const Entry& entry) { return INT_DoOverlap(entry.Region, region); });
+        }
+        return destination.Write(source, rowPitch, region);
+    }
+
+    const uint64_t hash{ this->Hash(source) };
+
+    {
+        std::lock_guard<std::mutex> lock(this->Lock);
+
+        const auto found{ this->Entries.find(&destination) };
+        if (found != this->Entries.end())
+        {
+            for (const auto& entry : found->second)
+            {
+                if ( INT_IsSame(entry->Region, region)
+                     && entry->RowPitch == rowPitch
+                     && entry->Size == size
+                     && entry->Hash == hash )
+                {
+                    this->Recent.splice(this->Recent.begin(), this->Recent, entry);
+                    this->Totals.Hits++;
+                    this->Totals.SkippedBytes += size;
+                    return INT_Skip<Image::Error>();
+                }
+            }
+        }
+
+        this->Drop(
+            &destination,
+            [&region](const Entry& entry) { return INT_DoOverlap(entry.Region, region); });
+
+        this->Totals.Misses++;
+        this->Totals.UploadedBytes += size;
+    }
+
+    std::unique_ptr<DflGen::Job<Image::Error>> pWrite{ new DflGen::Job<Image::Error>(
+                                                            destination.Write(source, rowPitch, region)) };
+
+    return this->Follow(
+                std::move(pWrite),
+                { .Destination{ &destination }, .Region{ region }, .RowPitch{ rowPitch }, .Size{ size }, .Hash{ hash } },
+                false);
+}
+
+void DflMem::UploadCache::Forget(const GenericBuffer& destination) noexcept
+{
+    std::lock_guard<std::mutex> lock(this->Lock);
+    this->Drop(
+        &destination,
+        [](const Entry&) { return true; });
+}
+
+void DflMem::UploadCache::Forget(const Image& destination) noexcept
+{
+    std::lock_guard<std::mutex> lock(this->Lock);
+    this->Drop(
+        &destination,
+        [](const Entry&) { return true; });
+}
+
+void DflMem::UploadCache::Clear() noexcept
+{
+    std::lock_guard<std::mutex> lock(this->Lock);
+    this->Entries.clear();
+    this->Recent.clear();
+    this->Locations.clear();
+}
+
+uint64_t DflMem::UploadCache::Hash(const std::span<const std::byte> source) const noexcept
+{
+    return this->ChosenKernel == Kernel::SSE42
+            ? INT_HashSSE42(source.data(), source.size())
+            : INT_HashScalar(source.data(), source.size());
+}
@@ -0,0 +1,181 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <array>
+#include <span>
+#include <cstddef>
+#include <mutex>
+#include <list>
+#include <unordered_map>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "Dragonfly.h"
+
+#include "Dragonfly.Generics.hxx"
+#include "Dragonfly.Memory.Buffer.hxx"
+
+namespace Dfl {
+    // Dragonfly.Memory
+    namespace Memory {
+        // Dragonfly.Memory.UploadCache
+        // Remembers what was written where, by a hash of the bytes, so writing
+        // the same bytes to the same place again is skipped, and writing bytes
+        // another buffer already holds becomes a copy on the device instead of
+        // an upload. The hash is two CRC32C lanes over the source, one of them
+        // over its words scrambled, so 64 bits in all; it's fast, not
+        // cryptographic.
+        // The cache only knows about the writes that go through it: a
+        // destination written some other way, by the host or the device, has
+        // to be forgotten first. So does a destination that is destroyed.
+        // A write is only remembered once its job is done without error, so
+        // copies on the device only read bytes that are already there.
+        class UploadCache {
+        public:
+            using Image = Buffer<StorageType::Image>;
+
+            enum class Kernel {
+                Scalar = 0,
+                SSE42 = 1 // the CRC32 instruction
+            };
+
+            struct Info {
+                const uint64_t MinSize{ 256 }; // in B. Smaller writes go through without hashing, dropping what they overlap
+                const uint32_t MaxEntries{ 4096 }; // writes remembered; the least recently used are forgotten first
+                const bool     DoDeviceCopies{ true }; // bytes another buffer holds are copied from it on the device
+                const Kernel   MaxKernel{ Kernel::SSE42 };
+            };
+
+            struct Statistics {
+                uint64_t Hits{ 0 }; // writes skipped
+                uint64_t DeviceCopies{ 0 };
+                uint64_t Misses{ 0 }; // writes uploaded
+
+                uint64_t SkippedBytes{ 0 };
+                uint64_t CopiedBytes{ 0 }; // on the device, instead of uploaded
+                uint64_t UploadedBytes{ 0 };
+
+                // The share of the bytes written through the cache it didn't upload
+                double   GetSavings() const noexcept {
+                            const uint64_t total{ this->SkippedBytes + this->CopiedBytes + this->UploadedBytes };
+                            return total > 0 ? static_cast<double>(this->SkippedBytes + this->CopiedBytes) / total : 0; }
+            };
+
+        protected:
+            // What a range of a destination was last written with
+            struct Entry {
+                const void*          Destination{ nullptr };
+                uint64_t             Offset{ 0 }; // of a buffer's range
+                Image::Region        Region{ }; // of an image's
+                uint64_t             RowPitch{ 0 };
+                uint64_t             Size{ 0 };
+                uint64_t             Hash{ 0 };
+            };
+
+            // Where bytes of a hash are held, for device copies
+            struct Location {
+                const GenericBuffer* pBuffer{ nullptr };
+                uint64_t             Offset{ 0 };
+                uint64_t             Size{ 0 };
+            };
+
+            const std::unique_ptr<const Info> pInfo{ nullptr };
+
+            const Kernel                      ChosenKernel{ Kernel::Scalar };
+
+            mutable std::mutex                Lock;
+                  std::list<Entry>            Recent{ }; // every entry, the most recently used first
+                  std::unordered_map<
+                    const void*,
+                    std::vector<
+                      std::list<
+                        Entry>::iterator>>    Entries{ }; // by destination
+                  std::unordered_map<
+                    uint64_t,
+                    Location>                 Locations{ }; // by hash
+
+                  Statistics                  Totals{ };
+
+            // Drops the entries of destination that the predicate holds for,
+            // and the locations in them
+            template< typename P >
+                  void                        Drop(
+                                                const void* destination,
+                                                P           isDropped) noexcept;
+            // Remembers entry, forgetting the least recently used one if full
+                  void                        Remember(const Entry& entry) noexcept;
+            // Resumes the write whenever the job it returns is resumed, and
+            // remembers entry once the write is done without error; if it's of a
+            // buffer, as where its bytes are too
+            template< typename E >
+                  DflGen::Job<E>              Follow(
+                                                      std::unique_ptr<
+                                                        DflGen::Job<E>> pWrite,
+                                                const Entry             entry,
+                                                const bool              isBuffer) noexcept;
+        public:
+            DFL_API DFL_CALL UploadCache(const Info& info);
+            DFL_API DFL_CALL ~UploadCache();
+
+            const Kernel             GetKernel() const noexcept {
+                                        return this->ChosenKernel; }
+            const Statistics         GetStatistics() const noexcept {
+                                        std::lock_guard<std::mutex> lock(this->Lock);
+                                        return this->Totals; }
+
+            // Writes source to [dstOffset, dstOffset + source's size) of the
+            // destination, unless the same bytes were written there last.
+            // If another buffer holds them, and destination can copy from it, they
+            // are copied on the device.
+            DFL_API
+            const DflGen::Job<GenericBuffer::Error>
+            DFL_CALL                 Write(
+                                        const GenericBuffer&             destination,
+                                        const std::span<const std::byte> source,
+                                        const uint64_t                   dstOffset) noexcept;
+            // Writes source to the region of the image, as Image::Write does,
+            // unless the same bytes were written to the same region last
+            DFL_API
+            const DflGen::Job<Image::Error>
+            DFL_CALL                 Write(
+                                        const Image&                     destination,
+                                        const std::span<const std::byte> source,
+                                        const uint64_t                   rowPitch,
+                                        const Image::Region&             region) noexcept;
+
+            // Forgets what was written to the destination
+            DFL_API
+                  void
+            DFL_CALL                 Forget(const GenericBuffer& destination) noexcept;
+            DFL_API
+                  void
+            DFL_CALL                 Forget(const Image& destination) noexcept;
+            DFL_API
+                  void
+            DFL_CALL                 Clear() noexcept;
+
+            DFL_API
+                  uint64_t
+            DFL_CALL                 Hash(const std::span<const std::byte> source) const noexcept;
+        };
+    }
+    namespace DflMem = Dfl::Memory;
+}
@@ -0,0 +1,1094 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Dragonfly.Memory.VirtualTexture.hxx"
+
+#include <algorithm>
+#include <limits>
+#include <cstring>
+
+namespace DflHW = Dfl::Hardware;
+namespace DflMem = Dfl::Memory;
+namespace DflGen = Dfl::Generics;
+
+// Internal for VirtualTexture
+
+// of slots and tiles that have nothing
+static constexpr uint32_t INT_None{ std::numeric_limits<uint32_t>::max() };
+
+using INT_Image = DflMem::Buffer<DflMem::StorageType::Image>;
+
+static inline std::array<uint32_t, 2> INT_GetLevelSize(
+    const std::array<uint32_t, 2>& size,
+    const uint32_t                 level)
+{
+    return { std::max(size[0] >> level, 1u),
+             std::max(size[1] >> level, 1u) };
+}
+
+// Tiles in a row and in a column of every level out of the mip tail
+static inline std::vector<std::array<uint32_t, 2>> INT_GetLevelTiles(
+    const std::array<uint32_t, 2>& size,
+    const std::array<uint32_t, 2>& tileSize,
+    const uint32_t                 mipTailLevel)
+{
+    std::vector<std::array<uint32_t, 2>> tiles(mipTailLevel);
+    for (uint32_t level{ 0 }; level < mipTailLevel; level++)
+    {
+        const std::array<uint32_t, 2> levelSize{ INT_GetLevelSize(size, level) };
+        tiles[level] = { (levelSize[0] + tileSize[0] - 1) / tileSize[0],
+                         (levelSize[1] + tileSize[1] - 1) / tileSize[1] };
+    }
+
+    return tiles;
+}
+
+// B the loader fills for every level of the mip tail, placed after the tiles
+// in the stage
+static inline uint64_t INT_GetMipTailStageSize(const DflMem::VirtualTexture::Info& info,
+                                               const uint32_t                      mipTailLevel)
+{
+    const INT_Image::TexelBlock block{ INT_Image::GetTexelBlock(info.Format) };
+    uint64_t size{ 0 };
+    for (uint32_t level{ mipTailLevel }; level < info.MipLevels; level++)
+    {
+        const std::array<uint32_t, 2> levelSize{ INT_GetLevelSize(info.Size, level) };
+        size += block.GetCopySize({ levelSize[0], levelSize[1], 1 });
+    }
+
+    return size;
+}
+
+// Memory of a type the resource can be bound to, allocated with exactly that
+// type
+template< DflHW::Device::MemoryType type >
+static inline bool INT_BorrowFittingMemory(
+          DflHW::Device&                     device,
+    const VkMemoryRequirements&              requirements,
+    const bool                               isHostVisible,
+          DflMem::VirtualTexture::Allocation& allocation)
+{
+    const auto& heaps{ [&]() -> const auto& {
+                          if constexpr (type == DflHW::Device::MemoryType::Local) { return device.GetCharacteristics().LocalHeaps; }
+                          else { return device.GetCharacteristics().SharedHeaps; } }() };
+    for (uint64_t heapIndex{ 0 }; heapIndex < heaps.size(); heapIndex++)
+    {
+        for (const auto& property : heaps[heapIndex].MemProperties)
+        {
+            // host visible memory is coherent, so neither the feedback nor the
+            // stage need flushing
+            if ( !(requirements.memoryTypeBits & (1u << property.TypeIndex))
+                 || property.IsHostVisible != isHostVisible
+                 || (isHostVisible && !property.IsHostCoherent) )
+            {
+                continue;
+            }
+
+            const VkDeviceMemory memory{ device.BorrowMemory<type>(
+                                            heapIndex,
+                                            property.TypeIndex,
+                                            requirements.size) };
+            if (memory != nullptr)
+            {
+                allocation = { memory, type, heapIndex, requirements.size };
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// Device memory for the tiles is local; memory the host touches is shared
+// if it can be, as in Stream
+static DflMem::VirtualTexture::Allocation INT_Allocate(
+          DflHW::Device&        device,
+    const VkMemoryRequirements& requirements,
+    const bool                  isHostVisible)
+{
+    DflMem::VirtualTexture::Allocation allocation{ };
+    const bool isFound{ isHostVisible
+                        ? INT_BorrowFittingMemory<DflHW::Device::MemoryType::Shared>(device, requirements, true, allocation)
+                          || INT_BorrowFittingMemory<DflHW::Device::MemoryType::Local>(device, requirements, true, allocation)
+                        : INT_BorrowFittingMemory<DflHW::Device::MemoryType::Local>(device, requirements, false, allocation) };
+    if (!isFound)
+    {
+        throw Dfl::Error::Limit(
+                L"Unable to find memory for the virtual texture",
+                L"INT_Allocate",
+                Dfl::API::None);
+    }
+
+    return allocation;
+}
+
+static inline void INT_Return(
+          DflHW::Device&                            device,
+    const DflMem::VirtualTexture::Allocation& allocation)
+{
+    if (allocation.hMemory == nullptr) { return; }
+
+    if (allocation.HeapType == DflHW::Device::MemoryType::Local)
+    {
+        device.ReturnMemory<DflHW::Device::MemoryType::Local>(allocation.hMemory, allocation.HeapIndex, allocation.Size);
+    }
+    else
+    {
+        device.ReturnMemory<DflHW::Device::MemoryType::Shared>(allocation.hMemory, allocation.HeapIndex, allocation.Size);
+    }
+}
+
+static VkBuffer INT_GetBuffer(
+    const VkDevice&              hGPU,
+    const uint64_t               size,
+    const VkBufferUsageFlags     usage,
+    const std::vector<uint32_t>& families)
+{
+    const VkBufferCreateInfo bufInfo{
+        .sType{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .size{ size },
+        .usage{ usage },
+        .sharingMode{ families.size() > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE },
+        .queueFamilyIndexCount{ families.size() > 1 ? static_cast<uint32_t>(families.size()) : 0 },
+        .pQueueFamilyIndices{ families.size() > 1 ? families.data() : nullptr }
+    };
+    VkBuffer buffer{ nullptr };
+    if ( vkCreateBuffer(
+            hGPU,
+            &bufInfo,
+            nullptr,
+            &buffer) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create buffer",
+                L"INT_GetBuffer");
+    }
+
+    return buffer;
+}
+
+static DflMem::VirtualTexture::Handles INT_GetHandles(
+          DflHW::Device&                 gpu,
+    const DflMem::VirtualTexture::Info&  info)
+{
+    const VkDevice& hGPU{ gpu.GetDevice() };
+
+    const INT_Image::TexelBlock block{ INT_Image::GetTexelBlock(info.Format) };
+    if ( !DflMem::VirtualTexture::IsSupported(gpu, info.Format)
+         || block.Size == 0 )
+    {
+        throw Dfl::Error::Limit(
+                L"Device can't keep sparse images of this format",
+                L"INT_GetHandles",
+                Dfl::API::None);
+    }
+    if ( info.Size[0] == 0
+         || info.Size[1] == 0
+         || info.MipLevels == 0
+         || info.MaxUploads == 0
+         || !info.Loader )
+    {
+        throw Dfl::Error::Limit(
+                L"Virtual texture has nothing to stream",
+                L"INT_GetHandles",
+                Dfl::API::None);
+    }
+
+    const DflHW::Device::Queue queue{ gpu.BorrowQueue(DflHW::Device::Queue::Type::Sparse) };
+    if (queue.hQueue == nullptr)
+    {
+        throw Dfl::Error::NoData(
+                L"Unable to find a queue that binds sparse memory and copies",
+                L"INT_GetHandles",
+                Dfl::API::None);
+    }
+
+    std::vector<uint32_t> families{ queue.FamilyIndex };
+    for (const uint32_t family : info.AccessingQueues)
+    {
+        if (std::find(families.begin(), families.end(), family) == families.end()) { families.push_back(family); }
+    }
+
+    VkImage         image{ nullptr };
+    VkBuffer        feedback{ nullptr };
+    VkBuffer        stage{ nullptr };
+    VkCommandPool   cmdPool{ nullptr };
+    VkCommandBuffer cmdBuffer{ nullptr };
+    VkSemaphore     bound{ nullptr };
+    VkFence         fence{ nullptr };
+    DflMem::VirtualTexture::Allocation mipTail{ };
+    DflMem::VirtualTexture::Allocation pool{ };
+    DflMem::VirtualTexture::Allocation feedbackMemory{ };
+    DflMem::VirtualTexture::Allocation stageMemory{ };
+    try {
+        const VkImageCreateInfo imageInfo{
+            .sType{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ VK_IMAGE_CREATE_SPARSE_BINDING_BIT | VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT },
+            .imageType{ VK_IMAGE_TYPE_2D },
+            .format{ info.Format },
+            .extent{ info.Size[0], info.Size[1], 1 },
+            .mipLevels{ info.MipLevels },
+            .arrayLayers{ 1 },
+            .samples{ VK_SAMPLE_COUNT_1_BIT },
+            .tiling{ VK_IMAGE_TILING_OPTIMAL },
+            .usage{ info.Options | VK_IMAGE_USAGE_TRANSFER_DST_BIT },
+            .sharingMode{ families.size() > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE },
+            .queueFamilyIndexCount{ families.size() > 1 ? static_cast<uint32_t>(families.size()) : 0 },
+            .pQueueFamilyIndices{ families.size() > 1 ? families.data() : nullptr },
+            .initialLayout{ VK_IMAGE_LAYOUT_UNDEFINED }
+        };
+        if ( vkCreateImage(
+                hGPU,
+                &imageInfo,
+                nullptr,
+                &image) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create sparse image",
+                    L"INT_GetHandles");
+        }
+
+        VkMemoryRequirements requirements{ };
+        vkGetImageMemoryRequirements(
+            hGPU,
+            image,
+            &requirements);
+
+        uint32_t sparseCount{ 0 };
+        vkGetImageSparseMemoryRequirements(
+            hGPU,
+            image,
+            &sparseCount,
+            nullptr);
+        std::vector<VkSparseImageMemoryRequirements> sparseRequirements(sparseCount);
+        vkGetImageSparseMemoryRequirements(
+            hGPU,
+            image,
+            &sparseCount,
+            sparseRequirements.data());
+        const auto colour{ std::find_if(
+                            sparseRequirements.begin(),
+                            sparseRequirements.end(),
+                            [](const VkSparseImageMemoryRequirements& sparse) {
+                                return (sparse.formatProperties.aspectMask & VK_IMAGE_ASPECT_COLOR_BIT) != 0; }) };
+        if (colour == sparseRequirements.end())
+        {
+            throw Dfl::Error::NoData(
+                    L"Sparse image has no colour tiles",
+                    L"INT_GetHandles",
+                    Dfl::API::None);
+        }
+
+        // the sparse block is a tile, and takes as much memory as the image's alignment
+        const std::array<uint32_t, 2> tileSize{
+            colour->formatProperties.imageGranularity.width,
+            colour->formatProperties.imageGranularity.height };
+        const uint64_t tileMemory{ requirements.alignment };
+        const uint32_t mipTailLevel{ std::min(colour->imageMipTailFirstLod, info.MipLevels) };
+        const uint64_t mipTailSize{ mipTailLevel < info.MipLevels ? colour->imageMipTailSize : 0 };
+
+        const uint64_t poolTiles{ info.Budget > mipTailSize ? (info.Budget - mipTailSize) / tileMemory : 0 };
+        if (poolTiles == 0)
+        {
+            throw Dfl::Error::Limit(
+                    L"Budget of the virtual texture doesn't fit a single tile",
+                    L"INT_GetHandles",
+                    Dfl::API::None);
+        }
+
+        if (mipTailSize > 0)
+        {
+            mipTail = INT_Allocate(gpu, { mipTailSize, requirements.alignment, requirements.memoryTypeBits }, false);
+        }
+        pool = INT_Allocate(gpu, { poolTiles * tileMemory, requirements.alignment, requirements.memoryTypeBits }, false);
+
+        uint64_t tileCount{ 0 };
+        for (const auto& tiles : INT_GetLevelTiles(info.Size, tileSize, mipTailLevel))
+        {
+            tileCount += static_cast<uint64_t>(tiles[0]) * tiles[1];
+        }
+        feedback = INT_GetBuffer(
+                    hGPU,
+                    std::max<uint64_t>(tileCount, 1) * sizeof(uint32_t),
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                    families);
+        VkMemoryRequirements feedbackRequirements{ };
+        vkGetBufferMemoryRequirements(
+            hGPU,
+            feedback,
+            &feedbackRequirements);
+        feedbackMemory = INT_Allocate(gpu, feedbackRequirements, true);
+
+        const uint64_t stageSlotSize{ block.GetCopySize({ tileSize[0], tileSize[1], 1 }) };
+        stage = INT_GetBuffer(
+                    hGPU,
+                    stageSlotSize * info.MaxUploads + INT_GetMipTailStageSize(info, mipTailLevel),
+                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    { queue.FamilyIndex });
+        VkMemoryRequirements stageRequirements{ };
+        vkGetBufferMemoryRequirements(
+            hGPU,
+            stage,
+            &stageRequirements);
+        stageMemory = INT_Allocate(gpu, stageRequirements, true);
+
+        void* pFeedback{ nullptr };
+        void* pStage{ nullptr };
+        if ( vkBindBufferMemory(hGPU, feedback, feedbackMemory.hMemory, 0) != VK_SUCCESS
+             || vkBindBufferMemory(hGPU, stage, stageMemory.hMemory, 0) != VK_SUCCESS
+             || vkMapMemory(hGPU, feedbackMemory.hMemory, 0, VK_WHOLE_SIZE, 0, &pFeedback) != VK_SUCCESS
+             || vkMapMemory(hGPU, stageMemory.hMemory, 0, VK_WHOLE_SIZE, 0, &pStage) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to bind and map the feedback and stage buffers",
+                    L"INT_GetHandles");
+        }
+        std::memset(pFeedback, 0, feedbackRequirements.size);
+
+        const VkCommandPoolCreateInfo poolInfo{
+            .sType{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT },
+            .queueFamilyIndex{ queue.FamilyIndex }
+        };
+        if ( vkCreateCommandPool(
+                hGPU,
+                &poolInfo,
+                nullptr,
+                &cmdPool) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create command pool",
+                    L"INT_GetHandles");
+        }
+
+        const VkCommandBufferAllocateInfo bufferInfo{
+            .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO },
+            .pNext{ nullptr },
+            .commandPool{ cmdPool },
+            .level{ VK_COMMAND_BUFFER_LEVEL_PRIMARY },
+            .commandBufferCount{ 1 }
+        };
+        if ( vkAllocateCommandBuffers(
+                hGPU,
+                &bufferInfo,
+                &cmdBuffer) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to allocate command buffer",
+                    L"INT_GetHandles");
+        }
+
+        const VkSemaphoreCreateInfo semaphoreInfo{
+            .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 }
+        };
+        const VkFenceCreateInfo fenceInfo{
+            .sType{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 }
+        };
+        if ( vkCreateSemaphore(
+                hGPU,
+                &semaphoreInfo,
+                nullptr,
+                &bound) != VK_SUCCESS
+             || vkCreateFence(
+                hGPU,
+                &fenceInfo,
+                nullptr,
+                &fence) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create synchronization primitives",
+                    L"INT_GetHandles");
+        }
+
+        // the mip tail is bound for good, and its binding signals the fence,
+        // so that the first update waits for it
+        const VkSparseMemoryBind mipTailBind{
+            .resourceOffset{ colour->imageMipTailOffset },
+            .size{ mipTailSize },
+            .memory{ mipTail.hMemory },
+            .memoryOffset{ 0 },
+            .flags{ 0 }
+        };
+        const VkSparseImageOpaqueMemoryBindInfo opaqueInfo{
+            .image{ image },
+            .bindCount{ 1 },
+            .pBinds{ &mipTailBind }
+        };
+        const VkBindSparseInfo bindInfo{
+            .sType{ VK_STRUCTURE_TYPE_BIND_SPARSE_INFO },
+            .pNext{ nullptr },
+            .waitSemaphoreCount{ 0 },
+            .pWaitSemaphores{ nullptr },
+            .bufferBindCount{ 0 },
+            .pBufferBinds{ nullptr },
+            .imageOpaqueBindCount{ mipTailSize > 0 ? 1u : 0u },
+            .pImageOpaqueBinds{ &opaqueInfo },
+            .imageBindCount{ 0 },
+            .pImageBinds{ nullptr },
+            .signalSemaphoreCount{ 0 },
+            .pSignalSemaphores{ nullptr }
+        };
+        if ( vkQueueBindSparse(
+                queue,
+                1,
+                &bindInfo,
+                fence) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to bind the mip tail",
+                    L"INT_GetHandles");
+        }
+
+        return { queue,
+                 cmdPool,
+                 cmdBuffer,
+                 bound,
+                 fence,
+                 image,
+                 tileSize,
+                 tileMemory,
+                 mipTailLevel,
+                 colour->imageMipTailOffset,
+                 mipTail,
+                 pool,
+                 feedback,
+                 feedbackMemory,
+                 static_cast<uint32_t*>(pFeedback),
+                 stage,
+                 stageMemory,
+                 static_cast<std::byte*>(pStage),
+                 stageSlotSize };
+    }
+    catch (Dfl::Error::Generic& err) {
+        if (fence != nullptr) { vkDestroyFence(hGPU, fence, nullptr); }
+        if (bound != nullptr) { vkDestroySemaphore(hGPU, bound, nullptr); }
+        if (cmdPool != nullptr) { vkDestroyCommandPool(hGPU, cmdPool, nullptr); }
+        if (stage != nullptr) { vkDestroyBuffer(hGPU, stage, nullptr); }
+        if (feedback != nullptr) { vkDestroyBuffer(hGPU, feedback, nullptr); }
+        if (image != nullptr) { vkDestroyImage(hGPU, image, nullptr); }
+
+        INT_Return(gpu, stageMemory);
+        INT_Return(gpu, feedbackMemory);
+        INT_Return(gpu, pool);
+        INT_Return(gpu, mipTail);
+
+        gpu.ReturnQueue(queue);
+
+        throw;
+    }
+}
+
+// A tile taken out of its slot by an update, to be put back if the binding fails
+struct INT_Eviction {
+    uint32_t Slot{ 0 };
+    uint32_t Tile{ 0 };
+    uint64_t LastUsed{ 0 };
+};
+
+static inline VkImageMemoryBarrier2 INT_GetBarrier(
+    const VkImage               image,
+    const uint32_t              levels,
+    const VkImageLayout         oldLayout,
+    const VkImageLayout         newLayout,
+    const VkPipelineStageFlags2 srcStages,
+    const VkAccessFlags2        srcAccess,
+    const VkPipelineStageFlags2 dstStages,
+    const VkAccessFlags2        dstAccess)
+{
+    return { .sType{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 },
+             .pNext{ nullptr },
+             .srcStageMask{ srcStages },
+             .srcAccessMask{ srcAccess },
+             .dstStageMask{ dstStages },
+             .dstAccessMask{ dstAccess },
+             .oldLayout{ oldLayout },
+             .newLayout{ newLayout },
+             .srcQueueFamilyIndex{ VK_QUEUE_FAMILY_IGNORED },
+             .dstQueueFamilyIndex{ VK_QUEUE_FAMILY_IGNORED },
+             .image{ image },
+             .subresourceRange{
+                .aspectMask{ VK_IMAGE_ASPECT_COLOR_BIT },
+                .baseMipLevel{ 0 },
+                .levelCount{ levels },
+                .baseArrayLayer{ 0 },
+                .layerCount{ 1 } } };
+}
+
+static inline void INT_RecordBarrier(
+    const VkCommandBuffer        cmdBuffer,
+    const VkImageMemoryBarrier2& barrier)
+{
+    const VkDependencyInfo dependency{
+        .sType{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO },
+        .pNext{ nullptr },
+        .dependencyFlags{ 0 },
+        .memoryBarrierCount{ 0 },
+        .pMemoryBarriers{ nullptr },
+        .bufferMemoryBarrierCount{ 0 },
+        .pBufferMemoryBarriers{ nullptr },
+        .imageMemoryBarrierCount{ 1 },
+        .pImageMemoryBarriers{ &barrier }
+    };
+    vkCmdPipelineBarrier2(
+        cmdBuffer,
+        &dependency);
+}
+
+// Dragonfly.Memory.VirtualTexture
+
+DflMem::VirtualTexture::VirtualTexture(const Info& info)
+: pInfo( new Info(info) ),
+  Texture( INT_GetHandles(
+             info.Device,
+             info) )
+{
+    const auto levelTiles{ INT_GetLevelTiles(
+                            info.Size,
+                            this->Texture.TileSize,
+                            this->Texture.MipTailLevel) };
+    uint32_t tileCount{ 0 };
+    for (const auto& tiles : levelTiles)
+    {
+        this->LevelOffsets.push_back(tileCount);
+        this->TilesX.push_back(tiles[0]);
+        tileCount += tiles[0] * tiles[1];
+    }
+
+    const uint32_t slotCount{ static_cast<uint32_t>(this->Texture.Pool.Size / this->Texture.TileMemory) };
+    this->SlotOfTile.assign(tileCount, INT_None);
+    this->TileOfSlot.assign(slotCount, INT_None);
+    this->LastUsed.assign(slotCount, 0);
+    // the first slots are taken first
+    for (uint32_t slot{ slotCount }; slot > 0; slot--)
+    {
+        this->FreeSlots.push_back(slot - 1);
+    }
+}
+
+DflMem::VirtualTexture::~VirtualTexture()
+{
+    const VkDevice& device{ this->pInfo->Device.GetDevice() };
+    vkWaitForFences(
+        device,
+        1,
+        &this->Texture.hFence,
+        VK_TRUE,
+        UINT64_MAX);
+
+    vkDestroyFence(device, this->Texture.hFence, nullptr);
+    vkDestroySemaphore(device, this->Texture.hBound, nullptr);
+    vkDestroyCommandPool(device, this->Texture.hCmdPool, nullptr);
+    vkDestroyBuffer(device, this->Texture.hStage, nullptr);
+    vkDestroyBuffer(device, this->Texture.hFeedback, nullptr);
+    vkDestroyImage(device, this->Texture.hImage, nullptr);
+
+    // freeing mapped memory unmaps it
+    INT_Return(this->pInfo->Device, this->Texture.StageMemory);
+    INT_Return(this->pInfo->Device, this->Texture.FeedbackMemory);
+    INT_Return(this->pInfo->Device, this->Texture.Pool);
+    INT_Return(this->pInfo->Device, this->Texture.MipTail);
+
+    this->pInfo->Device.ReturnQueue(this->Texture.SparseQueue);
+}
+
+auto DflMem::VirtualTexture::GetTile(const uint32_t tile) const noexcept
+-> Tile
+{
+    const uint32_t level{ static_cast<uint32_t>(
+                            std::upper_bound(this->LevelOffsets.begin(), this->LevelOffsets.end(), tile)
+                            - this->LevelOffsets.begin() ) - 1 };
+    const uint32_t local{ tile - this->LevelOffsets[level] };
+    const std::array<uint32_t, 2> index{ local % this->TilesX[level], local / this->TilesX[level] };
+    const std::array<uint32_t, 2> levelSize{ INT_GetLevelSize(this->pInfo->Size, level) };
+    const std::array<uint32_t, 2> offset{
+        index[0] * this->Texture.TileSize[0],
+        index[1] * this->Texture.TileSize[1] };
+
+    return { .Level{ level },
+             .Index{ index },
+             .Offset{ offset },
+             .Extent{ std::min(this->Texture.TileSize[0], levelSize[0] - offset[0]),
+                      std::min(this->Texture.TileSize[1], levelSize[1] - offset[1]) } };
+}
+
+auto DflMem::VirtualTexture::Update(const DflHW::Device::TimelinePoint& sampled)
+-> DflGen::Job<Error>
+{
+    const VkDevice gpu{ this->pInfo->Device.GetDevice() };
+
+    // the command buffer and the stage may be in use by the previous update,
+    // or the mip tail still being bound
+    while (vkGetFenceStatus(gpu, this->Texture.hFence) == VK_NOT_READY)
+    {
+        co_await DflGen::Job<Error>::Awaitable(
+            gpu,
+            this->Texture.hFence);
+    }
+
+    // nothing is read from the feedback, unbound or copied over until the
+    // work sampling the image and writing the feedback is done
+    if (sampled.hSemaphore != nullptr)
+    {
+        const VkSemaphoreSubmitInfo wait{
+            .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO },
+            .pNext{ nullptr },
+            .semaphore{ sampled.hSemaphore },
+            .value{ sampled.Value },
+            .stageMask{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT },
+            .deviceIndex{ 0 }
+        };
+        const VkSubmitInfo2 waitInfo{
+            .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .waitSemaphoreInfoCount{ 1 },
+            .pWaitSemaphoreInfos{ &wait },
+            .commandBufferInfoCount{ 0 },
+            .pCommandBufferInfos{ nullptr },
+            .signalSemaphoreInfoCount{ 0 },
+            .pSignalSemaphoreInfos{ nullptr }
+        };
+        vkResetFences(
+            gpu,
+            1,
+            &this->Texture.hFence);
+        if ( vkQueueSubmit2(
+                this->Texture.SparseQueue,
+                1,
+                &waitInfo,
+                this->Texture.hFence) != VK_SUCCESS )
+        {
+            // the fence still has to be signaled, or the next update would wait forever
+            vkQueueSubmit(
+                this->Texture.SparseQueue,
+                0,
+                nullptr,
+                this->Texture.hFence);
+            co_return Error::SubmitError;
+        }
+
+        while (vkGetFenceStatus(gpu, this->Texture.hFence) == VK_NOT_READY)
+        {
+            co_await DflGen::Job<Error>::Awaitable(
+                gpu,
+                this->Texture.hFence);
+        }
+    }
+
+    const uint64_t update{ ++this->Updates };
+    Statistics statistics{ };
+
+    // resident tiles that are requested stay; the rest are to be loaded
+    std::vector<uint32_t> missing{ };
+    for (uint32_t tile{ 0 }; tile < this->SlotOfTile.size(); tile++)
+    {
+        if (this->Texture.pFeedback[tile] == 0) { continue; }
+
+        statistics.Requested++;
+        if (this->SlotOfTile[tile] != INT_None) { this->LastUsed[this->SlotOfTile[tile]] = update; }
+        else { missing.push_back(tile); }
+    }
+    std::memset(this->Texture.pFeedback, 0, this->SlotOfTile.size() * sizeof(uint32_t));
+
+    // coarser levels first, since finer ones are sampled from them while they're out
+    std::stable_sort(
+        missing.begin(),
+        missing.end(),
+        [this](const uint32_t a, const uint32_t b) {
+            return this->GetTile(a).Level > this->GetTile(b).Level; });
+
+    // tiles not requested in this update can go, the least recently requested first
+    std::vector<uint32_t> evictable{ };
+    for (uint32_t slot{ 0 }; slot < this->TileOfSlot.size(); slot++)
+    {
+        if ( this->TileOfSlot[slot] != INT_None
+             && this->LastUsed[slot] < update )
+        {
+            evictable.push_back(slot);
+        }
+    }
+    std::sort(
+        evictable.begin(),
+        evictable.end(),
+        [this](const uint32_t a, const uint32_t b) {
+            return this->LastUsed[a] < this->LastUsed[b]; });
+
+    const INT_Image::TexelBlock block{ INT_Image::GetTexelBlock(this->pInfo->Format) };
+    std::vector<VkSparseImageMemoryBind> unbinds{ };
+    std::vector<VkSparseImageMemoryBind> binds{ };
+    std::vector<VkBufferImageCopy> copies{ };
+    std::vector<uint32_t> loaded{ };
+    std::vector<INT_Eviction> evictions{ };
+    uint64_t nextEvictable{ 0 };
+    for (const uint32_t tile : missing)
+    {
+        if (loaded.size() == this->pInfo->MaxUploads) { break; }
+
+        uint32_t slot{ INT_None };
+        if (!this->FreeSlots.empty())
+        {
+            slot = this->FreeSlots.back();
+            this->FreeSlots.pop_back();
+        }
+        else if (nextEvictable < evictable.size())
+        {
+            slot = evictable[nextEvictable++];
+
+            const Tile evicted{ this->GetTile(this->TileOfSlot[slot]) };
+            unbinds.push_back({
+                .subresource{ VK_IMAGE_ASPECT_COLOR_BIT, evicted.Level, 0 },
+                .offset{ static_cast<int32_t>(evicted.Offset[0]), static_cast<int32_t>(evicted.Offset[1]), 0 },
+                .extent{ evicted.Extent[0], evicted.Extent[1], 1 },
+                .memory{ nullptr },
+                .memoryOffset{ 0 },
+                .flags{ 0 } });
+            evictions.push_back({ .Slot{ slot }, .Tile{ this->TileOfSlot[slot] }, .LastUsed{ this->LastUsed[slot] } });
+            this->SlotOfTile[this->TileOfSlot[slot]] = INT_None;
+            this->TileOfSlot[slot] = INT_None;
+            statistics.Evicted++;
+        }
+        else
+        {
+            // every slot holds a tile requested in this update
+            break;
+        }
+
+        const Tile target{ this->GetTile(tile) };
+        const uint64_t stageOffset{ loaded.size() * this->Texture.StageSlotSize };
+        const std::span<std::byte> texels(
+                                    this->Texture.pStage + stageOffset,
+                                    block.GetCopySize({ target.Extent[0], target.Extent[1], 1 }));
+        if (!this->pInfo->Loader(target, texels))
+        {
+            this->FreeSlots.push_back(slot);
+            continue;
+        }
+
+        binds.push_back({
+            .subresource{ VK_IMAGE_ASPECT_COLOR_BIT, target.Level, 0 },
+            .offset{ static_cast<int32_t>(target.Offset[0]), static_cast<int32_t>(target.Offset[1]), 0 },
+            .extent{ target.Extent[0], target.Extent[1], 1 },
+            .memory{ this->Texture.Pool.hMemory },
+            .memoryOffset{ slot * this->Texture.TileMemory },
+            .flags{ 0 } });
+        copies.push_back({
+            .bufferOffset{ stageOffset },
+            .bufferRowLength{ 0 },
+            .bufferImageHeight{ 0 },
+            .imageSubresource{ VK_IMAGE_ASPECT_COLOR_BIT, target.Level, 0, 1 },
+            .imageOffset{ static_cast<int32_t>(target.Offset[0]), static_cast<int32_t>(target.Offset[1]), 0 },
+            .imageExtent{ target.Extent[0], target.Extent[1], 1 } });
+        this->SlotOfTile[tile] = slot;
+        this->TileOfSlot[slot] = tile;
+        this->LastUsed[slot] = update;
+        loaded.push_back(tile);
+    }
+    statistics.Loaded = static_cast<uint32_t>(loaded.size());
+    statistics.Missing = static_cast<uint32_t>(missing.size() - loaded.size());
+
+    // the mip tail is loaded once, after the tiles in the stage
+    bool isTailLoading{ false };
+    if (!this->IsTailLoaded)
+    {
+        isTailLoading = true;
+        uint64_t stageOffset{ this->pInfo->MaxUploads * this->Texture.StageSlotSize };
+        for (uint32_t level{ this->Texture.MipTailLevel }; level < this->pInfo->MipLevels; level++)
+        {
+            const std::array<uint32_t, 2> levelSize{ INT_GetLevelSize(this->pInfo->Size, level) };
+            const uint64_t size{ block.GetCopySize({ levelSize[0], levelSize[1], 1 }) };
+            const Tile whole{ .Level{ level }, .Extent{ levelSize } };
+            if (!this->pInfo->Loader(whole, std::span<std::byte>(this->Texture.pStage + stageOffset, size)))
+            {
+                isTailLoading = false;
+                break;
+            }
+
+            copies.push_back({
+                .bufferOffset{ stageOffset },
+                .bufferRowLength{ 0 },
+                .bufferImageHeight{ 0 },
+                .imageSubresource{ VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 },
+                .imageOffset{ 0, 0, 0 },
+                .imageExtent{ levelSize[0], levelSize[1], 1 } });
+            stageOffset += size;
+        }
+
+        // a level the loader couldn't fill has them all tried again next time
+        if (!isTailLoading) { copies.resize(loaded.size()); }
+    }
+
+    const bool isBinding{ !unbinds.empty() || !binds.empty() };
+    if ( copies.empty()
+         && !isBinding
+         && this->IsInitialized )
+    {
+        statistics.Resident = static_cast<uint32_t>(this->TileOfSlot.size() - this->FreeSlots.size());
+        this->LastUpdate = statistics;
+        co_return Error::Success;
+    }
+
+    Error error{ Error::Success };
+    vkResetFences(
+        gpu,
+        1,
+        &this->Texture.hFence);
+
+    // evicted tiles are unbound in a batch before the one that binds their
+    // slots again, so no memory is ever bound to two tiles
+    if (isBinding)
+    {
+        const VkSparseImageMemoryBindInfo unbindInfo{
+            .image{ this->Texture.hImage },
+            .bindCount{ static_cast<uint32_t>(unbinds.size()) },
+            .pBinds{ unbinds.data() }
+        };
+        const VkSparseImageMemoryBindInfo bindInfo{
+            .image{ this->Texture.hImage },
+            .bindCount{ static_cast<uint32_t>(binds.size()) },
+            .pBinds{ binds.data() }
+        };
+        const std::array<VkBindSparseInfo, 2> batches{
+            VkBindSparseInfo{
+                .sType{ VK_STRUCTURE_TYPE_BIND_SPARSE_INFO },
+                .pNext{ nullptr },
+                .waitSemaphoreCount{ 0 },
+                .pWaitSemaphores{ nullptr },
+                .bufferBindCount{ 0 },
+                .pBufferBinds{ nullptr },
+                .imageOpaqueBindCount{ 0 },
+                .pImageOpaqueBinds{ nullptr },
+                .imageBindCount{ unbinds.empty() ? 0u : 1u },
+                .pImageBinds{ &unbindInfo },
+                .signalSemaphoreCount{ 0 },
+                .pSignalSemaphores{ nullptr } },
+            VkBindSparseInfo{
+                .sType{ VK_STRUCTURE_TYPE_BIND_SPARSE_INFO },
+                .pNext{ nullptr },
+                .waitSemaphoreCount{ 0 },
+                .pWaitSemaphores{ nullptr },
+                .bufferBindCount{ 0 },
+                .pBufferBinds{ nullptr },
+                .imageOpaqueBindCount{ 0 },
+                .pImageOpaqueBinds{ nullptr },
+                .imageBindCount{ binds.empty() ? 0u : 1u },
+                .pImageBinds{ &bindInfo },
+                .signalSemaphoreCount{ 1 },
+                .pSignalSemaphores{ &this->Texture.hBound } } };
+        if ( vkQueueBindSparse(
+                this->Texture.SparseQueue,
+                static_cast<uint32_t>(batches.size()),
+                batches.data(),
+                nullptr) != VK_SUCCESS )
+        {
+            error = Error::BindError;
+        }
+    }
+
+    if (error == Error::Success)
+    {
+        const VkCommandBufferBeginInfo beginInfo{
+            .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO },
+            .pNext{ nullptr },
+            .flags{ VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT },
+            .pInheritanceInfo{ nullptr }
+        };
+        if ( vkResetCommandBuffer(this->Texture.hCmdBuffer, 0) != VK_SUCCESS
+             || vkBeginCommandBuffer(this->Texture.hCmdBuffer, &beginInfo) != VK_SUCCESS )
+        {
+            error = Error::RecordError;
+        }
+        else
+        {
+            {
+                DflHW::Profiler::Zone zone(
+                                        this->pInfo->pProfiler,
+                                        this->Texture.hCmdBuffer,
+                                        this->Texture.SparseQueue.FamilyIndex,
+                                        "VirtualTexture::Update");
+
+                // the sampling is done, and the submission waits for the
+                // binding, so the transition only has to come after that
+                // wait, at whatever stage it's done; resident tiles are kept,
+                // unless the image is still undefined
+                INT_RecordBarrier(
+                    this->Texture.hCmdBuffer,
+                    INT_GetBarrier(
+                        this->Texture.hImage,
+                        this->pInfo->MipLevels,
+                        this->IsInitialized ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                        VK_ACCESS_2_NONE,
+                        VK_PIPELINE_STAGE_2_COPY_BIT,
+                        VK_ACCESS_2_TRANSFER_WRITE_BIT));
+
+                if (!copies.empty())
+                {
+                    vkCmdCopyBufferToImage(
+                        this->Texture.hCmdBuffer,
+                        this->Texture.hStage,
+                        this->Texture.hImage,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        static_cast<uint32_t>(copies.size()),
+                        copies.data());
+                }
+
+                INT_RecordBarrier(
+                    this->Texture.hCmdBuffer,
+                    INT_GetBarrier(
+                        this->Texture.hImage,
+                        this->pInfo->MipLevels,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                        VK_PIPELINE_STAGE_2_COPY_BIT,
+                        VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                        VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                        VK_ACCESS_2_SHADER_SAMPLED_READ_BIT));
+            }
+
+            if (vkEndCommandBuffer(this->Texture.hCmdBuffer) != VK_SUCCESS)
+            {
+                if (this->pInfo->pProfiler != nullptr)
+                {
+                    this->pInfo->pProfiler->Discard(this->Texture.hCmdBuffer);
+                }
+                error = Error::RecordError;
+            }
+        }
+
+        const VkPipelineStageFlags waitStage{ VK_PIPELINE_STAGE_TRANSFER_BIT };
+        const VkSubmitInfo submitInfo{
+            .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO },
+            .pNext{ nullptr },
+            .waitSemaphoreCount{ isBinding ? 1u : 0u },
+            .pWaitSemaphores{ &this->Texture.hBound },
+            .pWaitDstStageMask{ &waitStage },
+            .commandBufferCount{ error == Error::Success ? 1u : 0u },
+            .pCommandBuffers{ &this->Texture.hCmdBuffer },
+            .signalSemaphoreCount{ 0 },
+            .pSignalSemaphores{ nullptr }
+        };
+        // a failed recording still submits, without the commands, so the
+        // binding's semaphore is waited on and can be signaled again
+        if ( vkQueueSubmit(
+                this->Texture.SparseQueue,
+                1,
+                &submitInfo,
+                this->Texture.hFence) != VK_SUCCESS )
+        {
+            // the fence still has to be signaled, or the next update would wait forever
+            vkQueueSubmit(
+                this->Texture.SparseQueue,
+                0,
+                nullptr,
+                this->Texture.hFence);
+            if (this->pInfo->pProfiler != nullptr)
+            {
+                this->pInfo->pProfiler->Discard(this->Texture.hCmdBuffer);
+            }
+            error = Error::SubmitError;
+        }
+    }
+    else
+    {
+        vkQueueSubmit(
+            this->Texture.SparseQueue,
+            0,
+            nullptr,
+            this->Texture.hFence);
+    }
+
+    while (vkGetFenceStatus(gpu, this->Texture.hFence) == VK_NOT_READY)
+    {
+        co_await DflGen::Job<Error>::Awaitable(
+            gpu,
+            this->Texture.hFence);
+    }
+
+    if (error == Error::Success)
+    {
+        this->IsInitialized = true;
+        this->IsTailLoaded = this->IsTailLoaded || isTailLoading;
+    }
+    else
+    {
+        // the loaded tiles aren't in the image, so they're requested again
+        for (const uint32_t tile : loaded)
+        {
+            this->TileOfSlot[this->SlotOfTile[tile]] = INT_None;
+            this->FreeSlots.push_back(this->SlotOfTile[tile]);
+            this->SlotOfTile[tile] = INT_None;
+        }
+
+        // evicted ones were unbound, unless the binding failed, which leaves
+        // them bound to their slots, so they're put back
+        if (error == Error::BindError)
+        {
+            for (const auto& eviction : evictions)
+            {
+                const auto free{ std::find(this->FreeSlots.begin(), this->FreeSlots.end(), eviction.Slot) };
+                if (free != this->FreeSlots.end()) { this->FreeSlots.erase(free); }
+
+                this->TileOfSlot[eviction.Slot] = eviction.Tile;
+                this->SlotOfTile[eviction.Tile] = eviction.Slot;
+                this->LastUsed[eviction.Slot] = eviction.LastUsed;
+            }
+            statistics.Evicted = 0;
+        }
+        statistics.Loaded = 0;
+        statistics.Missing = static_cast<uint32_t>(missing.size());
+    }
+
+    statistics.Resident = static_cast<uint32_t>(this->TileOfSlot.size() - this->FreeSlots.size());
+    this->LastUpdate = statistics;
+    co_return error;
+}
+
+bool DflMem::VirtualTexture::IsSupported(
+    const DflHW::Device& device,
+    const VkFormat       format) noexcept
+{
+    VkPhysicalDeviceFeatures features{ };
+    vkGetPhysicalDeviceFeatures(
+        device.GetPhysicalDevice(),
+        &features);
+    if ( !features.sparseBinding
+         || !features.sparseResidencyImage2D )
+    {
+        return false;
+    }
+
+    uint32_t count{ 0 };
+    vkGetPhysicalDeviceSparseImageFormatProperties(
+        device.GetPhysicalDevice(),
+        format,
+        VK_IMAGE_TYPE_2D,
+        VK_SAMPLE_COUNT_1_BIT,
+        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        VK_IMAGE_TILING_OPTIMAL,
+        &count,
+        nullptr);
+
+    return count > 0;
+}
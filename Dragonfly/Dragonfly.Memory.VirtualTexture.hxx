@@ -0,0 +1,197 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <array>
+#include <span>
+#include <cstddef>
+#include <functional>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "Dragonfly.h"
+
+#include "Dragonfly.Generics.hxx"
+#include "Dragonfly.Hardware.Device.hxx"
+#include "Dragonfly.Hardware.Profiler.hxx"
+#include "Dragonfly.Memory.Buffer.hxx"
+
+namespace Dfl {
+    // Dragonfly.Memory
+    namespace Memory {
+        // Dragonfly.Memory.VirtualTexture
+        // An image too big to keep in device memory whole, of which only the
+        // tiles that are sampled are. The image is sparse, so its tiles can be
+        // bound to memory one by one: a pool of Budget B is split into slots
+        // of a tile each, and Update moves tiles in and out of them.
+        // Shaders say which tiles they need through the feedback buffer, one
+        // uint per tile of every level out of the mip tail, in order of level,
+        // then row, then column. A shader sampling (u, v) at level l sets
+        //     Feedback[LevelOffsets[l] + (y / TileHeight) * TilesX[l] + x / TileWidth]
+        // to non-zero, with (x, y) the texel at l. Levels in the mip tail are
+        // always resident.
+        // Tiles are bound with vkQueueBindSparse and filled by the loader
+        // through a staging buffer, on a queue that can do both.
+        class VirtualTexture {
+        public:
+            // Where a tile is, at its level
+            struct Tile {
+                uint32_t                Level{ 0 };
+                std::array<uint32_t, 2> Index{ 0, 0 }; // in tiles
+                std::array<uint32_t, 2> Offset{ 0, 0 }; // in texels
+                std::array<uint32_t, 2> Extent{ 0, 0 }; // in texels, less than a tile at the level's edges
+            };
+
+            struct Info {
+                      DflHW::Device&        Device;
+
+                const std::vector<uint32_t> AccessingQueues; // families other than the sparse queue's that use the image
+
+                const std::array<uint32_t, 2> Size{ 16384, 16384 }; // in texels
+                const uint32_t              MipLevels{ 1 };
+                const VkFormat              Format{ VK_FORMAT_R8G8B8A8_UNORM };
+                const uint64_t              Budget{ 256 * 1024 * 1024 }; // B of device memory for the tiles and the mip tail
+                const uint32_t              MaxUploads{ 64 }; // tiles streamed in per update
+
+                // Fills the texels of a tile, tightly packed in blocks of the
+                // format, row after row. Returns false if it can't, and the tile
+                // stays out.
+                const std::function<
+                    bool(const Tile&,
+                         std::span<std::byte>)> Loader;
+
+                const DflGen::BitFlag       Options{ VK_IMAGE_USAGE_SAMPLED_BIT }; // usage of the image
+
+                      DflHW::Profiler*      pProfiler{ nullptr }; // if not null, uploads are timed
+            };
+
+            // Device memory the texture took for itself
+            struct Allocation {
+                VkDeviceMemory            hMemory{ nullptr };
+                DflHW::Device::MemoryType HeapType{ DflHW::Device::MemoryType::Local };
+                uint64_t                  HeapIndex{ 0 };
+                uint64_t                  Size{ 0 };
+            };
+
+            struct Handles {
+                const DflHW::Device::Queue    SparseQueue{ };
+                const VkCommandPool           hCmdPool{ nullptr };
+                const VkCommandBuffer         hCmdBuffer{ nullptr };
+                const VkSemaphore             hBound{ nullptr }; // signaled once the tiles of an update are bound
+                const VkFence                 hFence{ nullptr };
+
+                const VkImage                 hImage{ nullptr };
+                const std::array<uint32_t, 2> TileSize{ 0, 0 }; // in texels
+                const uint64_t                TileMemory{ 0 }; // B of device memory a tile is bound to
+                const uint32_t                MipTailLevel{ 0 }; // the first level in the mip tail
+                const uint64_t                MipTailOffset{ 0 };
+                const Allocation              MipTail{ };
+                const Allocation              Pool{ };
+
+                const VkBuffer                hFeedback{ nullptr };
+                const Allocation              FeedbackMemory{ };
+                      uint32_t* const         pFeedback{ nullptr };
+
+                const VkBuffer                hStage{ nullptr };
+                const Allocation              StageMemory{ };
+                      std::byte* const        pStage{ nullptr };
+                const uint64_t                StageSlotSize{ 0 }; // B of the texels of a tile
+            };
+
+            struct Statistics {
+                uint32_t Requested{ 0 }; // tiles the feedback asked for
+                uint32_t Loaded{ 0 };
+                uint32_t Evicted{ 0 };
+                uint32_t Resident{ 0 }; // tiles bound to the pool after the update
+                uint32_t Missing{ 0 }; // requested tiles that stayed out, for lack of room or uploads
+            };
+
+            enum class Error {
+                Success = 0,
+                RecordError = -1,
+                SubmitError = -2,
+                BindError = -3
+            };
+
+        protected:
+            const std::unique_ptr<const Info> pInfo{ nullptr };
+
+            const Handles                     Texture{ };
+
+                  std::vector<uint32_t>       LevelOffsets{ }; // of the first tile of every level out of the tail
+                  std::vector<uint32_t>       TilesX{ }; // tiles in a row of every level out of the tail
+
+                  std::vector<uint32_t>       SlotOfTile{ }; // or none, if the tile isn't resident
+                  std::vector<uint32_t>       TileOfSlot{ }; // or none, if the slot is free
+                  std::vector<uint64_t>       LastUsed{ }; // of every slot, as the update it was last requested in
+                  std::vector<uint32_t>       FreeSlots{ };
+                  uint64_t                    Updates{ 0 };
+                  bool                        IsTailLoaded{ false };
+                  bool                        IsInitialized{ false }; // the image has left the undefined layout
+
+                  Statistics                  LastUpdate{ };
+
+                  Tile                        GetTile(const uint32_t tile) const noexcept;
+        public:
+            DFL_API DFL_CALL VirtualTexture(const Info& info);
+            DFL_API DFL_CALL ~VirtualTexture();
+
+            const VkImage                  GetImage() const noexcept {
+                                               return this->Texture.hImage; }
+            // In the shader read only layout after every update
+            const VkImageLayout            GetLayout() const noexcept {
+                                               return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL; }
+            const VkBuffer                 GetFeedbackBuffer() const noexcept {
+                                               return this->Texture.hFeedback; }
+            const std::array<uint32_t, 2>& GetTileSize() const noexcept {
+                                               return this->Texture.TileSize; }
+            const std::vector<uint32_t>&   GetLevelOffsets() const noexcept {
+                                               return this->LevelOffsets; }
+            const std::vector<uint32_t>&   GetTilesX() const noexcept {
+                                               return this->TilesX; }
+            const uint32_t                 GetMipTailLevel() const noexcept {
+                                               return this->Texture.MipTailLevel; }
+            const DflHW::Device::Queue&    GetQueue() const noexcept {
+                                               return this->Texture.SparseQueue; }
+            const Statistics&              GetStatistics() const noexcept {
+                                               return this->LastUpdate; }
+
+            // Waits for sampled, the point reached once the work sampling the
+            // image and writing the feedback is done (e.g. the renderer's
+            // GetTimeline()), then reads and clears the feedback, evicts the least
+            // recently requested tiles to make room for the requested ones that
+            // are out, and binds and loads them, coarser levels first.
+            // That work has to make its feedback writes available to the host,
+            // and the image can't be sampled again until the update is done.
+            DFL_API
+                  DflGen::Job<Error>
+            DFL_CALL                       Update(const DflHW::Device::TimelinePoint& sampled);
+
+            // The texture's format can be sparse, 2D and optimally tiled on the device
+            DFL_API
+            static
+                  bool
+            DFL_CALL                       IsSupported(
+                                               const DflHW::Device& device,
+                                               const VkFormat       format) noexcept;
+        };
+    }
+    namespace DflMem = Dfl::Memory;
+}
@@ -0,0 +1,1048 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Dragonfly.Simulation.Compute.hxx"
+
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+namespace DflHW = Dfl::Hardware;
+namespace DflSim = Dfl::Simulation;
+
+// Internal for Compute constructor
+
+static VkShaderModule INT_GetModule(
+    const VkDevice&              hGPU,
+    const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        throw Dfl::Error::NoData(
+                L"Unable to open compute shader file",
+                L"INT_GetModule",
+                Dfl::API::None);
+    }
+
+    // SPIR-V is made of 32-bit words
+    std::vector<uint32_t> code(static_cast<uint64_t>(file.tellg()) / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(code.data()), code.size() * sizeof(uint32_t));
+
+    const VkShaderModuleCreateInfo moduleInfo{
+        .sType{ VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .codeSize{ code.size() * sizeof(uint32_t) },
+        .pCode{ code.data() }
+    };
+
+    VkShaderModule module{ nullptr };
+    if ( vkCreateShaderModule(
+            hGPU,
+            &moduleInfo,
+            nullptr,
+            &module) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create compute shader module",
+                L"INT_GetModule");
+    }
+
+    return module;
+}
+
+static VkDescriptorSetLayout INT_GetSetLayout(
+    const VkDevice& hGPU,
+    const uint32_t  buffersNumber)
+{
+    std::vector<VkDescriptorSetLayoutBinding> bindings(buffersNumber);
+    for (uint32_t i{ 0 }; i < buffersNumber; i++)
+    {
+        bindings[i] = {
+            .binding{ i },
+            .descriptorType{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+            .descriptorCount{ 1 },
+            .stageFlags{ VK_SHADER_STAGE_COMPUTE_BIT },
+            .pImmutableSamplers{ nullptr } };
+    }
+
+    const VkDescriptorSetLayoutCreateInfo layoutInfo{
+        .sType{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .bindingCount{ buffersNumber },
+        .pBindings{ bindings.data() }
+    };
+
+    VkDescriptorSetLayout layout{ nullptr };
+    if ( vkCreateDescriptorSetLayout(
+            hGPU,
+            &layoutInfo,
+            nullptr,
+            &layout) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create descriptor set layout",
+                L"INT_GetSetLayout");
+    }
+
+    return layout;
+}
+
+static VkPipelineLayout INT_GetLayout(
+    const VkDevice&              hGPU,
+    const VkDescriptorSetLayout& hSetLayout,
+    const uint32_t               pushConstantSize)
+{
+    const VkPushConstantRange pushRange{
+        .stageFlags{ VK_SHADER_STAGE_COMPUTE_BIT },
+        .offset{ 0 },
+        .size{ pushConstantSize }
+    };
+    const VkPipelineLayoutCreateInfo layoutInfo{
+        .sType{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .setLayoutCount{ 1 },
+        .pSetLayouts{ &hSetLayout },
+        .pushConstantRangeCount{ pushConstantSize > 0 ? 1u : 0u },
+        .pPushConstantRanges{ pushConstantSize > 0 ? &pushRange : nullptr }
+    };
+
+    VkPipelineLayout layout{ nullptr };
+    if ( vkCreatePipelineLayout(
+            hGPU,
+            &layoutInfo,
+            nullptr,
+            &layout) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create compute pipeline layout",
+                L"INT_GetLayout");
+    }
+
+    return layout;
+}
+
+static VkPipeline INT_GetPipeline(
+    const VkDevice&         hGPU,
+    const VkShaderModule&   hModule,
+    const VkPipelineLayout& hLayout)
+{
+    const VkComputePipelineCreateInfo pipelineInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .stage{
+            .sType{ VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .stage{ VK_SHADER_STAGE_COMPUTE_BIT },
+            .module{ hModule },
+            .pName{ "main" },
+            .pSpecializationInfo{ nullptr } },
+        .layout{ hLayout },
+        .basePipelineHandle{ nullptr },
+        .basePipelineIndex{ -1 }
+    };
+
+    VkPipeline pipeline{ nullptr };
+    if ( vkCreateComputePipelines(
+            hGPU,
+            nullptr,
+            1,
+            &pipelineInfo,
+            nullptr,
+            &pipeline) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create compute pipeline",
+                L"INT_GetPipeline");
+    }
+
+    return pipeline;
+}
+
+static VkDescriptorPool INT_GetDescriptorPool(
+    const VkDevice& hGPU,
+    const uint32_t  buffersNumber)
+{
+    const VkDescriptorPoolSize poolSize{
+        .type{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+        .descriptorCount{ buffersNumber }
+    };
+    const VkDescriptorPoolCreateInfo poolInfo{
+        .sType{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .maxSets{ 1 },
+        .poolSizeCount{ 1 },
+        .pPoolSizes{ &poolSize }
+    };
+
+    VkDescriptorPool pool{ nullptr };
+    if ( vkCreateDescriptorPool(
+            hGPU,
+            &poolInfo,
+            nullptr,
+            &pool) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to create descriptor pool",
+                L"INT_GetDescriptorPool");
+    }
+
+    return pool;
+}
+
+static VkDescriptorSet INT_GetSet(
+    const VkDevice&              hGPU,
+    const VkDescriptorPool&      hPool,
+    const VkDescriptorSetLayout& hSetLayout)
+{
+    const VkDescriptorSetAllocateInfo setInfo{
+        .sType{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO },
+        .pNext{ nullptr },
+        .descriptorPool{ hPool },
+        .descriptorSetCount{ 1 },
+        .pSetLayouts{ &hSetLayout }
+    };
+
+    VkDescriptorSet set{ nullptr };
+    if ( vkAllocateDescriptorSets(
+            hGPU,
+            &setInfo,
+            &set) != VK_SUCCESS )
+    {
+        throw Dfl::Error::HandleCreation(
+                L"Unable to allocate descriptor set",
+                L"INT_GetSet");
+    }
+
+    return set;
+}
+
+static DflSim::Compute::Handles INT_GetHandles(
+          DflHW::Device&          gpu,
+    const DflSim::Compute::Info&  info)
+{
+    const VkDevice& hGPU{ gpu.GetDevice() };
+
+    // compute queues are those reserved through Device::Info::SimulationsNumber
+    const DflHW::Device::Queue queue{ gpu.BorrowQueue(DflHW::Device::Queue::Type::Compute) };
+    if (queue.hQueue == nullptr)
+    {
+        throw Dfl::Error::NoData(
+                L"Unable to find a compute queue",
+                L"INT_GetHandles",
+                Dfl::API::None);
+    }
+
+    VkCommandPool         cmdPool{ nullptr };
+    VkCommandBuffer       cmdBuffer{ nullptr };
+    VkFence               fence{ nullptr };
+    VkShaderModule        module{ nullptr };
+    VkDescriptorSetLayout setLayout{ nullptr };
+    VkPipelineLayout      layout{ nullptr };
+    VkPipeline            pipeline{ nullptr };
+    VkDescriptorPool      descriptorPool{ nullptr };
+    VkDescriptorSet       set{ nullptr };
+    DflHW::Device::TimelinePoint timeline{ };
+    try {
+        const VkCommandPoolCreateInfo poolInfo{
+            .sType{ VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT },
+            .queueFamilyIndex{ queue.FamilyIndex }
+        };
+        if ( vkCreateCommandPool(
+                hGPU,
+                &poolInfo,
+                nullptr,
+                &cmdPool) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create command pool",
+                    L"INT_GetHandles");
+        }
+
+        const VkCommandBufferAllocateInfo bufferInfo{
+            .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO },
+            .pNext{ nullptr },
+            .commandPool{ cmdPool },
+            .level{ VK_COMMAND_BUFFER_LEVEL_PRIMARY },
+            .commandBufferCount{ 1 }
+        };
+        if ( vkAllocateCommandBuffers(
+                hGPU,
+                &bufferInfo,
+                &cmdBuffer) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to allocate command buffer",
+                    L"INT_GetHandles");
+        }
+
+        // signaled, so that the first dispatch doesn't wait
+        const VkFenceCreateInfo fenceInfo{
+            .sType{ VK_STRUCTURE_TYPE_FENCE_CREATE_INFO },
+            .pNext{ nullptr },
+            .flags{ VK_FENCE_CREATE_SIGNALED_BIT }
+        };
+        if ( vkCreateFence(
+                hGPU,
+                &fenceInfo,
+                nullptr,
+                &fence) != VK_SUCCESS )
+        {
+            throw Dfl::Error::HandleCreation(
+                    L"Unable to create fence",
+                    L"INT_GetHandles");
+        }
+
+        module = INT_GetModule(hGPU, info.Shader);
+        setLayout = INT_GetSetLayout(hGPU, info.BuffersNumber);
+        layout = INT_GetLayout(hGPU, setLayout, info.PushConstantSize);
+        pipeline = INT_GetPipeline(hGPU, module, layout);
+        descriptorPool = INT_GetDescriptorPool(hGPU, info.BuffersNumber);
+        set = INT_GetSet(hGPU, descriptorPool, setLayout);
+
+        timeline = gpu.GetTimeline();
+    }
+    catch (Dfl::Error::Generic& err) {
+        if (descriptorPool != nullptr) { vkDestroyDescriptorPool(hGPU, descriptorPool, nullptr); }
+        if (pipeline != nullptr) { vkDestroyPipeline(hGPU, pipeline, nullptr); }
+        if (layout != nullptr) { vkDestroyPipelineLayout(hGPU, layout, nullptr); }
+        if (setLayout != nullptr) { vkDestroyDescriptorSetLayout(hGPU, setLayout, nullptr); }
+        if (module != nullptr) { vkDestroyShaderModule(hGPU, module, nullptr); }
+        if (fence != nullptr) { vkDestroyFence(hGPU, fence, nullptr); }
+        if (cmdPool != nullptr) { vkDestroyCommandPool(hGPU, cmdPool, nullptr); }
+
+        gpu.ReturnQueue(queue);
+
+        throw;
+    }
+
+    return { queue,
+             cmdPool,
+             cmdBuffer,
+             fence,
+             timeline.hSemaphore,
+             timeline.Value,
+             module,
+             setLayout,
+             layout,
+             pipeline,
+             descriptorPool,
+             set };
+}
+
+// Dragonfly.Simulation.Compute
+
+DflSim::Compute::Compute(const Info& info)
+: pInfo( new Info(info) ),
+  Program( INT_GetHandles(
+             info.Device,
+             info) ),
+  Bound( info.BuffersNumber, nullptr ),
+  pTracker( new Tracker{ .TimelineValue{ this->Program.TimelineStart } } )
+{
+}
+
+DflSim::Compute::~Compute()
+{
+    const VkDevice& device{ this->pInfo->Device.GetDevice() };
+    vkWaitForFences(
+        device,
+        1,
+        &this->Program.hFence,
+        VK_TRUE,
+        UINT64_MAX);
+
+    vkDestroyDescriptorPool(device, this->Program.hDescriptorPool, nullptr);
+    vkDestroyPipeline(device, this->Program.hPipeline, nullptr);
+    vkDestroyPipelineLayout(device, this->Program.hLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, this->Program.hSetLayout, nullptr);
+    vkDestroyShaderModule(device, this->Program.hModule, nullptr);
+    vkDestroyFence(device, this->Program.hFence, nullptr);
+    vkDestroyCommandPool(device, this->Program.hCmdPool, nullptr);
+
+    this->pInfo->Device.ReturnTimeline(this->Program.hTimeline);
+    this->pInfo->Device.ReturnQueue(this->Program.AssignedQueue);
+}
+
+DflSim::Compute& DflSim::Compute::Bind(
+    const uint32_t               binding,
+    const DflMem::GenericBuffer& buffer)
+{
+    if (binding >= this->pInfo->BuffersNumber)
+    {
+        throw Dfl::Error::OutOfBounds(
+                L"Binding is outside of the shader's buffers",
+                L"Compute::Bind");
+    }
+
+    // the set may be in use by a dispatch that hasn't finished
+    vkWaitForFences(
+        this->pInfo->Device.GetDevice(),
+        1,
+        &this->Program.hFence,
+        VK_TRUE,
+        UINT64_MAX);
+
+    const VkDescriptorBufferInfo bufferInfo{
+        .buffer{ buffer.GetBuffer() },
+        .offset{ 0 },
+        .range{ VK_WHOLE_SIZE }
+    };
+    const VkWriteDescriptorSet write{
+        .sType{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET },
+        .pNext{ nullptr },
+        .dstSet{ this->Program.hSet },
+        .dstBinding{ binding },
+        .dstArrayElement{ 0 },
+        .descriptorCount{ 1 },
+        .descriptorType{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+        .pImageInfo{ nullptr },
+        .pBufferInfo{ &bufferInfo },
+        .pTexelBufferView{ nullptr }
+    };
+    vkUpdateDescriptorSets(
+        this->pInfo->Device.GetDevice(),
+        1,
+        &write,
+        0,
+        nullptr);
+
+    this->Bound[binding] = &buffer;
+    return *this;
+}
+
+auto DflSim::Compute::GetTimeline() const noexcept
+-> DflHW::Device::TimelinePoint
+{
+    std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+
+    return { .hSemaphore{ this->Program.hTimeline },
+             .Value{ this->pTracker->TimelineValue } };
+}
+
+DflSim::Compute& DflSim::Compute::WaitFor(const DflHW::Device::TimelinePoint& point) noexcept
+{
+    std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+
+    this->pTracker->Waits.push_back(point);
+    return *this;
+}
+
+bool DflSim::Compute::Record(
+    const std::vector<Step>&                         steps,
+    const VkBuffer&                                  argumentsBuffer,
+    const uint64_t                                   argumentsOffset,
+    const std::vector<const DflMem::GenericBuffer*>& borrowed) const noexcept
+{
+    const VkCommandBuffer& cmdBuffer{ this->Program.hCmdBuffer };
+    const uint32_t         family{ this->Program.AssignedQueue.FamilyIndex };
+
+    const VkCommandBufferBeginInfo beginInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO },
+        .pNext{ nullptr },
+        .flags{ VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT },
+        .pInheritanceInfo{ nullptr }
+    };
+    if ( vkBeginCommandBuffer(
+            cmdBuffer,
+            &beginInfo) != VK_SUCCESS )
+    {
+        return false;
+    }
+
+    {
+        // graphics statistics can't be queried on compute-only families,
+        // and the statistics pool always includes them
+        const bool canQueryStatistics{ 
+            ( this->pInfo->Device.GetQueueFamilies()[this->Program.AssignedQueue.FamilyIndex].QueueType 
+              & DflHW::Device::Queue::Type::Graphics ).GetValue() != 0 };
+        DflHW::Profiler::Zone zone(
+                                this->pInfo->pProfiler,
+                                cmdBuffer,
+                                this->Program.AssignedQueue.FamilyIndex,
+                                "Compute::Dispatch",
+                                canQueryStatistics);
+
+        // borrowed buffers are acquired from their families; their
+        // writes are made visible by the acquisition itself
+        std::vector<VkBufferMemoryBarrier2> acquireBarriers{ };
+        for (const auto* pBuffer : borrowed)
+        {
+            acquireBarriers.push_back({
+                .sType{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 },
+                .pNext{ nullptr },
+                .srcStageMask{ VK_PIPELINE_STAGE_2_NONE },
+                .srcAccessMask{ VK_ACCESS_2_NONE },
+                .dstStageMask{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT },
+                .dstAccessMask{ VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+                                | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+                                | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT },
+                .srcQueueFamilyIndex{ pBuffer->GetFamily() },
+                .dstQueueFamilyIndex{ family },
+                .buffer{ pBuffer->GetBuffer() },
+                .offset{ 0 },
+                .size{ VK_WHOLE_SIZE } });
+        }
+
+        // whatever was written to the buffers before, be it a transfer or
+        // a previous dispatch, has to be visible to the shader
+        const VkMemoryBarrier2 inputBarrier{
+            .sType{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 },
+            .pNext{ nullptr },
+            .srcStageMask{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT },
+            .srcAccessMask{ VK_ACCESS_2_MEMORY_WRITE_BIT },
+            .dstStageMask{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT },
+            .dstAccessMask{ VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+                            | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+                            | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT }
+        };
+        const VkDependencyInfo dependency{
+            .sType{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO },
+            .pNext{ nullptr },
+            .dependencyFlags{ 0 },
+            .memoryBarrierCount{ 1 },
+            .pMemoryBarriers{ &inputBarrier },
+            .bufferMemoryBarrierCount{ static_cast<uint32_t>(acquireBarriers.size()) },
+            .pBufferMemoryBarriers{ acquireBarriers.data() }
+        };
+        vkCmdPipelineBarrier2(
+            cmdBuffer,
+            &dependency);
+
+        vkCmdBindPipeline(
+            cmdBuffer,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            this->Program.hPipeline);
+        vkCmdBindDescriptorSets(
+            cmdBuffer,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            this->Program.hLayout,
+            0,
+            1,
+            &this->Program.hSet,
+            0,
+            nullptr);
+
+        const VkMemoryBarrier2 stepBarrier{
+            .sType{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 },
+            .pNext{ nullptr },
+            .srcStageMask{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT },
+            .srcAccessMask{ VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT },
+            .dstStageMask{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT },
+            .dstAccessMask{ VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+                            | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+                            | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT }
+        };
+        const VkDependencyInfo stepDependency{
+            .sType{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO },
+            .pNext{ nullptr },
+            .dependencyFlags{ 0 },
+            .memoryBarrierCount{ 1 },
+            .pMemoryBarriers{ &stepBarrier }
+        };
+        for (uint64_t i{ 0 }; i < steps.size(); i++)
+        {
+            const Step& step{ steps[i] };
+            if (i > 0)
+            {
+                vkCmdPipelineBarrier2(
+                    cmdBuffer,
+                    &stepDependency);
+            }
+
+            if (!step.PushData.empty())
+            {
+                vkCmdPushConstants(
+                    cmdBuffer,
+                    this->Program.hLayout,
+                    VK_SHADER_STAGE_COMPUTE_BIT,
+                    0,
+                    static_cast<uint32_t>(step.PushData.size()),
+                    step.PushData.data());
+            }
+
+            if (argumentsBuffer != nullptr)
+            {
+                vkCmdDispatchIndirect(
+                    cmdBuffer,
+                    argumentsBuffer,
+                    argumentsOffset);
+            }
+            else
+            {
+                vkCmdDispatch(
+                    cmdBuffer,
+                    step.Groups[0],
+                    step.Groups[1],
+                    step.Groups[2]);
+            }
+        }
+
+        // what the shader wrote is made visible to the host, which reads
+        // mapped buffers directly, and borrowed buffers are released back
+        const VkMemoryBarrier2 hostBarrier{
+            .sType{ VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 },
+            .pNext{ nullptr },
+            .srcStageMask{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT },
+            .srcAccessMask{ VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT },
+            .dstStageMask{ VK_PIPELINE_STAGE_2_HOST_BIT },
+            .dstAccessMask{ VK_ACCESS_2_HOST_READ_BIT }
+        };
+        {
+            std::vector<VkBufferMemoryBarrier2> releaseBarriers{ };
+            for (const auto* pBuffer : borrowed)
+            {
+                releaseBarriers.push_back({
+                    .sType{ VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 },
+                    .pNext{ nullptr },
+                    .srcStageMask{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT },
+                    .srcAccessMask{ VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT },
+                    .dstStageMask{ VK_PIPELINE_STAGE_2_NONE },
+                    .dstAccessMask{ VK_ACCESS_2_NONE },
+                    .srcQueueFamilyIndex{ family },
+                    .dstQueueFamilyIndex{ pBuffer->GetFamily() },
+                    .buffer{ pBuffer->GetBuffer() },
+                    .offset{ 0 },
+                    .size{ VK_WHOLE_SIZE } });
+            }
+            const VkDependencyInfo releaseDependency{
+                .sType{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO },
+                .pNext{ nullptr },
+                .dependencyFlags{ 0 },
+                .memoryBarrierCount{ 1 },
+                .pMemoryBarriers{ &hostBarrier },
+                .bufferMemoryBarrierCount{ static_cast<uint32_t>(releaseBarriers.size()) },
+                .pBufferMemoryBarriers{ releaseBarriers.data() }
+            };
+            vkCmdPipelineBarrier2(
+                cmdBuffer,
+                &releaseDependency);
+        }
+    }
+
+    if (this->pInfo->pProfiler != nullptr)
+    {
+        this->pInfo->pProfiler->Count(
+                                    DflHW::Profiler::Counter::BarriersIssued, 
+                                    steps.size() + 1);
+    }
+
+    return vkEndCommandBuffer(cmdBuffer) == VK_SUCCESS;
+}
+
+// Internal for Submit and GiveBack
+
+// Signals what a submission that failed would have, without its work, so
+// nothing waiting on its timeline point or on the fence hangs. If even that
+// can't be submitted, the point is signaled by the host, once the submissions
+// before it are done.
+static inline void INT_SignalSkipped(
+    const VkDevice&                           hGPU,
+    const VkQueue&                            hQueue,
+    const std::vector<VkSemaphoreSubmitInfo>& waits,
+    const VkSemaphoreSubmitInfo&              timelineSignal,
+    const VkFence&                            hFence)
+{
+    const VkSubmitInfo2 skipInfo{
+        .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .waitSemaphoreInfoCount{ static_cast<uint32_t>(waits.size()) },
+        .pWaitSemaphoreInfos{ waits.data() },
+        .commandBufferInfoCount{ 0 },
+        .pCommandBufferInfos{ nullptr },
+        .signalSemaphoreInfoCount{ 1 },
+        .pSignalSemaphoreInfos{ &timelineSignal }
+    };
+    if ( vkQueueSubmit2(
+            hQueue,
+            1,
+            &skipInfo,
+            hFence) == VK_SUCCESS )
+    {
+        return;
+    }
+
+    const uint64_t previousValue{ timelineSignal.value - 1 };
+    const VkSemaphoreWaitInfo previousInfo{
+        .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .semaphoreCount{ 1 },
+        .pSemaphores{ &timelineSignal.semaphore },
+        .pValues{ &previousValue }
+    };
+    vkWaitSemaphores(
+        hGPU,
+        &previousInfo,
+        UINT64_MAX);
+
+    const VkSemaphoreSignalInfo signalInfo{
+        .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO },
+        .pNext{ nullptr },
+        .semaphore{ timelineSignal.semaphore },
+        .value{ timelineSignal.value }
+    };
+    vkSignalSemaphore(
+        hGPU,
+        &signalInfo);
+    vkQueueSubmit2(
+        hQueue,
+        0,
+        nullptr,
+        hFence);
+}
+
+auto DflSim::Compute::Submit(
+          std::vector<Step>       steps,
+    const DflMem::GenericBuffer*  pArguments,
+          uint64_t                argumentsOffset) const noexcept
+-> DflGen::Job<Error>
+{
+    for (const auto* pBuffer : this->Bound)
+    {
+        if (pBuffer == nullptr)
+        {
+            co_return Error::UnboundError;
+        }
+    }
+
+    const VkDevice& device{ this->pInfo->Device.GetDevice() };
+
+    // the command buffer can't be rerecorded while the previous dispatch runs
+    while (vkGetFenceStatus(device, this->Program.hFence) != VK_SUCCESS)
+    {
+        co_await DflGen::Job<Error>::Awaitable(
+                    device,
+                    this->Program.hFence);
+    }
+
+    const uint32_t family{ this->Program.AssignedQueue.FamilyIndex };
+
+    // exclusive buffers of other families are lent to this one for the dispatch.
+    // The device waits for the lending, so the CPU doesn't have to.
+    std::vector<const DflMem::GenericBuffer*> borrowed{ };
+    std::vector<VkSemaphoreSubmitInfo>        waits{ };
+    std::vector<const DflMem::GenericBuffer*> used{ this->Bound };
+    if (pArguments != nullptr)
+    {
+        used.push_back(pArguments);
+    }
+    for (const auto* pBuffer : used)
+    {
+        if (!pBuffer->IsExclusive()
+            || pBuffer->GetFamily() == family
+            || std::find(borrowed.begin(), borrowed.end(), pBuffer) != borrowed.end())
+        {
+            continue;
+        }
+
+        const auto point{ pBuffer->Release(family) };
+        if (!point.has_value())
+        {
+            this->GiveBack(borrowed, waits);
+            co_return Error::OwnershipError;
+        }
+        borrowed.push_back(pBuffer);
+        waits.push_back({
+            .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO },
+            .pNext{ nullptr },
+            .semaphore{ point.value().hSemaphore },
+            .value{ point.value().Value },
+            .stageMask{ VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT },
+            .deviceIndex{ 0 } });
+    }
+
+    vkResetCommandBuffer(
+        this->Program.hCmdBuffer,
+        0);
+    if (!this->Record(
+            steps,
+            pArguments == nullptr ? nullptr : pArguments->GetBuffer(),
+            argumentsOffset,
+            borrowed))
+    {
+        if (this->pInfo->pProfiler != nullptr)
+        {
+            this->pInfo->pProfiler->Discard(this->Program.hCmdBuffer);
+        }
+        this->GiveBack(borrowed, waits);
+        co_return Error::RecordError;
+    }
+
+    uint64_t signalValue{ 0 };
+    std::vector<DflHW::Device::TimelinePoint> trackedWaits{ };
+    {
+        std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+        for (const auto& point : this->pTracker->Waits)
+        {
+            waits.push_back({
+                .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO },
+                .pNext{ nullptr },
+                .semaphore{ point.hSemaphore },
+                .value{ point.Value },
+                .stageMask{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT },
+                .deviceIndex{ 0 } });
+        }
+        trackedWaits.swap(this->pTracker->Waits);
+
+        signalValue = ++this->pTracker->TimelineValue;
+    }
+
+    const VkCommandBufferSubmitInfo cmdBufferInfo{
+        .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO },
+        .pNext{ nullptr },
+        .commandBuffer{ this->Program.hCmdBuffer },
+        .deviceMask{ 0 }
+    };
+    const VkSemaphoreSubmitInfo signal{
+        .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO },
+        .pNext{ nullptr },
+        .semaphore{ this->Program.hTimeline },
+        .value{ signalValue },
+        .stageMask{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT },
+        .deviceIndex{ 0 }
+    };
+    const VkSubmitInfo2 submitInfo{
+        .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 },
+        .pNext{ nullptr },
+        .flags{ 0 },
+        .waitSemaphoreInfoCount{ static_cast<uint32_t>(waits.size()) },
+        .pWaitSemaphoreInfos{ waits.data() },
+        .commandBufferInfoCount{ 1 },
+        .pCommandBufferInfos{ &cmdBufferInfo },
+        .signalSemaphoreInfoCount{ 1 },
+        .pSignalSemaphoreInfos{ &signal }
+    };
+
+    // reset only now, as nothing would signal the fence if the dispatch wasn't submitted
+    vkResetFences(
+        device,
+        1,
+        &this->Program.hFence);
+    if ( vkQueueSubmit2(
+            this->Program.AssignedQueue,
+            1,
+            &submitInfo,
+            this->Program.hFence) != VK_SUCCESS )
+    {
+        // the fence still has to be signaled, or the next dispatch would wait
+        // forever, and so does the point, which GetTimeline may have handed out
+        INT_SignalSkipped(
+            device,
+            this->Program.AssignedQueue,
+            waits,
+            signal,
+            this->Program.hFence);
+        if (this->pInfo->pProfiler != nullptr)
+        {
+            this->pInfo->pProfiler->Discard(this->Program.hCmdBuffer);
+        }
+
+        // the next dispatch still has to wait for what this one would have
+        {
+            std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+            this->pTracker->Waits.insert(
+                                    this->pTracker->Waits.begin(),
+                                    trackedWaits.begin(),
+                                    trackedWaits.end());
+        }
+        this->GiveBack(
+                borrowed,
+                std::vector<VkSemaphoreSubmitInfo>(waits.begin(), waits.begin() + borrowed.size()));
+        co_return Error::SubmitError;
+    }
+
+    // the next transfer on each buffer's queue acquires it back
+    for (const auto* pBuffer : borrowed)
+    {
+        pBuffer->Return(
+                    family,
+                    { .hSemaphore{ this->Program.hTimeline },
+                      .Value{ signalValue } });
+    }
+
+    while (vkGetFenceStatus(device, this->Program.hFence) != VK_SUCCESS)
+    {
+        co_await DflGen::Job<Error>::Awaitable(
+                    device,
+                    this->Program.hFence);
+    }
+
+    co_return Error::Success;
+}
+
+void DflSim::Compute::GiveBack(
+    const std::vector<const DflMem::GenericBuffer*>& borrowed,
+    const std::vector<VkSemaphoreSubmitInfo>&        releases) const noexcept
+{
+    if (borrowed.empty())
+    {
+        return;
+    }
+
+    const VkDevice& device{ this->pInfo->Device.GetDevice() };
+    const uint32_t  family{ this->Program.AssignedQueue.FamilyIndex };
+
+    // a failed submission may have left the fence to be signaled by an empty one
+    vkWaitForFences(
+        device,
+        1,
+        &this->Program.hFence,
+        VK_TRUE,
+        UINT64_MAX);
+
+    // without any steps, the command buffer only acquires the buffers and releases them back
+    vkResetCommandBuffer(
+        this->Program.hCmdBuffer,
+        0);
+    bool isGivenBack{ this->Record(
+                        { },
+                        nullptr,
+                        0,
+                        borrowed) };
+
+    uint64_t signalValue{ 0 };
+    if (isGivenBack)
+    {
+        std::lock_guard<std::mutex> lock(this->pTracker->Lock);
+        signalValue = ++this->pTracker->TimelineValue;
+    }
+    else if (this->pInfo->pProfiler != nullptr)
+    {
+        this->pInfo->pProfiler->Discard(this->Program.hCmdBuffer);
+    }
+
+    if (isGivenBack)
+    {
+        const VkCommandBufferSubmitInfo cmdBufferInfo{
+            .sType{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO },
+            .pNext{ nullptr },
+            .commandBuffer{ this->Program.hCmdBuffer },
+            .deviceMask{ 0 }
+        };
+        const VkSemaphoreSubmitInfo signal{
+            .sType{ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO },
+            .pNext{ nullptr },
+            .semaphore{ this->Program.hTimeline },
+            .value{ signalValue },
+            .stageMask{ VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT },
+            .deviceIndex{ 0 }
+        };
+        const VkSubmitInfo2 submitInfo{
+            .sType{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 },
+            .pNext{ nullptr },
+            .flags{ 0 },
+            .waitSemaphoreInfoCount{ static_cast<uint32_t>(releases.size()) },
+            .pWaitSemaphoreInfos{ releases.data() },
+            .commandBufferInfoCount{ 1 },
+            .pCommandBufferInfos{ &cmdBufferInfo },
+            .signalSemaphoreInfoCount{ 1 },
+            .pSignalSemaphoreInfos{ &signal }
+        };
+
+        vkResetFences(
+            device,
+            1,
+            &this->Program.hFence);
+        if ( vkQueueSubmit2(
+                this->Program.AssignedQueue,
+                1,
+                &submitInfo,
+                this->Program.hFence) != VK_SUCCESS )
+        {
+            INT_SignalSkipped(
+                device,
+                this->Program.AssignedQueue,
+                releases,
+                signal,
+                this->Program.hFence);
+            if (this->pInfo->pProfiler != nullptr)
+            {
+                this->pInfo->pProfiler->Discard(this->Program.hCmdBuffer);
+            }
+            isGivenBack = false;
+        }
+    }
+
+    // if even that couldn't be submitted, the buffers are given back as they were
+    // released, so their families don't wait on a point that's never reached
+    for (uint64_t i{ 0 }; i < borrowed.size(); i++)
+    {
+        borrowed[i]->Return(
+                        family,
+                        isGivenBack
+                        ? DflHW::Device::TimelinePoint{ .hSemaphore{ this->Program.hTimeline },
+                                                        .Value{ signalValue } }
+                        : DflHW::Device::TimelinePoint{ .hSemaphore{ releases[i].semaphore },
+                                                        .Value{ releases[i].value } });
+    }
+}
+
+static inline std::vector<char> INT_CopyPushData(
+    const void*    pPushData,
+    const uint32_t size)
+{
+    // the job may outlive the caller's data, so it keeps its own copy
+    std::vector<char> pushData(pPushData == nullptr ? 0 : size);
+    if (!pushData.empty())
+    {
+        std::memcpy(pushData.data(), pPushData, size);
+    }
+
+    return pushData;
+}
+
+auto DflSim::Compute::Dispatch(
+    const std::array<uint32_t, 3>& groups,
+    const void*                    pPushData) const noexcept
+-> DflGen::Job<Error>
+{
+    return this->Submit(
+                { { groups, INT_CopyPushData(pPushData, this->pInfo->PushConstantSize) } },
+                nullptr,
+                0);
+}
+
+auto DflSim::Compute::Dispatch(const std::vector<Step>& steps) const noexcept
+-> DflGen::Job<Error>
+{
+    return this->Submit(
+                steps,
+                nullptr,
+                0);
+}
+
+auto DflSim::Compute::DispatchIndirect(
+    const DflMem::GenericBuffer& arguments,
+    const uint64_t               offset,
+    const void*                  pPushData) const noexcept
+-> DflGen::Job<Error>
+{
+    return this->Submit(
+                { { { 0, 0, 0 }, INT_CopyPushData(pPushData, this->pInfo->PushConstantSize) } },
+                &arguments,
+                offset);
+}
@@ -0,0 +1,163 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <array>
+#include <mutex>
+#include <filesystem>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "Dragonfly.h"
+
+#include "Dragonfly.Generics.hxx"
+#include "Dragonfly.Hardware.Device.hxx"
+#include "Dragonfly.Hardware.Profiler.hxx"
+#include "Dragonfly.Memory.Buffer.hxx"
+
+namespace Dfl {
+    // Dragonfly.Simulation
+    namespace Simulation {
+        // Dragonfly.Simulation.Compute
+        // A compute shader that runs on one of the queues the device
+        // reserved for simulations. The shader sees its buffers as
+        // storage buffers in set 0, binding i being the i-th buffer.
+        // Every dispatch advances a timeline semaphore, which other
+        // queues can wait on instead of the CPU waiting for them.
+        class Compute {
+        public:
+            struct Info {
+                      DflHW::Device&        Device;
+                const std::filesystem::path Shader{ };
+                const uint32_t              BuffersNumber{ 1 }; // storage buffers the shader binds
+                const uint32_t              PushConstantSize{ 0 }; // in B. 0 if the shader has no push constants
+
+                      DflHW::Profiler*      pProfiler{ nullptr }; // if not null, dispatches are timed
+            };
+
+            struct Handles {
+                const DflHW::Device::Queue  AssignedQueue{ };
+                const VkCommandPool         hCmdPool{ nullptr };
+                const VkCommandBuffer       hCmdBuffer{ nullptr };
+                const VkFence               hFence{ nullptr };
+                const VkSemaphore           hTimeline{ nullptr }; // reaches TimelineStart + n once the n-th dispatch is done
+                const uint64_t              TimelineStart{ 0 }; // the value it had reached when it was lent
+
+                const VkShaderModule        hModule{ nullptr };
+                const VkDescriptorSetLayout hSetLayout{ nullptr };
+                const VkPipelineLayout      hLayout{ nullptr };
+                const VkPipeline            hPipeline{ nullptr };
+
+                const VkDescriptorPool      hDescriptorPool{ nullptr };
+                const VkDescriptorSet       hSet{ nullptr };
+
+                operator VkPipeline() const { return this->hPipeline; }
+            };
+
+            // One dispatch of a sequence, which sees the writes of the steps before it
+            struct Step {
+                std::array<uint32_t, 3> Groups{ 1, 1, 1 };
+                std::vector<char>       PushData{ }; // PushConstantSize bytes, or empty if the shader has none
+            };
+
+            struct Tracker {
+                uint64_t                                  TimelineValue{ 0 };
+                std::vector<DflHW::Device::TimelinePoint> Waits{ }; // for the next dispatch
+
+                std::mutex                                Lock;
+            };
+
+            enum class Error {
+                Success = 0,
+                RecordError = -1,
+                SubmitError = -2,
+                UnboundError = -3,
+                OwnershipError = -4
+            };
+
+        protected:
+            const std::unique_ptr<const Info>         pInfo{ nullptr };
+            const Handles                             Program{ };
+                  std::vector<
+                    const DflMem::GenericBuffer*>     Bound{ };
+            const std::unique_ptr<Tracker>            pTracker{ nullptr };
+
+                  bool                                Record(
+                                                        const std::vector<Step>&                         steps,
+                                                        const VkBuffer&                                  argumentsBuffer,
+                                                        const uint64_t                                   argumentsOffset,
+                                                        const std::vector<const DflMem::GenericBuffer*>& borrowed) const noexcept;
+                  // Gives borrowed buffers back when the dispatch they were lent for fails.
+                  // releases are the points their lending was submitted with, in order.
+                  void                                GiveBack(
+                                                        const std::vector<const DflMem::GenericBuffer*>& borrowed,
+                                                        const std::vector<VkSemaphoreSubmitInfo>&        releases) const noexcept;
+                  DflGen::Job<Error>                  Submit(
+                                                              std::vector<Step>                          steps,
+                                                        const DflMem::GenericBuffer*                     pArguments,
+                                                              uint64_t                                   argumentsOffset) const noexcept;
+        public:
+            DFL_API DFL_CALL Compute(const Info& info);
+            DFL_API DFL_CALL ~Compute();
+
+            const DflHW::Device::Queue& GetQueue() const noexcept {
+                                            return this->Program.AssignedQueue; }
+
+            // The point reached once the latest dispatch is done
+            DFL_API
+                  DflHW::Device::TimelinePoint
+            DFL_CALL                    GetTimeline() const noexcept;
+            // The next dispatch waits on the device for point, e.g. the
+            // frame of a renderer that writes what the shader reads
+            DFL_API
+                  Compute&
+            DFL_CALL                    WaitFor(const DflHW::Device::TimelinePoint& point) noexcept;
+
+            DFL_API
+                  Compute&
+            DFL_CALL                    Bind(
+                                            const uint32_t                      binding,
+                                            const DflMem::GenericBuffer&        buffer);
+            // The buffers have to be bound before dispatching. pPushData
+            // has to point to PushConstantSize bytes, if there are any.
+            // Exclusive buffers of other families are borrowed for the
+            // dispatch and given back once it's submitted.
+            DFL_API
+                  DflGen::Job<Error>
+            DFL_CALL                    Dispatch(
+                                            const std::array<uint32_t, 3>&      groups,
+                                            const void*                         pPushData = nullptr) const noexcept;
+            // Records the steps in order into one submission, so multi-pass
+            // algorithms don't go through the CPU between passes
+            DFL_API
+                  DflGen::Job<Error>
+            DFL_CALL                    Dispatch(const std::vector<Step>& steps) const noexcept;
+            // The group counts are read by the device from a VkDispatchIndirectCommand
+            // at offset in arguments, which needs VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+            DFL_API
+                  DflGen::Job<Error>
+            DFL_CALL                    DispatchIndirect(
+                                            const DflMem::GenericBuffer&        arguments,
+                                            const uint64_t                      offset,
+                                            const void*                         pPushData = nullptr) const noexcept;
+        };
+    }
+    namespace DflSim = Dfl::Simulation;
+}
@@ -0,0 +1,263 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Dragonfly.Simulation.Primitives.hxx"
+
+#include <algorithm>
+#include <cstring>
+
+namespace DflHW = Dfl::Hardware;
+namespace DflMem = Dfl::Memory;
+namespace DflSim = Dfl::Simulation;
+
+// Internal for Primitives
+
+// as laid out in the shaders
+static constexpr uint32_t INT_GroupSize{ 256 };
+static constexpr uint32_t INT_Radix{ 256 };
+static constexpr uint32_t INT_Passes{ 4 };
+static constexpr uint64_t INT_TileStateSize{ 4 * sizeof(uint32_t) };
+
+struct INT_ScanParameters {
+    uint32_t Count{ 0 };
+    uint32_t Step{ 0 };
+    uint32_t IsInclusive{ 0 };
+};
+
+struct INT_ReduceParameters {
+    uint32_t SegmentCount{ 0 };
+};
+
+struct INT_SortParameters {
+    uint32_t Count{ 0 };
+    uint32_t Step{ 0 };
+    uint32_t HasValues{ 0 };
+};
+
+struct INT_CompactParameters {
+    uint32_t Count{ 0 };
+    uint32_t Step{ 0 };
+};
+
+static inline uint32_t INT_GetTileCount(const uint32_t count)
+{
+    return (count + DflSim::Primitives::TileSize - 1) / DflSim::Primitives::TileSize;
+}
+
+template< typename P >
+static inline DflSim::Compute::Step INT_GetStep(
+    const uint32_t groups,
+    const P&       parameters)
+{
+    std::vector<char> pushData(sizeof(P));
+    std::memcpy(pushData.data(), &parameters, sizeof(P));
+
+    return { .Groups{ std::max(groups, 1u), 1, 1 },
+             .PushData{ pushData } };
+}
+
+static inline DflMem::GenericBuffer::Info INT_GetScratchInfo(
+          DflMem::Block&   block,
+    const uint32_t         computeFamily,
+    const uint64_t         size,
+          DflHW::Profiler* pProfiler)
+{
+    return { .MemoryBlock{ block },
+             .AccessingQueueFamilies{ computeFamily },
+             .Size{ size },
+             .Options{ VK_BUFFER_USAGE_STORAGE_BUFFER_BIT },
+             .pProfiler{ pProfiler } };
+}
+
+// Dragonfly.Simulation.Primitives
+
+DflSim::Primitives::Primitives(const Info& info)
+: pInfo( new Info(info) ),
+  ScanProgram({ .Device{ info.Device },
+                .Shader{ info.ShaderDirectory / L"primitives_scan.spv" },
+                .BuffersNumber{ 3 },
+                .PushConstantSize{ sizeof(INT_ScanParameters) },
+                .pProfiler{ info.pProfiler } }),
+  ReduceProgram({ .Device{ info.Device },
+                  .Shader{ info.ShaderDirectory / L"primitives_reduce.spv" },
+                  .BuffersNumber{ 3 },
+                  .PushConstantSize{ sizeof(INT_ReduceParameters) },
+                  .pProfiler{ info.pProfiler } }),
+  SortProgram({ .Device{ info.Device },
+                .Shader{ info.ShaderDirectory / L"primitives_sort.spv" },
+                .BuffersNumber{ 5 },
+                .PushConstantSize{ sizeof(INT_SortParameters) },
+                .pProfiler{ info.pProfiler } }),
+  CompactProgram({ .Device{ info.Device },
+                   .Shader{ info.ShaderDirectory / L"primitives_compact.spv" },
+                   .BuffersNumber{ 5 },
+                   .PushConstantSize{ sizeof(INT_CompactParameters) },
+                   .pProfiler{ info.pProfiler } }),
+  ScanStatus( INT_GetScratchInfo(
+                info.MemoryBlock,
+                this->ScanProgram.GetQueue().FamilyIndex,
+                INT_TileStateSize * (1 + INT_GetTileCount(info.MaxElements)),
+                info.pProfiler) ),
+  SortScratch( INT_GetScratchInfo(
+                info.MemoryBlock,
+                this->SortProgram.GetQueue().FamilyIndex,
+                sizeof(uint32_t) * ( INT_Passes * INT_Radix + INT_Passes
+                                     + INT_Passes * INT_GetTileCount(info.MaxElements) * INT_Radix ),
+                info.pProfiler) ),
+  CompactStatus( INT_GetScratchInfo(
+                    info.MemoryBlock,
+                    this->CompactProgram.GetQueue().FamilyIndex,
+                    INT_TileStateSize * (1 + INT_GetTileCount(info.MaxElements)),
+                    info.pProfiler) )
+{
+}
+
+void DflSim::Primitives::CheckCount(
+    const uint32_t count,
+    const wchar_t* function) const
+{
+    if (count > this->pInfo->MaxElements)
+    {
+        throw Dfl::Error::Limit(
+                L"Input is larger than the primitives were made for",
+                function,
+                Dfl::API::None);
+    }
+}
+
+auto DflSim::Primitives::Scan(
+    const DflMem::GenericBuffer& input,
+    const DflMem::GenericBuffer& output,
+    const uint32_t               count,
+    const bool                   isInclusive)
+-> DflGen::Job<Error>
+{
+    this->CheckCount(count, L"Primitives::Scan");
+
+    const uint32_t tileCount{ INT_GetTileCount(count) };
+    this->ScanProgram.Bind(0, input)
+                     .Bind(1, output)
+                     .Bind(2, this->ScanStatus);
+
+    return this->ScanProgram.Dispatch({
+                INT_GetStep(
+                    (tileCount + INT_GroupSize - 1) / INT_GroupSize,
+                    INT_ScanParameters{ count, 0, isInclusive }),
+                INT_GetStep(
+                    tileCount,
+                    INT_ScanParameters{ count, 1, isInclusive }) });
+}
+
+auto DflSim::Primitives::Reduce(
+    const DflMem::GenericBuffer& values,
+    const DflMem::GenericBuffer& offsets,
+    const DflMem::GenericBuffer& output,
+    const uint32_t               segmentCount)
+-> DflGen::Job<Error>
+{
+    this->ReduceProgram.Bind(0, values)
+                       .Bind(1, offsets)
+                       .Bind(2, output);
+
+    // a group per segment, wrapped into rows since a dimension
+    // can only hold so many groups
+    const uint32_t columns{ std::clamp(segmentCount, 1u, 65535u) };
+    const INT_ReduceParameters parameters{ segmentCount };
+    DflSim::Compute::Step step{ INT_GetStep(columns, parameters) };
+    step.Groups[1] = (segmentCount + columns - 1) / columns;
+
+    return this->ReduceProgram.Dispatch({ step });
+}
+
+auto DflSim::Primitives::Sort(
+    const DflMem::GenericBuffer& keys,
+    const DflMem::GenericBuffer& temporary,
+    const uint32_t               count)
+-> DflGen::Job<Error>
+{
+    // the value bindings can't be left empty, though they're never accessed
+    return this->Sort(
+                keys,
+                keys,
+                temporary,
+                temporary,
+                count);
+}
+
+auto DflSim::Primitives::Sort(
+    const DflMem::GenericBuffer& keys,
+    const DflMem::GenericBuffer& values,
+    const DflMem::GenericBuffer& keysTemporary,
+    const DflMem::GenericBuffer& valuesTemporary,
+    const uint32_t               count)
+-> DflGen::Job<Error>
+{
+    this->CheckCount(count, L"Primitives::Sort");
+
+    const uint32_t hasValues{ &keys != &values ? 1u : 0u };
+    const uint32_t tileCount{ INT_GetTileCount(count) };
+    this->SortProgram.Bind(0, keys)
+                     .Bind(1, keysTemporary)
+                     .Bind(2, values)
+                     .Bind(3, valuesTemporary)
+                     .Bind(4, this->SortScratch);
+
+    // clearing covers the histograms and every pass' tile states
+    std::vector<DflSim::Compute::Step> steps{
+        INT_GetStep(
+            std::max(INT_Passes, INT_Passes * tileCount),
+            INT_SortParameters{ count, 0, hasValues }),
+        INT_GetStep(
+            tileCount,
+            INT_SortParameters{ count, 1, hasValues }),
+        INT_GetStep(
+            1,
+            INT_SortParameters{ count, 2, hasValues }) };
+    for (uint32_t pass{ 0 }; pass < INT_Passes; pass++)
+    {
+        steps.push_back(INT_GetStep(
+                            tileCount,
+                            INT_SortParameters{ count, 3 + pass, hasValues }));
+    }
+
+    return this->SortProgram.Dispatch(steps);
+}
+
+auto DflSim::Primitives::Compact(
+    const DflMem::GenericBuffer& input,
+    const DflMem::GenericBuffer& flags,
+    const DflMem::GenericBuffer& output,
+    const DflMem::GenericBuffer& total,
+    const uint32_t               count)
+-> DflGen::Job<Error>
+{
+    this->CheckCount(count, L"Primitives::Compact");
+
+    const uint32_t tileCount{ INT_GetTileCount(count) };
+    this->CompactProgram.Bind(0, input)
+                        .Bind(1, flags)
+                        .Bind(2, output)
+                        .Bind(3, total)
+                        .Bind(4, this->CompactStatus);
+
+    return this->CompactProgram.Dispatch({
+                INT_GetStep(
+                    (tileCount + INT_GroupSize - 1) / INT_GroupSize,
+                    INT_CompactParameters{ count, 0 }),
+                INT_GetStep(
+                    tileCount,
+                    INT_CompactParameters{ count, 1 }) });
+}
@@ -0,0 +1,124 @@
+/*
+   Copyright 2024 Christopher-Marios Mamaloukas
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#pragma once
+
+#include <memory>
+#include <filesystem>
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+#include "Dragonfly.h"
+
+#include "Dragonfly.Generics.hxx"
+#include "Dragonfly.Hardware.Device.hxx"
+#include "Dragonfly.Hardware.Profiler.hxx"
+#include "Dragonfly.Memory.Buffer.hxx"
+#include "Dragonfly.Simulation.Compute.hxx"
+
+namespace Dfl {
+    // Dragonfly.Simulation
+    namespace Simulation {
+        // Dragonfly.Simulation.Primitives
+        // Data-parallel building blocks for simulations, over buffers of 32-bit
+        // unsigned integers. Every operation is a single submission, so
+        // nothing goes through the CPU between its passes.
+        // The shaders are Shaders/Primitives*.glsl, compiled to SPIR-V as
+        // primitives_<name>.spv (e.g. glslc -fshader-stage=compute
+        // --target-env=vulkan1.3 PrimitivesScan.glsl -o primitives_scan.spv).
+        class Primitives {
+        public:
+            struct Info {
+                      DflHW::Device&        Device;
+                      DflMem::Block&        MemoryBlock; // the scratch buffers are allocated here
+                const std::filesystem::path ShaderDirectory{ L"Shaders" };
+                const uint32_t              MaxElements{ 1 << 20 }; // of any operation's input. Sorting needs it below 2^30
+
+                      DflHW::Profiler*      pProfiler{ nullptr }; // if not null, operations are timed
+            };
+
+            static constexpr uint32_t TileSize{ 2048 }; // elements per group, as in the shaders
+
+            using Error = Compute::Error;
+
+        protected:
+            const std::unique_ptr<const Info> pInfo{ nullptr };
+
+                  Compute                     ScanProgram;
+                  Compute                     ReduceProgram;
+                  Compute                     SortProgram;
+                  Compute                     CompactProgram;
+
+            // the tile states of the look-back, one per program since
+            // operations on different programs can run at once
+            const DflMem::GenericBuffer       ScanStatus;
+            const DflMem::GenericBuffer       SortScratch;
+            const DflMem::GenericBuffer       CompactStatus;
+
+                  void                        CheckCount(
+                                                const uint32_t count,
+                                                const wchar_t* function) const;
+        public:
+            DFL_API DFL_CALL Primitives(const Info& info);
+
+            // output[i] is the sum of input[0, i), or of input[0, i] if inclusive
+            DFL_API
+                  DflGen::Job<Error>
+            DFL_CALL                 Scan(
+                                        const DflMem::GenericBuffer& input,
+                                        const DflMem::GenericBuffer& output,
+                                        const uint32_t               count,
+                                        const bool                   isInclusive = false);
+            // output[i] is the sum of values[offsets[i], offsets[i + 1]),
+            // so offsets has segmentCount + 1 elements
+            DFL_API
+                  DflGen::Job<Error>
+            DFL_CALL                 Reduce(
+                                        const DflMem::GenericBuffer& values,
+                                        const DflMem::GenericBuffer& offsets,
+                                        const DflMem::GenericBuffer& output,
+                                        const uint32_t               segmentCount);
+            // Sorts keys in place and stably. temporary has to be as large as keys.
+            DFL_API
+                  DflGen::Job<Error>
+            DFL_CALL                 Sort(
+                                        const DflMem::GenericBuffer& keys,
+                                        const DflMem::GenericBuffer& temporary,
+                                        const uint32_t               count);
+            // Sorts keys in place and stably, moving values along with them
+            DFL_API
+                  DflGen::Job<Error>
+            DFL_CALL                 Sort(
+                                        const DflMem::GenericBuffer& keys,
+                                        const DflMem::GenericBuffer& values,
+                                        const DflMem::GenericBuffer& keysTemporary,
+                                        const DflMem::GenericBuffer& valuesTemporary,
+                                        const uint32_t               count);
+            // Writes the elements of input whose flag isn't 0 to output, in
+            // order, and how many they are to the first 4 bytes of total
+            DFL_API
+                  DflGen::Job<Error>
+            DFL_CALL                 Compact(
+                                        const DflMem::GenericBuffer& input,
+                                        const DflMem::GenericBuffer& flags,
+                                        const DflMem::GenericBuffer& output,
+                                        const DflMem::GenericBuffer& total,
+                                        const uint32_t               count);
+        };
+    }
+    namespace DflSim = Dfl::Simulation;
+}
@@ -27,11 +27,27 @@
 // Dfl::Hardware
 #include "Dragonfly.Hardware.Session.hxx"
 #include "Dragonfly.Hardware.Device.hxx"
+#include "Dragonfly.Hardware.Profiler.hxx"
 // Dfl::Memory
+#include "Dragonfly.Memory.Copier.hxx"
 #include "Dragonfly.Memory.Block.hxx"
 #include "Dragonfly.Memory.Buffer.hxx"
+#include "Dragonfly.Memory.Transitions.hxx"
+#include "Dragonfly.Memory.Stream.hxx"
+#include "Dragonfly.Memory.Transfer.hxx"
+#include "Dragonfly.Memory.Downsampler.hxx"
+#include "Dragonfly.Memory.Encoder.hxx"
+#include "Dragonfly.Memory.Converter.hxx"
+#include "Dragonfly.Memory.Atlas.hxx"
+#include "Dragonfly.Memory.VirtualTexture.hxx"
+#include "Dragonfly.Memory.UploadCache.hxx"
+#include "Dragonfly.Memory.DynamicBuffer.hxx"
 // Dfl::Graphics
 #include "Dragonfly.Graphics.Renderer.hxx"
+#include "Dragonfly.Graphics.PipelineBuilder.hxx"
+// Dfl::Simulation
+#include "Dragonfly.Simulation.Compute.hxx"
+#include "Dragonfly.Simulation.Primitives.hxx"
 // Dfl::UI
 #include "Dragonfly.UI.Window.hxx"
 
@@ -0,0 +1,174 @@
+#version 460
+
+// Converts texels from the raw bytes of a source format to those of a
+// destination format, one texel per invocation. Source texels are read as
+// RGBA, with the channels a format lacks filled from (0, 0, 0, 1), go
+// through the swizzle, and are written whole, so destination texels are
+// always whole words.
+// Groups are (ceil(TexelCount / 256), 1, 1).
+
+const uint SourceR8 = 0;
+const uint SourceRG8 = 1;
+const uint SourceRGB8 = 2;
+const uint SourceBGR8 = 3;
+const uint SourceRGBA8 = 4;
+const uint SourceBGRA8 = 5;
+const uint SourceRGB16F = 6;
+const uint SourceRGBA16F = 7;
+const uint SourceRGB32F = 8;
+const uint SourceRGBA32F = 9;
+const uint SourceR5G6B5 = 10;
+const uint SourceR4G4B4A4 = 11;
+const uint SourceA2B10G10R10 = 12;
+
+const uint DestinationRGBA8 = 0;
+const uint DestinationBGRA8 = 1;
+const uint DestinationRGBA16F = 2;
+const uint DestinationRGBA32F = 3;
+
+const uint ChannelZero = 4;
+const uint ChannelOne = 5;
+
+layout(local_size_x = 256) in;
+
+layout(std430, set = 0, binding = 0) readonly buffer Source { uint SourceWords[]; };
+layout(std430, set = 0, binding = 1) writeonly buffer Destination { uint DestinationWords[]; };
+
+layout(push_constant) uniform Parameters {
+    uint TexelCount;
+    uint SourceFormat;
+    uint SourceSize; // in B
+    uint DestinationFormat;
+    uint Swizzle; // a channel every 4 bits, red's first
+    uint IsEncoded; // the linear values of float sources are encoded to sRGB
+};
+
+uint LoadByte(const uint offset)
+{
+    return (SourceWords[offset / 4] >> (8 * (offset % 4))) & 0xFF;
+}
+
+// offsets of 16-bit values are even, so they never straddle two words
+uint LoadHalf(const uint offset)
+{
+    return (SourceWords[offset / 4] >> (8 * (offset % 4))) & 0xFFFF;
+}
+
+vec4 Load(const uint texel)
+{
+    const uint offset = texel * SourceSize;
+    switch (SourceFormat)
+    {
+    case SourceR8:
+        return vec4(LoadByte(offset) / 255.0, 0.0, 0.0, 1.0);
+    case SourceRG8:
+        return vec4(LoadByte(offset) / 255.0, LoadByte(offset + 1) / 255.0, 0.0, 1.0);
+    case SourceRGB8:
+        return vec4(vec3(LoadByte(offset), LoadByte(offset + 1), LoadByte(offset + 2)) / 255.0, 1.0);
+    case SourceBGR8:
+        return vec4(vec3(LoadByte(offset + 2), LoadByte(offset + 1), LoadByte(offset)) / 255.0, 1.0);
+    case SourceRGBA8:
+        return unpackUnorm4x8(SourceWords[texel]);
+    case SourceBGRA8:
+        return unpackUnorm4x8(SourceWords[texel]).bgra;
+    case SourceRGB16F:
+        return vec4(
+                unpackHalf2x16(LoadHalf(offset)).x,
+                unpackHalf2x16(LoadHalf(offset + 2)).x,
+                unpackHalf2x16(LoadHalf(offset + 4)).x,
+                1.0);
+    case SourceRGBA16F:
+        return vec4(
+                unpackHalf2x16(SourceWords[2 * texel]),
+                unpackHalf2x16(SourceWords[2 * texel + 1]));
+    case SourceRGB32F:
+        return vec4(
+                uintBitsToFloat(SourceWords[3 * texel]),
+                uintBitsToFloat(SourceWords[3 * texel + 1]),
+                uintBitsToFloat(SourceWords[3 * texel + 2]),
+                1.0);
+    case SourceRGBA32F:
+        return uintBitsToFloat(uvec4(
+                SourceWords[4 * texel],
+                SourceWords[4 * texel + 1],
+                SourceWords[4 * texel + 2],
+                SourceWords[4 * texel + 3]));
+    case SourceR5G6B5:
+    {
+        const uint value = LoadHalf(offset);
+        return vec4((value >> 11) / 31.0, ((value >> 5) & 0x3F) / 63.0, (value & 0x1F) / 31.0, 1.0);
+    }
+    case SourceR4G4B4A4:
+    {
+        const uint value = LoadHalf(offset);
+        return vec4(uvec4(value >> 12, value >> 8, value >> 4, value) & 0xF) / 15.0;
+    }
+    case SourceA2B10G10R10:
+    {
+        const uint value = SourceWords[texel];
+        return vec4(
+                vec3(uvec3(value, value >> 10, value >> 20) & 0x3FF) / 1023.0,
+                (value >> 30) / 3.0);
+    }
+    default:
+        return vec4(0.0, 0.0, 0.0, 1.0);
+    }
+}
+
+float Select(
+    const vec4 value,
+    const uint channel)
+{
+    switch (channel)
+    {
+    case ChannelZero:
+        return 0.0;
+    case ChannelOne:
+        return 1.0;
+    default:
+        return value[channel];
+    }
+}
+
+vec3 EncodeSRGB(const vec3 linear)
+{
+    const vec3 value = clamp(linear, 0.0, 1.0);
+    return mix(
+            1.055 * pow(value, vec3(1.0 / 2.4)) - 0.055,
+            12.92 * value,
+            lessThanEqual(value, vec3(0.0031308)));
+}
+
+void main()
+{
+    const uint texel = gl_GlobalInvocationID.x;
+    if (texel >= TexelCount) { return; }
+
+    const vec4 loaded = Load(texel);
+    vec4 value = vec4(
+                    Select(loaded, Swizzle & 0xF),
+                    Select(loaded, (Swizzle >> 4) & 0xF),
+                    Select(loaded, (Swizzle >> 8) & 0xF),
+                    Select(loaded, (Swizzle >> 12) & 0xF));
+    if (IsEncoded != 0) { value.rgb = EncodeSRGB(value.rgb); }
+
+    switch (DestinationFormat)
+    {
+    case DestinationRGBA8:
+        DestinationWords[texel] = packUnorm4x8(value);
+        break;
+    case DestinationBGRA8:
+        DestinationWords[texel] = packUnorm4x8(value.bgra);
+        break;
+    case DestinationRGBA16F:
+        DestinationWords[2 * texel] = packHalf2x16(value.rg);
+        DestinationWords[2 * texel + 1] = packHalf2x16(value.ba);
+        break;
+    case DestinationRGBA32F:
+        DestinationWords[4 * texel] = floatBitsToUint(value.r);
+        DestinationWords[4 * texel + 1] = floatBitsToUint(value.g);
+        DestinationWords[4 * texel + 2] = floatBitsToUint(value.b);
+        DestinationWords[4 * texel + 3] = floatBitsToUint(value.a);
+        break;
+    }
+}
@@ -0,0 +1,152 @@
+#version 460
+
+// Generates the whole mip chain of a 2D image array in a single dispatch,
+// after AMD's single pass downsampler. Every group reduces a 64x64 tile of
+// level 0 down to a single texel of level 6, keeping the levels in between
+// in shared memory. The last group to finish a layer, found through a
+// global atomic counter, then reduces level 6 (at most 64x64, since level
+// 0 is at most 4096x4096) down to level 12 the same way.
+// Groups are (ceil(width / 64), ceil(height / 64), layers).
+// The levels are declared without a format, so the same shader reads and
+// writes any float, unorm or snorm format the device can store to that way.
+
+const uint GroupSize = 256;
+const uint MaxLevels = 13;
+const uint LevelsPerPass = 6;
+
+const uint FilterAverage = 0;
+const uint FilterMin = 1;
+const uint FilterMax = 2;
+const uint FilterNearest = 3;
+
+layout(local_size_x = 256) in;
+
+// levels past the last one are bound to it, but never accessed
+layout(set = 0, binding = 0) uniform coherent image2DArray Levels[MaxLevels];
+layout(std430, set = 0, binding = 1) coherent buffer Counters { uint Counter[]; }; // one per layer, cleared to 0
+
+layout(push_constant) uniform Parameters {
+    uint LevelCount;
+    uint GroupsPerLayer;
+    uint Filter;
+};
+
+shared vec4 Reduced[16][16];
+shared uint IsLastGroup;
+
+vec4 Reduce(
+    const vec4 a,
+    const vec4 b,
+    const vec4 c,
+    const vec4 d)
+{
+    switch (Filter)
+    {
+    case FilterMin:
+        return min(min(a, b), min(c, d));
+    case FilterMax:
+        return max(max(a, b), max(c, d));
+    case FilterNearest:
+        return a;
+    default:
+        return (a + b + c + d) * 0.25;
+    }
+}
+
+// Past the edges the last row or column is repeated
+vec4 Load(
+    const uint  level,
+    const ivec2 texel,
+    const int   layer)
+{
+    const ivec2 size = imageSize(Levels[level]).xy;
+    return imageLoad(Levels[level], ivec3(min(texel, size - 1), layer));
+}
+
+void Store(
+    const uint  level,
+    const ivec2 texel,
+    const int   layer,
+    const vec4  value)
+{
+    if (all(lessThan(texel, imageSize(Levels[level]).xy)))
+    {
+        imageStore(Levels[level], ivec3(texel, layer), value);
+    }
+}
+
+vec4 Downsample(
+    const uint  level,
+    const ivec2 texel,
+    const int   layer)
+{
+    return Reduce(
+            Load(level - 1, 2 * texel, layer),
+            Load(level - 1, 2 * texel + ivec2(1, 0), layer),
+            Load(level - 1, 2 * texel + ivec2(0, 1), layer),
+            Load(level - 1, 2 * texel + ivec2(1, 1), layer));
+}
+
+// Reduces the 64x64 tile of source to the following LevelsPerPass levels
+void DownsampleTile(
+    const uint  source,
+    const ivec2 tile,
+    const int   layer)
+{
+    const ivec2 invocation = ivec2(gl_LocalInvocationIndex % 16, gl_LocalInvocationIndex / 16);
+
+    // every invocation reduces a 4x4 block of source to 2x2 texels, and
+    // those to the 1 texel of the level after
+    vec4 block[4];
+    for (int i = 0; i < 4; i++)
+    {
+        const ivec2 texel = tile * 32 + invocation * 2 + ivec2(i % 2, i / 2);
+        block[i] = Downsample(source + 1, texel, layer);
+        if (source + 1 < LevelCount) { Store(source + 1, texel, layer, block[i]); }
+    }
+    const vec4 value = Reduce(block[0], block[1], block[2], block[3]);
+    if (source + 2 < LevelCount) { Store(source + 2, tile * 16 + invocation, layer, value); }
+    Reduced[invocation.y][invocation.x] = value;
+
+    // the rest halve the invocations that take part at every level
+    for (uint level = source + 3, width = 8; level <= source + LevelsPerPass; level++, width /= 2)
+    {
+        barrier();
+
+        const bool isReducing = all(lessThan(invocation, ivec2(width)));
+        vec4 reduced = vec4(0.0);
+        if (isReducing)
+        {
+            reduced = Reduce(
+                        Reduced[2 * invocation.y][2 * invocation.x],
+                        Reduced[2 * invocation.y][2 * invocation.x + 1],
+                        Reduced[2 * invocation.y + 1][2 * invocation.x],
+                        Reduced[2 * invocation.y + 1][2 * invocation.x + 1]);
+            if (level < LevelCount) { Store(level, tile * int(width) + invocation, layer, reduced); }
+        }
+        barrier();
+
+        if (isReducing) { Reduced[invocation.y][invocation.x] = reduced; }
+    }
+}
+
+void main()
+{
+    const int layer = int(gl_WorkGroupID.z);
+
+    DownsampleTile(0, ivec2(gl_WorkGroupID.xy), layer);
+    if (LevelCount <= LevelsPerPass + 1) { return; }
+
+    // the writes to level 6 have to be visible to whichever group goes on
+    memoryBarrierImage();
+    barrier();
+    if (gl_LocalInvocationIndex == 0)
+    {
+        IsLastGroup = atomicAdd(Counter[layer], 1) == GroupsPerLayer - 1 ? 1 : 0;
+    }
+    barrier();
+
+    if (IsLastGroup == 0) { return; }
+    memoryBarrierImage();
+    DownsampleTile(LevelsPerPass, ivec2(0, 0), layer);
+}
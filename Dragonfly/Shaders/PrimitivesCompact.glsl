@@ -0,0 +1,134 @@
+#version 460
+#extension GL_KHR_shader_subgroup_basic : enable
+#extension GL_KHR_shader_subgroup_arithmetic : enable
+
+// Stream compaction of 32-bit elements: the ones whose flag isn't 0 are
+// written to the output in the same order, and their number to Total.
+// Where each kept element goes is a prefix sum of the flags, done in the
+// same pass with decoupled look-back, like PrimitivesScan.
+// Step 0 clears the tile states, step 1 compacts.
+
+const uint GroupSize = 256;
+const uint ItemsPerInvocation = 8;
+const uint TileSize = GroupSize * ItemsPerInvocation;
+
+const uint StateEmpty = 0;
+const uint StateAggregate = 1;
+const uint StatePrefix = 2;
+
+layout(local_size_x = 256) in;
+
+layout(std430, set = 0, binding = 0) readonly buffer Input { uint Values[]; };
+layout(std430, set = 0, binding = 1) readonly buffer Predicates { uint Flags[]; };
+layout(std430, set = 0, binding = 2) writeonly buffer Output { uint Kept[]; };
+layout(std430, set = 0, binding = 3) writeonly buffer Result { uint Total; };
+struct Tile {
+    uint State;
+    uint Aggregate;
+    uint Prefix;
+    uint Padding;
+};
+layout(std430, set = 0, binding = 4) coherent buffer Status {
+    uint TileCounter;
+    uint Padding[3];
+    Tile Tiles[];
+};
+
+layout(push_constant) uniform Parameters {
+    uint Count;
+    uint Step;
+};
+
+shared uint TileIndex;
+shared uint SubgroupSums[GroupSize];
+shared uint TileExclusive;
+
+void main()
+{
+    const uint tileCount = (Count + TileSize - 1) / TileSize;
+
+    if (Step == 0)
+    {
+        if (gl_GlobalInvocationID.x == 0) { TileCounter = 0; Total = 0; }
+        if (gl_GlobalInvocationID.x < tileCount) { Tiles[gl_GlobalInvocationID.x] = Tile(StateEmpty, 0, 0, 0); }
+        return;
+    }
+
+    if (gl_LocalInvocationIndex == 0) { TileIndex = atomicAdd(TileCounter, 1); }
+    barrier();
+    const uint tile = TileIndex;
+
+    const uint invocation = gl_SubgroupID * gl_SubgroupSize + gl_SubgroupInvocationID;
+    const uint first = tile * TileSize + invocation * ItemsPerInvocation;
+    bool isKept[ItemsPerInvocation];
+    uint invocationSum = 0;
+    for (uint i = 0; i < ItemsPerInvocation; i++)
+    {
+        isKept[i] = first + i < Count && Flags[first + i] != 0;
+        invocationSum += isKept[i] ? 1 : 0;
+    }
+
+    const uint subgroupExclusive = subgroupExclusiveAdd(invocationSum);
+    if (subgroupElect()) { SubgroupSums[gl_SubgroupID] = subgroupAdd(invocationSum); }
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0)
+    {
+        uint aggregate = 0;
+        for (uint i = 0; i < gl_NumSubgroups; i++)
+        {
+            const uint sum = SubgroupSums[i];
+            SubgroupSums[i] = aggregate;
+            aggregate += sum;
+        }
+
+        uint exclusive = 0;
+        if (tile == 0)
+        {
+            Tiles[0].Prefix = aggregate;
+            memoryBarrierBuffer();
+            atomicExchange(Tiles[0].State, StatePrefix);
+        }
+        else
+        {
+            Tiles[tile].Aggregate = aggregate;
+            memoryBarrierBuffer();
+            atomicExchange(Tiles[tile].State, StateAggregate);
+
+            int previous = int(tile) - 1;
+            while (previous >= 0)
+            {
+                const uint state = atomicAdd(Tiles[previous].State, 0);
+                if (state == StateEmpty) { continue; }
+
+                memoryBarrierBuffer();
+                if (state == StatePrefix)
+                {
+                    exclusive += Tiles[previous].Prefix;
+                    break;
+                }
+                exclusive += Tiles[previous].Aggregate;
+                previous--;
+            }
+
+            Tiles[tile].Prefix = exclusive + aggregate;
+            memoryBarrierBuffer();
+            atomicExchange(Tiles[tile].State, StatePrefix);
+        }
+        TileExclusive = exclusive;
+
+        // the last tile knows how many were kept in total
+        if (tile == tileCount - 1) { Total = exclusive + aggregate; }
+    }
+    barrier();
+
+    uint destination = TileExclusive + SubgroupSums[gl_SubgroupID] + subgroupExclusive;
+    for (uint i = 0; i < ItemsPerInvocation; i++)
+    {
+        if (isKept[i])
+        {
+            Kept[destination] = Values[first + i];
+            destination++;
+        }
+    }
+}
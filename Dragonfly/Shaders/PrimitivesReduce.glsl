@@ -0,0 +1,50 @@
+#version 460
+#extension GL_KHR_shader_subgroup_basic : enable
+#extension GL_KHR_shader_subgroup_arithmetic : enable
+
+// Sums of the segments of an array of 32-bit unsigned integers. Segment i
+// spans [Offsets[i], Offsets[i + 1]), and is reduced by group i; groups
+// are laid out in two dimensions to go past the limit of one.
+
+const uint GroupSize = 256;
+
+layout(local_size_x = 256) in;
+
+layout(std430, set = 0, binding = 0) readonly buffer Input { uint Values[]; };
+layout(std430, set = 0, binding = 1) readonly buffer Segments { uint Offsets[]; };
+layout(std430, set = 0, binding = 2) writeonly buffer Output { uint Sums[]; };
+
+layout(push_constant) uniform Parameters {
+    uint SegmentCount;
+};
+
+shared uint SubgroupSums[GroupSize];
+
+void main()
+{
+    const uint segment = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    if (segment >= SegmentCount) { return; }
+
+    const uint begin = Offsets[segment];
+    const uint end = Offsets[segment + 1];
+
+    uint sum = 0;
+    for (uint i = begin + gl_LocalInvocationIndex; i < end; i += GroupSize)
+    {
+        sum += Values[i];
+    }
+
+    sum = subgroupAdd(sum);
+    if (subgroupElect()) { SubgroupSums[gl_SubgroupID] = sum; }
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0)
+    {
+        uint total = 0;
+        for (uint i = 0; i < gl_NumSubgroups; i++)
+        {
+            total += SubgroupSums[i];
+        }
+        Sums[segment] = total;
+    }
+}
@@ -0,0 +1,134 @@
+#version 460
+#extension GL_KHR_shader_subgroup_basic : enable
+#extension GL_KHR_shader_subgroup_arithmetic : enable
+
+// Prefix sum of 32-bit unsigned integers in a single pass over the input,
+// with decoupled look-back: every tile publishes its total as soon as it
+// knows it, and its inclusive prefix once its predecessors are known, so
+// a tile rarely waits for more than the one before it.
+// Step 0 clears the tile states, step 1 scans.
+
+const uint GroupSize = 256;
+const uint ItemsPerInvocation = 8;
+const uint TileSize = GroupSize * ItemsPerInvocation;
+
+const uint StateEmpty = 0;
+const uint StateAggregate = 1; // the tile's total is known
+const uint StatePrefix = 2; // the total of every element up to the tile's end is known
+
+layout(local_size_x = 256) in;
+
+layout(std430, set = 0, binding = 0) readonly buffer Input { uint Values[]; };
+layout(std430, set = 0, binding = 1) writeonly buffer Output { uint Sums[]; };
+// a tile's values are written before its state, and read after it,
+// so a state never refers to a value that isn't visible yet
+struct Tile {
+    uint State;
+    uint Aggregate;
+    uint Prefix;
+    uint Padding;
+};
+layout(std430, set = 0, binding = 2) coherent buffer Status {
+    uint TileCounter;
+    uint Padding[3];
+    Tile Tiles[];
+};
+
+layout(push_constant) uniform Parameters {
+    uint Count;
+    uint Step;
+    uint IsInclusive;
+};
+
+shared uint TileIndex;
+shared uint SubgroupSums[GroupSize];
+shared uint TileExclusive;
+
+void main()
+{
+    const uint tileCount = (Count + TileSize - 1) / TileSize;
+
+    if (Step == 0)
+    {
+        if (gl_GlobalInvocationID.x == 0) { TileCounter = 0; }
+        if (gl_GlobalInvocationID.x < tileCount) { Tiles[gl_GlobalInvocationID.x] = Tile(StateEmpty, 0, 0, 0); }
+        return;
+    }
+
+    // tiles are numbered in the order groups start, not by group ID, so
+    // that a tile only ever waits on tiles that are already running
+    if (gl_LocalInvocationIndex == 0) { TileIndex = atomicAdd(TileCounter, 1); }
+    barrier();
+    const uint tile = TileIndex;
+
+    // elements follow subgroup order, which the subgroup scan depends on
+    const uint invocation = gl_SubgroupID * gl_SubgroupSize + gl_SubgroupInvocationID;
+    const uint first = tile * TileSize + invocation * ItemsPerInvocation;
+    uint values[ItemsPerInvocation];
+    uint invocationSum = 0;
+    for (uint i = 0; i < ItemsPerInvocation; i++)
+    {
+        values[i] = first + i < Count ? Values[first + i] : 0;
+        invocationSum += values[i];
+    }
+
+    const uint subgroupExclusive = subgroupExclusiveAdd(invocationSum);
+    if (subgroupElect()) { SubgroupSums[gl_SubgroupID] = subgroupAdd(invocationSum); }
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0)
+    {
+        uint aggregate = 0;
+        for (uint i = 0; i < gl_NumSubgroups; i++)
+        {
+            const uint sum = SubgroupSums[i];
+            SubgroupSums[i] = aggregate;
+            aggregate += sum;
+        }
+
+        uint exclusive = 0;
+        if (tile == 0)
+        {
+            Tiles[0].Prefix = aggregate;
+            memoryBarrierBuffer();
+            atomicExchange(Tiles[0].State, StatePrefix);
+        }
+        else
+        {
+            Tiles[tile].Aggregate = aggregate;
+            memoryBarrierBuffer();
+            atomicExchange(Tiles[tile].State, StateAggregate);
+
+            int previous = int(tile) - 1;
+            while (previous >= 0)
+            {
+                const uint state = atomicAdd(Tiles[previous].State, 0);
+                if (state == StateEmpty) { continue; }
+
+                memoryBarrierBuffer();
+                if (state == StatePrefix)
+                {
+                    exclusive += Tiles[previous].Prefix;
+                    break;
+                }
+                exclusive += Tiles[previous].Aggregate;
+                previous--;
+            }
+
+            Tiles[tile].Prefix = exclusive + aggregate;
+            memoryBarrierBuffer();
+            atomicExchange(Tiles[tile].State, StatePrefix);
+        }
+        TileExclusive = exclusive;
+    }
+    barrier();
+
+    uint sum = TileExclusive + SubgroupSums[gl_SubgroupID] + subgroupExclusive;
+    for (uint i = 0; i < ItemsPerInvocation; i++)
+    {
+        if (first + i >= Count) { break; }
+
+        Sums[first + i] = IsInclusive != 0 ? sum + values[i] : sum;
+        sum += values[i];
+    }
+}
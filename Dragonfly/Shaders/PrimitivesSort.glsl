@@ -0,0 +1,216 @@
+#version 460
+#extension GL_KHR_shader_subgroup_basic : enable
+#extension GL_KHR_shader_subgroup_ballot : enable
+
+// Stable least significant digit radix sort of 32-bit unsigned keys, with
+// optional 32-bit values, in 8-bit digits. Every pass moves each key once
+// ("onesweep"): the offsets of a digit in a tile come from decoupled
+// look-back over the tiles before it, on top of a histogram of the whole
+// input that is built once for all four passes.
+// Step 0 clears the scratch, step 1 builds the histograms, step 2 turns
+// them into offsets and steps 3 to 6 are the passes. Even passes move
+// A to B and odd ones B to A, so the result ends up in A.
+
+const uint GroupSize = 256;
+const uint ItemsPerInvocation = 8;
+const uint TileSize = GroupSize * ItemsPerInvocation;
+
+const uint Radix = 256;
+const uint Passes = 4;
+
+// a tile state is a digit count with the state in the top 2 bits,
+// so that both are published with one atomic
+const uint StateEmpty = 0;
+const uint StateAggregate = 1; // the tile's count of the digit is known
+const uint StatePrefix = 2; // the count of the digit up to the tile's end is known
+const uint CountMask = 0x3FFFFFFF;
+
+layout(local_size_x = 256) in;
+
+layout(std430, set = 0, binding = 0) buffer KeysA { uint KeysInA[]; };
+layout(std430, set = 0, binding = 1) buffer KeysB { uint KeysInB[]; };
+layout(std430, set = 0, binding = 2) buffer ValuesA { uint ValuesInA[]; };
+layout(std430, set = 0, binding = 3) buffer ValuesB { uint ValuesInB[]; };
+layout(std430, set = 0, binding = 4) coherent buffer Scratch {
+    uint GlobalHistogram[Passes * Radix]; // the offsets of every digit, after step 2
+    uint TileCounters[Passes];
+    uint TileStates[]; // by pass, then tile, then digit
+};
+
+layout(push_constant) uniform Parameters {
+    uint Count;
+    uint Step;
+    uint HasValues;
+};
+
+shared uint TileIndex;
+shared uint LocalHistogram[Passes * Radix];
+shared uint DigitOffsets[Radix];
+
+void Clear(const uint tileCount)
+{
+    const uint i = gl_GlobalInvocationID.x;
+    if (i < Passes * Radix) { GlobalHistogram[i] = 0; }
+    if (i < Passes) { TileCounters[i] = 0; }
+    if (i < Passes * tileCount * Radix) { TileStates[i] = 0; }
+}
+
+void BuildHistograms()
+{
+    for (uint i = gl_LocalInvocationIndex; i < Passes * Radix; i += GroupSize)
+    {
+        LocalHistogram[i] = 0;
+    }
+    barrier();
+
+    for (uint i = 0; i < ItemsPerInvocation; i++)
+    {
+        const uint index = gl_WorkGroupID.x * TileSize + i * GroupSize + gl_LocalInvocationIndex;
+        if (index >= Count) { break; }
+
+        const uint key = KeysInA[index];
+        for (uint pass = 0; pass < Passes; pass++)
+        {
+            atomicAdd(LocalHistogram[pass * Radix + ((key >> (pass * 8)) & 0xFF)], 1);
+        }
+    }
+    barrier();
+
+    for (uint i = gl_LocalInvocationIndex; i < Passes * Radix; i += GroupSize)
+    {
+        if (LocalHistogram[i] != 0) { atomicAdd(GlobalHistogram[i], LocalHistogram[i]); }
+    }
+}
+
+void BuildOffsets()
+{
+    if (gl_LocalInvocationIndex >= Passes) { return; }
+
+    uint offset = 0;
+    for (uint digit = 0; digit < Radix; digit++)
+    {
+        const uint count = GlobalHistogram[gl_LocalInvocationIndex * Radix + digit];
+        GlobalHistogram[gl_LocalInvocationIndex * Radix + digit] = offset;
+        offset += count;
+    }
+}
+
+void Sort(const uint pass, const uint tileCount)
+{
+    const uint shift = pass * 8;
+    const bool isFromA = (pass & 1) == 0;
+
+    if (gl_LocalInvocationIndex == 0) { TileIndex = atomicAdd(TileCounters[pass], 1); }
+    LocalHistogram[gl_LocalInvocationIndex] = 0;
+    barrier();
+    const uint tile = TileIndex;
+
+    // elements follow subgroup order, so that ranking keeps the sort stable
+    const uint invocation = gl_SubgroupID * gl_SubgroupSize + gl_SubgroupInvocationID;
+
+    uint keys[ItemsPerInvocation];
+    uint values[ItemsPerInvocation];
+    uint ranks[ItemsPerInvocation];
+    for (uint i = 0; i < ItemsPerInvocation; i++)
+    {
+        const uint index = tile * TileSize + i * GroupSize + invocation;
+        const bool isValid = index < Count;
+
+        keys[i] = isValid ? (isFromA ? KeysInA[index] : KeysInB[index]) : 0;
+        values[i] = isValid && HasValues != 0 ? (isFromA ? ValuesInA[index] : ValuesInB[index]) : 0;
+        const uint digit = (keys[i] >> shift) & 0xFF;
+
+        // the invocations of the subgroup whose keys have the same digit
+        uvec4 peers = subgroupBallot(isValid);
+        for (uint bit = 0; bit < 8; bit++)
+        {
+            const bool isSet = ((digit >> bit) & 1) != 0;
+            const uvec4 ballot = subgroupBallot(isSet);
+            peers &= isSet ? ballot : ~ballot;
+        }
+        const uint peerRank = subgroupBallotExclusiveBitCount(peers);
+        const bool isLeader = isValid && subgroupBallotFindLSB(peers) == gl_SubgroupInvocationID;
+
+        // subgroups take turns, so that earlier elements get lower ranks
+        for (uint subgroup = 0; subgroup < gl_NumSubgroups; subgroup++)
+        {
+            if (subgroup == gl_SubgroupID)
+            {
+                const uint base = isValid ? LocalHistogram[digit] : 0;
+                subgroupBarrier();
+                if (isLeader) { LocalHistogram[digit] = base + subgroupBallotBitCount(peers); }
+                ranks[i] = base + peerRank;
+            }
+            barrier();
+        }
+    }
+
+    // every invocation looks back for one digit
+    const uint digit = gl_LocalInvocationIndex;
+    const uint count = LocalHistogram[digit];
+    const uint states = pass * tileCount * Radix;
+
+    uint exclusive = 0;
+    if (tile == 0)
+    {
+        atomicExchange(TileStates[states + digit], (StatePrefix << 30) | count);
+    }
+    else
+    {
+        atomicExchange(TileStates[states + tile * Radix + digit], (StateAggregate << 30) | count);
+
+        int previous = int(tile) - 1;
+        while (previous >= 0)
+        {
+            const uint state = atomicAdd(TileStates[states + uint(previous) * Radix + digit], 0);
+            if ((state >> 30) == StateEmpty) { continue; }
+
+            exclusive += state & CountMask;
+            if ((state >> 30) == StatePrefix) { break; }
+            previous--;
+        }
+
+        atomicExchange(TileStates[states + tile * Radix + digit], (StatePrefix << 30) | (exclusive + count));
+    }
+    DigitOffsets[digit] = GlobalHistogram[pass * Radix + digit] + exclusive;
+    barrier();
+
+    for (uint i = 0; i < ItemsPerInvocation; i++)
+    {
+        const uint index = tile * TileSize + i * GroupSize + invocation;
+        if (index >= Count) { break; }
+
+        const uint destination = DigitOffsets[(keys[i] >> shift) & 0xFF] + ranks[i];
+        if (isFromA)
+        {
+            KeysInB[destination] = keys[i];
+            if (HasValues != 0) { ValuesInB[destination] = values[i]; }
+        }
+        else
+        {
+            KeysInA[destination] = keys[i];
+            if (HasValues != 0) { ValuesInA[destination] = values[i]; }
+        }
+    }
+}
+
+void main()
+{
+    const uint tileCount = (Count + TileSize - 1) / TileSize;
+
+    switch (Step)
+    {
+    case 0:
+        Clear(tileCount);
+        break;
+    case 1:
+        BuildHistograms();
+        break;
+    case 2:
+        BuildOffsets();
+        break;
+    default:
+        Sort(Step - 3, tileCount);
+        break;
+    }
+}
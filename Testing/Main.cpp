@@ -4,21 +4,30 @@
 #include <thread>
 
 #include <atomic>
+#include <array>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <new>
+#include <fstream>
+#include <vector>
+#include <span>
 
 #include "../Dragonfly/Dragonfly.hxx"
 
 class Rendering {
-    Dfl::Hardware::Device& Device;
+    Dfl::Hardware::Device&   Device;
+    Dfl::Hardware::Profiler& Profiler;
 
     std::atomic<bool>            Close{ false };
 public:
-    Rendering(Dfl::Hardware::Device& device);
+    Rendering(Dfl::Hardware::Device& device, Dfl::Hardware::Profiler& profiler);
 
           void operator() ();
     const bool ShouldClose() const noexcept { return this->Close; };
 };
 
-Rendering::Rendering(Dfl::Hardware::Device& device) : Device(device) {}
+Rendering::Rendering(Dfl::Hardware::Device& device, Dfl::Hardware::Profiler& profiler) : Device(device), Profiler(profiler) {}
 
 void Rendering::operator() () 
 {
@@ -35,6 +44,7 @@ void Rendering::operator() ()
         const Dfl::Graphics::Renderer::Info renderInfo{
             .AssocDevice{ this->Device },
             .AssocWindow{ window },
+            .pProfiler{ &this->Profiler },
         };
         Dfl::Graphics::Renderer renderer(renderInfo);
 
@@ -83,6 +93,21 @@ int main() {
         std::cout << "\nYour device's name is " << device.GetCharacteristics().Name << "\n";
         std::cout << "\nThe session can also tell your device's name: " << session.GetDeviceName(0) << "\n";
 
+        // built twice, to compare a cold with a warm pipeline cache: the first
+        // builder saves its cache when destroyed, and the second loads it
+        for (uint32_t pass{ 0 }; pass < 2; pass++)
+        {
+            auto start{ std::chrono::steady_clock::now() };
+            const Dfl::Graphics::PipelineBuilder::Info builderInfo{
+                .Device{ device },
+            };
+            Dfl::Graphics::PipelineBuilder builder(builderInfo);
+            builder.Build(Dfl::Graphics::PipelineBuilder::State{ });
+            auto duration{ std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start) };
+
+            std::cout << "Building the test pipeline with a " << (builder.WasCacheWarm() ? "warm" : "cold") << " cache took " << duration.count() << " us\n";
+        }
+
         const Dfl::Memory::Block::Info memoryInfo{
             .Device{ device },
             .Size{ Dfl::MakeBinaryPower(20) }
@@ -95,8 +120,378 @@ int main() {
             .Options{ Dfl::NoOptions }
         };
         Dfl::Memory::GenericBuffer buffer(bufferInfo);
+        std::cout << "The buffer is " << (buffer.IsMapped() ? "mapped, so transfers skip staging" : "written to through staging") << "\n";
+
+        {
+            // a host array the device copies from directly, if it can import it
+            constexpr uint64_t hostSize{ Dfl::MakeBinaryPower(16) };
+            void* pHostArray{ ::operator new(hostSize, std::align_val_t{ hostSize }) };
+            {
+                const Dfl::Memory::GenericBuffer::Info hostInfo{
+                    .MemoryBlock{ memory },
+                    .Size{ hostSize },
+                    .Options{ Dfl::NoOptions },
+                    .pHostMemory{ pHostArray }
+                };
+                Dfl::Memory::GenericBuffer hostBuffer(hostInfo);
+                std::cout << "The host array was " << (hostBuffer.IsImported() ? "imported" : "copied to a buffer") << "\n";
+
+                auto copy{ buffer.CopyFrom(hostBuffer, 0, 0, buffer.GetSize()) };
+                while (copy.GetState() != Dfl::Generics::Job<Dfl::Memory::GenericBuffer::Error>::RoutineState::Done) { copy.Resume(); }
+            }
+            ::operator delete(pHostArray, std::align_val_t{ hostSize });
+        }
+
+        {
+            // sparse updates from a dynamic array, in one command
+            const std::vector<uint32_t> values{ 1, 2, 3, 4, 5, 6, 7, 8 };
+            const std::vector<Dfl::Memory::GenericBuffer::Region> regions{
+                { .SourceOffset{ 0 }, .DstOffset{ 0 }, .Size{ 8 } },
+                { .SourceOffset{ 8 }, .DstOffset{ 256 }, .Size{ 16 } },
+                { .SourceOffset{ 24 }, .DstOffset{ 1000 }, .Size{ 8 } } };
+            auto scatter{ buffer.Write(std::as_bytes(std::span(values)), regions) };
+            while (scatter.GetState() != Dfl::Generics::Job<Dfl::Memory::GenericBuffer::Error>::RoutineState::Done) { scatter.Resume(); }
+        }
+
+        try {
+            // a clear and a copy in one submission, without going through the host
+            const Dfl::Memory::Transfer::Info transferInfo{
+                .Device{ device }
+            };
+            Dfl::Memory::Transfer transfer(transferInfo);
+
+            const Dfl::Memory::GenericBuffer::Info copyInfo{
+                .MemoryBlock{ memory },
+                .AccessingQueueFamilies{ transfer.GetFamily() },
+                .Size{ 1024 }
+            };
+            Dfl::Memory::GenericBuffer source(copyInfo);
+            Dfl::Memory::GenericBuffer copy(copyInfo);
+
+            auto batch{ transfer.Fill(source, 0, source.GetSize(), 0xFFFFFFFF)
+                                .Copy(source, copy, 0, 0, source.GetSize())
+                                .Submit() };
+            while (batch.GetState() != Dfl::Generics::Job<Dfl::Memory::Transfer::Error>::RoutineState::Done) { batch.Resume(); }
+        }
+        catch (Dfl::Error::Generic& err) {
+            std::wcout << L"Skipping the transfers: " << err.GetError() << "\n";
+        }
+
+        try {
+            // how fast the primitives go through their input, e.g. on a software driver
+            constexpr uint32_t elementCount{ 1 << 18 };
+            using Keys = std::array<uint32_t, elementCount>;
+
+            const Dfl::Memory::Block::Info benchMemoryInfo{
+                .Device{ device },
+                .Size{ Dfl::MakeBinaryPower(24) }
+            };
+            Dfl::Memory::Block benchMemory(benchMemoryInfo);
+
+            const Dfl::Memory::GenericBuffer::Info keysInfo{
+                .MemoryBlock{ benchMemory },
+                .Size{ sizeof(Keys) },
+                .Options{ VK_BUFFER_USAGE_STORAGE_BUFFER_BIT }
+            };
+            Dfl::Memory::GenericBuffer keys(keysInfo);
+            Dfl::Memory::GenericBuffer temporary(keysInfo);
+            Dfl::Memory::GenericBuffer results(keysInfo);
+
+            auto pKeys{ std::make_unique<Keys>() };
+            std::mt19937 random(0);
+            for (auto& key : *pKeys) { key = random(); }
+            auto upload{ keys.Write(*pKeys, 0, 0) };
+            while (upload.GetState() != Dfl::Generics::Job<Dfl::Memory::GenericBuffer::Error>::RoutineState::Done) { upload.Resume(); }
 
-        Rendering render(device);
+            const Dfl::Simulation::Primitives::Info primitivesInfo{
+                .Device{ device },
+                .MemoryBlock{ benchMemory },
+                .MaxElements{ elementCount },
+            };
+            Dfl::Simulation::Primitives primitives(primitivesInfo);
+
+            const auto measure{ [&](const char* name, auto&& run) {
+                auto start{ std::chrono::steady_clock::now() };
+                auto job{ run() };
+                while (job.GetState() != Dfl::Generics::Job<Dfl::Simulation::Primitives::Error>::RoutineState::Done) { job.Resume(); }
+                const double seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+
+                std::cout << name << ": " << elementCount / seconds / 1e6 << " million elements/s\n";
+            } };
+            measure("Scan", [&]() { return primitives.Scan(keys, results, elementCount); });
+            measure("Compaction", [&]() { return primitives.Compact(keys, keys, temporary, results, elementCount); });
+            measure("Radix sort", [&]() { return primitives.Sort(keys, temporary, elementCount); });
+        }
+        catch (Dfl::Error::Generic& err) {
+            std::wcout << L"Skipping the primitives benchmark: " << err.GetError() << "\n";
+        }
+
+        try {
+            // how fast a file goes from the disk to a buffer
+            constexpr uint64_t fileSize{ Dfl::MakeBinaryPower(25) };
+            {
+                std::ofstream file("stream.bin", std::ios::binary);
+                const std::vector<char> contents(fileSize, 1);
+                file.write(contents.data(), contents.size());
+            }
+
+            const Dfl::Memory::Block::Info streamMemoryInfo{
+                .Device{ device },
+                .Size{ 2 * fileSize }
+            };
+            Dfl::Memory::Block streamMemory(streamMemoryInfo);
+
+            const Dfl::Memory::Stream::Info streamInfo{
+                .Device{ device },
+                .File{ L"stream.bin" }
+            };
+            Dfl::Memory::Stream stream(streamInfo);
+
+            const Dfl::Memory::GenericBuffer::Info assetInfo{
+                .MemoryBlock{ streamMemory },
+                .AccessingQueueFamilies{ stream.GetFamily() },
+                .Size{ fileSize }
+            };
+            Dfl::Memory::GenericBuffer asset(assetInfo);
+
+            auto load{ stream.Load(asset, 0, 0, fileSize) };
+            while (load.GetState() != Dfl::Generics::Job<Dfl::Memory::Stream::Error>::RoutineState::Done) { load.Resume(); }
+            std::cout << "Streaming: " << stream.GetStatistics().GetThroughput() << " GB/s\n";
+        }
+        catch (Dfl::Error::Generic& err) {
+            std::wcout << L"Skipping the streaming benchmark: " << err.GetError() << "\n";
+        }
+
+        try {
+            // how fast, and how well, raw textures are compressed on the host, and
+            // the upload of the result
+            constexpr uint32_t textureSize{ 256 };
+            std::vector<std::byte> texture(4 * textureSize * textureSize);
+            std::mt19937 random(0);
+            for (uint32_t y{ 0 }; y < textureSize; y++)
+            {
+                for (uint32_t x{ 0 }; x < textureSize; x++)
+                {
+                    const std::array<uint32_t, 4> texel{ x, y, (x + y) / 2 + random() % 16, 255 - (x ^ y) };
+                    for (uint32_t c{ 0 }; c < 4; c++) { texture[4 * (y * textureSize + x) + c] = static_cast<std::byte>(texel[c] & 0xFF); }
+                }
+            }
+
+            Dfl::Memory::Encoder encoder({ });
+            const std::array<std::pair<const char*, Dfl::Memory::Encoder::Format>, 4> formats{ {
+                { "BC1", Dfl::Memory::Encoder::Format::BC1 },
+                { "BC3", Dfl::Memory::Encoder::Format::BC3 },
+                { "BC5", Dfl::Memory::Encoder::Format::BC5 },
+                { "BC7", Dfl::Memory::Encoder::Format::BC7 } } };
+            std::vector<std::byte> encoded{ };
+            for (const auto& [name, format] : formats)
+            {
+                encoded = encoder.Encode(texture, textureSize, textureSize, format);
+                std::cout << name << " encoding: " << encoder.GetStatistics().GetThroughput() << " MPixels/s, "
+                          << Dfl::Memory::Encoder::GetPSNR(texture, encoded, textureSize, textureSize, format) << " dB\n";
+            }
+
+            const Dfl::Memory::Buffer<Dfl::Memory::StorageType::Image>::Info textureInfo{
+                .MemoryBlock{ memory },
+                .Size{ textureSize, textureSize, 1 },
+                .Format{ Dfl::Memory::Encoder::GetFormat(Dfl::Memory::Encoder::Format::BC7) },
+                .Options{ VK_IMAGE_USAGE_SAMPLED_BIT }
+            };
+            Dfl::Memory::Buffer<Dfl::Memory::StorageType::Image> compressed(textureInfo);
+            auto upload{ compressed.Write(encoded, 0) };
+            while (upload.GetState() != Dfl::Generics::Job<Dfl::Memory::Buffer<Dfl::Memory::StorageType::Image>::Error>::RoutineState::Done) { upload.Resume(); }
+
+            // and a patch of it again, straight out of the encoded rows
+            const uint64_t rowPitch{ (textureSize / 4) * Dfl::Memory::Encoder::GetBlockSize(Dfl::Memory::Encoder::Format::BC7) };
+            auto patch{ compressed.Write(
+                            std::span(encoded).subspan((128 / 4) * rowPitch + (64 / 4) * 16),
+                            rowPitch,
+                            { .Offset{ 64, 128, 0 }, .Extent{ 64, 32, 1 } }) };
+            while (patch.GetState() != Dfl::Generics::Job<Dfl::Memory::Buffer<Dfl::Memory::StorageType::Image>::Error>::RoutineState::Done) { patch.Resume(); }
+        }
+        catch (Dfl::Error::Generic& err) {
+            std::wcout << L"Skipping the encoding benchmark: " << err.GetError() << "\n";
+        }
+
+        try {
+            // raw RGB texels, expanded and converted on the device
+            constexpr uint32_t textureSize{ 256 };
+            std::vector<std::byte> texture(3 * textureSize * textureSize);
+            for (uint64_t i{ 0 }; i < texture.size(); i++) { texture[i] = static_cast<std::byte>(i & 0xFF); }
+
+            const Dfl::Memory::Converter::Info converterInfo{
+                .Device{ device }
+            };
+            Dfl::Memory::Converter converter(converterInfo);
+
+            const Dfl::Memory::Buffer<Dfl::Memory::StorageType::Image>::Info textureInfo{
+                .MemoryBlock{ memory },
+                .Size{ textureSize, textureSize, 1 },
+                .Format{ VK_FORMAT_R8G8B8A8_SRGB },
+                .Options{ VK_IMAGE_USAGE_SAMPLED_BIT }
+            };
+            Dfl::Memory::Buffer<Dfl::Memory::StorageType::Image> converted(textureInfo);
+            auto conversion{ converter.Write(
+                                texture,
+                                0,
+                                { .Format{ Dfl::Memory::Converter::Source::RGB8 } },
+                                converted,
+                                { .Extent{ textureSize, textureSize, 1 } }) };
+            while (conversion.GetState() != Dfl::Generics::Job<Dfl::Memory::Converter::Error>::RoutineState::Done) { conversion.Resume(); }
+        }
+        catch (Dfl::Error::Generic& err) {
+            std::wcout << L"Skipping the conversion: " << err.GetError() << "\n";
+        }
+
+        try {
+            // a thousand icons of assorted sizes, in a single image and a single upload
+            const Dfl::Memory::Atlas::Info atlasInfo{
+                .MemoryBlock{ memory },
+                .PageSize{ 1024 },
+                .Pages{ 2 }
+            };
+            Dfl::Memory::Atlas atlas(atlasInfo);
+
+            std::mt19937 random(0);
+            std::vector<std::byte> icon(4 * 64 * 64);
+            uint32_t placed{ 0 };
+            for (uint32_t i{ 0 }; i < 1000; i++)
+            {
+                const uint32_t width{ 8 + random() % 56 };
+                const uint32_t height{ 8 + random() % 56 };
+                std::fill(icon.begin(), icon.end(), static_cast<std::byte>(i & 0xFF));
+                if (atlas.Add(icon, width, height).has_value()) { placed++; }
+            }
+            auto upload{ atlas.Upload() };
+            while (upload.GetState() != Dfl::Generics::Job<Dfl::Memory::Atlas::Image::Error>::RoutineState::Done) { upload.Resume(); }
+            std::cout << "Atlas: " << placed << " icons, " << 100 * atlas.GetOccupancy() << "% occupied\n";
+        }
+        catch (Dfl::Error::Generic& err) {
+            std::wcout << L"Skipping the atlas: " << err.GetError() << "\n";
+        }
+
+        try {
+            // a 16K texture in 64 MB, of which only the mip tail is in at first;
+            // shaders sampling it request the rest through the feedback buffer
+            const Dfl::Memory::VirtualTexture::Info virtualInfo{
+                .Device{ device },
+                .Size{ 16384, 16384 },
+                .MipLevels{ 15 },
+                .Budget{ 64 * 1024 * 1024 },
+                .Loader{ [](const Dfl::Memory::VirtualTexture::Tile& tile, std::span<std::byte> texels) {
+                            std::fill(texels.begin(), texels.end(), static_cast<std::byte>(16 * tile.Level));
+                            return true; } }
+            };
+            Dfl::Memory::VirtualTexture texture(virtualInfo);
+            auto update{ texture.Update(renderer.GetTimeline()) };
+            while (update.GetState() != Dfl::Generics::Job<Dfl::Memory::VirtualTexture::Error>::RoutineState::Done) { update.Resume(); }
+            std::cout << "Virtual texture: " << texture.GetTileSize()[0] << "x" << texture.GetTileSize()[1]
+                      << " tiles, mip tail from level " << texture.GetMipTailLevel()
+                      << ", " << texture.GetStatistics().Resident << " resident\n";
+        }
+        catch (Dfl::Error::Generic& err) {
+            std::wcout << L"Skipping the virtual texture: " << err.GetError() << "\n";
+        }
+
+        try {
+            // the same mesh in two levels: uploaded once, copied on the device
+            // once, and skipped when the first level loads again
+            Dfl::Memory::UploadCache cache({ });
+            const Dfl::Memory::GenericBuffer::Info meshInfo{
+                .MemoryBlock{ memory },
+                .Size{ 4096 }
+            };
+            Dfl::Memory::GenericBuffer firstLevel(meshInfo);
+            Dfl::Memory::GenericBuffer secondLevel(meshInfo);
+
+            std::vector<std::byte> mesh(meshInfo.Size, std::byte{ 0x3F });
+            for (const Dfl::Memory::GenericBuffer* level : { &firstLevel, &secondLevel, &firstLevel })
+            {
+                auto write{ cache.Write(*level, mesh, 0) };
+                while (write.GetState() != Dfl::Generics::Job<Dfl::Memory::GenericBuffer::Error>::RoutineState::Done) { write.Resume(); }
+            }
+            const Dfl::Memory::UploadCache::Statistics cacheStatistics{ cache.GetStatistics() };
+            std::cout << "Upload cache: " << cacheStatistics.Hits << " hits, " << cacheStatistics.DeviceCopies << " device copies, "
+                      << cacheStatistics.Misses << " misses, " << 100 * cacheStatistics.GetSavings() << "% of the bytes not uploaded\n";
+        }
+        catch (Dfl::Error::Generic& err) {
+            std::wcout << L"Skipping the upload cache: " << err.GetError() << "\n";
+        }
+
+        try {
+            // GB/s of every copy kernel to and from mapped memory; the block is
+            // only mapped on UMA devices or with resizable BAR, so host memory
+            // stands in for it otherwise
+            const Dfl::Memory::Block::Info mappedInfo{
+                .Device{ device },
+                .Size{ Dfl::MakeBinaryPower(24) }
+            };
+            Dfl::Memory::Block mapped(mappedInfo);
+            std::vector<std::byte> host(mappedInfo.Size, std::byte{ 0x5A });
+            std::vector<std::byte> stand(mapped.GetMap() == nullptr ? mappedInfo.Size : 0);
+            void* pMapped{ mapped.GetMap() != nullptr ? mapped.GetMap() : stand.data() };
+
+            std::cout << "Copies to and from " << (mapped.GetMap() != nullptr ? "mapped device" : "host") << " memory:\n";
+            const char* kernelNames[]{ "memcpy", "SSE4.1", "AVX2", "AVX-512" };
+            for (uint32_t kernel{ 0 }; kernel <= static_cast<uint32_t>(Dfl::Memory::Copier::GetKernel()); kernel++)
+            {
+                constexpr uint32_t repeats{ 16 };
+                const auto start{ std::chrono::steady_clock::now() };
+                for (uint32_t i{ 0 }; i < repeats; i++)
+                {
+                    Dfl::Memory::Copier::ToMapped(pMapped, host.data(), host.size(), static_cast<Dfl::Memory::Copier::Kernel>(kernel));
+                }
+                const auto written{ std::chrono::steady_clock::now() };
+                for (uint32_t i{ 0 }; i < repeats; i++)
+                {
+                    Dfl::Memory::Copier::FromMapped(host.data(), pMapped, host.size(), static_cast<Dfl::Memory::Copier::Kernel>(kernel));
+                }
+                const auto read{ std::chrono::steady_clock::now() };
+
+                const double bytes{ static_cast<double>(repeats) * host.size() };
+                std::cout << "  " << kernelNames[kernel]
+                          << ": " << bytes / std::chrono::duration<double>(written - start).count() / 1e9 << " GB/s writing, "
+                          << bytes / std::chrono::duration<double>(read - written).count() / 1e9 << " GB/s reading\n";
+            }
+        }
+        catch (Dfl::Error::Generic& err) {
+            std::wcout << L"Skipping the copy benchmark: " << err.GetError() << "\n";
+        }
+
+        try {
+            // camera data, written every frame to the copy the device isn't
+            // reading, and bound by its dynamic offset
+            struct Camera {
+                float View[16];
+                float Projection[16];
+            };
+            const Dfl::Memory::DynamicBuffer::Info cameraInfo{
+                .Device{ device },
+                .Size{ sizeof(Camera) },
+                .Frames{ Dfl::Graphics::Renderer::FramesInFlight }
+            };
+            Dfl::Memory::DynamicBuffer camera(cameraInfo);
+
+            Camera frameCamera{ };
+            for (uint32_t frame{ 0 }; frame < 4; frame++)
+            {
+                frameCamera.View[12] = static_cast<float>(frame);
+                camera.Write(frameCamera, 0);
+                std::cout << "Dynamic buffer: frame " << frame << " written at dynamic offset " << camera.GetDynamicOffset() << "\n";
+                camera.Advance();
+            }
+        }
+        catch (Dfl::Error::Generic& err) {
+            std::wcout << L"Skipping the dynamic buffer: " << err.GetError() << "\n";
+        }
+
+        const Dfl::Hardware::Profiler::Info profilerInfo{
+            .Device{ device },
+            .DoStatistics{ true },
+        };
+        Dfl::Hardware::Profiler profiler(profilerInfo);
+
+        Rendering render(device, profiler);
 
         std::thread renderThread(std::ref(render));
 
@@ -118,6 +513,13 @@ int main() {
 
         renderThread.join();
 
+        profiler.Collect();
+        profiler.ExportChromeTrace(L"Dragonfly.Trace.json");
+
+        const auto counters{ profiler.GetCounters() };
+        std::cout << "Frame " << counters.Frame << ": " << counters.DrawCalls << " draws, " << counters.BarriersIssued << " barriers, "
+                  << counters.Statistics.FragmentInvocations << " fragment invocations\n";
+
         TestStruct test2{};
         auto task2{ buffer.Read(test2, 0, 0) };
         task2.Resume();